@@ -0,0 +1,821 @@
+/*
+ * Copyright (c) 2016, Xerox Corporation (Xerox) and Palo Alto Research Center, Inc (PARC)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL XEROX OR PARC BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * ################################################################################
+ * #
+ * # PATENT NOTICE
+ * #
+ * # This software is distributed under the BSD 2-clause License (see LICENSE
+ * # file).  This BSD License does not make any patent claims and as such, does
+ * # not act as a patent grant.  The purpose of this section is for each contributor
+ * # to define their intentions with respect to intellectual property.
+ * #
+ * # Each contributor to this source code is encouraged to state their patent
+ * # claims and licensing mechanisms for any contributions made. At the end of
+ * # this section contributors may each make their own statements.  Contributor's
+ * # claims and grants only apply to the pieces (source code, programs, text,
+ * # media, etc) that they have contributed directly to this software.
+ * #
+ * # There is no guarantee that this section is complete, up to date or accurate. It
+ * # is up to the contributors to maintain their portion of this section and up to
+ * # the user of the software to verify any claims herein.
+ * #
+ * # Do not remove this header notification.  The contents of this section must be
+ * # present in all distributions of the software.  You may only modify your own
+ * # intellectual property statements.  Please provide contact information.
+ *
+ * - Palo Alto Research Center, Inc
+ * This software distribution does not grant any rights to patents owned by Palo
+ * Alto Research Center, Inc (PARC). Rights to these patents are available via
+ * various mechanisms. As of January 2016 PARC has committed to FRAND licensing any
+ * intellectual property used by its contributions to this software. You may
+ * contact PARC at cipo@parc.com for more information or visit http://www.ccnx.org
+ */
+/**
+ * @author Christopher A. Wood, Palo Alto Research Center (Xerox PARC)
+ * @copyright (c) 2016, Xerox Corporation (Xerox) and Palo Alto Research Center, Inc (PARC).  All rights reserved.
+ */
+#include <LongBow/runtime.h>
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include <parc/algol/parc_Chunker.h>
+#include <parc/algol/parc_FileChunker.h>
+#include <parc/algol/parc_LinkedList.h>
+#include <parc/security/parc_CryptoHasher.h>
+#include <parc/security/parc_Security.h>
+
+#include <ccnx/common/ccnx_Interest.h>
+#include <ccnx/common/ccnx_Manifest.h>
+#include <ccnx/transport/common/transport_MetaMessage.h>
+#include <ccnx/common/internal/ccnx_WireFormatMessage.h>
+
+#include "ccnxFileRepo_Common.h"
+#include "ccnxFileRepo_Cache.h"
+#include "ccnxFileRepo_EncodedMessage.h"
+#include "ccnxFileRepo_ManifestBuilder.h"
+#include "ccnxFileRepo_ManifestFetcher.h"
+#include "ccnxFileRepo_NameTable.h"
+#include "ccnxFileRepo_Responder.h"
+#include "ccnxFileRepo_Sha256.h"
+#include "ccnxFileRepo_WorkerPool.h"
+
+/**
+ * The name under which the benchmarked file is published.
+ */
+static const char *_ccnxFileRepoBenchmark_Name = "ccnx:/ccnxFileRepo/benchmark";
+
+typedef struct {
+    CCNxFileRepoResponder *responder;
+    size_t answered;
+} _BenchmarkContext;
+
+static double
+_ccnxFileRepoBenchmark_Now(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+/**
+ * Collect the digest of every chunk below `manifest`, including the manifests themselves.
+ */
+static void
+_ccnxFileRepoBenchmark_CollectDigests(CCNxFileRepoCache *cache, const CCNxManifest *manifest, PARCLinkedList *digests)
+{
+    for (size_t i = 0; i < ccnxManifest_GetNumberOfHashGroups(manifest); i++) {
+        CCNxManifestHashGroup *group = ccnxManifest_GetHashGroupByIndex(manifest, i);
+        for (size_t j = 0; j < ccnxManifestHashGroup_GetNumberOfPointers(group); j++) {
+            CCNxManifestHashGroupPointer *pointer = ccnxManifestHashGroup_GetPointerAtIndex(group, j);
+            const PARCBuffer *digest = ccnxManifestHashGroupPointer_GetDigest(pointer);
+            parcLinkedList_Append(digests, digest);
+
+            if (ccnxManifestHashGroupPointer_GetType(pointer) == CCNxManifestHashGroupPointerType_Manifest) {
+                PARCBuffer *wireFormat = ccnxFileRepoCache_CreateWireEncodedMessageWithDigest(cache, (PARCBuffer *) digest);
+                if (wireFormat != NULL) {
+                    CCNxMetaMessage *child = ccnxMetaMessage_CreateFromWireFormatBuffer(wireFormat);
+                    _ccnxFileRepoBenchmark_CollectDigests(cache, ccnxMetaMessage_GetManifest(child), digests);
+                    ccnxMetaMessage_Release(&child);
+                    parcBuffer_Release(&wireFormat);
+                }
+            }
+        }
+        ccnxManifestHashGroup_Release(&group);
+    }
+}
+
+static void
+_ccnxFileRepoBenchmark_Answer(void *context, void *item)
+{
+    _BenchmarkContext *benchmarkContext = context;
+    size_t section = ccnxFileRepoResponder_BeginViews(benchmarkContext->responder);
+    CCNxMetaMessage *response = ccnxFileRepoResponder_CreateResponse(benchmarkContext->responder, item);
+    if (response != NULL) {
+        __atomic_add_fetch(&benchmarkContext->answered, 1, __ATOMIC_RELAXED);
+        ccnxMetaMessage_Release(&response);
+    }
+    ccnxFileRepoResponder_EndViews(benchmarkContext->responder, section);
+}
+
+/**
+ * Answer every interest `rounds` times with `threadCount` workers (or on this thread if
+ * `threadCount` is 0) and return the number of interests answered per second.
+ */
+static double
+_ccnxFileRepoBenchmark_RunServe(CCNxFileRepoResponder *responder, CCNxInterest **interests, size_t interestCount,
+                                size_t rounds, size_t threadCount, size_t queueDepth)
+{
+    _BenchmarkContext context = { .responder = responder, .answered = 0 };
+
+    double start = _ccnxFileRepoBenchmark_Now();
+    if (threadCount == 0) {
+        for (size_t round = 0; round < rounds; round++) {
+            for (size_t i = 0; i < interestCount; i++) {
+                _ccnxFileRepoBenchmark_Answer(&context, interests[i]);
+            }
+        }
+    } else {
+        CCNxFileRepoWorkerPool *pool = ccnxFileRepoWorkerPool_Create(threadCount, queueDepth, _ccnxFileRepoBenchmark_Answer, &context);
+        for (size_t round = 0; round < rounds; round++) {
+            for (size_t i = 0; i < interestCount; i++) {
+                ccnxFileRepoWorkerPool_Submit(pool, interests[i]);
+            }
+        }
+        ccnxFileRepoWorkerPool_Finish(pool);
+        ccnxFileRepoWorkerPool_Release(&pool);
+    }
+    double elapsed = _ccnxFileRepoBenchmark_Now() - start;
+
+    if (context.answered != rounds * interestCount) {
+        fprintf(stderr, "Only %zu of %zu interests were answered\n", context.answered, rounds * interestCount);
+    }
+    return context.answered / elapsed;
+}
+
+/**
+ * Publish `fileName` in the repo at `repoBase` and measure how many interests for its chunks
+ * are answered per second, doubling the number of worker threads up to `maxThreads`. This
+ * exercises everything the server does per interest except the portal itself.
+ */
+static int
+_ccnxFileRepoBenchmark_Serve(const char *fileName, char *repoBase, CCNxFileRepoCacheStorage storage, size_t chunkSize,
+                             size_t chunkCacheSize, size_t maxThreads, size_t queueDepth, size_t rounds)
+{
+    CCNxFileRepoCache *cache = ccnxFileRepoCache_CreateWithStorage(repoBase, chunkSize, storage);
+    if (cache == NULL) {
+        fprintf(stderr, "Could not open the repo in %s\n", repoBase);
+        return EXIT_FAILURE;
+    }
+    ccnxFileRepoCache_SetChunkCacheCapacity(cache, chunkCacheSize);
+
+    CCNxName *name = ccnxName_CreateFromCString(_ccnxFileRepoBenchmark_Name);
+    CCNxManifest *root = ccnxFileRepoCache_PublishFile(cache, name, fileName);
+    if (root == NULL) {
+        fprintf(stderr, "Could not publish %s\n", fileName);
+        ccnxName_Release(&name);
+        ccnxFileRepoCache_Release(&cache);
+        return EXIT_FAILURE;
+    }
+
+    CCNxFileRepoNameTable *table = ccnxFileRepoNameTable_Create();
+    ccnxFileRepoNameTable_Add(table, name, root);
+    CCNxFileRepoResponder *responder = ccnxFileRepoResponder_Create(cache, table);
+
+    PARCLinkedList *digests = parcLinkedList_Create();
+    _ccnxFileRepoBenchmark_CollectDigests(cache, root, digests);
+
+    size_t interestCount = parcLinkedList_Size(digests);
+    CCNxInterest **interests = parcMemory_Allocate(interestCount * sizeof(CCNxInterest *));
+    for (size_t i = 0; i < interestCount; i++) {
+        interests[i] = ccnxInterest_Create(name, 4000, NULL, parcLinkedList_GetAtIndex(digests, i));
+    }
+    parcLinkedList_Release(&digests);
+
+    printf("%zu chunks, %zu rounds, store %s, chunk cache %zu bytes\n", interestCount, rounds,
+           storage == CCNxFileRepoCacheStorage_Files ? "files" : (storage == CCNxFileRepoCacheStorage_Pack ? "pack" : "mmap"),
+           chunkCacheSize);
+    printf("%8s %16s %8s\n", "threads", "interests/s", "speedup");
+
+    double baseline = _ccnxFileRepoBenchmark_RunServe(responder, interests, interestCount, rounds, 0, queueDepth);
+    printf("%8s %16.0f %8.2f\n", "inline", baseline, 1.0);
+    // Double the number of threads each time, finishing with exactly maxThreads.
+    size_t threadCount = 1;
+    while (threadCount <= maxThreads) {
+        double rate = _ccnxFileRepoBenchmark_RunServe(responder, interests, interestCount, rounds, threadCount, queueDepth);
+        printf("%8zu %16.0f %8.2f\n", threadCount, rate, rate / baseline);
+
+        if (threadCount == maxThreads) {
+            break;
+        }
+        threadCount = (threadCount * 2 < maxThreads) ? threadCount * 2 : maxThreads;
+    }
+
+    for (size_t i = 0; i < interestCount; i++) {
+        ccnxInterest_Release(&interests[i]);
+    }
+    parcMemory_Deallocate(&interests);
+
+    char *cacheString = ccnxFileRepoCache_ToString(cache);
+    printf("%s\n", cacheString);
+    parcMemory_Deallocate(&cacheString);
+
+    ccnxFileRepoResponder_Release(&responder);
+    ccnxFileRepoNameTable_Release(&table);
+    ccnxManifest_Release(&root);
+    ccnxName_Release(&name);
+    ccnxFileRepoCache_Release(&cache);
+    return EXIT_SUCCESS;
+}
+
+static void
+_ccnxFileRepoBenchmark_HashMessage(void *context, CCNxFileRepoEncodedMessage *message)
+{
+    parcCryptoHasher_UpdateBuffer((PARCCryptoHasher *) context, ccnxFileRepoEncodedMessage_GetWireFormat(message));
+}
+
+/**
+ * Build the manifests of `fileName` with `threadCount` builder threads, storing the elapsed
+ * time in `elapsed` and the time each stage of the build was busy in `times`, and return a
+ * SHA-256 digest of every message built, in order.
+ */
+static PARCCryptoHash *
+_ccnxFileRepoBenchmark_RunBuild(const char *fileName, const CCNxName *name, size_t chunkSize, size_t threadCount,
+                                size_t fanout, double *elapsed, CCNxManifestBuilderStageTimes *times)
+{
+    PARCFile *file = parcFile_Create(fileName);
+    PARCFileChunker *fileChunker = parcFileChunker_Create(file, chunkSize);
+    PARCChunker *chunker = parcChunker_Create(fileChunker, PARCFileChunkerAsChunker);
+    parcFileChunker_Release(&fileChunker);
+    parcFile_Release(&file);
+
+    CCNxManifestBuilder *builder = ccnxManifestBuilder_Create();
+    ccnxManifestBuilder_SetChunkSize(builder, chunkSize);
+    ccnxManifestBuilder_SetThreadCount(builder, threadCount);
+    ccnxManifestBuilder_SetFanout(builder, fanout);
+    memset(times, 0, sizeof(*times));
+    ccnxManifestBuilder_SetStageTimes(builder, times);
+
+    PARCCryptoHasher *hasher = parcCryptoHasher_Create(PARCCryptoHashType_SHA256);
+    parcCryptoHasher_Init(hasher);
+
+    double start = _ccnxFileRepoBenchmark_Now();
+    CCNxFileRepoEncodedMessage *root =
+        ccnxManifestBuilder_StreamManifest(builder, chunker, name, _ccnxFileRepoBenchmark_HashMessage, hasher);
+    *elapsed = _ccnxFileRepoBenchmark_Now() - start;
+
+    PARCCryptoHash *result = parcCryptoHasher_Finalize(hasher);
+    parcCryptoHasher_Release(&hasher);
+    ccnxFileRepoEncodedMessage_Release(&root);
+    ccnxManifestBuilder_Release(&builder);
+    parcChunker_Release(&chunker);
+    return result;
+}
+
+/**
+ * Print the throughput of a build and how busy each of its stages was.
+ */
+static void
+_ccnxFileRepoBenchmark_PrintBuild(size_t threadCount, double megabytes, double elapsed, double baseline,
+                                  const CCNxManifestBuilderStageTimes *times)
+{
+    double nanoseconds = (times->elapsedNanoseconds > 0) ? (double) times->elapsedNanoseconds : 1.0;
+    double encodeNanoseconds = (times->encodeThreadNanoseconds > 0) ? (double) times->encodeThreadNanoseconds : 1.0;
+    printf("%8zu %16.1f %8.2f %7.0f%% %7.0f%% %7.0f%%\n", threadCount, megabytes / elapsed, baseline / elapsed,
+           100.0 * times->readNanoseconds / nanoseconds, 100.0 * times->encodeNanoseconds / encodeNanoseconds,
+           100.0 * times->writeNanoseconds / nanoseconds);
+}
+
+/**
+ * Measure how fast the manifests of `fileName` are built, doubling the number of builder
+ * threads up to `maxThreads`, and check that every thread count builds the same messages.
+ * The read, encode and write columns are how busy each stage of the build pipeline was, so
+ * the stage that is busy all the time is the one that limits the build.
+ */
+static int
+_ccnxFileRepoBenchmark_Build(const char *fileName, size_t chunkSize, size_t maxThreads, size_t fanout)
+{
+    struct stat statbuf;
+    if (stat(fileName, &statbuf) != 0) {
+        fprintf(stderr, "Could not stat %s\n", fileName);
+        return EXIT_FAILURE;
+    }
+    double megabytes = statbuf.st_size / (1024.0 * 1024.0);
+
+    CCNxName *name = ccnxName_CreateFromCString(_ccnxFileRepoBenchmark_Name);
+    int status = EXIT_SUCCESS;
+
+    printf("%.1f MB\n", megabytes);
+    printf("%8s %16s %8s %8s %8s %8s\n", "threads", "MB/s", "speedup", "read", "encode", "write");
+
+    CCNxManifestBuilderStageTimes times;
+    double baseline;
+    PARCCryptoHash *expected = _ccnxFileRepoBenchmark_RunBuild(fileName, name, chunkSize, 1, fanout, &baseline, &times);
+    _ccnxFileRepoBenchmark_PrintBuild(1, megabytes, baseline, baseline, &times);
+
+    size_t threadCount = 1;
+    while (threadCount < maxThreads) {
+        threadCount = (threadCount * 2 < maxThreads) ? threadCount * 2 : maxThreads;
+
+        double elapsed;
+        PARCCryptoHash *messages = _ccnxFileRepoBenchmark_RunBuild(fileName, name, chunkSize, threadCount, fanout, &elapsed,
+                                                                   &times);
+        _ccnxFileRepoBenchmark_PrintBuild(threadCount, megabytes, elapsed, baseline, &times);
+
+        if (!parcCryptoHash_Equals(expected, messages)) {
+            fprintf(stderr, "%zu threads built different messages than 1 thread\n", threadCount);
+            status = EXIT_FAILURE;
+        }
+        parcCryptoHash_Release(&messages);
+    }
+
+    parcCryptoHash_Release(&expected);
+    ccnxName_Release(&name);
+    return status;
+}
+
+/**
+ * The number of chunk-sized messages hashed per round by the 'sha' benchmark.
+ */
+#define _ccnxFileRepoBenchmark_ShaMessages 256
+
+/**
+ * Print the single-core throughput of hashing every benchmark message `rounds` times, in GB/s.
+ */
+static void
+_ccnxFileRepoBenchmark_PrintShaRate(const char *label, double elapsed, size_t chunkSize, size_t rounds)
+{
+    double gigabytes = (double) chunkSize * _ccnxFileRepoBenchmark_ShaMessages * rounds / 1e9;
+    printf("%-20s %12.2f\n", label, gigabytes / elapsed);
+}
+
+/**
+ * Measure how fast a single core hashes chunk-sized messages with each SHA-256 engine this
+ * processor supports, and with the PARC crypto hasher the repo used before, and check that every
+ * engine computes the same digests.
+ */
+static int
+_ccnxFileRepoBenchmark_Sha(size_t chunkSize, size_t rounds)
+{
+    uint8_t *storage = parcMemory_Allocate(chunkSize * _ccnxFileRepoBenchmark_ShaMessages);
+    for (size_t i = 0; i < chunkSize * _ccnxFileRepoBenchmark_ShaMessages; i++) {
+        storage[i] = (uint8_t) (i * 2654435761u >> 13);
+    }
+
+    const uint8_t *data[_ccnxFileRepoBenchmark_ShaMessages];
+    size_t lengths[_ccnxFileRepoBenchmark_ShaMessages];
+    for (size_t i = 0; i < _ccnxFileRepoBenchmark_ShaMessages; i++) {
+        data[i] = storage + i * chunkSize;
+        lengths[i] = chunkSize;
+    }
+
+    uint8_t (*expected)[CCNxFileRepoSha256_DigestLength] =
+        parcMemory_Allocate(_ccnxFileRepoBenchmark_ShaMessages * CCNxFileRepoSha256_DigestLength);
+    uint8_t (*digests)[CCNxFileRepoSha256_DigestLength] =
+        parcMemory_Allocate(_ccnxFileRepoBenchmark_ShaMessages * CCNxFileRepoSha256_DigestLength);
+
+    CCNxFileRepoSha256Engine defaultEngine = ccnxFileRepoSha256_GetEngine();
+    ccnxFileRepoSha256_SetEngine(CCNxFileRepoSha256Engine_Portable);
+    ccnxFileRepoSha256_DigestMany(_ccnxFileRepoBenchmark_ShaMessages, data, lengths, expected);
+
+    int status = EXIT_SUCCESS;
+    printf("%zu byte messages, default engine %s\n", chunkSize, ccnxFileRepoSha256_GetEngineName(defaultEngine));
+    printf("%-20s %12s\n", "engine", "GB/s");
+
+    PARCCryptoHasher *hasher = parcCryptoHasher_Create(PARCCryptoHashType_SHA256);
+    double start = _ccnxFileRepoBenchmark_Now();
+    for (size_t round = 0; round < rounds; round++) {
+        for (size_t i = 0; i < _ccnxFileRepoBenchmark_ShaMessages; i++) {
+            parcCryptoHasher_Init(hasher);
+            parcCryptoHasher_UpdateBytes(hasher, data[i], lengths[i]);
+            PARCCryptoHash *hash = parcCryptoHasher_Finalize(hasher);
+            parcCryptoHash_Release(&hash);
+        }
+    }
+    _ccnxFileRepoBenchmark_PrintShaRate("parc", _ccnxFileRepoBenchmark_Now() - start, chunkSize, rounds);
+    parcCryptoHasher_Release(&hasher);
+
+    for (CCNxFileRepoSha256Engine engine = CCNxFileRepoSha256Engine_Portable; engine <= CCNxFileRepoSha256Engine_Avx512; engine++) {
+        if (!ccnxFileRepoSha256_SetEngine(engine)) {
+            continue;
+        }
+
+        memset(digests, 0, _ccnxFileRepoBenchmark_ShaMessages * CCNxFileRepoSha256_DigestLength);
+        start = _ccnxFileRepoBenchmark_Now();
+        for (size_t round = 0; round < rounds; round++) {
+            ccnxFileRepoSha256_DigestMany(_ccnxFileRepoBenchmark_ShaMessages, data, lengths, digests);
+        }
+        _ccnxFileRepoBenchmark_PrintShaRate(ccnxFileRepoSha256_GetEngineName(engine), _ccnxFileRepoBenchmark_Now() - start,
+                                            chunkSize, rounds);
+
+        if (memcmp(digests, expected, _ccnxFileRepoBenchmark_ShaMessages * CCNxFileRepoSha256_DigestLength) != 0) {
+            fprintf(stderr, "%s computed different digests than %s\n", ccnxFileRepoSha256_GetEngineName(engine),
+                    ccnxFileRepoSha256_GetEngineName(CCNxFileRepoSha256Engine_Portable));
+            status = EXIT_FAILURE;
+        }
+    }
+
+    ccnxFileRepoSha256_SetEngine(defaultEngine);
+    start = _ccnxFileRepoBenchmark_Now();
+    for (size_t round = 0; round < rounds; round++) {
+        for (size_t i = 0; i < _ccnxFileRepoBenchmark_ShaMessages; i++) {
+            ccnxFileRepoSha256_Digest(data[i], lengths[i], digests[i]);
+        }
+    }
+    _ccnxFileRepoBenchmark_PrintShaRate("one at a time", _ccnxFileRepoBenchmark_Now() - start, chunkSize, rounds);
+
+    parcMemory_Deallocate(&digests);
+    parcMemory_Deallocate(&expected);
+    parcMemory_Deallocate(&storage);
+    return status;
+}
+
+/**
+ * A stand-in for the network between the client and the repo: every interest is answered at
+ * once by the responder, and the response arrives a round trip after the interest was sent,
+ * unless the interest or the response is dropped, each with probability `lossRate`.
+ */
+typedef struct {
+    CCNxFileRepoResponder *responder;
+    double roundTrip;
+    double lossRate;
+    unsigned int seed;
+
+    // The responses on their way, and when each arrives
+    CCNxMetaMessage **responses;
+    double *arrivals;
+    size_t count;
+    size_t capacity;
+
+    size_t dropped;
+} _BenchmarkNetwork;
+
+static bool
+_ccnxFileRepoBenchmark_IsDropped(_BenchmarkNetwork *network)
+{
+    if (rand_r(&network->seed) < network->lossRate * ((double) RAND_MAX + 1.0)) {
+        network->dropped++;
+        return true;
+    }
+    return false;
+}
+
+static bool
+_ccnxFileRepoBenchmark_NetworkSend(void *context, CCNxMetaMessage *message)
+{
+    _BenchmarkNetwork *network = context;
+    if (_ccnxFileRepoBenchmark_IsDropped(network)) {
+        return true;
+    }
+
+    CCNxMetaMessage *response = ccnxFileRepoResponder_CreateResponse(network->responder, ccnxMetaMessage_GetInterest(message));
+    if (response == NULL) {
+        return true;
+    }
+    if (_ccnxFileRepoBenchmark_IsDropped(network)) {
+        ccnxMetaMessage_Release(&response);
+        return true;
+    }
+
+    // Decode the response, as the portal does before handing it to the client
+    PARCBuffer *wireFormat = ccnxWireFormatMessage_GetWireFormatBuffer(response);
+    CCNxMetaMessage *decoded = ccnxMetaMessage_CreateFromWireFormatBuffer(wireFormat);
+    ccnxMetaMessage_Release(&response);
+    if (decoded == NULL) {
+        return true;
+    }
+
+    if (network->count == network->capacity) {
+        size_t capacity = (network->capacity > 0) ? 2 * network->capacity : 64;
+        CCNxMetaMessage **responses = parcMemory_Allocate(capacity * sizeof(CCNxMetaMessage *));
+        double *arrivals = parcMemory_Allocate(capacity * sizeof(double));
+        if (network->count > 0) {
+            memcpy(responses, network->responses, network->count * sizeof(CCNxMetaMessage *));
+            memcpy(arrivals, network->arrivals, network->count * sizeof(double));
+            parcMemory_Deallocate(&network->responses);
+            parcMemory_Deallocate(&network->arrivals);
+        }
+        network->responses = responses;
+        network->arrivals = arrivals;
+        network->capacity = capacity;
+    }
+    network->responses[network->count] = decoded;
+    network->arrivals[network->count] = _ccnxFileRepoBenchmark_Now() + network->roundTrip;
+    network->count++;
+    return true;
+}
+
+static void
+_ccnxFileRepoBenchmark_SleepUntil(double time)
+{
+    double wait = time - _ccnxFileRepoBenchmark_Now();
+    if (wait > 0.0) {
+        struct timespec duration = { .tv_sec = (time_t) wait, .tv_nsec = (long) ((wait - (time_t) wait) * 1e9) };
+        nanosleep(&duration, NULL);
+    }
+}
+
+static CCNxMetaMessage *
+_ccnxFileRepoBenchmark_NetworkReceive(void *context, uint64_t microseconds)
+{
+    _BenchmarkNetwork *network = context;
+    double deadline = _ccnxFileRepoBenchmark_Now() + microseconds / 1e6;
+
+    size_t first = 0;
+    for (size_t i = 1; i < network->count; i++) {
+        if (network->arrivals[i] < network->arrivals[first]) {
+            first = i;
+        }
+    }
+    if (network->count == 0 || network->arrivals[first] > deadline) {
+        _ccnxFileRepoBenchmark_SleepUntil(deadline);
+        return NULL;
+    }
+
+    _ccnxFileRepoBenchmark_SleepUntil(network->arrivals[first]);
+    CCNxMetaMessage *response = network->responses[first];
+    network->count--;
+    network->responses[first] = network->responses[network->count];
+    network->arrivals[first] = network->arrivals[network->count];
+    return response;
+}
+
+/**
+ * Fetch the publication `root` through a stand-in network that loses `lossRate` of the
+ * interests and responses, check that the data matches `expected`, and print how long it took.
+ */
+static bool
+_ccnxFileRepoBenchmark_RunFetch(CCNxFileRepoResponder *responder, CCNxManifest *root, const uint8_t *expected, size_t length,
+                                double roundTrip, double lossRate, size_t maxWindow)
+{
+    _BenchmarkNetwork network = { .responder = responder, .roundTrip = roundTrip, .lossRate = lossRate, .seed = 1 };
+    CCNxFileRepoManifestFetcher *fetcher =
+        ccnxFileRepoManifestFetcher_CreateWithTransport(_ccnxFileRepoBenchmark_NetworkSend, _ccnxFileRepoBenchmark_NetworkReceive,
+                                                        &network, root);
+    ccnxFileRepoManifestFetcher_SetMaxWindow(fetcher, maxWindow);
+
+    uint8_t *data = parcMemory_AllocateAndClear(length > 0 ? length : 1);
+    bool result = true;
+
+    double start = _ccnxFileRepoBenchmark_Now();
+    size_t offset;
+    PARCBuffer *chunk;
+    while ((chunk = ccnxFileRepoManifestFetcher_NextChunk(fetcher, &offset)) != NULL) {
+        size_t chunkLength = parcBuffer_Remaining(chunk);
+        if (offset + chunkLength <= length) {
+            memcpy(data + offset, parcBuffer_Overlay(chunk, 0), chunkLength);
+        } else {
+            result = false;
+        }
+        parcBuffer_Release(&chunk);
+    }
+    double elapsed = _ccnxFileRepoBenchmark_Now() - start;
+
+    if (!ccnxFileRepoManifestFetcher_IsComplete(fetcher)) {
+        fprintf(stderr, "Gave up at %.1f%% loss\n", 100.0 * lossRate);
+        result = false;
+    } else if (!result || memcmp(data, expected, length) != 0) {
+        fprintf(stderr, "Fetched different data than the file at %.1f%% loss\n", 100.0 * lossRate);
+        result = false;
+    }
+
+    printf("%8.1f %10.3f %10.1f %10zu\n", 100.0 * lossRate, elapsed, length / (1024.0 * 1024.0) / elapsed, network.dropped);
+    char *fetcherString = ccnxFileRepoManifestFetcher_ToString(fetcher);
+    printf("    %s\n", fetcherString);
+    parcMemory_Deallocate(&fetcherString);
+
+    ccnxFileRepoManifestFetcher_Release(&fetcher);
+    for (size_t i = 0; i < network.count; i++) {
+        ccnxMetaMessage_Release(&network.responses[i]);
+    }
+    if (network.capacity > 0) {
+        parcMemory_Deallocate(&network.responses);
+        parcMemory_Deallocate(&network.arrivals);
+    }
+    parcMemory_Deallocate(&data);
+    return result;
+}
+
+/**
+ * Publish `fileName` in the repo at `repoBase` and fetch it through a stand-in network with
+ * a round trip of `roundTrip` seconds, without loss and then losing 1, 2, 4, ... percent of
+ * the interests and responses up to `maxLoss` percent, to show what loss costs in throughput
+ * and in the time the slowest chunk took.
+ */
+static int
+_ccnxFileRepoBenchmark_Fetch(const char *fileName, char *repoBase, CCNxFileRepoCacheStorage storage, size_t chunkSize,
+                             double roundTrip, size_t maxLoss, size_t maxWindow)
+{
+    FILE *file = fopen(fileName, "rb");
+    if (file == NULL) {
+        fprintf(stderr, "Could not open %s\n", fileName);
+        return EXIT_FAILURE;
+    }
+    struct stat statbuf;
+    fstat(fileno(file), &statbuf);
+    size_t length = (size_t) statbuf.st_size;
+    uint8_t *expected = parcMemory_Allocate(length > 0 ? length : 1);
+    bool isRead = (fread(expected, 1, length, file) == length);
+    fclose(file);
+    if (!isRead) {
+        fprintf(stderr, "Could not read %s\n", fileName);
+        parcMemory_Deallocate(&expected);
+        return EXIT_FAILURE;
+    }
+
+    CCNxFileRepoCache *cache = ccnxFileRepoCache_CreateWithStorage(repoBase, chunkSize, storage);
+    if (cache == NULL) {
+        fprintf(stderr, "Could not open the repo in %s\n", repoBase);
+        parcMemory_Deallocate(&expected);
+        return EXIT_FAILURE;
+    }
+
+    CCNxName *name = ccnxName_CreateFromCString(_ccnxFileRepoBenchmark_Name);
+    CCNxManifest *root = ccnxFileRepoCache_PublishFile(cache, name, fileName);
+    if (root == NULL) {
+        fprintf(stderr, "Could not publish %s\n", fileName);
+        ccnxName_Release(&name);
+        ccnxFileRepoCache_Release(&cache);
+        parcMemory_Deallocate(&expected);
+        return EXIT_FAILURE;
+    }
+
+    CCNxFileRepoNameTable *table = ccnxFileRepoNameTable_Create();
+    ccnxFileRepoNameTable_Add(table, name, root);
+    CCNxFileRepoResponder *responder = ccnxFileRepoResponder_Create(cache, table);
+
+    printf("%.1f MB, round trip %.1f ms, window %zu\n", length / (1024.0 * 1024.0), roundTrip * 1e3, maxWindow);
+    printf("%8s %10s %10s %10s\n", "loss %", "seconds", "MB/s", "dropped");
+
+    int status = EXIT_SUCCESS;
+    if (!_ccnxFileRepoBenchmark_RunFetch(responder, root, expected, length, roundTrip, 0.0, maxWindow)) {
+        status = EXIT_FAILURE;
+    }
+    // Double the loss each time, finishing with exactly maxLoss.
+    size_t loss = 1;
+    while (loss <= maxLoss) {
+        if (!_ccnxFileRepoBenchmark_RunFetch(responder, root, expected, length, roundTrip, loss / 100.0, maxWindow)) {
+            status = EXIT_FAILURE;
+        }
+
+        if (loss == maxLoss) {
+            break;
+        }
+        loss = (loss * 2 < maxLoss) ? loss * 2 : maxLoss;
+    }
+
+    ccnxFileRepoResponder_Release(&responder);
+    ccnxFileRepoNameTable_Release(&table);
+    ccnxManifest_Release(&root);
+    ccnxName_Release(&name);
+    ccnxFileRepoCache_Release(&cache);
+    parcMemory_Deallocate(&expected);
+    return status;
+}
+
+/**
+ * Display an explanation of arguments accepted by this program.
+ *
+ * @param [in] programName The name of this program.
+ */
+static void
+_ccnxFileRepoBenchmark_DisplayUsage(const char *programName)
+{
+    printf("\n%s, %s\n\n", ccnxFileRepoCommon_ProgramName, programName);
+    printf("Measure the throughput of the repo without a forwarder.\n");
+    printf("\n");
+    printf("Usage: %s [-h] [options] serve <file name> <repo path>\n", programName);
+    printf("       %s [-h] [options] build <file name>\n", programName);
+    printf("       %s [-h] [options] sha\n", programName);
+    printf("       %s [-h] [options] fetch <file name> <repo path>\n", programName);
+    printf("\n");
+    printf("   e.g. %s --threads=8 serve /path/to/file /path/to/repo\n", programName);
+    printf("\n");
+    printf("  'serve': publish the file and answer interests for all of its chunks, as the server does,\n");
+    printf("           with 1, 2, 4, ... worker threads, printing the interests answered per second\n");
+    printf("  'build': build the manifests of the file with 1, 2, 4, ... builder threads, printing the\n");
+    printf("           megabytes built per second and how busy the read, encode and write stages were,\n");
+    printf("           and checking that every run builds the same messages\n");
+    printf("  'sha': hash chunk-sized messages on one core with every SHA-256 engine the processor supports,\n");
+    printf("         printing the gigabytes hashed per second\n");
+    printf("  'fetch': publish the file and fetch it as the client does, through a stand-in network that\n");
+    printf("           loses no interests and responses, then 1, 2, 4, ... percent of them, printing the time\n");
+    printf("           taken and the fetcher's timeouts and retransmissions, and checking the data fetched\n");
+    printf("  '--threads': the largest number of worker threads to try (default: the number of processors)\n");
+    printf("  '--queue-depth': number of interests that may wait for a worker thread (default %zu)\n",
+           ccnxFileRepoCommon_ServerQueueDepth);
+    printf("  '--chunk-size': size of the chunks the file is cut into (default %zu)\n", ccnxFileRepoCommon_ServerChunkSize);
+    printf("  '--fanout': build balanced manifest trees of this fanout (default 0: skewed)\n");
+    printf("  '--rounds': number of times every chunk is requested (default 10)\n");
+    printf("  '--store': files, pack or mmap, as for the server (default files)\n");
+    printf("  '--loss': the largest percentage of interests and responses the 'fetch' network loses (default 5)\n");
+    printf("  '--rtt': the round trip of the 'fetch' network in milliseconds (default 20)\n");
+    printf("  '--window': the most interests the fetcher keeps outstanding (default %zu)\n", ccnxFileRepoCommon_ClientMaxWindow);
+    printf("  '--cache-size': memory budget of the in-memory chunk cache (default %zuM)\n",
+           ccnxFileRepoCommon_ServerChunkCacheSize / (1024 * 1024));
+    printf("  '-h' will show this help\n\n");
+}
+
+int
+main(int argc, char *argv[argc])
+{
+    int status = EXIT_FAILURE;
+
+    char *commandArgs[argc];
+    int commandArgCount = 0;
+    char *commandOptions[argc];
+    int commandOptionCount = 0;
+    bool needToShowUsage = false;
+    bool shouldExit = false;
+
+    status = ccnxFileRepoCommon_ProcessCommandLineArguments(argc, argv, &commandArgCount, commandArgs,
+                                                            &commandOptionCount, commandOptions,
+                                                            &needToShowUsage, &shouldExit);
+
+    if (needToShowUsage) {
+        _ccnxFileRepoBenchmark_DisplayUsage(argv[0]);
+    }
+
+    if (shouldExit) {
+        exit(status);
+    }
+
+    long processorCount = sysconf(_SC_NPROCESSORS_ONLN);
+    size_t maxThreads = ccnxFileRepoCommon_GetSizeOption(commandOptionCount, commandOptions, "threads",
+                                                         processorCount > 0 ? (size_t) processorCount : 1);
+    size_t queueDepth = ccnxFileRepoCommon_GetSizeOption(commandOptionCount, commandOptions, "queue-depth",
+                                                         ccnxFileRepoCommon_ServerQueueDepth);
+    size_t rounds = ccnxFileRepoCommon_GetSizeOption(commandOptionCount, commandOptions, "rounds", 10);
+    size_t chunkSize = ccnxFileRepoCommon_GetSizeOption(commandOptionCount, commandOptions, "chunk-size",
+                                                        ccnxFileRepoCommon_ServerChunkSize);
+    size_t chunkCacheSize = ccnxFileRepoCommon_GetSizeOption(commandOptionCount, commandOptions, "cache-size",
+                                                             ccnxFileRepoCommon_ServerChunkCacheSize);
+
+    CCNxFileRepoCacheStorage storage = CCNxFileRepoCacheStorage_Files;
+    const char *store = ccnxFileRepoCommon_GetOption(commandOptionCount, commandOptions, "store");
+    if (store != NULL && strcmp(store, "pack") == 0) {
+        storage = CCNxFileRepoCacheStorage_Pack;
+    } else if (store != NULL && strcmp(store, "mmap") == 0) {
+        storage = CCNxFileRepoCacheStorage_MappedPack;
+    } else if (store != NULL && strcmp(store, "files") != 0) {
+        _ccnxFileRepoBenchmark_DisplayUsage(argv[0]);
+        exit(EXIT_FAILURE);
+    }
+
+    if (commandArgCount == 3 && strcmp(commandArgs[0], "serve") == 0) {
+        parcSecurity_Init();
+        status = _ccnxFileRepoBenchmark_Serve(commandArgs[1], commandArgs[2], storage, chunkSize, chunkCacheSize,
+                                              maxThreads, queueDepth, rounds);
+        parcSecurity_Fini();
+    } else if (commandArgCount == 2 && strcmp(commandArgs[0], "build") == 0) {
+        parcSecurity_Init();
+        size_t fanout = ccnxFileRepoCommon_GetSizeOption(commandOptionCount, commandOptions, "fanout", 0);
+        status = _ccnxFileRepoBenchmark_Build(commandArgs[1], chunkSize, maxThreads, fanout);
+        parcSecurity_Fini();
+    } else if (commandArgCount == 3 && strcmp(commandArgs[0], "fetch") == 0) {
+        parcSecurity_Init();
+        size_t maxLoss = ccnxFileRepoCommon_GetSizeOption(commandOptionCount, commandOptions, "loss", 5);
+        size_t roundTrip = ccnxFileRepoCommon_GetSizeOption(commandOptionCount, commandOptions, "rtt", 20);
+        size_t maxWindow = ccnxFileRepoCommon_GetSizeOption(commandOptionCount, commandOptions, "window",
+                                                            ccnxFileRepoCommon_ClientMaxWindow);
+        status = _ccnxFileRepoBenchmark_Fetch(commandArgs[1], commandArgs[2], storage, chunkSize, roundTrip / 1e3, maxLoss,
+                                              maxWindow);
+        parcSecurity_Fini();
+    } else if (commandArgCount == 1 && strcmp(commandArgs[0], "sha") == 0) {
+        parcSecurity_Init();
+        status = _ccnxFileRepoBenchmark_Sha(chunkSize, rounds);
+        parcSecurity_Fini();
+    } else {
+        status = EXIT_FAILURE;
+        _ccnxFileRepoBenchmark_DisplayUsage(argv[0]);
+    }
+
+    exit(status);
+}
@@ -58,9 +58,15 @@
  */
 #include <LongBow/runtime.h>
 
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <unistd.h>
+#include <sys/stat.h>
 
 #include <parc/algol/parc_FileChunker.h>
 #include <parc/algol/parc_Chunker.h>
@@ -69,6 +75,8 @@
 #include <parc/algol/parc_FileOutputStream.h>
 #include <parc/algol/parc_LinkedList.h>
 
+#include <parc/security/parc_CryptoHasher.h>
+
 #include <parc/logging/parc_Log.h>
 #include <parc/logging/parc_LogReporterFile.h>
 
@@ -77,13 +85,73 @@
 
 #include <ccnx/transport/common/transport_MetaMessage.h>
 
+#include "ccnxFileRepo_Common.h"
 #include "ccnxFileRepo_Cache.h"
+#include "ccnxFileRepo_PackStore.h"
 #include "ccnxFileRepo_ManifestBuilder.h"
+#include "ccnxFileRepo_ContentChunker.h"
+#include "ccnxFileRepo_ChunkTable.h"
+#include "ccnxFileRepo_Codec.h"
+#include "ccnxFileRepo_EncodedMessage.h"
+
+static const char _ccnxFileRepoCache_PublicationMagic[8] = { 'C', 'C', 'N', 'X', 'P', 'U', 'B', '1' };
+// Version 4: the entry size of a hash group is the size under each of its pointers but the last
+// Version 5: the root's entry size is that of its pointers, no longer the group size
+// Version 6: the overall data digest of a skewed tree is taken over the data in file order
+static const uint32_t _ccnxFileRepoCache_PublicationVersion = 6;
+
+#define _ccnxFileRepoCache_ContentDigestLength 32
+
+#ifdef __APPLE__
+#define _ccnxFileRepoCache_ModifiedTime(statbuf) ((statbuf)->st_mtimespec)
+#else
+#define _ccnxFileRepoCache_ModifiedTime(statbuf) ((statbuf)->st_mtim)
+#endif
+
+/**
+ * The header of a publication descriptor, which records what the repo already holds for a
+ * published file. It is followed by the name, the source path and the wire format of the
+ * root manifest.
+ */
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t chunkSize;
+    uint64_t fileSize;
+    uint64_t inode;
+    int64_t modifiedSeconds;
+    int64_t modifiedNanoseconds;
+    uint32_t nameLength;
+    uint32_t pathLength;
+    uint32_t rootLength;
+    uint32_t manifestFanout;
+    uint32_t groupSize;
+    uint32_t chunking;
+    uint8_t contentDigest[_ccnxFileRepoCache_ContentDigestLength];
+} _PublicationHeader;
 
 struct ccnx_file_repo_cache {
     PARCLog *log;
     char *directory;
     size_t chunkSize;
+    size_t groupSize;
+    size_t buildThreadCount;
+    size_t manifestFanout;
+    CCNxFileRepoCacheChunking chunking;
+    CCNxFileRepoChunkCache *chunkCache;
+
+    // Turns wire formats into the bytes stored in the repo and back
+    CCNxFileRepoCodec *codec;
+
+    // Only set for CCNxFileRepoCacheStorage_Pack
+    CCNxFileRepoPackStore *pack;
+
+    // The time each stage of the builds of every file published was busy
+    CCNxManifestBuilderStageTimes ingestTimes;
+
+    // Held while a publication is published or removed, so a file can be republished while
+    // the publications of missing files are removed
+    pthread_mutex_t publicationLock;
 };
 
 /**
@@ -112,13 +180,29 @@ _ccnxFileRepoCache_Destructor(CCNxFileRepoCache **repoPtr)
     CCNxFileRepoCache *repo = *repoPtr;
 
     parcMemory_Deallocate(&repo->directory);
+    pthread_mutex_destroy(&repo->publicationLock);
+    if (repo->chunkCache != NULL) {
+        ccnxFileRepoChunkCache_Release(&repo->chunkCache);
+    }
+    if (repo->pack != NULL) {
+        ccnxFileRepoPackStore_Release(&repo->pack);
+    }
+    ccnxFileRepoCodec_Release(&repo->codec);
     return true;
 }
 
 char *
 ccnxFileRepoCache_ToString(const CCNxFileRepoCache *repo)
 {
-    char *result = NULL;
+    char *chunkCacheString = (repo->chunkCache == NULL)
+                             ? parcMemory_StringDuplicate("chunk cache disabled", 20)
+                             : ccnxFileRepoChunkCache_ToString(repo->chunkCache);
+    char *codecString = ccnxFileRepoCodec_ToString(repo->codec);
+    char *ingestString = ccnxManifestBuilder_StageTimesToString(&repo->ingestTimes);
+    char *result = parcMemory_Format("%s: %s, %s, %s", repo->directory, chunkCacheString, codecString, ingestString);
+    parcMemory_Deallocate(&ingestString);
+    parcMemory_Deallocate(&codecString);
+    parcMemory_Deallocate(&chunkCacheString);
     return result;
 }
 
@@ -129,18 +213,306 @@ parcObject_Override(CCNxFileRepoCache, PARCObject,
 parcObject_ImplementAcquire(ccnxFileRepoCache, CCNxFileRepoCache);
 parcObject_ImplementRelease(ccnxFileRepoCache, CCNxFileRepoCache);
 
+/**
+ * Return the digest the root manifest `root` is stored under, which the caller must release.
+ */
+static PARCBuffer *
+_ccnxFileRepoCache_RootDigest(const CCNxManifest *root)
+{
+    CCNxMetaMessage *rootMessage = ccnxMetaMessage_CreateFromManifest(root);
+    CCNxFileRepoEncodedMessage *encodedRoot = ccnxFileRepoEncodedMessage_Create(rootMessage);
+    ccnxMetaMessage_Release(&rootMessage);
+    PARCBuffer *result = parcBuffer_Acquire(ccnxFileRepoEncodedMessage_GetDigest(encodedRoot));
+    ccnxFileRepoEncodedMessage_Release(&encodedRoot);
+    return result;
+}
+
+/**
+ * Add `delta` to the reference count of every message of the publication with the given
+ * root: the root itself and every message it points to, directly or through other manifests.
+ * These are the references `_ccnxFileRepoCache_SaveToRepo` counts as the publication is
+ * stored, one per pointer, so adding them and taking them away again leaves the counts as
+ * they were. Without a packfile nothing is counted.
+ */
+static void
+_ccnxFileRepoCache_AddPublicationReferences(CCNxFileRepoCache *cache, const CCNxManifest *root, int32_t delta)
+{
+    if (cache->pack == NULL) {
+        return;
+    }
+
+    PARCBuffer *rootDigest = _ccnxFileRepoCache_RootDigest(root);
+    ccnxFileRepoPackStore_AddReferences(cache->pack, rootDigest, delta);
+    parcBuffer_Release(&rootDigest);
+
+    // A skewed tree is as deep as it is long, so the manifests below the root are visited
+    // from a list rather than recursively. The manifests may be views of the mapped packfile.
+    size_t section = ccnxFileRepoPackStore_BeginViews(cache->pack);
+    PARCLinkedList *pending = parcLinkedList_Create();
+    PARCBuffer *wireFormat = NULL;
+    CCNxMetaMessage *message = NULL;
+    const CCNxManifest *manifest = root;
+    while (manifest != NULL) {
+        for (size_t i = 0; i < ccnxManifest_GetNumberOfHashGroups(manifest); i++) {
+            CCNxManifestHashGroup *group = ccnxManifest_GetHashGroupByIndex(manifest, i);
+            for (size_t j = 0; j < ccnxManifestHashGroup_GetNumberOfPointers(group); j++) {
+                CCNxManifestHashGroupPointer *pointer = ccnxManifestHashGroup_GetPointerAtIndex(group, j);
+                const PARCBuffer *digest = ccnxManifestHashGroupPointer_GetDigest(pointer);
+                ccnxFileRepoPackStore_AddReferences(cache->pack, digest, delta);
+                if (ccnxManifestHashGroupPointer_GetType(pointer) == CCNxManifestHashGroupPointerType_Manifest) {
+                    parcLinkedList_Append(pending, digest);
+                }
+            }
+            ccnxManifestHashGroup_Release(&group);
+        }
+
+        manifest = NULL;
+        while (manifest == NULL && !parcLinkedList_IsEmpty(pending)) {
+            if (message != NULL) {
+                ccnxMetaMessage_Release(&message);
+                parcBuffer_Release(&wireFormat);
+            }
+            PARCBuffer *digest = parcLinkedList_RemoveFirst(pending);
+            PARCBuffer *stored = ccnxFileRepoPackStore_Get(cache->pack, digest);
+            parcBuffer_Release(&digest);
+            if (stored != NULL) {
+                wireFormat = ccnxFileRepoCodec_Decode(cache->codec, stored);
+                parcBuffer_Release(&stored);
+            }
+            if (wireFormat != NULL) {
+                message = ccnxMetaMessage_CreateFromWireFormatBuffer(wireFormat);
+                if (message != NULL && ccnxMetaMessage_IsManifest(message)) {
+                    manifest = ccnxMetaMessage_GetManifest(message);
+                } else if (message == NULL) {
+                    parcBuffer_Release(&wireFormat);
+                }
+            }
+        }
+    }
+    if (message != NULL) {
+        ccnxMetaMessage_Release(&message);
+        parcBuffer_Release(&wireFormat);
+    }
+    parcLinkedList_Release(&pending);
+    ccnxFileRepoPackStore_EndViews(cache->pack, section);
+}
+
+/**
+ * Read the publication descriptor at `descriptorPath`. On success `body` holds the name, the
+ * source path and the wire format of the root manifest, and must be deallocated.
+ */
+static bool
+_ccnxFileRepoCache_ReadPublication(const char *descriptorPath, _PublicationHeader *header, char **body)
+{
+    int fd = open(descriptorPath, O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+
+    bool result = false;
+    struct stat descriptorStat;
+    if (fstat(fd, &descriptorStat) == 0
+        && read(fd, header, sizeof(*header)) == sizeof(*header)
+        && memcmp(header->magic, _ccnxFileRepoCache_PublicationMagic, sizeof(header->magic)) == 0
+        && header->version == _ccnxFileRepoCache_PublicationVersion
+        && descriptorStat.st_size == (off_t) (sizeof(*header) + header->nameLength + header->pathLength + header->rootLength)) {
+        size_t bodyLength = header->nameLength + header->pathLength + header->rootLength;
+        *body = parcMemory_Allocate(bodyLength);
+        result = read(fd, *body, bodyLength) == (ssize_t) bodyLength;
+        if (!result) {
+            parcMemory_Deallocate(body);
+        }
+    }
+    close(fd);
+
+    return result;
+}
+
+/**
+ * Decode the root manifest of a publication descriptor read by `_ccnxFileRepoCache_ReadPublication`.
+ */
+static CCNxManifest *
+_ccnxFileRepoCache_DecodePublishedRoot(const _PublicationHeader *header, const char *body)
+{
+    PARCBuffer *wireFormat = parcBuffer_Allocate(header->rootLength);
+    parcBuffer_PutArray(wireFormat, header->rootLength, (uint8_t *) body + header->nameLength + header->pathLength);
+    parcBuffer_Flip(wireFormat);
+
+    CCNxManifest *result = NULL;
+    CCNxMetaMessage *message = ccnxMetaMessage_CreateFromWireFormatBuffer(wireFormat);
+    if (message != NULL && ccnxMetaMessage_IsManifest(message)) {
+        result = ccnxManifest_Acquire(ccnxMetaMessage_GetManifest(message));
+    }
+    if (message != NULL) {
+        ccnxMetaMessage_Release(&message);
+    }
+    parcBuffer_Release(&wireFormat);
+    return result;
+}
+
+/**
+ * Return the root manifest recorded by the publication descriptor at `descriptorPath`,
+ * whether or not it still matches its source file, or NULL.
+ */
+static CCNxManifest *
+_ccnxFileRepoCache_ReadPublishedRoot(const char *descriptorPath)
+{
+    _PublicationHeader header;
+    char *body;
+    if (!_ccnxFileRepoCache_ReadPublication(descriptorPath, &header, &body)) {
+        return NULL;
+    }
+
+    CCNxManifest *result = _ccnxFileRepoCache_DecodePublishedRoot(&header, body);
+    parcMemory_Deallocate(&body);
+    return result;
+}
+
+/**
+ * Call `visitor` with the path of every publication descriptor in the repo directory.
+ */
+static size_t
+_ccnxFileRepoCache_ForEachPublication(CCNxFileRepoCache *cache, bool (*visitor)(CCNxFileRepoCache *cache, const char *descriptorPath))
+{
+    DIR *dir = opendir(cache->directory);
+    if (dir == NULL) {
+        parcLog_Error(cache->log, "%s: %s", cache->directory, strerror(errno));
+        return 0;
+    }
+
+    size_t count = 0;
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != NULL) {
+        size_t length = strlen(entry->d_name);
+        if (length > 4 && strcmp(entry->d_name + length - 4, ".pub") == 0) {
+            char *descriptorPath = parcMemory_Format("%s/%s", cache->directory, entry->d_name);
+            if (visitor(cache, descriptorPath)) {
+                count++;
+            }
+            parcMemory_Deallocate(&descriptorPath);
+        }
+    }
+    closedir(dir);
+    return count;
+}
+
+static bool
+_ccnxFileRepoCache_CountPublication(CCNxFileRepoCache *cache, const char *descriptorPath)
+{
+    CCNxManifest *root = _ccnxFileRepoCache_ReadPublishedRoot(descriptorPath);
+    if (root == NULL) {
+        return false;
+    }
+    _ccnxFileRepoCache_AddPublicationReferences(cache, root, 1);
+    ccnxManifest_Release(&root);
+    return true;
+}
+
+/**
+ * Count the references of every publication again, after the packfile index was created or
+ * rebuilt and lost the counts it kept.
+ */
+static void
+_ccnxFileRepoCache_CountReferences(CCNxFileRepoCache *cache)
+{
+    ccnxFileRepoPackStore_ClearReferences(cache->pack);
+    size_t count = _ccnxFileRepoCache_ForEachPublication(cache, _ccnxFileRepoCache_CountPublication);
+    ccnxFileRepoPackStore_SetHasReferenceCounts(cache->pack);
+    parcLog_Info(cache->log, "Counted the references of %zu publications in %s", count, cache->directory);
+}
+
 CCNxFileRepoCache *
-ccnxFileRepoCache_Create(char *directory, size_t chunkSize)
+ccnxFileRepoCache_CreateWithStorage(char *directory, size_t chunkSize, CCNxFileRepoCacheStorage storage)
 {
     CCNxFileRepoCache *repo = parcObject_CreateInstance(CCNxFileRepoCache);
     if (repo != NULL) {
         repo->directory = parcMemory_StringDuplicate(directory, strlen(directory));
+        pthread_mutex_init(&repo->publicationLock, NULL);
         repo->chunkSize = chunkSize;
+        repo->groupSize = 0;
+        repo->buildThreadCount = 1;
+        repo->manifestFanout = 0;
+        repo->chunking = CCNxFileRepoCacheChunking_Fixed;
         repo->log = _ccnxFileRepoCache_CreateLogger();
+        repo->chunkCache = NULL;
+        repo->codec = ccnxFileRepoCodec_Create(0);
+        repo->pack = NULL;
+        memset(&repo->ingestTimes, 0, sizeof(repo->ingestTimes));
+
+        if (storage == CCNxFileRepoCacheStorage_Pack || storage == CCNxFileRepoCacheStorage_MappedPack) {
+            repo->pack = ccnxFileRepoPackStore_Open(directory);
+            if (repo->pack == NULL) {
+                ccnxFileRepoCache_Release(&repo);
+            } else if (storage == CCNxFileRepoCacheStorage_MappedPack && !ccnxFileRepoPackStore_Map(repo->pack)) {
+                parcLog_Warning(repo->log, "Could not map the packfile in %s, falling back to reads", directory);
+            }
+            if (repo != NULL && !ccnxFileRepoPackStore_HasReferenceCounts(repo->pack)) {
+                _ccnxFileRepoCache_CountReferences(repo);
+            }
+        }
     }
     return repo;
 }
 
+CCNxFileRepoCache *
+ccnxFileRepoCache_Create(char *directory, size_t chunkSize)
+{
+    return ccnxFileRepoCache_CreateWithStorage(directory, chunkSize, CCNxFileRepoCacheStorage_Files);
+}
+
+void
+ccnxFileRepoCache_SetChunkCacheCapacity(CCNxFileRepoCache *repo, size_t capacity)
+{
+    if (repo->chunkCache != NULL) {
+        ccnxFileRepoChunkCache_Release(&repo->chunkCache);
+    }
+    if (capacity > 0) {
+        repo->chunkCache = ccnxFileRepoChunkCache_Create(capacity);
+    }
+}
+
+void
+ccnxFileRepoCache_SetBuildThreadCount(CCNxFileRepoCache *repo, size_t threadCount)
+{
+    repo->buildThreadCount = (threadCount > 0) ? threadCount : 1;
+}
+
+void
+ccnxFileRepoCache_SetGroupSize(CCNxFileRepoCache *repo, size_t groupSize)
+{
+    repo->groupSize = groupSize;
+}
+
+void
+ccnxFileRepoCache_SetManifestFanout(CCNxFileRepoCache *repo, size_t fanout)
+{
+    repo->manifestFanout = fanout;
+}
+
+void
+ccnxFileRepoCache_SetChunking(CCNxFileRepoCache *repo, CCNxFileRepoCacheChunking chunking)
+{
+    repo->chunking = chunking;
+}
+
+bool
+ccnxFileRepoCache_SetCompressionLevel(CCNxFileRepoCache *repo, int level)
+{
+    CCNxFileRepoCodec *codec = ccnxFileRepoCodec_Create(level);
+    if (codec == NULL) {
+        return false;
+    }
+    ccnxFileRepoCodec_Release(&repo->codec);
+    repo->codec = codec;
+    return true;
+}
+
+CCNxFileRepoChunkCache *
+ccnxFileRepoCache_GetChunkCache(const CCNxFileRepoCache *repo)
+{
+    return repo->chunkCache;
+}
+
 static char *
 _ccnxFileRepoCache_JoinPath(CCNxFileRepoCache *repo, char *suffix)
 {
@@ -153,40 +525,166 @@ _ccnxFileRepoCache_JoinPath(CCNxFileRepoCache *repo, char *suffix)
     return fullName;
 }
 
-static PARCBuffer *
-_ccnxFileRepoCache_SaveToRepo(CCNxFileRepoCache *repo, CCNxMetaMessage *message)
+/**
+ * The context of `_ccnxFileRepoCache_SaveToRepo`.
+ */
+typedef struct {
+    CCNxFileRepoCache *repo;
+    bool referenced; // count a reference to each message, as a publication does
+
+    // The digests counted so far, to take the references back if the build fails
+    uint8_t *counted;
+    size_t countedCount;
+    size_t countedCapacity;
+} _SaveContext;
+
+/**
+ * Remember that a reference to `digest` was counted for the build of `saveContext`.
+ */
+static void
+_ccnxFileRepoCache_RecordReference(_SaveContext *saveContext, PARCBuffer *digest)
 {
-    PARCBuffer *buffer = ccnxMetaMessage_CreateWireFormatBuffer(message, NULL);
-    CCNxMetaMessage *msg = ccnxMetaMessage_CreateFromWireFormatBuffer(buffer);
-    CCNxWireFormatMessageInterface *interface = ccnxWireFormatMessageInterface_GetInterface(msg);
-    PARCCryptoHash *hash = interface->computeContentObjectHash(msg);
+    if (saveContext->countedCount == saveContext->countedCapacity) {
+        saveContext->countedCapacity = (saveContext->countedCapacity == 0) ? 1024 : 2 * saveContext->countedCapacity;
+        saveContext->counted = parcMemory_Reallocate(saveContext->counted,
+                                                     saveContext->countedCapacity * CCNxFileRepoSha256_DigestLength);
+    }
+    memcpy(saveContext->counted + saveContext->countedCount * CCNxFileRepoSha256_DigestLength,
+           ccnxFileRepoCommon_GetBufferBytes(digest), CCNxFileRepoSha256_DigestLength);
+    saveContext->countedCount++;
+}
 
-    PARCBuffer *digest = parcBuffer_Acquire(parcCryptoHash_GetDigest(hash));
-    parcCryptoHash_Release(&hash);
-    parcBuffer_Release(&buffer);
+/**
+ * Release the references counted for a build that did not produce a publication, so a
+ * compaction can reclaim what it stored.
+ */
+static void
+_ccnxFileRepoCache_ReleaseRecordedReferences(CCNxFileRepoCache *repo, _SaveContext *saveContext)
+{
+    for (size_t i = 0; i < saveContext->countedCount; i++) {
+        PARCBuffer *digest = parcBuffer_Wrap(saveContext->counted + i * CCNxFileRepoSha256_DigestLength,
+                                             CCNxFileRepoSha256_DigestLength, 0, CCNxFileRepoSha256_DigestLength);
+        ccnxFileRepoPackStore_AddReferences(repo->pack, digest, -1);
+        parcBuffer_Release(&digest);
+    }
+    saveContext->countedCount = 0;
+}
+
+/**
+ * Store one message as the manifest builder produces it; a `CCNxManifestBuilderSink`.
+ * A message that is already stored, e.g., a chunk shared with another publication, is not
+ * written again, and one the builder reused from the previous version comes without a wire
+ * format and is only counted. What is written is the wire format as the codec stores it.
+ */
+static void
+_ccnxFileRepoCache_SaveToRepo(void *context, CCNxFileRepoEncodedMessage *encoded)
+{
+    _SaveContext *saveContext = context;
+    CCNxFileRepoCache *repo = saveContext->repo;
+    PARCBuffer *digest = ccnxFileRepoEncodedMessage_GetDigest(encoded);
+    PARCBuffer *wireBuffer = ccnxFileRepoEncodedMessage_GetWireFormat(encoded);
+
+    if (repo->pack != NULL) {
+        if (wireBuffer != NULL && !ccnxFileRepoPackStore_Contains(repo->pack, digest)) {
+            PARCBuffer *stored = ccnxFileRepoCodec_Encode(repo->codec, wireBuffer);
+            ccnxFileRepoPackStore_Put(repo->pack, digest, stored);
+            parcBuffer_Release(&stored);
+        }
+        // Counted as soon as it is stored, so a concurrent compaction keeps it.
+        if (saveContext->referenced) {
+            ccnxFileRepoPackStore_AddReferences(repo->pack, digest, 1);
+            _ccnxFileRepoCache_RecordReference(saveContext, digest);
+        }
+        return;
+    }
+    if (wireBuffer == NULL) {
+        return;
+    }
 
     char *fileName = parcBuffer_ToHexString(digest);
     char *fullName = _ccnxFileRepoCache_JoinPath(repo, fileName);
-    parcLog_Info(repo->log, "Saving file: %s", fullName);
 
-    PARCBuffer *wireBuffer = ccnxMetaMessage_CreateWireFormatBuffer(message, NULL);
     PARCFile *file = parcFile_Create(fullName);
     if (!parcFile_Exists(file)) {
+        parcLog_Info(repo->log, "Saving file: %s", fullName);
         parcFile_CreateNewFile(file);
+
+        PARCBuffer *stored = ccnxFileRepoCodec_Encode(repo->codec, wireBuffer);
+        PARCRandomAccessFile *raf = parcRandomAccessFile_Open(file);
+        parcRandomAccessFile_Write(raf, stored);
+        parcBuffer_Release(&stored);
+
+        parcRandomAccessFile_Close(raf);
+        parcRandomAccessFile_Release(&raf);
     }
+    parcFile_Release(&file);
+    parcMemory_Deallocate(&fileName);
+    parcMemory_Deallocate(&fullName);
+}
 
-    PARCRandomAccessFile *raf = parcRandomAccessFile_Open(file);
-    parcRandomAccessFile_Write(raf, wireBuffer);
+/**
+ * Return the wire format of a stored message read from the repo, and keep it in the chunk
+ * cache. `stored` is released.
+ */
+static PARCBuffer *
+_ccnxFileRepoCache_DecodeStored(CCNxFileRepoCache *repo, PARCBuffer *digest, PARCBuffer *stored)
+{
+    PARCBuffer *result = ccnxFileRepoCodec_Decode(repo->codec, stored);
+    if (result == NULL) {
+        char *fileName = parcBuffer_ToHexString(digest);
+        parcLog_Error(repo->log, "Could not decompress the stored message %s", fileName);
+        parcMemory_Deallocate(&fileName);
+    } else if (repo->chunkCache != NULL) {
+        ccnxFileRepoChunkCache_Put(repo->chunkCache, digest, result);
+    }
+    parcBuffer_Release(&stored);
+    return result;
+}
 
-    parcRandomAccessFile_Close(raf);
-    parcRandomAccessFile_Release(&raf);
+size_t
+ccnxFileRepoCache_BeginViews(CCNxFileRepoCache *repo)
+{
+    return (repo->pack != NULL) ? ccnxFileRepoPackStore_BeginViews(repo->pack) : 0;
+}
 
-    return digest;
+void
+ccnxFileRepoCache_EndViews(CCNxFileRepoCache *repo, size_t section)
+{
+    if (repo->pack != NULL) {
+        ccnxFileRepoPackStore_EndViews(repo->pack, section);
+    }
 }
 
 PARCBuffer *
 ccnxFileRepoCache_CreateWireEncodedMessageWithDigest(CCNxFileRepoCache *repo, PARCBuffer *digest)
 {
+    // An uncompressed message is served as a view of the mapping. Only compressed messages
+    // go through the chunk cache, so the hot ones are decompressed once.
+    if (repo->pack != NULL && ccnxFileRepoPackStore_IsMapped(repo->pack)) {
+        PARCBuffer *stored = ccnxFileRepoPackStore_Get(repo->pack, digest);
+        if (stored == NULL || !ccnxFileRepoCodec_IsEncoded(stored)) {
+            return stored;
+        }
+        PARCBuffer *cached = (repo->chunkCache != NULL) ? ccnxFileRepoChunkCache_Get(repo->chunkCache, digest) : NULL;
+        if (cached != NULL) {
+            parcBuffer_Release(&stored);
+            return cached;
+        }
+        return _ccnxFileRepoCache_DecodeStored(repo, digest, stored);
+    }
+
+    if (repo->chunkCache != NULL) {
+        PARCBuffer *cached = ccnxFileRepoChunkCache_Get(repo->chunkCache, digest);
+        if (cached != NULL) {
+            return cached;
+        }
+    }
+
+    if (repo->pack != NULL) {
+        PARCBuffer *stored = ccnxFileRepoPackStore_Get(repo->pack, digest);
+        return (stored == NULL) ? NULL : _ccnxFileRepoCache_DecodeStored(repo, digest, stored);
+    }
+
     char *fileName = parcBuffer_ToHexString(digest);
     char *fullName = _ccnxFileRepoCache_JoinPath(repo, fileName);
 
@@ -196,12 +694,14 @@ ccnxFileRepoCache_CreateWireEncodedMessageWithDigest(CCNxFileRepoCache *repo, PA
     if (parcFile_Exists(file)) {
         size_t fileSize = parcFile_GetFileSize(file);
         PARCRandomAccessFile *fhandle = parcRandomAccessFile_Open(file);
-        result = parcBuffer_Allocate(fileSize);
-        parcRandomAccessFile_Read(fhandle, result);
-        parcBuffer_Flip(result);
+        PARCBuffer *stored = parcBuffer_Allocate(fileSize);
+        parcRandomAccessFile_Read(fhandle, stored);
+        parcBuffer_Flip(stored);
 
         parcRandomAccessFile_Close(fhandle);
         parcRandomAccessFile_Release(&fhandle);
+
+        result = _ccnxFileRepoCache_DecodeStored(repo, digest, stored);
     }
     parcMemory_Deallocate(&fileName);
     parcMemory_Deallocate(&fullName);
@@ -210,27 +710,78 @@ ccnxFileRepoCache_CreateWireEncodedMessageWithDigest(CCNxFileRepoCache *repo, PA
     return result;
 }
 
+/**
+ * Build and store the publication of `file`. The chunks of `previousChunks` are reused
+ * rather than built again, and the chunks built are recorded in `chunks`; either may be NULL.
+ */
 static CCNxManifest *
-_ccnxFileRepoCache_BuildFile(CCNxFileRepoCache *cache, CCNxName *name, PARCFile *file)
+_ccnxFileRepoCache_BuildFile(CCNxFileRepoCache *cache, CCNxName *name, PARCFile *file, bool referenced,
+                             CCNxFileRepoChunkTable *previousChunks, CCNxFileRepoChunkTable *chunks)
 {
-    PARCFileChunker *fileChunker = parcFileChunker_Create(file, cache->chunkSize);
-    PARCChunker *chunker = parcChunker_Create(fileChunker, PARCFileChunkerAsChunker);
-    parcFileChunker_Release(&fileChunker);
-
-    CCNxManifestBuilder *builder = ccnxManifestBuilder_Create();
-    PARCLinkedList *chunks = ccnxManifestBuilder_BuildSkewedManifest(builder, chunker, name);
+    PARCChunker *chunker = NULL;
+    if (cache->chunking == CCNxFileRepoCacheChunking_Content) {
+        CCNxFileRepoContentChunker *contentChunker = ccnxFileRepoContentChunker_Create(file, cache->chunkSize);
+        if (contentChunker == NULL) {
+            return NULL;
+        }
+        chunker = parcChunker_Create(contentChunker, CCNxFileRepoContentChunkerAsChunker);
+        ccnxFileRepoContentChunker_Release(&contentChunker);
+    } else {
+        PARCFileChunker *fileChunker = parcFileChunker_Create(file, cache->chunkSize);
+        chunker = parcChunker_Create(fileChunker, PARCFileChunkerAsChunker);
+        parcFileChunker_Release(&fileChunker);
+    }
 
-    PARCIterator *itr = parcLinkedList_CreateIterator(chunks);
-    while (parcIterator_HasNext(itr)) {
-        CCNxMetaMessage *metaMessage = (CCNxMetaMessage *) parcIterator_Next(itr);
-        _ccnxFileRepoCache_SaveToRepo(cache, metaMessage);
+    // A chunk must fit in a packet together with its name
+    size_t maximumPayloadSize = ccnxFileRepoEncodedMessage_GetMaximumPayloadSize(name);
+    if (parcChunker_GetChunkSize(chunker) > maximumPayloadSize) {
+        parcLog_Error(cache->log, "Chunks of %zu bytes do not fit in a packet, which holds at most %zu under this name",
+                      parcChunker_GetChunkSize(chunker), maximumPayloadSize);
+        parcChunker_Release(&chunker);
+        return NULL;
     }
-    parcIterator_Release(&itr);
+
+    CCNxManifestBuilder *builder = ccnxManifestBuilder_Create();
+    // A content chunker reports its largest chunk, which is what a consumer must buffer.
+    ccnxManifestBuilder_SetChunkSize(builder, parcChunker_GetChunkSize(chunker));
+    ccnxManifestBuilder_SetGroupSize(builder, cache->groupSize);
+    ccnxManifestBuilder_SetThreadCount(builder, cache->buildThreadCount);
+    ccnxManifestBuilder_SetFanout(builder, cache->manifestFanout);
+    ccnxManifestBuilder_SetPreviousChunkTable(builder, previousChunks);
+    ccnxManifestBuilder_SetChunkTable(builder, chunks);
+    ccnxManifestBuilder_SetStageTimes(builder, &cache->ingestTimes);
+    // Each message is stored as soon as it is built, so memory does not grow with the file.
+    _SaveContext saveContext = { .repo = cache, .referenced = referenced };
+    CCNxFileRepoEncodedMessage *encodedRoot =
+        ccnxManifestBuilder_StreamManifest(builder, chunker, name, _ccnxFileRepoCache_SaveToRepo, &saveContext);
     ccnxManifestBuilder_Release(&builder);
     parcChunker_Release(&chunker);
 
-    CCNxManifest *root = ccnxMetaMessage_Acquire(parcLinkedList_GetLast(chunks));
-    parcLinkedList_Release(&chunks);
+    if (cache->pack != NULL) {
+        ccnxFileRepoPackStore_Flush(cache->pack);
+    }
+
+    // The builder only hands back encodings, so decode the root to keep it as a manifest.
+    CCNxManifest *root = NULL;
+    if (encodedRoot != NULL) {
+        CCNxMetaMessage *message = ccnxMetaMessage_CreateFromWireFormatBuffer(ccnxFileRepoEncodedMessage_GetWireFormat(encodedRoot));
+        if (message != NULL) {
+            if (ccnxMetaMessage_IsManifest(message)) {
+                root = ccnxManifest_Acquire(ccnxMetaMessage_GetManifest(message));
+            }
+            ccnxMetaMessage_Release(&message);
+        }
+        ccnxFileRepoEncodedMessage_Release(&encodedRoot);
+    }
+
+    // Without a root nothing points at what was stored, so its references are taken back.
+    if (root == NULL && saveContext.countedCount > 0) {
+        parcLog_Warning(cache->log, "A build failed, releasing the %zu messages it stored", saveContext.countedCount);
+        _ccnxFileRepoCache_ReleaseRecordedReferences(cache, &saveContext);
+    }
+    if (saveContext.counted != NULL) {
+        parcMemory_Deallocate(&saveContext.counted);
+    }
 
     return root;
 }
@@ -238,5 +789,375 @@ _ccnxFileRepoCache_BuildFile(CCNxFileRepoCache *cache, CCNxName *name, PARCFile
 CCNxManifest *
 ccnxFileRepoCache_LoadFile(CCNxFileRepoCache *cache, CCNxName *name, PARCFile *file)
 {
-    return _ccnxFileRepoCache_BuildFile(cache, name, file);
+    return _ccnxFileRepoCache_BuildFile(cache, name, file, false, NULL, NULL);
+}
+
+/**
+ * Return the path of the descriptor of the publication with the given name, which is named
+ * by the SHA-256 digest of the name so that any name maps to a valid file name.
+ */
+static char *
+_ccnxFileRepoCache_PublicationPath(CCNxFileRepoCache *cache, const char *nameString)
+{
+    PARCCryptoHasher *hasher = parcCryptoHasher_Create(PARCCryptoHashType_SHA256);
+    parcCryptoHasher_Init(hasher);
+    parcCryptoHasher_UpdateBytes(hasher, nameString, strlen(nameString));
+    PARCCryptoHash *hash = parcCryptoHasher_Finalize(hasher);
+    parcCryptoHasher_Release(&hasher);
+
+    char *hexName = parcBuffer_ToHexString(parcCryptoHash_GetDigest(hash));
+    parcCryptoHash_Release(&hash);
+
+    char *result = parcMemory_Format("%s/%s.pub", cache->directory, hexName);
+    parcMemory_Deallocate(&hexName);
+    return result;
+}
+
+/**
+ * Return the path of the chunk table kept next to the publication descriptor at
+ * `descriptorPath`, which records the chunks of the publication for its next version.
+ */
+static char *
+_ccnxFileRepoCache_ChunkTablePath(const char *descriptorPath)
+{
+    size_t length = strlen(descriptorPath) - strlen(".pub");
+    return parcMemory_Format("%.*s.chunks", (int) length, descriptorPath);
+}
+
+static bool
+_ccnxFileRepoCache_StoreContains(CCNxFileRepoCache *cache, const PARCBuffer *digest)
+{
+    if (cache->pack != NULL) {
+        return ccnxFileRepoPackStore_Contains(cache->pack, digest);
+    }
+
+    char *fileName = parcBuffer_ToHexString(digest);
+    char *fullName = _ccnxFileRepoCache_JoinPath(cache, fileName);
+    bool result = access(fullName, R_OK) == 0;
+    parcMemory_Deallocate(&fileName);
+    parcMemory_Deallocate(&fullName);
+    return result;
+}
+
+/**
+ * Check that every chunk the root manifest points to is in the store. This only looks at
+ * the root, so it catches a store that was emptied or replaced, not a single missing chunk.
+ */
+static bool
+_ccnxFileRepoCache_StoreContainsChildren(CCNxFileRepoCache *cache, const CCNxManifest *root)
+{
+    for (size_t i = 0; i < ccnxManifest_GetNumberOfHashGroups(root); i++) {
+        CCNxManifestHashGroup *group = ccnxManifest_GetHashGroupByIndex(root, i);
+        bool found = true;
+        for (size_t j = 0; found && j < ccnxManifestHashGroup_GetNumberOfPointers(group); j++) {
+            CCNxManifestHashGroupPointer *pointer = ccnxManifestHashGroup_GetPointerAtIndex(group, j);
+            found = _ccnxFileRepoCache_StoreContains(cache, ccnxManifestHashGroupPointer_GetDigest(pointer));
+        }
+        ccnxManifestHashGroup_Release(&group);
+        if (!found) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * Open the chunk table of the publication with root manifest `previousRoot`. A table left
+ * from any other version is not used, since only the references of the current publication
+ * keep the chunks it records in the store.
+ */
+static CCNxFileRepoChunkTable *
+_ccnxFileRepoCache_OpenPreviousChunks(CCNxFileRepoCache *cache, const char *chunkTablePath, const CCNxManifest *previousRoot)
+{
+    CCNxFileRepoChunkTable *table = ccnxFileRepoChunkTable_Open(chunkTablePath);
+    if (table == NULL) {
+        return NULL;
+    }
+
+    PARCBuffer *rootDigest = _ccnxFileRepoCache_RootDigest(previousRoot);
+    if (!ccnxFileRepoChunkTable_HasRoot(table, rootDigest) || !_ccnxFileRepoCache_StoreContainsChildren(cache, previousRoot)) {
+        ccnxFileRepoChunkTable_Release(&table);
+    }
+    parcBuffer_Release(&rootDigest);
+    return table;
+}
+
+/**
+ * Tie `chunks` to the publication with root manifest `root` and move it into place, once the
+ * descriptor of that publication is saved.
+ */
+static bool
+_ccnxFileRepoCache_SaveChunkTable(CCNxFileRepoCache *cache, CCNxFileRepoChunkTable *chunks, const CCNxManifest *root,
+                                  const char *chunkTablePath)
+{
+    PARCBuffer *rootDigest = _ccnxFileRepoCache_RootDigest(root);
+    ccnxFileRepoChunkTable_SetRoot(chunks, rootDigest);
+    parcBuffer_Release(&rootDigest);
+
+    bool result = ccnxFileRepoChunkTable_Sync(chunks) && ccnxFileRepoChunkTable_Rename(chunks, chunkTablePath);
+    if (!result) {
+        parcLog_Warning(cache->log, "Could not save %s: %s", chunkTablePath, strerror(errno));
+    }
+    return result;
+}
+
+static bool
+_ccnxFileRepoCache_DescribesFile(const CCNxFileRepoCache *cache, const _PublicationHeader *header, const struct stat *statbuf)
+{
+    return header->chunkSize == cache->chunkSize
+           && header->manifestFanout == cache->manifestFanout
+           && header->groupSize == cache->groupSize
+           && header->chunking == (uint32_t) cache->chunking
+           && header->fileSize == (uint64_t) statbuf->st_size
+           && header->inode == (uint64_t) statbuf->st_ino
+           && header->modifiedSeconds == (int64_t) _ccnxFileRepoCache_ModifiedTime(statbuf).tv_sec
+           && header->modifiedNanoseconds == (int64_t) _ccnxFileRepoCache_ModifiedTime(statbuf).tv_nsec;
+}
+
+/**
+ * Load the root manifest recorded by the publication descriptor at `descriptorPath`, if the
+ * descriptor still matches the source file and the store.
+ */
+static CCNxManifest *
+_ccnxFileRepoCache_LoadPublication(CCNxFileRepoCache *cache, const char *descriptorPath,
+                                   const char *nameString, const char *path, const struct stat *statbuf)
+{
+    _PublicationHeader header;
+    char *body;
+    if (!_ccnxFileRepoCache_ReadPublication(descriptorPath, &header, &body)) {
+        return NULL;
+    }
+
+    CCNxManifest *result = NULL;
+    if (_ccnxFileRepoCache_DescribesFile(cache, &header, statbuf)
+        && header.nameLength == strlen(nameString) && memcmp(body, nameString, header.nameLength) == 0
+        && header.pathLength == strlen(path) && memcmp(body + header.nameLength, path, header.pathLength) == 0) {
+        result = _ccnxFileRepoCache_DecodePublishedRoot(&header, body);
+        if (result != NULL && !_ccnxFileRepoCache_StoreContainsChildren(cache, result)) {
+            ccnxManifest_Release(&result);
+        }
+    }
+    parcMemory_Deallocate(&body);
+
+    return result;
+}
+
+/**
+ * Write the publication descriptor to a temporary file and rename it into place, so a
+ * descriptor is either complete or absent.
+ */
+static bool
+_ccnxFileRepoCache_SavePublication(CCNxFileRepoCache *cache, const char *descriptorPath, const char *nameString,
+                                   const char *path, const struct stat *statbuf, CCNxManifest *root)
+{
+    CCNxMetaMessage *message = ccnxMetaMessage_CreateFromManifest(root);
+    PARCBuffer *wireFormat = ccnxMetaMessage_CreateWireFormatBuffer(message, NULL);
+    ccnxMetaMessage_Release(&message);
+
+    _PublicationHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, _ccnxFileRepoCache_PublicationMagic, sizeof(header.magic));
+    header.version = _ccnxFileRepoCache_PublicationVersion;
+    header.chunkSize = (uint32_t) cache->chunkSize;
+    header.manifestFanout = (uint32_t) cache->manifestFanout;
+    header.groupSize = (uint32_t) cache->groupSize;
+    header.chunking = (uint32_t) cache->chunking;
+    header.fileSize = statbuf->st_size;
+    header.inode = statbuf->st_ino;
+    header.modifiedSeconds = _ccnxFileRepoCache_ModifiedTime(statbuf).tv_sec;
+    header.modifiedNanoseconds = _ccnxFileRepoCache_ModifiedTime(statbuf).tv_nsec;
+    header.nameLength = (uint32_t) strlen(nameString);
+    header.pathLength = (uint32_t) strlen(path);
+    header.rootLength = (uint32_t) parcBuffer_Remaining(wireFormat);
+
+    // The content digest is the overall data digest carried by the root's last hash group.
+    size_t groupCount = ccnxManifest_GetNumberOfHashGroups(root);
+    if (groupCount > 0) {
+        CCNxManifestHashGroup *group = ccnxManifest_GetHashGroupByIndex(root, groupCount - 1);
+        PARCBuffer *contentDigest = ccnxManifestHashGroup_GetOverallDataDigest(group);
+        if (contentDigest != NULL && parcBuffer_Remaining(contentDigest) == _ccnxFileRepoCache_ContentDigestLength) {
+            memcpy(header.contentDigest, ccnxFileRepoCommon_GetBufferBytes(contentDigest), sizeof(header.contentDigest));
+        }
+        ccnxManifestHashGroup_Release(&group);
+    }
+
+    char *temporaryPath = parcMemory_Format("%s.tmp", descriptorPath);
+    FILE *output = fopen(temporaryPath, "wb");
+    bool result = output != NULL;
+    if (result) {
+        result = fwrite(&header, sizeof(header), 1, output) == 1
+                 && fwrite(nameString, 1, header.nameLength, output) == header.nameLength
+                 && fwrite(path, 1, header.pathLength, output) == header.pathLength
+                 && fwrite(ccnxFileRepoCommon_GetBufferBytes(wireFormat), 1, header.rootLength, output) == header.rootLength
+                 && fflush(output) == 0
+                 && fsync(fileno(output)) == 0;
+        result = (fclose(output) == 0) && result;
+    }
+    result = result && rename(temporaryPath, descriptorPath) == 0;
+    if (!result) {
+        parcLog_Warning(cache->log, "Could not save %s: %s", descriptorPath, strerror(errno));
+        unlink(temporaryPath);
+    }
+
+    parcMemory_Deallocate(&temporaryPath);
+    parcBuffer_Release(&wireFormat);
+    return result;
+}
+
+CCNxManifest *
+ccnxFileRepoCache_PublishFile(CCNxFileRepoCache *cache, CCNxName *name, const char *path)
+{
+    struct stat statbuf;
+    if (stat(path, &statbuf) != 0) {
+        parcLog_Error(cache->log, "%s: %s", path, strerror(errno));
+        return NULL;
+    }
+
+    char *nameString = ccnxName_ToString(name);
+    char *descriptorPath = _ccnxFileRepoCache_PublicationPath(cache, nameString);
+
+    pthread_mutex_lock(&cache->publicationLock);
+    CCNxManifest *root = _ccnxFileRepoCache_LoadPublication(cache, descriptorPath, nameString, path, &statbuf);
+    if (root != NULL) {
+        parcLog_Info(cache->log, "%s is unchanged, loaded %s from %s", path, nameString, descriptorPath);
+    } else {
+        CCNxManifest *previousRoot = _ccnxFileRepoCache_ReadPublishedRoot(descriptorPath);
+
+        // Only the chunks that changed since the previous version are encoded and stored;
+        // the others are found in its chunk table by the hash of their content.
+        char *chunkTablePath = _ccnxFileRepoCache_ChunkTablePath(descriptorPath);
+        char *temporaryChunkTablePath = parcMemory_Format("%s.tmp", chunkTablePath);
+        CCNxFileRepoChunkTable *previousChunks = NULL;
+        if (previousRoot != NULL) {
+            previousChunks = _ccnxFileRepoCache_OpenPreviousChunks(cache, chunkTablePath, previousRoot);
+        }
+        CCNxFileRepoChunkTable *chunks = ccnxFileRepoChunkTable_Create(temporaryChunkTablePath, statbuf.st_size / cache->chunkSize + 1);
+        if (previousChunks != NULL) {
+            parcLog_Info(cache->log, "%s changed, republishing %s from the %zu messages of its previous version",
+                         path, nameString, ccnxFileRepoChunkTable_GetCount(previousChunks));
+        }
+
+        PARCFile *file = parcFile_Create(path);
+        root = _ccnxFileRepoCache_BuildFile(cache, name, file, true, previousChunks, chunks);
+        parcFile_Release(&file);
+
+        // The descriptor vouches for the chunks, so they must be durable before it is written.
+        bool durable = (cache->pack == NULL) || ccnxFileRepoPackStore_Sync(cache->pack);
+        bool saved = false;
+        if (root != NULL && durable && _ccnxFileRepoCache_SavePublication(cache, descriptorPath, nameString, path, &statbuf, root)) {
+            // The new version is counted before the old one is let go, so the chunks they
+            // share never drop to no references.
+            if (previousRoot != NULL) {
+                _ccnxFileRepoCache_AddPublicationReferences(cache, previousRoot, -1);
+            }
+            // The table names the root it belongs to, so a crash before it replaces the
+            // table of the previous version only costs the next version a full build.
+            saved = (chunks != NULL) && _ccnxFileRepoCache_SaveChunkTable(cache, chunks, root, chunkTablePath);
+        } else if (root != NULL) {
+            _ccnxFileRepoCache_AddPublicationReferences(cache, root, -1);
+        }
+        if (chunks != NULL) {
+            if (!saved) {
+                unlink(temporaryChunkTablePath);
+            }
+            ccnxFileRepoChunkTable_Release(&chunks);
+        }
+        if (previousChunks != NULL) {
+            ccnxFileRepoChunkTable_Release(&previousChunks);
+        }
+        if (previousRoot != NULL) {
+            ccnxManifest_Release(&previousRoot);
+        }
+        parcMemory_Deallocate(&temporaryChunkTablePath);
+        parcMemory_Deallocate(&chunkTablePath);
+    }
+    pthread_mutex_unlock(&cache->publicationLock);
+
+    parcMemory_Deallocate(&descriptorPath);
+    parcMemory_Deallocate(&nameString);
+    return root;
+}
+
+/**
+ * Remove the publication descriptor at `descriptorPath` and the references of its publication.
+ */
+static bool
+_ccnxFileRepoCache_RemoveDescriptor(CCNxFileRepoCache *cache, const char *descriptorPath)
+{
+    CCNxManifest *root = _ccnxFileRepoCache_ReadPublishedRoot(descriptorPath);
+
+    // The descriptor goes first: a crash in between leaves references too many, never too few.
+    bool result = unlink(descriptorPath) == 0;
+    if (result && root != NULL) {
+        _ccnxFileRepoCache_AddPublicationReferences(cache, root, -1);
+    }
+    if (result) {
+        char *chunkTablePath = _ccnxFileRepoCache_ChunkTablePath(descriptorPath);
+        unlink(chunkTablePath);
+        parcMemory_Deallocate(&chunkTablePath);
+    }
+    if (root != NULL) {
+        ccnxManifest_Release(&root);
+    }
+    return result;
+}
+
+bool
+ccnxFileRepoCache_RemovePublication(CCNxFileRepoCache *cache, const CCNxName *name)
+{
+    char *nameString = ccnxName_ToString(name);
+    char *descriptorPath = _ccnxFileRepoCache_PublicationPath(cache, nameString);
+
+    pthread_mutex_lock(&cache->publicationLock);
+    bool result = _ccnxFileRepoCache_RemoveDescriptor(cache, descriptorPath);
+    pthread_mutex_unlock(&cache->publicationLock);
+    if (result) {
+        parcLog_Info(cache->log, "Removed the publication of %s", nameString);
+    }
+
+    parcMemory_Deallocate(&descriptorPath);
+    parcMemory_Deallocate(&nameString);
+    return result;
+}
+
+static bool
+_ccnxFileRepoCache_RemoveIfMissing(CCNxFileRepoCache *cache, const char *descriptorPath)
+{
+    _PublicationHeader header;
+    char *body;
+    if (!_ccnxFileRepoCache_ReadPublication(descriptorPath, &header, &body)) {
+        return false;
+    }
+
+    char *path = parcMemory_StringDuplicate(body + header.nameLength, header.pathLength);
+    parcMemory_Deallocate(&body);
+
+    bool result = false;
+    if (access(path, F_OK) != 0 && errno == ENOENT) {
+        result = _ccnxFileRepoCache_RemoveDescriptor(cache, descriptorPath);
+        if (result) {
+            parcLog_Info(cache->log, "%s is gone, removed its publication", path);
+        }
+    }
+    parcMemory_Deallocate(&path);
+    return result;
+}
+
+size_t
+ccnxFileRepoCache_RemoveMissingPublications(CCNxFileRepoCache *cache)
+{
+    pthread_mutex_lock(&cache->publicationLock);
+    size_t result = _ccnxFileRepoCache_ForEachPublication(cache, _ccnxFileRepoCache_RemoveIfMissing);
+    pthread_mutex_unlock(&cache->publicationLock);
+    return result;
+}
+
+bool
+ccnxFileRepoCache_Compact(CCNxFileRepoCache *cache)
+{
+    if (cache->pack == NULL) {
+        parcLog_Warning(cache->log, "%s: only a packfile store can be compacted", cache->directory);
+        return false;
+    }
+    return ccnxFileRepoPackStore_Compact(cache->pack);
 }
@@ -62,9 +62,28 @@
 
 #include <stdint.h>
 
+#include "ccnxFileRepo_ChunkCache.h"
+
 struct ccnx_file_repo_cache;
 typedef struct ccnx_file_repo_cache CCNxFileRepoCache;
 
+/**
+ * The on-disk layout of the chunks in a repo directory.
+ */
+typedef enum {
+    CCNxFileRepoCacheStorage_Files, // one file per chunk, named by its hex digest
+    CCNxFileRepoCacheStorage_Pack,  // a single append-only packfile with a digest index
+    CCNxFileRepoCacheStorage_MappedPack // a packfile served from a memory mapping, without copies
+} CCNxFileRepoCacheStorage;
+
+/**
+ * How the files loaded into a repo are cut into chunks.
+ */
+typedef enum {
+    CCNxFileRepoCacheChunking_Fixed,  // chunks of the chunk size, at fixed offsets
+    CCNxFileRepoCacheChunking_Content // chunks around the chunk size, cut where the content says (FastCDC)
+} CCNxFileRepoCacheChunking;
+
 /**
  * Create a `CCNxFileRepoCache` instance that stores chunks in the specified
  * directory. Each chunk will be of the specified size.
@@ -83,6 +102,26 @@ typedef struct ccnx_file_repo_cache CCNxFileRepoCache;
  */
 CCNxFileRepoCache *ccnxFileRepoCache_Create(char *directory, size_t chunkSize);
 
+/**
+ * Create a `CCNxFileRepoCache` instance that stores chunks in the specified
+ * directory using the specified layout. Each chunk will be of the specified size.
+ *
+ * @param [in] directory The output chunk directory.
+ * @param [in] chunkSize Chunk size for each entry in the repo.
+ * @param [in] storage The layout of the chunks in `directory`.
+ *
+ * @retval NULL The storage in `directory` could not be opened.
+ * @retval CCNxFileRepoCache A new `CCNxFileRepoCache` instance.
+ *
+ * Example:
+ * @code
+ * {
+ *     CCNxFileRepoCache *cache = ccnxFileRepoCache_CreateWithStorage(".", 4096, CCNxFileRepoCacheStorage_Pack);
+ * }
+ * @endcode
+ */
+CCNxFileRepoCache *ccnxFileRepoCache_CreateWithStorage(char *directory, size_t chunkSize, CCNxFileRepoCacheStorage storage);
+
 /**
  * Increase the number of references to a `CCNxFileRepoCache` instance.
  *
@@ -131,9 +170,160 @@ CCNxFileRepoCache *ccnxFileRepoCache_Create(char *directory, size_t chunkSize);
  */
 void ccnxFileRepoCache_Release(CCNxFileRepoCache **instancePtr);
 
+/**
+ * Keep up to `capacity` bytes of recently served chunks in memory, so that repeated
+ * requests for the same chunk are answered without touching the file system.
+ * A capacity of 0 disables the in-memory cache, which is the initial state.
+ *
+ * @param [in] repo The `CCNxFileRepoCache` instance.
+ * @param [in] capacity The memory budget of the chunk cache, in bytes.
+ *
+ * Example:
+ * @code
+ * {
+ *     CCNxFileRepoCache *cache = ccnxFileRepoCache_Create(".", 4096);
+ *     ccnxFileRepoCache_SetChunkCacheCapacity(cache, 64 * 1024 * 1024);
+ * }
+ * @endcode
+ */
+void ccnxFileRepoCache_SetChunkCacheCapacity(CCNxFileRepoCache *repo, size_t capacity);
+
+/**
+ * Encode and hash the chunks of each file loaded into the cache on `threadCount` threads.
+ * The chunks and manifests stored are the same whatever the number of threads.
+ * A count of 0 or 1, the initial state, loads files on the calling thread.
+ *
+ * @param [in] repo The `CCNxFileRepoCache` instance.
+ * @param [in] threadCount The number of threads that encode chunks.
+ *
+ * Example:
+ * @code
+ * {
+ *     CCNxFileRepoCache *cache = ccnxFileRepoCache_Create(".", 4096);
+ *     ccnxFileRepoCache_SetBuildThreadCount(cache, 8);
+ * }
+ * @endcode
+ */
+void ccnxFileRepoCache_SetBuildThreadCount(CCNxFileRepoCache *repo, size_t threadCount);
+
+/**
+ * Limit the number of pointers in each hash group of the manifests of the files loaded into
+ * the cache. With 0, the initial state, each hash group is filled to its capacity. The limit
+ * and the chunk size given at creation are recorded in each root manifest.
+ *
+ * @param [in] repo The `CCNxFileRepoCache` instance.
+ * @param [in] groupSize 0, or the most pointers in a hash group, at least 2.
+ *
+ * Example:
+ * @code
+ * {
+ *     CCNxFileRepoCache *cache = ccnxFileRepoCache_Create(".", 65536);
+ *     ccnxFileRepoCache_SetGroupSize(cache, 256);
+ * }
+ * @endcode
+ */
+void ccnxFileRepoCache_SetGroupSize(CCNxFileRepoCache *repo, size_t groupSize);
+
+/**
+ * Choose the shape of the manifest trees of the files loaded into the cache. With a fanout
+ * of 0, the initial state, each full HashGroup is chained to the next one, so the depth of
+ * the tree grows with the file. Otherwise manifests form a balanced tree of that fanout,
+ * O(log n) deep, so a consumer learns many data pointers early in the transfer.
+ *
+ * @param [in] repo The `CCNxFileRepoCache` instance.
+ * @param [in] fanout 0 for a skewed tree, or the largest number of children of a manifest, at least 2.
+ *
+ * Example:
+ * @code
+ * {
+ *     CCNxFileRepoCache *cache = ccnxFileRepoCache_Create(".", 4096);
+ *     ccnxFileRepoCache_SetManifestFanout(cache, 64);
+ * }
+ * @endcode
+ */
+void ccnxFileRepoCache_SetManifestFanout(CCNxFileRepoCache *repo, size_t fanout);
+
+/**
+ * Choose how the files loaded into the cache are cut into chunks. With
+ * `CCNxFileRepoCacheChunking_Fixed`, the initial state, every chunk but the last has the
+ * chunk size given at creation. With `CCNxFileRepoCacheChunking_Content` the chunk size is
+ * the average, chunks are up to eight times as long, and their boundaries move with the
+ * content, so a new version of a file shares the chunks its edits did not touch.
+ *
+ * @param [in] repo The `CCNxFileRepoCache` instance.
+ * @param [in] chunking The chunking of the files loaded from now on.
+ *
+ * Example:
+ * @code
+ * {
+ *     CCNxFileRepoCache *cache = ccnxFileRepoCache_Create(".", 8192);
+ *     ccnxFileRepoCache_SetChunking(cache, CCNxFileRepoCacheChunking_Content);
+ * }
+ * @endcode
+ */
+void ccnxFileRepoCache_SetChunking(CCNxFileRepoCache *repo, CCNxFileRepoCacheChunking chunking);
+
+/**
+ * Compress the chunks and manifests stored from now on with zstd at the given level, or store
+ * them uncompressed with a level of 0, the initial state.
+ *
+ * Whatever the level, compressed messages already in the repo are decompressed when they are
+ * read, and the in-memory chunk cache holds them decompressed, so chunks that are requested
+ * over and over are decompressed once. The wire format of the messages does not change.
+ *
+ * @param [in] repo The `CCNxFileRepoCache` instance.
+ * @param [in] level The zstd compression level, or 0.
+ *
+ * @return true if the level was set, false if the repo was built without zstd.
+ *
+ * Example:
+ * @code
+ * {
+ *     CCNxFileRepoCache *cache = ccnxFileRepoCache_CreateWithStorage(".", 8192, CCNxFileRepoCacheStorage_Pack);
+ *     if (!ccnxFileRepoCache_SetCompressionLevel(cache, 3)) {
+ *         printf("Compression is not available\n");
+ *     }
+ * }
+ * @endcode
+ */
+bool ccnxFileRepoCache_SetCompressionLevel(CCNxFileRepoCache *repo, int level);
+
+/**
+ * Return the in-memory chunk cache of the given `CCNxFileRepoCache`, e.g., to read its counters.
+ *
+ * @param [in] repo The `CCNxFileRepoCache` instance.
+ *
+ * @retval NULL The in-memory chunk cache is disabled.
+ * @retval CCNxFileRepoChunkCache The chunk cache, owned by `repo`.
+ */
+CCNxFileRepoChunkCache *ccnxFileRepoCache_GetChunkCache(const CCNxFileRepoCache *repo);
+
+/**
+ * Produce a null-terminated string summarizing the state of the cache.
+ *
+ * The result must be freed by the caller via {@link parcMemory_Deallocate}.
+ *
+ * @param [in] repo The `CCNxFileRepoCache` instance.
+ *
+ * @return A pointer to an allocated, null-terminated C string.
+ */
+char *ccnxFileRepoCache_ToString(const CCNxFileRepoCache *repo);
+
 /**
  * Search for a file (Manifest or Content Object chunk) in the cache by its
- * ContentObjectHashRestriction digest.
+ * ContentObjectHashRestriction digest. Chunks held by the in-memory chunk cache
+ * are returned without any file system access.
+ *
+ * This function may be called from several threads at once, e.g., by a pool of workers
+ * answering interests, as long as no file is being loaded at the same time.
+ *
+ * With `CCNxFileRepoCacheStorage_MappedPack` the result is a read-only view of the
+ * mapped packfile rather than a copy, and the in-memory chunk cache is bypassed since the
+ * mapped pages already live in the page cache. Such a view is only valid inside the section
+ * of `ccnxFileRepoCache_BeginViews` it was read in, since a compaction unmaps the packfile it
+ * replaces once those sections have ended, so every holder of a view (including a portal
+ * with queued messages) must release it before the section ends.
+ * A message stored compressed is decompressed instead, and kept in the chunk cache.
  *
  * @param [in] repo The `CCNxFileRepoCache` instance.
  * @param [in] digest The hash digest of the chunk being sought after.
@@ -152,6 +342,36 @@ void ccnxFileRepoCache_Release(CCNxFileRepoCache **instancePtr);
  */
 PARCBuffer *ccnxFileRepoCache_CreateWireEncodedMessageWithDigest(CCNxFileRepoCache *repo, PARCBuffer *fileName);
 
+/**
+ * Enter a section in which the views returned by `ccnxFileRepoCache_CreateWireEncodedMessageWithDigest`
+ * may be used; see `ccnxFileRepoPackStore_BeginViews`. Without a packfile there are no views,
+ * and the section does nothing.
+ *
+ * @param [in] repo The `CCNxFileRepoCache` instance.
+ *
+ * @return The section entered, to pass to `ccnxFileRepoCache_EndViews`.
+ *
+ * Example:
+ * @code
+ * {
+ *     size_t section = ccnxFileRepoCache_BeginViews(repo);
+ *     PARCBuffer *wireFormat = ccnxFileRepoCache_CreateWireEncodedMessageWithDigest(repo, digest);
+ *     // send wireFormat
+ *     parcBuffer_Release(&wireFormat);
+ *     ccnxFileRepoCache_EndViews(repo, section);
+ * }
+ * @endcode
+ */
+size_t ccnxFileRepoCache_BeginViews(CCNxFileRepoCache *repo);
+
+/**
+ * End the section entered by `ccnxFileRepoCache_BeginViews`.
+ *
+ * @param [in] repo The `CCNxFileRepoCache` instance.
+ * @param [in] section The section returned by `ccnxFileRepoCache_BeginViews`.
+ */
+void ccnxFileRepoCache_EndViews(CCNxFileRepoCache *repo, size_t section);
+
 /**
  * Load the specified file into the repository and give each chunk the specified name.
  *
@@ -173,4 +393,101 @@ PARCBuffer *ccnxFileRepoCache_CreateWireEncodedMessageWithDigest(CCNxFileRepoCac
  * @endcode
  */
 CCNxManifest *ccnxFileRepoCache_LoadFile(CCNxFileRepoCache *cache, CCNxName *name, PARCFile *file);
+
+/**
+ * Publish the file at the specified path under the specified name, loading it into the
+ * repository only if the repository does not already hold it.
+ *
+ * Each publication leaves a small descriptor in the repo directory recording the source
+ * path, its size, inode and modification time, the overall digest of its contents and the
+ * wire format of the root manifest. If a later call finds a descriptor that still matches
+ * the file, and the chunks the root points to are still stored, the root manifest is taken
+ * from the descriptor and the file is not read at all. Otherwise the file is loaded as by
+ * `ccnxFileRepoCache_LoadFile` and a new descriptor is written.
+ *
+ * Next to the descriptor a chunk table records the SHA-256 hash of the content of every chunk
+ * and manifest of the publication. When the file changes, each chunk of the new version is
+ * hashed and looked up there first, and only the chunks that are not found, with the manifests above them, are
+ * encoded, hashed and stored; the rest are the messages already stored for the previous
+ * version. The file is still read in full, to check it and to compute its overall digest.
+ *
+ * With a packfile store, each publication holds a reference to every chunk and manifest it
+ * points to, and chunks it shares with other publications are stored only once. When a
+ * publication is replaced by a new version of the file, the chunks only the old version
+ * referenced are left without references, for `ccnxFileRepoCache_Compact` to reclaim.
+ *
+ * A file may be published while the repo answers interests and is compacted; publications
+ * are published and removed one at a time.
+ *
+ * @param [in] repo The `CCNxFileRepoCache` instance.
+ * @param [in] name The `CCNxName` for each chunk.
+ * @param [in] path The path of the file to publish.
+ *
+ * @retval NULL The file could not be loaded.
+ * @retval CCNxManifest The root `CCNxManifest` for the file.
+ *
+ * Example:
+ * @code
+ * {
+ *     CCNxName *dataName = ccnxName_CreateFromCString("ccnx:/some/file");
+ *
+ *     CCNxManifest *root = ccnxFileRepoCache_PublishFile(repo, dataName, "some_file.bin");
+ * }
+ * @endcode
+ */
+CCNxManifest *ccnxFileRepoCache_PublishFile(CCNxFileRepoCache *cache, CCNxName *name, const char *path);
+
+/**
+ * Remove the publication with the specified name: its descriptor is deleted and it no longer
+ * holds references to its chunks. The chunks stay in the store until the next compaction.
+ *
+ * @param [in] repo The `CCNxFileRepoCache` instance.
+ * @param [in] name The name the file was published under.
+ *
+ * @return true The publication was removed.
+ * @return false There is no publication with that name.
+ *
+ * Example:
+ * @code
+ * {
+ *     CCNxName *dataName = ccnxName_CreateFromCString("ccnx:/some/file");
+ *     ccnxFileRepoCache_RemovePublication(repo, dataName);
+ * }
+ * @endcode
+ */
+bool ccnxFileRepoCache_RemovePublication(CCNxFileRepoCache *cache, const CCNxName *name);
+
+/**
+ * Remove every publication whose source file no longer exists, as by
+ * `ccnxFileRepoCache_RemovePublication`.
+ *
+ * @param [in] repo The `CCNxFileRepoCache` instance.
+ *
+ * @return The number of publications removed.
+ */
+size_t ccnxFileRepoCache_RemoveMissingPublications(CCNxFileRepoCache *cache);
+
+/**
+ * Reclaim the space of the chunks and manifests no publication references any more.
+ *
+ * The reference counts are kept in the packfile's digest index, and counted again from the
+ * publication descriptors when the repo is opened after the index was lost or rebuilt. The
+ * store keeps serving and storing while it is compacted, and is only held up while it
+ * switches to the compacted packfile. Only a packfile store can be compacted.
+ *
+ * @param [in] repo The `CCNxFileRepoCache` instance.
+ *
+ * @return true The store was compacted.
+ * @return false The store is not a packfile, or could not be compacted and is unchanged.
+ *
+ * Example:
+ * @code
+ * {
+ *     CCNxFileRepoCache *cache = ccnxFileRepoCache_CreateWithStorage(".", 4096, CCNxFileRepoCacheStorage_Pack);
+ *     ccnxFileRepoCache_RemoveMissingPublications(cache);
+ *     ccnxFileRepoCache_Compact(cache);
+ * }
+ * @endcode
+ */
+bool ccnxFileRepoCache_Compact(CCNxFileRepoCache *cache);
 #endif // ccnxFileRepoCache_h
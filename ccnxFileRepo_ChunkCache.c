@@ -0,0 +1,408 @@
+/*
+ * Copyright (c) 2016, Xerox Corporation (Xerox) and Palo Alto Research Center, Inc (PARC)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL XEROX OR PARC BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * ################################################################################
+ * #
+ * # PATENT NOTICE
+ * #
+ * # This software is distributed under the BSD 2-clause License (see LICENSE
+ * # file).  This BSD License does not make any patent claims and as such, does
+ * # not act as a patent grant.  The purpose of this section is for each contributor
+ * # to define their intentions with respect to intellectual property.
+ * #
+ * # Each contributor to this source code is encouraged to state their patent
+ * # claims and licensing mechanisms for any contributions made. At the end of
+ * # this section contributors may each make their own statements.  Contributor's
+ * # claims and grants only apply to the pieces (source code, programs, text,
+ * # media, etc) that they have contributed directly to this software.
+ * #
+ * # There is no guarantee that this section is complete, up to date or accurate. It
+ * # is up to the contributors to maintain their portion of this section and up to
+ * # the user of the software to verify any claims herein.
+ * #
+ * # Do not remove this header notification.  The contents of this section must be
+ * # present in all distributions of the software.  You may only modify your own
+ * # intellectual property statements.  Please provide contact information.
+ *
+ * - Palo Alto Research Center, Inc
+ * This software distribution does not grant any rights to patents owned by Palo
+ * Alto Research Center, Inc (PARC). Rights to these patents are available via
+ * various mechanisms. As of January 2016 PARC has committed to FRAND licensing any
+ * intellectual property used by its contributions to this software. You may
+ * contact PARC at cipo@parc.com for more information or visit http://www.ccnx.org
+ */
+/**
+ * @author Christopher A. Wood, Palo Alto Research Center (Xerox PARC)
+ * @copyright (c) 2016, Xerox Corporation (Xerox) and Palo Alto Research Center, Inc (PARC).  All rights reserved.
+ */
+#include <LongBow/runtime.h>
+
+#include <stdio.h>
+#include <string.h>
+#include <inttypes.h>
+#include <pthread.h>
+
+#include <parc/algol/parc_Object.h>
+#include <parc/algol/parc_Memory.h>
+
+#include "ccnxFileRepo_Common.h"
+#include "ccnxFileRepo_ChunkCache.h"
+
+/**
+ * The three queues of the 2Q policy (Johnson and Shasha, VLDB '94).
+ */
+typedef enum {
+    _ChunkCacheQueue_In = 0,   // A1in: resident entries seen once, FIFO
+    _ChunkCacheQueue_Out = 1,  // A1out: digests (only) of entries evicted from A1in, FIFO
+    _ChunkCacheQueue_Main = 2, // Am: resident entries seen more than once, LRU
+    _ChunkCacheQueue_Count = 3
+} _ChunkCacheQueueId;
+
+typedef struct chunk_cache_entry {
+    struct chunk_cache_entry *hashNext;
+    struct chunk_cache_entry *prev;
+    struct chunk_cache_entry *next;
+    uint64_t hash;
+    _ChunkCacheQueueId queue;
+    PARCBuffer *wireFormat; // NULL for entries in A1out
+    size_t cost;
+    size_t digestLength;
+    uint8_t digest[CCNxFileRepoChunkCache_MaxDigestLength];
+} _ChunkCacheEntry;
+
+typedef struct {
+    _ChunkCacheEntry *head; // most recently inserted or used
+    _ChunkCacheEntry *tail; // next to be evicted
+    size_t count;
+    size_t bytes;
+} _ChunkCacheQueue;
+
+struct ccnx_file_repo_chunk_cache {
+    // Guards everything below; a hit reorders the queues, so even lookups take it.
+    pthread_mutex_t lock;
+
+    size_t capacity;
+    size_t inCapacity;
+
+    _ChunkCacheEntry **buckets;
+    size_t bucketCount;
+    size_t entryCount;
+
+    _ChunkCacheQueue queues[_ChunkCacheQueue_Count];
+
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t evictions;
+};
+
+static const size_t _ccnxFileRepoChunkCache_InitialBucketCount = 1024;
+
+static uint64_t
+_ccnxFileRepoChunkCache_Hash(const uint8_t *digest, size_t length)
+{
+    // The keys are cryptographic digests, so their leading bytes are already uniformly distributed.
+    uint64_t hash = 0;
+    memcpy(&hash, digest, length < sizeof(hash) ? length : sizeof(hash));
+    return hash;
+}
+
+static void
+_ccnxFileRepoChunkCache_QueueRemove(CCNxFileRepoChunkCache *cache, _ChunkCacheEntry *entry)
+{
+    _ChunkCacheQueue *queue = &cache->queues[entry->queue];
+    if (entry->prev != NULL) {
+        entry->prev->next = entry->next;
+    } else {
+        queue->head = entry->next;
+    }
+    if (entry->next != NULL) {
+        entry->next->prev = entry->prev;
+    } else {
+        queue->tail = entry->prev;
+    }
+    entry->prev = NULL;
+    entry->next = NULL;
+    queue->count--;
+    queue->bytes -= entry->cost;
+}
+
+static void
+_ccnxFileRepoChunkCache_QueuePush(CCNxFileRepoChunkCache *cache, _ChunkCacheQueueId queueId, _ChunkCacheEntry *entry)
+{
+    _ChunkCacheQueue *queue = &cache->queues[queueId];
+    entry->queue = queueId;
+    entry->prev = NULL;
+    entry->next = queue->head;
+    if (queue->head != NULL) {
+        queue->head->prev = entry;
+    } else {
+        queue->tail = entry;
+    }
+    queue->head = entry;
+    queue->count++;
+    queue->bytes += entry->cost;
+}
+
+static _ChunkCacheEntry *
+_ccnxFileRepoChunkCache_Find(const CCNxFileRepoChunkCache *cache, const uint8_t *digest, size_t length, uint64_t hash)
+{
+    _ChunkCacheEntry *entry = cache->buckets[hash & (cache->bucketCount - 1)];
+    while (entry != NULL) {
+        if (entry->hash == hash && entry->digestLength == length && memcmp(entry->digest, digest, length) == 0) {
+            return entry;
+        }
+        entry = entry->hashNext;
+    }
+    return NULL;
+}
+
+static void
+_ccnxFileRepoChunkCache_Resize(CCNxFileRepoChunkCache *cache)
+{
+    size_t newCount = cache->bucketCount * 2;
+    _ChunkCacheEntry **newBuckets = parcMemory_AllocateAndClear(newCount * sizeof(_ChunkCacheEntry *));
+    assertNotNull(newBuckets, "parcMemory_AllocateAndClear(%zu) returned NULL", newCount * sizeof(_ChunkCacheEntry *));
+
+    for (size_t i = 0; i < cache->bucketCount; i++) {
+        _ChunkCacheEntry *entry = cache->buckets[i];
+        while (entry != NULL) {
+            _ChunkCacheEntry *next = entry->hashNext;
+            size_t index = entry->hash & (newCount - 1);
+            entry->hashNext = newBuckets[index];
+            newBuckets[index] = entry;
+            entry = next;
+        }
+    }
+
+    parcMemory_Deallocate(&cache->buckets);
+    cache->buckets = newBuckets;
+    cache->bucketCount = newCount;
+}
+
+static void
+_ccnxFileRepoChunkCache_Unlink(CCNxFileRepoChunkCache *cache, _ChunkCacheEntry *entry)
+{
+    _ChunkCacheEntry **link = &cache->buckets[entry->hash & (cache->bucketCount - 1)];
+    while (*link != entry) {
+        link = &(*link)->hashNext;
+    }
+    *link = entry->hashNext;
+    cache->entryCount--;
+}
+
+static void
+_ccnxFileRepoChunkCache_Delete(CCNxFileRepoChunkCache *cache, _ChunkCacheEntry *entry)
+{
+    _ccnxFileRepoChunkCache_QueueRemove(cache, entry);
+    _ccnxFileRepoChunkCache_Unlink(cache, entry);
+    if (entry->wireFormat != NULL) {
+        parcBuffer_Release(&entry->wireFormat);
+    }
+    parcMemory_Deallocate(&entry);
+}
+
+/**
+ * Evict resident entries until the cache is within its budget. Entries leaving A1in
+ * are remembered (by digest only) in A1out, entries leaving Am are forgotten.
+ */
+static void
+_ccnxFileRepoChunkCache_Reclaim(CCNxFileRepoChunkCache *cache)
+{
+    _ChunkCacheQueue *in = &cache->queues[_ChunkCacheQueue_In];
+    _ChunkCacheQueue *out = &cache->queues[_ChunkCacheQueue_Out];
+    _ChunkCacheQueue *frequent = &cache->queues[_ChunkCacheQueue_Main];
+
+    while (in->bytes + frequent->bytes > cache->capacity) {
+        if (in->bytes > cache->inCapacity || frequent->tail == NULL) {
+            _ChunkCacheEntry *victim = in->tail;
+            _ccnxFileRepoChunkCache_QueueRemove(cache, victim);
+            parcBuffer_Release(&victim->wireFormat);
+            victim->cost = 0;
+            _ccnxFileRepoChunkCache_QueuePush(cache, _ChunkCacheQueue_Out, victim);
+        } else {
+            _ccnxFileRepoChunkCache_Delete(cache, frequent->tail);
+        }
+        cache->evictions++;
+    }
+
+    // A1out holds at most half as many digests as there are resident entries.
+    size_t outCapacity = (in->count + frequent->count) / 2 + 1;
+    while (out->count > outCapacity) {
+        _ccnxFileRepoChunkCache_Delete(cache, out->tail);
+    }
+}
+
+static bool
+_ccnxFileRepoChunkCache_Destructor(CCNxFileRepoChunkCache **cachePtr)
+{
+    CCNxFileRepoChunkCache *cache = *cachePtr;
+
+    for (size_t i = 0; i < _ChunkCacheQueue_Count; i++) {
+        while (cache->queues[i].tail != NULL) {
+            _ccnxFileRepoChunkCache_Delete(cache, cache->queues[i].tail);
+        }
+    }
+    parcMemory_Deallocate(&cache->buckets);
+    pthread_mutex_destroy(&cache->lock);
+
+    return true;
+}
+
+parcObject_Override(CCNxFileRepoChunkCache, PARCObject,
+                    .destructor = (PARCObjectDestructor *) _ccnxFileRepoChunkCache_Destructor,
+                    .toString = (PARCObjectToString *) ccnxFileRepoChunkCache_ToString);
+
+parcObject_ImplementAcquire(ccnxFileRepoChunkCache, CCNxFileRepoChunkCache);
+parcObject_ImplementRelease(ccnxFileRepoChunkCache, CCNxFileRepoChunkCache);
+
+CCNxFileRepoChunkCache *
+ccnxFileRepoChunkCache_Create(size_t capacity)
+{
+    CCNxFileRepoChunkCache *cache = parcObject_CreateAndClearInstance(CCNxFileRepoChunkCache);
+    if (cache != NULL) {
+        pthread_mutex_init(&cache->lock, NULL);
+        cache->capacity = capacity;
+        cache->inCapacity = capacity / 4; // Kin = 25% of the budget, as recommended for 2Q
+        cache->bucketCount = _ccnxFileRepoChunkCache_InitialBucketCount;
+        cache->buckets = parcMemory_AllocateAndClear(cache->bucketCount * sizeof(_ChunkCacheEntry *));
+        assertNotNull(cache->buckets, "parcMemory_AllocateAndClear(%zu) returned NULL",
+                      cache->bucketCount * sizeof(_ChunkCacheEntry *));
+    }
+    return cache;
+}
+
+PARCBuffer *
+ccnxFileRepoChunkCache_Get(CCNxFileRepoChunkCache *cache, const PARCBuffer *digest)
+{
+    const uint8_t *digestBytes = ccnxFileRepoCommon_GetBufferBytes(digest);
+    size_t digestLength = parcBuffer_Remaining(digest);
+    uint64_t hash = _ccnxFileRepoChunkCache_Hash(digestBytes, digestLength);
+
+    pthread_mutex_lock(&cache->lock);
+    _ChunkCacheEntry *entry = _ccnxFileRepoChunkCache_Find(cache, digestBytes, digestLength, hash);
+    if (entry == NULL || entry->wireFormat == NULL) {
+        cache->misses++;
+        pthread_mutex_unlock(&cache->lock);
+        return NULL;
+    }
+
+    // A1in is a FIFO, so only entries in Am are moved on a hit.
+    if (entry->queue == _ChunkCacheQueue_Main) {
+        _ccnxFileRepoChunkCache_QueueRemove(cache, entry);
+        _ccnxFileRepoChunkCache_QueuePush(cache, _ChunkCacheQueue_Main, entry);
+    }
+
+    cache->hits++;
+    PARCBuffer *result = parcBuffer_Slice(entry->wireFormat);
+    pthread_mutex_unlock(&cache->lock);
+    return result;
+}
+
+void
+ccnxFileRepoChunkCache_Put(CCNxFileRepoChunkCache *cache, const PARCBuffer *digest, const PARCBuffer *wireFormat)
+{
+    size_t digestLength = parcBuffer_Remaining(digest);
+    size_t cost = parcBuffer_Remaining(wireFormat) + sizeof(_ChunkCacheEntry);
+    if (digestLength > CCNxFileRepoChunkCache_MaxDigestLength || cost > cache->inCapacity) {
+        return;
+    }
+
+    const uint8_t *digestBytes = ccnxFileRepoCommon_GetBufferBytes(digest);
+    uint64_t hash = _ccnxFileRepoChunkCache_Hash(digestBytes, digestLength);
+
+    pthread_mutex_lock(&cache->lock);
+    _ChunkCacheEntry *entry = _ccnxFileRepoChunkCache_Find(cache, digestBytes, digestLength, hash);
+    _ChunkCacheQueueId queueId = _ChunkCacheQueue_In;
+    if (entry != NULL) {
+        if (entry->wireFormat != NULL) {
+            pthread_mutex_unlock(&cache->lock);
+            return; // already resident
+        }
+
+        // The digest was evicted from A1in and requested again, so it belongs in Am.
+        _ccnxFileRepoChunkCache_QueueRemove(cache, entry);
+        queueId = _ChunkCacheQueue_Main;
+    } else {
+        entry = parcMemory_AllocateAndClear(sizeof(_ChunkCacheEntry));
+        assertNotNull(entry, "parcMemory_AllocateAndClear(%zu) returned NULL", sizeof(_ChunkCacheEntry));
+        entry->hash = hash;
+        entry->digestLength = digestLength;
+        memcpy(entry->digest, digestBytes, digestLength);
+
+        size_t index = hash & (cache->bucketCount - 1);
+        entry->hashNext = cache->buckets[index];
+        cache->buckets[index] = entry;
+        cache->entryCount++;
+    }
+
+    entry->wireFormat = parcBuffer_Slice(wireFormat);
+    entry->cost = cost;
+    _ccnxFileRepoChunkCache_QueuePush(cache, queueId, entry);
+
+    _ccnxFileRepoChunkCache_Reclaim(cache);
+
+    if (cache->entryCount > cache->bucketCount) {
+        _ccnxFileRepoChunkCache_Resize(cache);
+    }
+    pthread_mutex_unlock(&cache->lock);
+}
+
+uint64_t
+ccnxFileRepoChunkCache_GetHits(const CCNxFileRepoChunkCache *cache)
+{
+    return cache->hits;
+}
+
+uint64_t
+ccnxFileRepoChunkCache_GetMisses(const CCNxFileRepoChunkCache *cache)
+{
+    return cache->misses;
+}
+
+uint64_t
+ccnxFileRepoChunkCache_GetEvictions(const CCNxFileRepoChunkCache *cache)
+{
+    return cache->evictions;
+}
+
+size_t
+ccnxFileRepoChunkCache_GetSize(const CCNxFileRepoChunkCache *cache)
+{
+    return cache->queues[_ChunkCacheQueue_In].bytes + cache->queues[_ChunkCacheQueue_Main].bytes;
+}
+
+size_t
+ccnxFileRepoChunkCache_GetCapacity(const CCNxFileRepoChunkCache *cache)
+{
+    return cache->capacity;
+}
+
+char *
+ccnxFileRepoChunkCache_ToString(const CCNxFileRepoChunkCache *cache)
+{
+    return parcMemory_Format("chunk cache: %zu/%zu bytes, %zu once, %zu frequent, %" PRIu64 " hits, %" PRIu64 " misses, %" PRIu64 " evictions",
+                             ccnxFileRepoChunkCache_GetSize(cache), cache->capacity,
+                             cache->queues[_ChunkCacheQueue_In].count, cache->queues[_ChunkCacheQueue_Main].count,
+                             cache->hits, cache->misses, cache->evictions);
+}
@@ -0,0 +1,237 @@
+/*
+ * Copyright (c) 2016, Xerox Corporation (Xerox) and Palo Alto Research Center, Inc (PARC)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL XEROX OR PARC BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * ################################################################################
+ * #
+ * # PATENT NOTICE
+ * #
+ * # This software is distributed under the BSD 2-clause License (see LICENSE
+ * # file).  This BSD License does not make any patent claims and as such, does
+ * # not act as a patent grant.  The purpose of this section is for each contributor
+ * # to define their intentions with respect to intellectual property.
+ * #
+ * # Each contributor to this source code is encouraged to state their patent
+ * # claims and licensing mechanisms for any contributions made. At the end of
+ * # this section contributors may each make their own statements.  Contributor's
+ * # claims and grants only apply to the pieces (source code, programs, text,
+ * # media, etc) that they have contributed directly to this software.
+ * #
+ * # There is no guarantee that this section is complete, up to date or accurate. It
+ * # is up to the contributors to maintain their portion of this section and up to
+ * # the user of the software to verify any claims herein.
+ * #
+ * # Do not remove this header notification.  The contents of this section must be
+ * # present in all distributions of the software.  You may only modify your own
+ * # intellectual property statements.  Please provide contact information.
+ *
+ * - Palo Alto Research Center, Inc
+ * This software distribution does not grant any rights to patents owned by Palo
+ * Alto Research Center, Inc (PARC). Rights to these patents are available via
+ * various mechanisms. As of January 2016 PARC has committed to FRAND licensing any
+ * intellectual property used by its contributions to this software. You may
+ * contact PARC at cipo@parc.com for more information or visit http://www.ccnx.org
+ */
+/**
+ * @author Christopher A. Wood, Palo Alto Research Center (Xerox PARC)
+ * @copyright (c) 2016, Xerox Corporation (Xerox) and Palo Alto Research Center, Inc (PARC).  All rights reserved.
+ */
+
+#ifndef ccnxFileRepoChunkCache_h
+#define ccnxFileRepoChunkCache_h
+
+#include <stdint.h>
+
+#include <parc/algol/parc_Buffer.h>
+
+struct ccnx_file_repo_chunk_cache;
+typedef struct ccnx_file_repo_chunk_cache CCNxFileRepoChunkCache;
+
+/**
+ * The largest digest (in bytes) that can be used as a key in a `CCNxFileRepoChunkCache`.
+ */
+#define CCNxFileRepoChunkCache_MaxDigestLength 64
+
+/**
+ * Create a `CCNxFileRepoChunkCache` instance that holds at most `capacity` bytes
+ * of wire-encoded messages in memory.
+ *
+ * Entries are managed with the 2Q replacement policy: chunks seen once are kept in
+ * a small FIFO queue and only promoted to the main LRU queue when they are requested
+ * again after being evicted from the FIFO. A sequential scan over a large file therefore
+ * cannot flush the chunks that are requested repeatedly.
+ *
+ * `ccnxFileRepoChunkCache_Get` and `ccnxFileRepoChunkCache_Put` may be called from several threads at once.
+ *
+ * @param [in] capacity The memory budget of the cache, in bytes.
+ *
+ * @return A new `CCNxFileRepoChunkCache` instance.
+ *
+ * Example:
+ * @code
+ * {
+ *     CCNxFileRepoChunkCache *cache = ccnxFileRepoChunkCache_Create(64 * 1024 * 1024);
+ * }
+ * @endcode
+ */
+CCNxFileRepoChunkCache *ccnxFileRepoChunkCache_Create(size_t capacity);
+
+/**
+ * Increase the number of references to a `CCNxFileRepoChunkCache` instance.
+ *
+ * Note that new `CCNxFileRepoChunkCache` is not created,
+ * only that the given `CCNxFileRepoChunkCache` reference count is incremented.
+ * Discard the reference by invoking `ccnxFileRepoChunkCache_Release`.
+ *
+ * @param [in] instance A pointer to a valid CCNxFileRepoChunkCache instance.
+ *
+ * @return The same value as @p instance.
+ *
+ * Example:
+ * @code
+ * {
+ *     CCNxFileRepoChunkCache *a = ccnxFileRepoChunkCache_Create(4096);
+ *
+ *     CCNxFileRepoChunkCache *b = ccnxFileRepoChunkCache_Acquire(a);
+ *
+ *     ccnxFileRepoChunkCache_Release(&a);
+ *     ccnxFileRepoChunkCache_Release(&b);
+ * }
+ * @endcode
+ */
+CCNxFileRepoChunkCache *ccnxFileRepoChunkCache_Acquire(const CCNxFileRepoChunkCache *instance);
+
+/**
+ * Release a previously acquired reference to the given `CCNxFileRepoChunkCache` instance,
+ * decrementing the reference count for the instance.
+ *
+ * The pointer to the instance is set to NULL as a side-effect of this function.
+ *
+ * If the invocation causes the last reference to the instance to be released,
+ * the instance is deallocated and every cached buffer is released.
+ *
+ * @param [in,out] instancePtr A pointer to a pointer to the instance to release.
+ *
+ * Example:
+ * @code
+ * {
+ *     CCNxFileRepoChunkCache *a = ccnxFileRepoChunkCache_Create(4096);
+ *
+ *     ccnxFileRepoChunkCache_Release(&a);
+ * }
+ * @endcode
+ */
+void ccnxFileRepoChunkCache_Release(CCNxFileRepoChunkCache **instancePtr);
+
+/**
+ * Look up the wire-encoded message with the given digest.
+ *
+ * A hit returns a new `PARCBuffer` that shares the cached bytes, so the caller may
+ * move its position and limit freely. Every call updates the hit or miss counter.
+ *
+ * @param [in] cache The `CCNxFileRepoChunkCache` instance.
+ * @param [in] digest The ContentObjectHash digest of the message.
+ *
+ * @retval NULL The message is not in the cache.
+ * @retval PARCBuffer A buffer that must be released by calling `parcBuffer_Release`.
+ *
+ * Example:
+ * @code
+ * {
+ *     PARCBuffer *wireFormat = ccnxFileRepoChunkCache_Get(cache, digest);
+ *     if (wireFormat != NULL) {
+ *         // use the buffer
+ *         parcBuffer_Release(&wireFormat);
+ *     }
+ * }
+ * @endcode
+ */
+PARCBuffer *ccnxFileRepoChunkCache_Get(CCNxFileRepoChunkCache *cache, const PARCBuffer *digest);
+
+/**
+ * Insert the wire-encoded message with the given digest, evicting other entries as
+ * needed to stay within the memory budget. Messages larger than a quarter of the
+ * budget are not cached.
+ *
+ * The bytes between the position and the limit of `wireFormat` are shared, not copied.
+ *
+ * @param [in] cache The `CCNxFileRepoChunkCache` instance.
+ * @param [in] digest The ContentObjectHash digest of the message.
+ * @param [in] wireFormat The wire-encoded message.
+ *
+ * Example:
+ * @code
+ * {
+ *     PARCBuffer *wireFormat = <read from disk>
+ *     ccnxFileRepoChunkCache_Put(cache, digest, wireFormat);
+ * }
+ * @endcode
+ */
+void ccnxFileRepoChunkCache_Put(CCNxFileRepoChunkCache *cache, const PARCBuffer *digest, const PARCBuffer *wireFormat);
+
+/**
+ * Return the number of lookups that were served from the cache.
+ *
+ * @param [in] cache The `CCNxFileRepoChunkCache` instance.
+ */
+uint64_t ccnxFileRepoChunkCache_GetHits(const CCNxFileRepoChunkCache *cache);
+
+/**
+ * Return the number of lookups that were not served from the cache.
+ *
+ * @param [in] cache The `CCNxFileRepoChunkCache` instance.
+ */
+uint64_t ccnxFileRepoChunkCache_GetMisses(const CCNxFileRepoChunkCache *cache);
+
+/**
+ * Return the number of messages that were evicted to stay within the memory budget.
+ *
+ * @param [in] cache The `CCNxFileRepoChunkCache` instance.
+ */
+uint64_t ccnxFileRepoChunkCache_GetEvictions(const CCNxFileRepoChunkCache *cache);
+
+/**
+ * Return the number of bytes currently charged against the memory budget.
+ *
+ * @param [in] cache The `CCNxFileRepoChunkCache` instance.
+ */
+size_t ccnxFileRepoChunkCache_GetSize(const CCNxFileRepoChunkCache *cache);
+
+/**
+ * Return the memory budget of the cache, in bytes.
+ *
+ * @param [in] cache The `CCNxFileRepoChunkCache` instance.
+ */
+size_t ccnxFileRepoChunkCache_GetCapacity(const CCNxFileRepoChunkCache *cache);
+
+/**
+ * Produce a null-terminated string summarizing the cache counters.
+ *
+ * The result must be freed by the caller via {@link parcMemory_Deallocate}.
+ *
+ * @param [in] cache The `CCNxFileRepoChunkCache` instance.
+ *
+ * @return A pointer to an allocated, null-terminated C string.
+ */
+char *ccnxFileRepoChunkCache_ToString(const CCNxFileRepoChunkCache *cache);
+#endif // ccnxFileRepoChunkCache_h
@@ -0,0 +1,435 @@
+/*
+ * Copyright (c) 2016, Xerox Corporation (Xerox) and Palo Alto Research Center, Inc (PARC)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL XEROX OR PARC BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * ################################################################################
+ * #
+ * # PATENT NOTICE
+ * #
+ * # This software is distributed under the BSD 2-clause License (see LICENSE
+ * # file).  This BSD License does not make any patent claims and as such, does
+ * # not act as a patent grant.  The purpose of this section is for each contributor
+ * # to define their intentions with respect to intellectual property.
+ * #
+ * # Each contributor to this source code is encouraged to state their patent
+ * # claims and licensing mechanisms for any contributions made. At the end of
+ * # this section contributors may each make their own statements.  Contributor's
+ * # claims and grants only apply to the pieces (source code, programs, text,
+ * # media, etc) that they have contributed directly to this software.
+ * #
+ * # There is no guarantee that this section is complete, up to date or accurate. It
+ * # is up to the contributors to maintain their portion of this section and up to
+ * # the user of the software to verify any claims herein.
+ * #
+ * # Do not remove this header notification.  The contents of this section must be
+ * # present in all distributions of the software.  You may only modify your own
+ * # intellectual property statements.  Please provide contact information.
+ *
+ * - Palo Alto Research Center, Inc
+ * This software distribution does not grant any rights to patents owned by Palo
+ * Alto Research Center, Inc (PARC). Rights to these patents are available via
+ * various mechanisms. As of January 2016 PARC has committed to FRAND licensing any
+ * intellectual property used by its contributions to this software. You may
+ * contact PARC at cipo@parc.com for more information or visit http://www.ccnx.org
+ */
+/**
+ * @author Christopher A. Wood, Palo Alto Research Center (Xerox PARC)
+ * @copyright (c) 2016, Xerox Corporation (Xerox) and Palo Alto Research Center, Inc (PARC).  All rights reserved.
+ */
+#include <LongBow/runtime.h>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include <parc/algol/parc_Object.h>
+#include <parc/algol/parc_Memory.h>
+
+#include "ccnxFileRepo_ChunkTable.h"
+#include "ccnxFileRepo_Sha256.h"
+
+static const char _ccnxFileRepoChunkTable_Magic[8] = { 'C', 'C', 'N', 'X', 'C', 'H', 'K', '1' };
+// Version 2: entries are keyed by the SHA-256 hash of the content instead of a 128-bit checksum
+static const uint32_t _ccnxFileRepoChunkTable_Version = 2;
+
+#define _ccnxFileRepoChunkTable_DigestLength 32
+
+/**
+ * The file header. It occupies one cache line, so the slots that follow it are cache line aligned.
+ */
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t slotSize;
+    uint64_t slotCount; // always a power of two
+    uint64_t count;
+    uint8_t root[_ccnxFileRepoChunkTable_DigestLength]; // all zero until the table is complete
+} _ChunkTableHeader;
+
+typedef struct {
+    uint8_t hash[CCNxFileRepoSha256_DigestLength];
+    uint32_t length; // 0 marks an empty slot
+    uint32_t type;
+    uint8_t digest[_ccnxFileRepoChunkTable_DigestLength];
+    uint8_t reserved[56];
+} _ChunkTableSlot;
+
+typedef char _ChunkTableHeaderIsOneCacheLine[(sizeof(_ChunkTableHeader) == 64) ? 1 : -1];
+typedef char _ChunkTableSlotIsTwoCacheLines[(sizeof(_ChunkTableSlot) == 128) ? 1 : -1];
+
+struct ccnx_file_repo_chunk_table {
+    char *path;
+    int fd;
+    bool writable;
+
+    uint8_t *base;
+    size_t mappedLength;
+    _ChunkTableHeader *header;
+    _ChunkTableSlot *slots;
+};
+
+void
+ccnxFileRepoChunkTable_ComputeChecksum(const PARCBuffer *content, uint32_t type, CCNxFileRepoChunkChecksum *checksum)
+{
+    size_t length = parcBuffer_Remaining(content);
+    ccnxFileRepoSha256_Digest(parcBuffer_Overlay((PARCBuffer *) content, 0), length, checksum->hash);
+    checksum->length = (uint32_t) length;
+    checksum->type = type;
+}
+
+void
+ccnxFileRepoChunkTable_ComputeChecksums(size_t count, PARCBuffer *const contents[], uint32_t type,
+                                        CCNxFileRepoChunkChecksum checksums[])
+{
+    if (count == 0) {
+        return;
+    }
+
+    const uint8_t *data[count];
+    size_t lengths[count];
+    uint8_t hashes[count][CCNxFileRepoSha256_DigestLength];
+    for (size_t i = 0; i < count; i++) {
+        lengths[i] = parcBuffer_Remaining(contents[i]);
+        data[i] = parcBuffer_Overlay(contents[i], 0);
+    }
+
+    ccnxFileRepoSha256_DigestMany(count, data, lengths, hashes);
+    for (size_t i = 0; i < count; i++) {
+        memcpy(checksums[i].hash, hashes[i], CCNxFileRepoSha256_DigestLength);
+        checksums[i].length = (uint32_t) lengths[i];
+        checksums[i].type = type;
+    }
+}
+
+static size_t
+_ccnxFileRepoChunkTable_MappedLength(uint64_t slotCount)
+{
+    return sizeof(_ChunkTableHeader) + slotCount * sizeof(_ChunkTableSlot);
+}
+
+static bool
+_ccnxFileRepoChunkTable_Matches(const _ChunkTableSlot *slot, const CCNxFileRepoChunkChecksum *checksum)
+{
+    return memcmp(slot->hash, checksum->hash, sizeof(slot->hash)) == 0
+           && slot->length == checksum->length && slot->type == checksum->type;
+}
+
+static _ChunkTableSlot *
+_ccnxFileRepoChunkTable_Probe(_ChunkTableSlot *slots, uint64_t slotCount, const CCNxFileRepoChunkChecksum *checksum)
+{
+    uint64_t start;
+    memcpy(&start, checksum->hash, sizeof(start));
+
+    size_t mask = slotCount - 1;
+    size_t i = start & mask;
+
+    // Linear probing; the load factor is kept below 3/4, so an empty slot is always found.
+    while (slots[i].length != 0 && !_ccnxFileRepoChunkTable_Matches(&slots[i], checksum)) {
+        i = (i + 1) & mask;
+    }
+    return &slots[i];
+}
+
+static void
+_ccnxFileRepoChunkTable_SetTable(CCNxFileRepoChunkTable *table, int fd, uint8_t *base, uint64_t slotCount)
+{
+    table->fd = fd;
+    table->base = base;
+    table->mappedLength = _ccnxFileRepoChunkTable_MappedLength(slotCount);
+    table->header = (_ChunkTableHeader *) base;
+    table->slots = (_ChunkTableSlot *) (base + sizeof(_ChunkTableHeader));
+}
+
+static void
+_ccnxFileRepoChunkTable_UnmapTable(CCNxFileRepoChunkTable *table)
+{
+    if (table->base != NULL) {
+        munmap(table->base, table->mappedLength);
+        table->base = NULL;
+    }
+    if (table->fd >= 0) {
+        close(table->fd);
+        table->fd = -1;
+    }
+}
+
+/**
+ * Create a new, empty table with `slotCount` slots in the file at `path`.
+ */
+static bool
+_ccnxFileRepoChunkTable_CreateTable(const char *path, uint64_t slotCount, int *fdOut, uint8_t **baseOut)
+{
+    int fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        return false;
+    }
+
+    size_t length = _ccnxFileRepoChunkTable_MappedLength(slotCount);
+    void *base = MAP_FAILED;
+    if (ftruncate(fd, length) == 0) {
+        base = mmap(NULL, length, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    }
+    if (base == MAP_FAILED) {
+        close(fd);
+        unlink(path);
+        return false;
+    }
+
+    _ChunkTableHeader *header = base;
+    memcpy(header->magic, _ccnxFileRepoChunkTable_Magic, sizeof(header->magic));
+    header->version = _ccnxFileRepoChunkTable_Version;
+    header->slotSize = sizeof(_ChunkTableSlot);
+    header->slotCount = slotCount;
+    header->count = 0;
+
+    *fdOut = fd;
+    *baseOut = base;
+    return true;
+}
+
+static void
+_ccnxFileRepoChunkTable_Grow(CCNxFileRepoChunkTable *table)
+{
+    uint64_t slotCount = table->header->slotCount * 2;
+    char *growPath = parcMemory_Format("%s.grow", table->path);
+
+    int fd;
+    uint8_t *base;
+    bool created = _ccnxFileRepoChunkTable_CreateTable(growPath, slotCount, &fd, &base);
+    assertTrue(created, "Could not grow the chunk table to %llu slots: %s", (unsigned long long) slotCount, strerror(errno));
+
+    _ChunkTableHeader *header = (_ChunkTableHeader *) base;
+    _ChunkTableSlot *slots = (_ChunkTableSlot *) (base + sizeof(_ChunkTableHeader));
+    for (uint64_t i = 0; i < table->header->slotCount; i++) {
+        const _ChunkTableSlot *slot = &table->slots[i];
+        if (slot->length != 0) {
+            CCNxFileRepoChunkChecksum checksum = { .length = slot->length, .type = slot->type };
+            memcpy(checksum.hash, slot->hash, sizeof(checksum.hash));
+            *_ccnxFileRepoChunkTable_Probe(slots, slotCount, &checksum) = *slot;
+        }
+    }
+    header->count = table->header->count;
+    memcpy(header->root, table->header->root, sizeof(header->root));
+
+    // The table is only complete once it is synced, so there is no need to sync it here.
+    rename(growPath, table->path);
+    parcMemory_Deallocate(&growPath);
+
+    _ccnxFileRepoChunkTable_UnmapTable(table);
+    _ccnxFileRepoChunkTable_SetTable(table, fd, base, slotCount);
+}
+
+static bool
+_ccnxFileRepoChunkTable_Destructor(CCNxFileRepoChunkTable **tablePtr)
+{
+    CCNxFileRepoChunkTable *table = *tablePtr;
+    _ccnxFileRepoChunkTable_UnmapTable(table);
+    parcMemory_Deallocate(&table->path);
+    return true;
+}
+
+parcObject_Override(CCNxFileRepoChunkTable, PARCObject,
+                    .destructor = (PARCObjectDestructor *) _ccnxFileRepoChunkTable_Destructor);
+
+parcObject_ImplementAcquire(ccnxFileRepoChunkTable, CCNxFileRepoChunkTable);
+parcObject_ImplementRelease(ccnxFileRepoChunkTable, CCNxFileRepoChunkTable);
+
+static CCNxFileRepoChunkTable *
+_ccnxFileRepoChunkTable_CreateInstance(const char *path, bool writable)
+{
+    CCNxFileRepoChunkTable *table = parcObject_CreateAndClearInstance(CCNxFileRepoChunkTable);
+    if (table != NULL) {
+        table->fd = -1;
+        table->base = NULL;
+        table->writable = writable;
+        table->path = parcMemory_StringDuplicate(path, strlen(path));
+    }
+    return table;
+}
+
+CCNxFileRepoChunkTable *
+ccnxFileRepoChunkTable_Create(const char *path, size_t initialCapacity)
+{
+    CCNxFileRepoChunkTable *table = _ccnxFileRepoChunkTable_CreateInstance(path, true);
+    if (table == NULL) {
+        return NULL;
+    }
+
+    // Slots are 128 bytes, so start with one 4 KB page worth of slots.
+    uint64_t slotCount = 32;
+    while (slotCount * 3 / 4 < initialCapacity) {
+        slotCount *= 2;
+    }
+
+    int fd;
+    uint8_t *base;
+    if (!_ccnxFileRepoChunkTable_CreateTable(path, slotCount, &fd, &base)) {
+        ccnxFileRepoChunkTable_Release(&table);
+        return NULL;
+    }
+    _ccnxFileRepoChunkTable_SetTable(table, fd, base, slotCount);
+    return table;
+}
+
+CCNxFileRepoChunkTable *
+ccnxFileRepoChunkTable_Open(const char *path)
+{
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return NULL;
+    }
+
+    struct stat statbuf;
+    _ChunkTableHeader header;
+    bool valid = fstat(fd, &statbuf) == 0
+                 && statbuf.st_size >= (off_t) sizeof(header)
+                 && pread(fd, &header, sizeof(header), 0) == sizeof(header)
+                 && memcmp(header.magic, _ccnxFileRepoChunkTable_Magic, sizeof(header.magic)) == 0
+                 && header.version == _ccnxFileRepoChunkTable_Version
+                 && header.slotSize == sizeof(_ChunkTableSlot)
+                 && header.slotCount > 0 && (header.slotCount & (header.slotCount - 1)) == 0
+                 && statbuf.st_size == (off_t) _ccnxFileRepoChunkTable_MappedLength(header.slotCount);
+
+    void *base = MAP_FAILED;
+    if (valid) {
+        base = mmap(NULL, _ccnxFileRepoChunkTable_MappedLength(header.slotCount), PROT_READ, MAP_SHARED, fd, 0);
+    }
+    if (base == MAP_FAILED) {
+        close(fd);
+        return NULL;
+    }
+
+    CCNxFileRepoChunkTable *table = _ccnxFileRepoChunkTable_CreateInstance(path, false);
+    if (table == NULL) {
+        munmap(base, _ccnxFileRepoChunkTable_MappedLength(header.slotCount));
+        close(fd);
+        return NULL;
+    }
+    _ccnxFileRepoChunkTable_SetTable(table, fd, base, header.slotCount);
+    return table;
+}
+
+void
+ccnxFileRepoChunkTable_Put(CCNxFileRepoChunkTable *table, const CCNxFileRepoChunkChecksum *checksum,
+                           const PARCBuffer *digest)
+{
+    assertTrue(table->writable, "Chunk table %s was opened for reading", table->path);
+    assertTrue(checksum->length > 0, "Empty content has no entry");
+    assertTrue(parcBuffer_Remaining(digest) == _ccnxFileRepoChunkTable_DigestLength,
+               "Expected a %d byte digest, got %zu", _ccnxFileRepoChunkTable_DigestLength, parcBuffer_Remaining(digest));
+
+    if ((table->header->count + 1) * 4 > table->header->slotCount * 3) {
+        _ccnxFileRepoChunkTable_Grow(table);
+    }
+
+    _ChunkTableSlot *slot = _ccnxFileRepoChunkTable_Probe(table->slots, table->header->slotCount, checksum);
+    if (slot->length == 0) {
+        memcpy(slot->hash, checksum->hash, sizeof(slot->hash));
+        slot->length = checksum->length;
+        slot->type = checksum->type;
+        table->header->count++;
+    }
+    memcpy(slot->digest, parcBuffer_Overlay((PARCBuffer *) digest, 0), _ccnxFileRepoChunkTable_DigestLength);
+}
+
+PARCBuffer *
+ccnxFileRepoChunkTable_Get(const CCNxFileRepoChunkTable *table, const CCNxFileRepoChunkChecksum *checksum)
+{
+    if (checksum->length == 0) {
+        return NULL;
+    }
+
+    _ChunkTableSlot *slot = _ccnxFileRepoChunkTable_Probe(table->slots, table->header->slotCount, checksum);
+    if (slot->length == 0) {
+        return NULL;
+    }
+
+    PARCBuffer *result = parcBuffer_Allocate(_ccnxFileRepoChunkTable_DigestLength);
+    parcBuffer_PutArray(result, _ccnxFileRepoChunkTable_DigestLength, slot->digest);
+    return parcBuffer_Flip(result);
+}
+
+void
+ccnxFileRepoChunkTable_SetRoot(CCNxFileRepoChunkTable *table, const PARCBuffer *digest)
+{
+    assertTrue(table->writable, "Chunk table %s was opened for reading", table->path);
+    assertTrue(parcBuffer_Remaining(digest) == _ccnxFileRepoChunkTable_DigestLength,
+               "Expected a %d byte digest, got %zu", _ccnxFileRepoChunkTable_DigestLength, parcBuffer_Remaining(digest));
+
+    memcpy(table->header->root, parcBuffer_Overlay((PARCBuffer *) digest, 0), _ccnxFileRepoChunkTable_DigestLength);
+}
+
+bool
+ccnxFileRepoChunkTable_HasRoot(const CCNxFileRepoChunkTable *table, const PARCBuffer *digest)
+{
+    return parcBuffer_Remaining(digest) == _ccnxFileRepoChunkTable_DigestLength
+           && memcmp(table->header->root, parcBuffer_Overlay((PARCBuffer *) digest, 0), _ccnxFileRepoChunkTable_DigestLength) == 0;
+}
+
+size_t
+ccnxFileRepoChunkTable_GetCount(const CCNxFileRepoChunkTable *table)
+{
+    return table->header->count;
+}
+
+bool
+ccnxFileRepoChunkTable_Sync(CCNxFileRepoChunkTable *table)
+{
+    assertTrue(table->writable, "Chunk table %s was opened for reading", table->path);
+    return msync(table->base, table->mappedLength, MS_SYNC) == 0 && fsync(table->fd) == 0;
+}
+
+bool
+ccnxFileRepoChunkTable_Rename(CCNxFileRepoChunkTable *table, const char *path)
+{
+    if (rename(table->path, path) != 0) {
+        return false;
+    }
+    parcMemory_Deallocate(&table->path);
+    table->path = parcMemory_StringDuplicate(path, strlen(path));
+    return true;
+}
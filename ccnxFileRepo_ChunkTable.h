@@ -0,0 +1,261 @@
+/*
+ * Copyright (c) 2016, Xerox Corporation (Xerox) and Palo Alto Research Center, Inc (PARC)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL XEROX OR PARC BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * ################################################################################
+ * #
+ * # PATENT NOTICE
+ * #
+ * # This software is distributed under the BSD 2-clause License (see LICENSE
+ * # file).  This BSD License does not make any patent claims and as such, does
+ * # not act as a patent grant.  The purpose of this section is for each contributor
+ * # to define their intentions with respect to intellectual property.
+ * #
+ * # Each contributor to this source code is encouraged to state their patent
+ * # claims and licensing mechanisms for any contributions made. At the end of
+ * # this section contributors may each make their own statements.  Contributor's
+ * # claims and grants only apply to the pieces (source code, programs, text,
+ * # media, etc) that they have contributed directly to this software.
+ * #
+ * # There is no guarantee that this section is complete, up to date or accurate. It
+ * # is up to the contributors to maintain their portion of this section and up to
+ * # the user of the software to verify any claims herein.
+ * #
+ * # Do not remove this header notification.  The contents of this section must be
+ * # present in all distributions of the software.  You may only modify your own
+ * # intellectual property statements.  Please provide contact information.
+ *
+ * - Palo Alto Research Center, Inc
+ * This software distribution does not grant any rights to patents owned by Palo
+ * Alto Research Center, Inc (PARC). Rights to these patents are available via
+ * various mechanisms. As of January 2016 PARC has committed to FRAND licensing any
+ * intellectual property used by its contributions to this software. You may
+ * contact PARC at cipo@parc.com for more information or visit http://www.ccnx.org
+ */
+/**
+ * @author Christopher A. Wood, Palo Alto Research Center (Xerox PARC)
+ * @copyright (c) 2016, Xerox Corporation (Xerox) and Palo Alto Research Center, Inc (PARC).  All rights reserved.
+ */
+
+#ifndef ccnxFileRepoChunkTable_h
+#define ccnxFileRepoChunkTable_h
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+
+#include <parc/algol/parc_Buffer.h>
+
+#include "ccnxFileRepo_Sha256.h"
+
+struct ccnx_file_repo_chunk_table;
+typedef struct ccnx_file_repo_chunk_table CCNxFileRepoChunkTable;
+
+/**
+ * The SHA-256 hash of the content of a chunk or a manifest, with its length and the
+ * `CCNxManifestHashGroupPointerType` of the message it becomes. A message is reused only for
+ * the content it was made from, so the hash must be collision resistant: anyone who can edit
+ * a published file could otherwise make a chunk that takes the place of another one.
+ */
+typedef struct {
+    uint8_t hash[CCNxFileRepoSha256_DigestLength];
+    uint32_t length;
+    uint32_t type;
+} CCNxFileRepoChunkChecksum;
+
+/**
+ * Compute the checksum of the remaining bytes of `content`, without changing its position.
+ *
+ * Hashing the content alone skips encoding the message and writing it to the store, which
+ * is most of the cost of a chunk that the previous version of a file already had.
+ *
+ * @param [in] content The content of a chunk, or the description of a manifest.
+ * @param [in] type The `CCNxManifestHashGroupPointerType` of the message made from @p content.
+ * @param [out] checksum Set to the checksum.
+ *
+ * Example:
+ * @code
+ * {
+ *     CCNxFileRepoChunkChecksum checksum;
+ *     ccnxFileRepoChunkTable_ComputeChecksum(chunk, CCNxManifestHashGroupPointerType_Data, &checksum);
+ * }
+ * @endcode
+ */
+void ccnxFileRepoChunkTable_ComputeChecksum(const PARCBuffer *content, uint32_t type, CCNxFileRepoChunkChecksum *checksum);
+
+/**
+ * Compute the checksums of the remaining bytes of `count` buffers at once, with the
+ * multi-buffer SHA-256 engine of `ccnxFileRepoSha256_DigestMany`.
+ *
+ * @param [in] count The number of buffers.
+ * @param [in] contents The contents of the chunks, whose positions are not changed.
+ * @param [in] type The `CCNxManifestHashGroupPointerType` of the messages made from @p contents.
+ * @param [out] checksums Set to the checksum of each buffer.
+ */
+void ccnxFileRepoChunkTable_ComputeChecksums(size_t count, PARCBuffer *const contents[], uint32_t type,
+                                             CCNxFileRepoChunkChecksum checksums[]);
+
+/**
+ * Create an empty `CCNxFileRepoChunkTable` in the file at `path`, replacing any file there.
+ *
+ * A chunk table maps the checksums of the chunks and manifests of one publication to the
+ * digests they were stored under. When the publication is built again, a chunk whose
+ * checksum is in the table of the previous version is not encoded or stored again; the
+ * digest from the table is used instead. The table is keyed by content rather than by
+ * position, so a chunk is found again wherever an edit moved it to.
+ *
+ * Like a `CCNxFileRepoDigestIndex`, the table is an open-addressing hash table of slots of
+ * two cache lines in a mapped file, and it grows by rehashing into a new file.
+ *
+ * @param [in] path The path of the table file.
+ * @param [in] initialCapacity The number of entries the table should hold before it grows.
+ *
+ * @return A new `CCNxFileRepoChunkTable` instance, or NULL if the file could not be created or mapped.
+ *
+ * Example:
+ * @code
+ * {
+ *     CCNxFileRepoChunkTable *table = ccnxFileRepoChunkTable_Create("/tmp/repo/file.chunks.tmp", 1024);
+ *     ccnxFileRepoChunkTable_Put(table, &checksum, digest);
+ *     ccnxFileRepoChunkTable_Sync(table);
+ *     ccnxFileRepoChunkTable_Release(&table);
+ * }
+ * @endcode
+ */
+CCNxFileRepoChunkTable *ccnxFileRepoChunkTable_Create(const char *path, size_t initialCapacity);
+
+/**
+ * Open the `CCNxFileRepoChunkTable` in the file at `path` for reading.
+ *
+ * The file is mapped and probed in place, so opening a table takes constant time.
+ *
+ * @param [in] path The path of the table file.
+ *
+ * @return A new, read-only `CCNxFileRepoChunkTable` instance, or NULL if the file does not exist or is not a valid table.
+ */
+CCNxFileRepoChunkTable *ccnxFileRepoChunkTable_Open(const char *path);
+
+/**
+ * Increase the number of references to a `CCNxFileRepoChunkTable` instance.
+ *
+ * @param [in] instance A pointer to a valid CCNxFileRepoChunkTable instance.
+ *
+ * @return The same value as @p instance.
+ */
+CCNxFileRepoChunkTable *ccnxFileRepoChunkTable_Acquire(const CCNxFileRepoChunkTable *instance);
+
+/**
+ * Release a previously acquired reference to the given `CCNxFileRepoChunkTable` instance,
+ * decrementing the reference count for the instance.
+ *
+ * The pointer to the instance is set to NULL as a side-effect of this function.
+ *
+ * @param [in,out] instancePtr A pointer to a pointer to the instance to release.
+ */
+void ccnxFileRepoChunkTable_Release(CCNxFileRepoChunkTable **instancePtr);
+
+/**
+ * Record the digest that the content with the given checksum was stored under. An existing
+ * entry for the same checksum is replaced.
+ *
+ * @param [in] table A `CCNxFileRepoChunkTable` instance made by `ccnxFileRepoChunkTable_Create`.
+ * @param [in] checksum The checksum of the content.
+ * @param [in] digest The SHA-256 ContentObjectHash of the message made from the content.
+ */
+void ccnxFileRepoChunkTable_Put(CCNxFileRepoChunkTable *table, const CCNxFileRepoChunkChecksum *checksum,
+                                const PARCBuffer *digest);
+
+/**
+ * Find the digest that the content with the given checksum was stored under.
+ *
+ * Lookups do not modify the table, so any number of threads may look up at once.
+ *
+ * @param [in] table The `CCNxFileRepoChunkTable` instance.
+ * @param [in] checksum The checksum of the content.
+ *
+ * @return A new `PARCBuffer` holding the digest, or NULL if the checksum is not in the table.
+ *
+ * Example:
+ * @code
+ * {
+ *     PARCBuffer *digest = ccnxFileRepoChunkTable_Get(previous, &checksum);
+ *     if (digest != NULL) {
+ *         // the chunk is already stored under digest
+ *         parcBuffer_Release(&digest);
+ *     }
+ * }
+ * @endcode
+ */
+PARCBuffer *ccnxFileRepoChunkTable_Get(const CCNxFileRepoChunkTable *table, const CCNxFileRepoChunkChecksum *checksum);
+
+/**
+ * Record the digest of the root manifest of the publication the table describes.
+ *
+ * @param [in] table A `CCNxFileRepoChunkTable` instance made by `ccnxFileRepoChunkTable_Create`.
+ * @param [in] digest The SHA-256 ContentObjectHash of the root manifest.
+ */
+void ccnxFileRepoChunkTable_SetRoot(CCNxFileRepoChunkTable *table, const PARCBuffer *digest);
+
+/**
+ * Determine if the table describes the publication with the given root manifest.
+ *
+ * A table is only worth trusting if it belongs to the publication whose references keep
+ * its chunks in the store, so a table left from another version must not be used.
+ *
+ * @param [in] table The `CCNxFileRepoChunkTable` instance.
+ * @param [in] digest The SHA-256 ContentObjectHash of a root manifest.
+ *
+ * @return true The table was recorded for the publication with that root.
+ * @return false The table describes another publication, or none.
+ */
+bool ccnxFileRepoChunkTable_HasRoot(const CCNxFileRepoChunkTable *table, const PARCBuffer *digest);
+
+/**
+ * Return the number of entries in the table.
+ *
+ * @param [in] table The `CCNxFileRepoChunkTable` instance.
+ */
+size_t ccnxFileRepoChunkTable_GetCount(const CCNxFileRepoChunkTable *table);
+
+/**
+ * Write the table to its file and wait for the data to reach the disk.
+ *
+ * @param [in] table A `CCNxFileRepoChunkTable` instance made by `ccnxFileRepoChunkTable_Create`.
+ *
+ * @return true The table is durable.
+ * @return false The table could not be synced.
+ */
+bool ccnxFileRepoChunkTable_Sync(CCNxFileRepoChunkTable *table);
+
+/**
+ * Rename the file of the table, e.g., to move a table that was written under a temporary
+ * name into place once it is complete. The table stays usable.
+ *
+ * @param [in] table The `CCNxFileRepoChunkTable` instance.
+ * @param [in] path The new path of the table file.
+ *
+ * @return true The file was renamed.
+ * @return false The file could not be renamed, and keeps its old path.
+ */
+bool ccnxFileRepoChunkTable_Rename(CCNxFileRepoChunkTable *table, const char *path);
+#endif // ccnxFileRepoChunkTable_h
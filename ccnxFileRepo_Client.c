@@ -56,7 +56,11 @@
  * @author Christopher A. Wood, Palo Alto Research Center (Xerox PARC)
  * @copyright (c) 2016, Xerox Corporation (Xerox) and Palo Alto Research Center, Inc (PARC).  All rights reserved.
  */
+#include <errno.h>
+#include <stdint.h>
 #include <stdio.h>
+#include <string.h>
+#include <time.h>
 #include <unistd.h>
 
 #include <LongBow/runtime.h>
@@ -66,8 +70,6 @@
 
 #include <parc/security/parc_Security.h>
 
-#include <parc/algol/parc_File.h>
-#include <parc/algol/parc_RandomAccessFile.h>
 #include <parc/algol/parc_LinkedList.h>
 #include <parc/algol/parc_FileOutputStream.h>
 
@@ -76,6 +78,7 @@
 
 #include "ccnxFileRepo_Common.h"
 #include "ccnxFileRepo_ManifestFetcher.h"
+#include "ccnxFileRepo_OutputFile.h"
 
 /**
  * Create a new CCNxPortalFactory instance using a randomly generated identity saved to
@@ -113,35 +116,197 @@ _ccnxFileRepoClient_CreateLogger(void)
     return log;
 }
 
+static double
+_ccnxFileRepoClient_Now(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + now.tv_nsec / 1e9;
+}
+
 /**
- * Write the input buffer to the specified file.
- *
- * @param [in] outFile Name of the file to which the buffer will be written.
- * @param [in] data A `PARCBuffer` instance which stores the data to be written.
+ * Fetch the data described by `root` through `portal` into `outFile`, writing each chunk at
+ * its offset as soon as it arrives, and log how much of the time went to writing the output.
  */
-static void
-_ccnxFileRepoClient_AppendBufferToFile(char *outFile, PARCBuffer *data, size_t offset)
+static bool
+_ccnxFileRepoClient_FetchFile(PARCLog *log, CCNxPortal *portal, CCNxManifest *root, const char *outFile,
+                              size_t maxWindow, size_t maxRetransmissions, bool mapped)
+{
+    CCNxFileRepoManifestFetcher *fetcher = ccnxFileRepoManifestFetcher_Create(portal, root);
+    ccnxFileRepoManifestFetcher_SetMaxWindow(fetcher, maxWindow);
+    ccnxFileRepoManifestFetcher_SetMaxRetransmissions(fetcher, maxRetransmissions);
+
+    size_t dataSize = ccnxFileRepoManifestFetcher_GetDataSize(fetcher);
+    parcLog_Info(log, "Fetching %zu bytes in %zu byte chunks.", dataSize, ccnxFileRepoManifestFetcher_GetChunkSize(fetcher));
+
+    double start = _ccnxFileRepoClient_Now();
+    CCNxFileRepoOutputFile *file = ccnxFileRepoOutputFile_Create(outFile, dataSize, mapped);
+    if (file == NULL) {
+        parcLog_Error(log, "Could not create %s: %s", outFile, strerror(errno));
+        ccnxFileRepoManifestFetcher_Release(&fetcher);
+        return false;
+    }
+
+    bool result = true;
+    size_t offset;
+    PARCBuffer *chunk;
+    while (result && (chunk = ccnxFileRepoManifestFetcher_NextChunk(fetcher, &offset)) != NULL) {
+        result = ccnxFileRepoOutputFile_Write(file, offset, chunk);
+        parcBuffer_Release(&chunk);
+    }
+    result = ccnxFileRepoOutputFile_Close(file) && result;
+    if (!result) {
+        parcLog_Error(log, "Could not write %s: %s", outFile, strerror(errno));
+    } else if (!ccnxFileRepoManifestFetcher_IsComplete(fetcher)) {
+        parcLog_Error(log, "Gave up before %s was complete", outFile);
+        result = false;
+    }
+    double elapsed = _ccnxFileRepoClient_Now() - start;
+
+    char *fetcherString = ccnxFileRepoManifestFetcher_ToString(fetcher);
+    parcLog_Info(log, "Done: %s", fetcherString);
+    parcMemory_Deallocate(&fetcherString);
+
+    double ioTime = ccnxFileRepoOutputFile_GetIoTime(file);
+    char *fileString = ccnxFileRepoOutputFile_ToString(file);
+    parcLog_Info(log, "Output I/O took %.3f of %.3f seconds (%.0f%%): %s", ioTime, elapsed,
+                 (elapsed > 0.0) ? 100.0 * ioTime / elapsed : 0.0, fileString);
+    parcMemory_Deallocate(&fileString);
+
+    ccnxFileRepoOutputFile_Release(&file);
+    ccnxFileRepoManifestFetcher_Release(&fetcher);
+    return result;
+}
+
+/**
+ * Read the `length` bytes of the data described by `root` at `offset` through `portal`, fetching
+ * only the manifests and chunks that cover them, and write them to `outFile`. The range is read
+ * a block of `ccnxFileRepoCommon_ClientBufferSize` bytes at a time, so memory does not grow
+ * with it.
+ */
+static bool
+_ccnxFileRepoClient_ReadRange(PARCLog *log, CCNxPortal *portal, CCNxManifest *root, const char *outFile,
+                              size_t maxWindow, size_t maxRetransmissions, size_t offset, size_t length)
+{
+    CCNxFileRepoManifestFetcher *fetcher = ccnxFileRepoManifestFetcher_Create(portal, root);
+    ccnxFileRepoManifestFetcher_SetMaxWindow(fetcher, maxWindow);
+    ccnxFileRepoManifestFetcher_SetMaxRetransmissions(fetcher, maxRetransmissions);
+
+    size_t dataSize = ccnxFileRepoManifestFetcher_GetDataSize(fetcher);
+    size_t available = (offset < dataSize) ? dataSize - offset : 0;
+    if (length > available) {
+        length = available;
+    }
+    parcLog_Info(log, "Reading %zu bytes at offset %zu of %zu.", length, offset, dataSize);
+
+    CCNxFileRepoOutputFile *file = ccnxFileRepoOutputFile_Create(outFile, length, false);
+    if (file == NULL) {
+        parcLog_Error(log, "Could not create %s: %s", outFile, strerror(errno));
+        ccnxFileRepoManifestFetcher_Release(&fetcher);
+        return false;
+    }
+
+    double start = _ccnxFileRepoClient_Now();
+    size_t blockSize = (length < ccnxFileRepoCommon_ClientBufferSize) ? length : ccnxFileRepoCommon_ClientBufferSize;
+    PARCBuffer *buffer = parcBuffer_Allocate(blockSize);
+
+    bool result = true;
+    size_t read = 0;
+    while (result && read < length) {
+        size_t blockLength = (length - read < blockSize) ? length - read : blockSize;
+        parcBuffer_Clear(buffer);
+        size_t blockRead = ccnxFileRepoManifestFetcher_ReadAt(fetcher, offset + read, blockLength, buffer);
+        parcBuffer_Flip(buffer);
+        if (blockRead != blockLength) {
+            parcLog_Error(log, "Gave up after reading %zu of %zu bytes", read + blockRead, length);
+            result = false;
+        } else if (!ccnxFileRepoOutputFile_Write(file, read, buffer)) {
+            parcLog_Error(log, "Could not write %s: %s", outFile, strerror(errno));
+            result = false;
+        }
+        read += blockRead;
+    }
+    parcBuffer_Release(&buffer);
+    double elapsed = _ccnxFileRepoClient_Now() - start;
+
+    if (!ccnxFileRepoOutputFile_Close(file) && result) {
+        parcLog_Error(log, "Could not write %s: %s", outFile, strerror(errno));
+        result = false;
+    }
+    ccnxFileRepoOutputFile_Release(&file);
+
+    char *fetcherString = ccnxFileRepoManifestFetcher_ToString(fetcher);
+    parcLog_Info(log, "Done in %.3f seconds: %s", elapsed, fetcherString);
+    parcMemory_Deallocate(&fetcherString);
+
+    ccnxFileRepoManifestFetcher_Release(&fetcher);
+    return result;
+}
+
+/**
+ * Write the payload of a publication that fits in a single content object to `outFile`.
+ */
+static bool
+_ccnxFileRepoClient_WritePayload(PARCLog *log, PARCBuffer *payload, const char *outFile)
 {
-    PARCFile *out = parcFile_Create(outFile);
-    parcFile_CreateNewFile(out);
+    size_t length = (payload != NULL) ? parcBuffer_Remaining(payload) : 0;
+    CCNxFileRepoOutputFile *file = ccnxFileRepoOutputFile_Create(outFile, length, false);
+    if (file == NULL) {
+        parcLog_Error(log, "Could not create %s: %s", outFile, strerror(errno));
+        return false;
+    }
 
-    PARCRandomAccessFile *fout = parcRandomAccessFile_Open(out);
-    parcRandomAccessFile_Seek(fout, offset, PARCRandomAccessFilePosition_Start);
-    parcRandomAccessFile_Write(fout, data);
-    parcRandomAccessFile_Close(fout);
+    bool result = (length == 0) || ccnxFileRepoOutputFile_Write(file, 0, payload);
+    result = ccnxFileRepoOutputFile_Close(file) && result;
+    if (!result) {
+        parcLog_Error(log, "Could not write %s: %s", outFile, strerror(errno));
+    }
+    ccnxFileRepoOutputFile_Release(&file);
+    return result;
+}
 
-    parcRandomAccessFile_Release(&fout);
-    parcFile_Release(&out);
+/**
+ * Wait up to `timeout` microseconds for a manifest or content object, discarding anything else.
+ *
+ * @return The response, which the caller must release, or NULL if none arrived in time.
+ */
+static CCNxMetaMessage *
+_ccnxFileRepoClient_ReceiveData(CCNxPortal *portal, uint64_t timeout)
+{
+    double deadline = _ccnxFileRepoClient_Now() + timeout / 1e6;
+    double now;
+    while ((now = _ccnxFileRepoClient_Now()) < deadline) {
+        CCNxMetaMessage *response = ccnxPortal_Receive(portal, CCNxStackTimeout_MicroSeconds((uint64_t) ((deadline - now) * 1e6)));
+        if (response == NULL) {
+            break;
+        }
+        if (ccnxMetaMessage_IsManifest(response) || ccnxMetaMessage_IsContentObject(response)) {
+            return response;
+        }
+        ccnxMetaMessage_Release(&response);
+    }
+    return NULL;
 }
 
 /**
- * Run the consumer to fetch the specified file. Save it to disk once transferred.
+ * Run the consumer to fetch the specified file. Save it to disk as it is transferred.
+ *
+ * The interest for the root is sent again if its response does not arrive in time, waiting
+ * twice as long each time, up to `maxRetransmissions` times.
  *
  * @param [in] target Name of the content to request.
- * @param [in] outFile Name of the file to which the buffer will be written.
+ * @param [in] outFile Name of the file to which the content will be written.
+ * @param [in] maxWindow The most interests kept outstanding.
+ * @param [in] maxRetransmissions The most times an interest is sent again before giving up.
+ * @param [in] mapped Whether to write the file through a memory mapping.
+ * @param [in] offset The offset of the data to read, if not the whole file.
+ * @param [in] length The number of bytes to read, or SIZE_MAX for the rest of the file.
+ *
+ * @return true The content was fetched and written.
  */
-static int
-_ccnxFileRepoClient_Run(char *target, char *outFile)
+static bool
+_ccnxFileRepoClient_Run(char *target, char *outFile, size_t maxWindow, size_t maxRetransmissions, bool mapped,
+                        size_t offset, size_t length)
 {
     parcSecurity_Init();
 
@@ -155,60 +320,48 @@ _ccnxFileRepoClient_Run(char *target, char *outFile)
     CCNxInterest *interest = ccnxInterest_CreateSimple(name);
     CCNxMetaMessage *message = ccnxMetaMessage_CreateFromInterest(interest);
 
-    if (ccnxPortal_Send(portal, message, CCNxStackTimeout_Never)) {
-        while (ccnxPortal_IsError(portal) == false) {
-            CCNxMetaMessage *response = ccnxPortal_Receive(portal, CCNxStackTimeout_Never);
-            if (response != NULL) {
-                if (ccnxMetaMessage_IsManifest(response)) {
-                    parcLog_Info(log, "Received root manifest. Beginning to retrieve the content.");
-
-                    // Extract the manifest and instantiate a new fetcher for it
-                    CCNxManifest *root = ccnxMetaMessage_GetManifest(response);
-                    CCNxFileRepoManifestFetcher *fetcher = ccnxFileRepoManifestFetcher_Create(portal, root);
-
-                    // Initialize the file offset and I/O buffer
-                    size_t fileOffset = 0;
-                    PARCBuffer *chunkBuffer = parcBuffer_Allocate(ccnxFileRepoCommon_ClientBufferSize);
-
-                    // Start reading from the manifest until done
-                    bool done = false;
-                    while (!done) {
-                        // Reset the buffer information
-                        parcBuffer_SetPosition(chunkBuffer, 0);
-                        parcBuffer_SetLimit(chunkBuffer, ccnxFileRepoCommon_ClientBufferSize);
-
-                        // Fill the buffer with data from the manifest
-                        done = ccnxFileRepoManifestFetcher_FillBuffer(fetcher, chunkBuffer);
-                        parcBuffer_Flip(chunkBuffer);
-
-                        // Write the buffer to the file
-                        size_t totalSize = parcBuffer_Remaining(chunkBuffer);
-                        _ccnxFileRepoClient_AppendBufferToFile(outFile, chunkBuffer, fileOffset);
-                        fileOffset += totalSize;
-
-                        // Flip the buffer back around for writing
-                        parcBuffer_Flip(chunkBuffer);
-                    }
-                    parcBuffer_Release(&chunkBuffer);
-
-                    break;
-                } else if (ccnxMetaMessage_IsContentObject(response)) {
-                    parcLog_Info(log, "Received a content object. Dump the payload and exit.");
-                    CCNxContentObject *contentObject = ccnxMetaMessage_GetContentObject(response);
-                    PARCBuffer *payload = ccnxContentObject_GetPayload(contentObject);
-                    _ccnxFileRepoClient_AppendBufferToFile(outFile, payload, 0);
-                    break;
-                }
-            }
-            ccnxMetaMessage_Release(&response);
+    CCNxMetaMessage *response = NULL;
+    uint64_t timeout = ccnxFileRepoCommon_ClientInitialTimeout;
+    for (size_t attempt = 0; response == NULL && attempt <= maxRetransmissions; attempt++) {
+        if (attempt > 0) {
+            parcLog_Info(log, "No response after %.1f seconds, sending the interest again.", timeout / 1e6);
+            timeout *= 2;
         }
+        if (!ccnxPortal_Send(portal, message, CCNxStackTimeout_Never)) {
+            parcLog_Error(log, "Could not send the interest for %s", target);
+            break;
+        }
+        response = _ccnxFileRepoClient_ReceiveData(portal, timeout);
+    }
+
+    bool result = false;
+    if (response == NULL) {
+        parcLog_Error(log, "No response for %s, giving up", target);
+    } else if (ccnxMetaMessage_IsManifest(response)) {
+        parcLog_Info(log, "Received root manifest. Beginning to retrieve the content.");
+        CCNxManifest *root = ccnxMetaMessage_GetManifest(response);
+        if (offset > 0 || length < SIZE_MAX) {
+            result = _ccnxFileRepoClient_ReadRange(log, portal, root, outFile, maxWindow, maxRetransmissions, offset, length);
+        } else {
+            result = _ccnxFileRepoClient_FetchFile(log, portal, root, outFile, maxWindow, maxRetransmissions, mapped);
+        }
+    } else {
+        parcLog_Info(log, "Received a content object. Dump the payload and exit.");
+        CCNxContentObject *contentObject = ccnxMetaMessage_GetContentObject(response);
+        result = _ccnxFileRepoClient_WritePayload(log, ccnxContentObject_GetPayload(contentObject), outFile);
+    }
+    if (response != NULL) {
+        ccnxMetaMessage_Release(&response);
     }
+    ccnxMetaMessage_Release(&message);
+    ccnxInterest_Release(&interest);
+    ccnxName_Release(&name);
 
     ccnxPortal_Release(&portal);
     ccnxPortalFactory_Release(&factory);
 
     parcSecurity_Fini();
-    return 0;
+    return result;
 }
 
 /**
@@ -223,12 +376,20 @@ _ccnxFileRepoClient_DisplayUsage(const char *programName)
     printf("This example file transfer application showcases how a Manifest can be created from a file\n");
     printf("stored in a repository, and served upon request from a consumer.\n");
     printf("\n");
-    printf("Usage: %s [-h] <data name> <output name>\n", programName);
+    printf("Usage: %s [-h] [--window=<n>] [--retries=<n>] [--mmap] [--offset=<bytes>] [--length=<bytes>] <data name> <output name>\n",
+           programName);
     printf("\n");
     printf("   e.g. %s ccnx:/producer/file output.bin\n", programName);
     printf("\n");
     printf("  'data name': the name of the content to request\n");
     printf("  'output name': the file in which the content will be stored\n");
+    printf("  '--window': the most interests kept outstanding (default %zu, 1 to fetch one chunk at a time)\n",
+           ccnxFileRepoCommon_ClientMaxWindow);
+    printf("  '--retries': the most times an interest is sent again before giving up (default %zu)\n",
+           ccnxFileRepoCommon_ClientMaxRetransmissions);
+    printf("  '--mmap': write the output file through a memory mapping instead of in %zu byte batches\n",
+           ccnxFileRepoCommon_ClientBufferSize);
+    printf("  '--offset', '--length': read only these bytes of the content, fetching only the manifests and chunks that hold them\n");
     printf("  '-h' will show this help\n\n");
 }
 
@@ -239,10 +400,13 @@ main(int argc, char *argv[argc])
 
     char *commandArgs[argc];
     int commandArgCount = 0;
+    char *commandOptions[argc];
+    int commandOptionCount = 0;
     bool needToShowUsage = false;
     bool shouldExit = false;
 
     status = ccnxFileRepoCommon_ProcessCommandLineArguments(argc, argv, &commandArgCount, commandArgs,
+                                                            &commandOptionCount, commandOptions,
                                                             &needToShowUsage, &shouldExit);
 
     if (needToShowUsage) {
@@ -254,7 +418,15 @@ main(int argc, char *argv[argc])
     }
 
     if (commandArgCount == 2) {
-        status = _ccnxFileRepoClient_Run(commandArgs[0], commandArgs[1]) ? EXIT_SUCCESS : EXIT_FAILURE;
+        size_t maxWindow = ccnxFileRepoCommon_GetSizeOption(commandOptionCount, commandOptions, "window",
+                                                            ccnxFileRepoCommon_ClientMaxWindow);
+        size_t maxRetransmissions = ccnxFileRepoCommon_GetSizeOption(commandOptionCount, commandOptions, "retries",
+                                                                     ccnxFileRepoCommon_ClientMaxRetransmissions);
+        bool mapped = ccnxFileRepoCommon_GetOption(commandOptionCount, commandOptions, "mmap") != NULL;
+        size_t offset = ccnxFileRepoCommon_GetSizeOption(commandOptionCount, commandOptions, "offset", 0);
+        size_t length = ccnxFileRepoCommon_GetSizeOption(commandOptionCount, commandOptions, "length", SIZE_MAX);
+        status = _ccnxFileRepoClient_Run(commandArgs[0], commandArgs[1], maxWindow, maxRetransmissions, mapped, offset, length)
+                 ? EXIT_SUCCESS : EXIT_FAILURE;
     } else {
         status = EXIT_FAILURE;
         _ccnxFileRepoClient_DisplayUsage(argv[0]);
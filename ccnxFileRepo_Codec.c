@@ -0,0 +1,275 @@
+/*
+ * Copyright (c) 2016, Xerox Corporation (Xerox) and Palo Alto Research Center, Inc (PARC)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL XEROX OR PARC BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * ################################################################################
+ * #
+ * # PATENT NOTICE
+ * #
+ * # This software is distributed under the BSD 2-clause License (see LICENSE
+ * # file).  This BSD License does not make any patent claims and as such, does
+ * # not act as a patent grant.  The purpose of this section is for each contributor
+ * # to define their intentions with respect to intellectual property.
+ * #
+ * # Each contributor to this source code is encouraged to state their patent
+ * # claims and licensing mechanisms for any contributions made. At the end of
+ * # this section contributors may each make their own statements.  Contributor's
+ * # claims and grants only apply to the pieces (source code, programs, text,
+ * # media, etc) that they have contributed directly to this software.
+ * #
+ * # There is no guarantee that this section is complete, up to date or accurate. It
+ * # is up to the contributors to maintain their portion of this section and up to
+ * # the user of the software to verify any claims herein.
+ * #
+ * # Do not remove this header notification.  The contents of this section must be
+ * # present in all distributions of the software.  You may only modify your own
+ * # intellectual property statements.  Please provide contact information.
+ *
+ * - Palo Alto Research Center, Inc
+ * This software distribution does not grant any rights to patents owned by Palo
+ * Alto Research Center, Inc (PARC). Rights to these patents are available via
+ * various mechanisms. As of January 2016 PARC has committed to FRAND licensing any
+ * intellectual property used by its contributions to this software. You may
+ * contact PARC at cipo@parc.com for more information or visit http://www.ccnx.org
+ */
+/**
+ * @author Christopher A. Wood, Palo Alto Research Center (Xerox PARC)
+ * @copyright (c) 2016, Xerox Corporation (Xerox) and Palo Alto Research Center, Inc (PARC).  All rights reserved.
+ */
+#include <LongBow/runtime.h>
+
+#include <inttypes.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+
+#ifdef CCNX_FILE_REPO_HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+#include <parc/algol/parc_Object.h>
+#include <parc/algol/parc_Memory.h>
+
+#include "ccnxFileRepo_Common.h"
+#include "ccnxFileRepo_Codec.h"
+
+/**
+ * The first bytes of a zstd frame (0xFD2FB528, little endian). Every CCNx packet starts with
+ * its version, 1, so a stored message is never mistaken for a frame.
+ */
+static const uint8_t _ccnxFileRepoCodec_FrameMagic[4] = { 0x28, 0xB5, 0x2F, 0xFD };
+
+struct ccnx_file_repo_codec {
+    int level;
+
+    // Updated by every thread that stores or reads messages
+    uint64_t encodedMessages;
+    uint64_t wireBytes;
+    uint64_t storedBytes;
+    uint64_t decodes;
+    uint64_t decodedBytes;
+    uint64_t decodeNanoseconds;
+};
+
+parcObject_Override(CCNxFileRepoCodec, PARCObject,
+                    .toString = (PARCObjectToString *) ccnxFileRepoCodec_ToString);
+
+parcObject_ImplementAcquire(ccnxFileRepoCodec, CCNxFileRepoCodec);
+parcObject_ImplementRelease(ccnxFileRepoCodec, CCNxFileRepoCodec);
+
+bool
+ccnxFileRepoCodec_IsAvailable(void)
+{
+#ifdef CCNX_FILE_REPO_HAVE_ZSTD
+    return true;
+#else
+    return false;
+#endif
+}
+
+CCNxFileRepoCodec *
+ccnxFileRepoCodec_Create(int level)
+{
+    if (level != 0 && !ccnxFileRepoCodec_IsAvailable()) {
+        return NULL;
+    }
+
+    CCNxFileRepoCodec *codec = parcObject_CreateAndClearInstance(CCNxFileRepoCodec);
+    if (codec != NULL) {
+        codec->level = level;
+    }
+    return codec;
+}
+
+#ifdef CCNX_FILE_REPO_HAVE_ZSTD
+/**
+ * Each thread keeps its own zstd contexts, so that a message is not compressed or
+ * decompressed with a freshly allocated context, which costs about as much as the work itself
+ * for a chunk.
+ */
+static pthread_once_t _ccnxFileRepoCodec_ContextsOnce = PTHREAD_ONCE_INIT;
+static pthread_key_t _ccnxFileRepoCodec_CompressionContext;
+static pthread_key_t _ccnxFileRepoCodec_DecompressionContext;
+
+static void
+_ccnxFileRepoCodec_FreeCompressionContext(void *context)
+{
+    ZSTD_freeCCtx(context);
+}
+
+static void
+_ccnxFileRepoCodec_FreeDecompressionContext(void *context)
+{
+    ZSTD_freeDCtx(context);
+}
+
+static void
+_ccnxFileRepoCodec_CreateContextKeys(void)
+{
+    pthread_key_create(&_ccnxFileRepoCodec_CompressionContext, _ccnxFileRepoCodec_FreeCompressionContext);
+    pthread_key_create(&_ccnxFileRepoCodec_DecompressionContext, _ccnxFileRepoCodec_FreeDecompressionContext);
+}
+
+static ZSTD_CCtx *
+_ccnxFileRepoCodec_GetCompressionContext(void)
+{
+    pthread_once(&_ccnxFileRepoCodec_ContextsOnce, _ccnxFileRepoCodec_CreateContextKeys);
+    ZSTD_CCtx *context = pthread_getspecific(_ccnxFileRepoCodec_CompressionContext);
+    if (context == NULL) {
+        context = ZSTD_createCCtx();
+        pthread_setspecific(_ccnxFileRepoCodec_CompressionContext, context);
+    }
+    return context;
+}
+
+static ZSTD_DCtx *
+_ccnxFileRepoCodec_GetDecompressionContext(void)
+{
+    pthread_once(&_ccnxFileRepoCodec_ContextsOnce, _ccnxFileRepoCodec_CreateContextKeys);
+    ZSTD_DCtx *context = pthread_getspecific(_ccnxFileRepoCodec_DecompressionContext);
+    if (context == NULL) {
+        context = ZSTD_createDCtx();
+        pthread_setspecific(_ccnxFileRepoCodec_DecompressionContext, context);
+    }
+    return context;
+}
+
+static uint64_t
+_ccnxFileRepoCodec_Nanoseconds(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t) now.tv_sec * 1000000000 + now.tv_nsec;
+}
+#endif
+
+PARCBuffer *
+ccnxFileRepoCodec_Encode(CCNxFileRepoCodec *codec, PARCBuffer *wireFormat)
+{
+    size_t length = parcBuffer_Remaining(wireFormat);
+    PARCBuffer *result = NULL;
+
+#ifdef CCNX_FILE_REPO_HAVE_ZSTD
+    if (codec->level != 0) {
+        size_t capacity = ZSTD_compressBound(length);
+        PARCBuffer *frame = parcBuffer_Allocate(capacity);
+        size_t frameLength = ZSTD_compressCCtx(_ccnxFileRepoCodec_GetCompressionContext(), parcBuffer_Overlay(frame, 0), capacity,
+                                               ccnxFileRepoCommon_GetBufferBytes(wireFormat), length, codec->level);
+        if (!ZSTD_isError(frameLength) && frameLength <= length - length / 8) {
+            parcBuffer_SetLimit(frame, frameLength);
+            result = frame;
+        } else {
+            parcBuffer_Release(&frame);
+        }
+    }
+#endif
+
+    if (result == NULL) {
+        result = parcBuffer_Acquire(wireFormat);
+    }
+
+    __atomic_add_fetch(&codec->encodedMessages, 1, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&codec->wireBytes, length, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&codec->storedBytes, parcBuffer_Remaining(result), __ATOMIC_RELAXED);
+    return result;
+}
+
+bool
+ccnxFileRepoCodec_IsEncoded(const PARCBuffer *stored)
+{
+    return parcBuffer_Remaining(stored) >= sizeof(_ccnxFileRepoCodec_FrameMagic)
+           && memcmp(ccnxFileRepoCommon_GetBufferBytes(stored), _ccnxFileRepoCodec_FrameMagic, sizeof(_ccnxFileRepoCodec_FrameMagic)) == 0;
+}
+
+PARCBuffer *
+ccnxFileRepoCodec_Decode(CCNxFileRepoCodec *codec, PARCBuffer *stored)
+{
+    if (!ccnxFileRepoCodec_IsEncoded(stored)) {
+        return parcBuffer_Acquire(stored);
+    }
+
+    PARCBuffer *result = NULL;
+
+#ifdef CCNX_FILE_REPO_HAVE_ZSTD
+    uint64_t start = _ccnxFileRepoCodec_Nanoseconds();
+
+    const uint8_t *frame = ccnxFileRepoCommon_GetBufferBytes(stored);
+    size_t frameLength = parcBuffer_Remaining(stored);
+    unsigned long long length = ZSTD_getFrameContentSize(frame, frameLength);
+    if (length != ZSTD_CONTENTSIZE_UNKNOWN && length != ZSTD_CONTENTSIZE_ERROR && length > 0) {
+        result = parcBuffer_Allocate(length);
+        size_t decodedLength = ZSTD_decompressDCtx(_ccnxFileRepoCodec_GetDecompressionContext(),
+                                                   parcBuffer_Overlay(result, 0), length, frame, frameLength);
+        if (decodedLength != length) {
+            parcBuffer_Release(&result);
+        }
+    }
+
+    if (result != NULL) {
+        __atomic_add_fetch(&codec->decodes, 1, __ATOMIC_RELAXED);
+        __atomic_add_fetch(&codec->decodedBytes, length, __ATOMIC_RELAXED);
+        __atomic_add_fetch(&codec->decodeNanoseconds, _ccnxFileRepoCodec_Nanoseconds() - start, __ATOMIC_RELAXED);
+    }
+#endif
+
+    return result;
+}
+
+char *
+ccnxFileRepoCodec_ToString(const CCNxFileRepoCodec *codec)
+{
+    uint64_t wireBytes = __atomic_load_n(&codec->wireBytes, __ATOMIC_RELAXED);
+    uint64_t storedBytes = __atomic_load_n(&codec->storedBytes, __ATOMIC_RELAXED);
+    uint64_t decodes = __atomic_load_n(&codec->decodes, __ATOMIC_RELAXED);
+    uint64_t decodedBytes = __atomic_load_n(&codec->decodedBytes, __ATOMIC_RELAXED);
+    uint64_t decodeNanoseconds = __atomic_load_n(&codec->decodeNanoseconds, __ATOMIC_RELAXED);
+
+    return parcMemory_Format("codec: %s level %d, %" PRIu64 " messages stored, %.2f:1 compression, "
+                             "%" PRIu64 " decodes of %" PRIu64 " bytes, %.1f us per decode",
+                             ccnxFileRepoCodec_IsAvailable() ? "zstd" : "none", codec->level,
+                             __atomic_load_n(&codec->encodedMessages, __ATOMIC_RELAXED),
+                             (storedBytes > 0) ? (double) wireBytes / storedBytes : 1.0,
+                             decodes, decodedBytes,
+                             (decodes > 0) ? decodeNanoseconds / 1e3 / decodes : 0.0);
+}
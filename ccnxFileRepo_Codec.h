@@ -0,0 +1,171 @@
+/*
+ * Copyright (c) 2016, Xerox Corporation (Xerox) and Palo Alto Research Center, Inc (PARC)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL XEROX OR PARC BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * ################################################################################
+ * #
+ * # PATENT NOTICE
+ * #
+ * # This software is distributed under the BSD 2-clause License (see LICENSE
+ * # file).  This BSD License does not make any patent claims and as such, does
+ * # not act as a patent grant.  The purpose of this section is for each contributor
+ * # to define their intentions with respect to intellectual property.
+ * #
+ * # Each contributor to this source code is encouraged to state their patent
+ * # claims and licensing mechanisms for any contributions made. At the end of
+ * # this section contributors may each make their own statements.  Contributor's
+ * # claims and grants only apply to the pieces (source code, programs, text,
+ * # media, etc) that they have contributed directly to this software.
+ * #
+ * # There is no guarantee that this section is complete, up to date or accurate. It
+ * # is up to the contributors to maintain their portion of this section and up to
+ * # the user of the software to verify any claims herein.
+ * #
+ * # Do not remove this header notification.  The contents of this section must be
+ * # present in all distributions of the software.  You may only modify your own
+ * # intellectual property statements.  Please provide contact information.
+ *
+ * - Palo Alto Research Center, Inc
+ * This software distribution does not grant any rights to patents owned by Palo
+ * Alto Research Center, Inc (PARC). Rights to these patents are available via
+ * various mechanisms. As of January 2016 PARC has committed to FRAND licensing any
+ * intellectual property used by its contributions to this software. You may
+ * contact PARC at cipo@parc.com for more information or visit http://www.ccnx.org
+ */
+/**
+ * @author Christopher A. Wood, Palo Alto Research Center (Xerox PARC)
+ * @copyright (c) 2016, Xerox Corporation (Xerox) and Palo Alto Research Center, Inc (PARC).  All rights reserved.
+ */
+
+#ifndef ccnxFileRepoCodec_h
+#define ccnxFileRepoCodec_h
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include <parc/algol/parc_Buffer.h>
+
+struct ccnx_file_repo_codec;
+typedef struct ccnx_file_repo_codec CCNxFileRepoCodec;
+
+/**
+ * Return true if the repo was built with a compression library, so that stored messages can
+ * be compressed and compressed messages can be read back.
+ *
+ * @return true if compression is available.
+ */
+bool ccnxFileRepoCodec_IsAvailable(void);
+
+/**
+ * Create a `CCNxFileRepoCodec` that turns the wire format of a message into the bytes the repo
+ * stores, and back.
+ *
+ * A stored message is either the wire format itself or a zstd frame of it. A zstd frame starts
+ * with a magic number a CCNx packet cannot start with, so both may live side by side in one
+ * store, and a repo written with compression can be served without it and the other way around
+ * (as long as the repo was built with zstd). The wire format, and with it the digest a message
+ * is stored under, does not change.
+ *
+ * The codec counts the bytes it compresses and the time it spends decompressing, which
+ * `ccnxFileRepoCodec_ToString` reports.
+ *
+ * @param [in] level The zstd compression level of the messages stored from now on, or 0 to store them uncompressed.
+ *
+ * @return A new `CCNxFileRepoCodec` instance, or NULL if @p level is not 0 and compression is not available.
+ *
+ * Example:
+ * @code
+ * {
+ *     CCNxFileRepoCodec *codec = ccnxFileRepoCodec_Create(3);
+ *     PARCBuffer *stored = ccnxFileRepoCodec_Encode(codec, wireFormat);
+ *     ...
+ *     PARCBuffer *decoded = ccnxFileRepoCodec_Decode(codec, stored);
+ *     parcBuffer_Release(&decoded);
+ *     parcBuffer_Release(&stored);
+ *     ccnxFileRepoCodec_Release(&codec);
+ * }
+ * @endcode
+ */
+CCNxFileRepoCodec *ccnxFileRepoCodec_Create(int level);
+
+/**
+ * Increase the number of references to a `CCNxFileRepoCodec` instance.
+ *
+ * @param [in] codec A `CCNxFileRepoCodec` instance.
+ *
+ * @return The input `CCNxFileRepoCodec` pointer.
+ */
+CCNxFileRepoCodec *ccnxFileRepoCodec_Acquire(const CCNxFileRepoCodec *codec);
+
+/**
+ * Release a previously acquired reference to the specified instance,
+ * decrementing the reference count for the instance.
+ *
+ * @param [in,out] codecPtr A pointer to a pointer to the instance to release.
+ */
+void ccnxFileRepoCodec_Release(CCNxFileRepoCodec **codecPtr);
+
+/**
+ * Return the bytes to store for the remaining bytes of `wireFormat`.
+ *
+ * A message is only stored compressed if that saves at least an eighth of its size, so
+ * content that does not compress, e.g., a file that is already compressed, is stored as it
+ * is and costs nothing to read back.
+ *
+ * @param [in] codec A `CCNxFileRepoCodec` instance.
+ * @param [in] wireFormat The wire format of a message.
+ *
+ * @return The bytes to store, which the caller must release; @p wireFormat itself, acquired, if it is stored uncompressed.
+ */
+PARCBuffer *ccnxFileRepoCodec_Encode(CCNxFileRepoCodec *codec, PARCBuffer *wireFormat);
+
+/**
+ * Return true if the remaining bytes of `stored` are a compressed message.
+ *
+ * @param [in] stored The bytes of a stored message.
+ *
+ * @return true if @p stored must be decoded before it is sent.
+ */
+bool ccnxFileRepoCodec_IsEncoded(const PARCBuffer *stored);
+
+/**
+ * Return the wire format of the stored message `stored`.
+ *
+ * @param [in] codec A `CCNxFileRepoCodec` instance.
+ * @param [in] stored The bytes of a stored message.
+ *
+ * @return The wire format, which the caller must release; @p stored itself, acquired, if it is not compressed.
+ * @return NULL if @p stored is compressed and compression is not available, or the frame is corrupt.
+ */
+PARCBuffer *ccnxFileRepoCodec_Decode(CCNxFileRepoCodec *codec, PARCBuffer *stored);
+
+/**
+ * Produce a string describing the codec: the compression level, the compression ratio of the
+ * messages stored through it and the average time a decode took.
+ *
+ * @param [in] codec A `CCNxFileRepoCodec` instance.
+ *
+ * @return A string which must be deallocated by calling parcMemory_Deallocate().
+ */
+char *ccnxFileRepoCodec_ToString(const CCNxFileRepoCodec *codec);
+#endif // ccnxFileRepoCodec_h
@@ -57,6 +57,7 @@
  * @copyright (c) 2016, Xerox Corporation (Xerox) and Palo Alto Research Center, Inc (PARC).  All rights reserved.
  */
 #include <stdio.h>
+#include <string.h>
 
 #include <LongBow/runtime.h>
 
@@ -74,14 +75,62 @@
 const char *ccnxFileRepoCommon_ProgramName = "CCNx 1.0 Single File Manifest Transfer";
 
 /**
- * The server chunk size.
+ * The default server chunk size, which the client learns from each root manifest.
  */
 const size_t ccnxFileRepoCommon_ServerChunkSize = 4096;
 
 /**
- * The client streaming I/O buffer size.
+ * The largest chunk size the server accepts, which leaves room in a 65535-byte packet for
+ * the headers and the name of a chunk.
  */
-const size_t ccnxFileRepoCommon_ClientBufferSize = 16384; // 4*4K
+const size_t ccnxFileRepoCommon_ServerMaximumChunkSize = 61440; // 60K
+
+/**
+ * The size of the aligned batches in which the client writes its output file.
+ */
+const size_t ccnxFileRepoCommon_ClientBufferSize = 1048576; // 1M
+
+/**
+ * The default largest number of interests the client keeps outstanding.
+ */
+const size_t ccnxFileRepoCommon_ClientMaxWindow = 256;
+
+/**
+ * The time the client waits for the response to its first interest before sending it again,
+ * in microseconds, doubled for every retransmission. The fetcher starts from it too, until it
+ * has measured the round-trip time.
+ */
+const size_t ccnxFileRepoCommon_ClientInitialTimeout = 1000000; // 1 s
+
+/**
+ * The default number of times the client sends an interest again before giving up on it.
+ */
+const size_t ccnxFileRepoCommon_ClientMaxRetransmissions = 6;
+
+/**
+ * The default memory budget of the server's in-memory chunk cache.
+ */
+const size_t ccnxFileRepoCommon_ServerChunkCacheSize = 64 * 1024 * 1024;
+
+/**
+ * The default number of interests that may wait for a worker thread in the server.
+ */
+const size_t ccnxFileRepoCommon_ServerQueueDepth = 1024;
+
+/**
+ * The default fanout of the balanced manifest trees built by the server.
+ */
+const size_t ccnxFileRepoCommon_ServerManifestFanout = 64;
+
+/**
+ * The default number of milliseconds a changed file must be left alone before the server republishes it.
+ */
+const size_t ccnxFileRepoCommon_ServerWatchDelay = 250;
+
+/**
+ * The default zstd level the server compresses stored chunks at.
+ */
+const size_t ccnxFileRepoCommon_ServerCompressionLevel = 3;
 
 
 PARCIdentity *
@@ -125,10 +174,12 @@ ccnxFileRepoCommon_SetupPortalFactory(const char *keystoreName,
 int
 ccnxFileRepoCommon_ProcessCommandLineArguments(int argc, char **argv,
                                                int *commandArgCount, char **commandArgs,
+                                               int *commandOptionCount, char **commandOptions,
                                                bool *needToShowUsage, bool *shouldExit)
 {
     int status = EXIT_SUCCESS;
     *commandArgCount = 0;
+    *commandOptionCount = 0;
     *needToShowUsage = false;
 
     for (size_t i = 1; i < argc; i++) {
@@ -140,6 +191,10 @@ ccnxFileRepoCommon_ProcessCommandLineArguments(int argc, char **argv,
                     *shouldExit = true;
                     break;
                 }
+                case '-': { // Long option, interpreted by the caller.
+                    commandOptions[(*commandOptionCount)++] = &arg[2];
+                    break;
+                }
                 default: { // Unexpected '-' option.
                     *needToShowUsage = true;
                     *shouldExit = true;
@@ -154,3 +209,58 @@ ccnxFileRepoCommon_ProcessCommandLineArguments(int argc, char **argv,
     }
     return status;
 }
+
+const char *
+ccnxFileRepoCommon_GetOption(int commandOptionCount, char **commandOptions, const char *optionName)
+{
+    size_t nameLength = strlen(optionName);
+
+    for (int i = 0; i < commandOptionCount; i++) {
+        const char *option = commandOptions[i];
+        if (strncmp(option, optionName, nameLength) == 0) {
+            if (option[nameLength] == '=') {
+                return &option[nameLength + 1];
+            } else if (option[nameLength] == '\0') {
+                return &option[nameLength];
+            }
+        }
+    }
+    return NULL;
+}
+
+size_t
+ccnxFileRepoCommon_GetSizeOption(int commandOptionCount, char **commandOptions,
+                                 const char *optionName, size_t defaultValue)
+{
+    const char *value = ccnxFileRepoCommon_GetOption(commandOptionCount, commandOptions, optionName);
+    if (value == NULL || value[0] == '\0') {
+        return defaultValue;
+    }
+
+    char *suffix = NULL;
+    size_t result = strtoull(value, &suffix, 10);
+    switch (*suffix) {
+        case 'G':
+        case 'g':
+            result *= 1024;
+        // fall through
+        case 'M':
+        case 'm':
+            result *= 1024;
+        // fall through
+        case 'K':
+        case 'k':
+            result *= 1024;
+            break;
+        default:
+            break;
+    }
+    return result;
+}
+
+const uint8_t *
+ccnxFileRepoCommon_GetBufferBytes(const PARCBuffer *buffer)
+{
+    // Overlaying zero bytes yields the address of the position without moving it.
+    return parcBuffer_Overlay((PARCBuffer *) buffer, 0);
+}
@@ -62,6 +62,7 @@
 
 #include <stdint.h>
 
+#include <parc/algol/parc_Buffer.h>
 #include <parc/security/parc_Identity.h>
 
 #include <ccnx/common/ccnx_Name.h>
@@ -74,15 +75,63 @@
 extern const char *ccnxFileRepoCommon_ProgramName;
 
 /**
- * The server chunk size.
+ * The default server chunk size, which the client learns from each root manifest.
  */
 extern const size_t ccnxFileRepoCommon_ServerChunkSize;
 
 /**
- * The client streaming I/O buffer size.
+ * The largest chunk size the server accepts, which leaves room in a 65535-byte packet for
+ * the headers and the name of a chunk.
+ */
+extern const size_t ccnxFileRepoCommon_ServerMaximumChunkSize;
+
+/**
+ * The size of the aligned batches in which the client writes its output file.
  */
 extern const size_t ccnxFileRepoCommon_ClientBufferSize;
 
+/**
+ * The default largest number of interests the client keeps outstanding.
+ */
+extern const size_t ccnxFileRepoCommon_ClientMaxWindow;
+
+/**
+ * The time the client waits for the response to its first interest before sending it again,
+ * in microseconds, doubled for every retransmission. The fetcher starts from it too, until it
+ * has measured the round-trip time.
+ */
+extern const size_t ccnxFileRepoCommon_ClientInitialTimeout;
+
+/**
+ * The default number of times the client sends an interest again before giving up on it.
+ */
+extern const size_t ccnxFileRepoCommon_ClientMaxRetransmissions;
+
+/**
+ * The default memory budget of the server's in-memory chunk cache.
+ */
+extern const size_t ccnxFileRepoCommon_ServerChunkCacheSize;
+
+/**
+ * The default number of interests that may wait for a worker thread in the server.
+ */
+extern const size_t ccnxFileRepoCommon_ServerQueueDepth;
+
+/**
+ * The default fanout of the balanced manifest trees built by the server.
+ */
+extern const size_t ccnxFileRepoCommon_ServerManifestFanout;
+
+/**
+ * The default number of milliseconds a changed file must be left alone before the server republishes it.
+ */
+extern const size_t ccnxFileRepoCommon_ServerWatchDelay;
+
+/**
+ * The default zstd level the server compresses stored chunks at.
+ */
+extern const size_t ccnxFileRepoCommon_ServerCompressionLevel;
+
 /**
  * Creates and returns a new randomly generated Identity, which is required for signing.
  * In a real application, you would actually use a real Identity. The returned instance
@@ -118,13 +167,17 @@ CCNxPortalFactory *ccnxFileRepoCommon_SetupPortalFactory(const char *keystoreNam
  * Process our command line arguments. If we're given '-h' or '-v', we handle them by displaying
  * the usage help or version, respectively. Unexpected will cause a return value of EXIT_FAILURE.
  * While processing the argument array, we also populate a list of pointers to non '-' arguments
- * and return those in the `commandArgs` parameter.
+ * and return those in the `commandArgs` parameter. Long options of the form `--name=value`
+ * or `--name` are returned in the `commandOptions` parameter.
  *
  * @param [in] argc The count of command line arguments in `argv`.
  * @param [in] argv A pointer to the list of command line argument strings.
  * @param [out] commandArgCount A pointer to a int which will contain the number of non '-' arguments in `argv`.
  * @param [out] commandArgs A pointer to an array of pointers. The pointers will be set to the non '-' arguments
  *                          that were passed in in `argv`.
+ * @param [out] commandOptionCount A pointer to a int which will contain the number of '--' options in `argv`.
+ * @param [out] commandOptions A pointer to an array of pointers. The pointers will be set to the '--' options
+ *                          that were passed in in `argv`, without the leading dashes.
  * @param [out] needToShowUsage A pointer to a boolean that will be set to true if the caller should display the
  *                          usage of this application.
  * @param [out] shouldExit A pointer to a boolean that will be set to true if the caller should exit instead of
@@ -134,6 +187,50 @@ CCNxPortalFactory *ccnxFileRepoCommon_SetupPortalFactory(const char *keystoreNam
  */
 int ccnxFileRepoCommon_ProcessCommandLineArguments(int argc, char **argv,
                                                    int *commandArgCount, char **commandArgs,
+                                                   int *commandOptionCount, char **commandOptions,
                                                    bool *needToShowUsage, bool *shouldExit);
 
+/**
+ * Look up the value of a long option collected by `ccnxFileRepoCommon_ProcessCommandLineArguments`.
+ *
+ * @param [in] commandOptionCount The number of options in `commandOptions`.
+ * @param [in] commandOptions The options returned by `ccnxFileRepoCommon_ProcessCommandLineArguments`.
+ * @param [in] optionName The name of the option, without the leading dashes.
+ *
+ * @retval NULL The option was not given.
+ * @retval char* The text following the '=', or an empty string if the option was given without a value.
+ *
+ * Example:
+ * @code
+ * {
+ *     const char *value = ccnxFileRepoCommon_GetOption(commandOptionCount, commandOptions, "cache-size");
+ * }
+ * @endcode
+ */
+const char *ccnxFileRepoCommon_GetOption(int commandOptionCount, char **commandOptions, const char *optionName);
+
+/**
+ * Look up a long option whose value is a size, such as `--cache-size=64M`. The suffixes
+ * 'K', 'M' and 'G' multiply the value by 2^10, 2^20 and 2^30, respectively.
+ *
+ * @param [in] commandOptionCount The number of options in `commandOptions`.
+ * @param [in] commandOptions The options returned by `ccnxFileRepoCommon_ProcessCommandLineArguments`.
+ * @param [in] optionName The name of the option, without the leading dashes.
+ * @param [in] defaultValue The value to return if the option was not given.
+ *
+ * @return The size given by the option, or `defaultValue`.
+ */
+size_t ccnxFileRepoCommon_GetSizeOption(int commandOptionCount, char **commandOptions,
+                                        const char *optionName, size_t defaultValue);
+
+/**
+ * Return a pointer to the bytes between the position and the limit of `buffer`, without
+ * copying them or moving the position. Used to treat digests as plain byte keys.
+ *
+ * @param [in] buffer A `PARCBuffer` instance.
+ *
+ * @return A pointer into the memory of `buffer`, valid for as long as `buffer` is.
+ */
+const uint8_t *ccnxFileRepoCommon_GetBufferBytes(const PARCBuffer *buffer);
+
 #endif // ccnxFileRepoCommon_h
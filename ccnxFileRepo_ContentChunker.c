@@ -0,0 +1,431 @@
+/*
+ * Copyright (c) 2016, Xerox Corporation (Xerox) and Palo Alto Research Center, Inc (PARC)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL XEROX OR PARC BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * ################################################################################
+ * #
+ * # PATENT NOTICE
+ * #
+ * # This software is distributed under the BSD 2-clause License (see LICENSE
+ * # file).  This BSD License does not make any patent claims and as such, does
+ * # not act as a patent grant.  The purpose of this section is for each contributor
+ * # to define their intentions with respect to intellectual property.
+ * #
+ * # Each contributor to this source code is encouraged to state their patent
+ * # claims and licensing mechanisms for any contributions made. At the end of
+ * # this section contributors may each make their own statements.  Contributor's
+ * # claims and grants only apply to the pieces (source code, programs, text,
+ * # media, etc) that they have contributed directly to this software.
+ * #
+ * # There is no guarantee that this section is complete, up to date or accurate. It
+ * # is up to the contributors to maintain their portion of this section and up to
+ * # the user of the software to verify any claims herein.
+ * #
+ * # Do not remove this header notification.  The contents of this section must be
+ * # present in all distributions of the software.  You may only modify your own
+ * # intellectual property statements.  Please provide contact information.
+ *
+ * - Palo Alto Research Center, Inc
+ * This software distribution does not grant any rights to patents owned by Palo
+ * Alto Research Center, Inc (PARC). Rights to these patents are available via
+ * various mechanisms. As of January 2016 PARC has committed to FRAND licensing any
+ * intellectual property used by its contributions to this software. You may
+ * contact PARC at cipo@parc.com for more information or visit http://www.ccnx.org
+ */
+/**
+ * @author Christopher A. Wood, Palo Alto Research Center (Xerox PARC)
+ * @copyright (c) 2016, Xerox Corporation (Xerox) and Palo Alto Research Center, Inc (PARC).  All rights reserved.
+ */
+#include <LongBow/runtime.h>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include <parc/algol/parc_Object.h>
+#include <parc/algol/parc_Memory.h>
+#include <parc/algol/parc_Buffer.h>
+
+#include "ccnxFileRepo_Common.h"
+#include "ccnxFileRepo_ContentChunker.h"
+
+/**
+ * The seed of the gear table. Chunk boundaries depend on the table, so changing it means
+ * no chunk of an existing publication is found again.
+ */
+static const uint64_t _ccnxFileRepoContentChunker_GearSeed = 0x6363786e46696c65ULL;
+
+/**
+ * The size of the window the file is read through, unless the largest chunk is larger.
+ */
+static const size_t _ccnxFileRepoContentChunker_WindowSize = 4 * 1024 * 1024;
+
+struct ccnx_file_repo_content_chunker {
+    int fd;
+    size_t length;
+
+    // The file is read into this window rather than mapped, since a file that is truncated
+    // while it is being published would raise SIGBUS on access to a mapping past its end
+    uint8_t *window;
+    size_t windowCapacity;
+    size_t windowStart;
+    size_t windowLength;
+
+    size_t minimumSize;
+    size_t averageSize;
+    size_t maximumSize;
+
+    // Before the average size a boundary needs more matching bits, after it fewer, so that
+    // chunk sizes cluster around the average (FastCDC normalized chunking).
+    uint64_t strictMask;
+    uint64_t looseMask;
+    uint64_t gear[256];
+
+    PARCBuffer *currentElement;
+};
+
+typedef struct {
+    size_t position;
+
+    // Only for the reverse iterator: the end of every chunk, and how many are left
+    size_t *ends;
+    size_t remaining;
+} _ContentChunkerState;
+
+static bool
+_ccnxFileRepoContentChunker_Destructor(CCNxFileRepoContentChunker **chunkerPtr)
+{
+    CCNxFileRepoContentChunker *chunker = *chunkerPtr;
+    if (chunker->window != NULL) {
+        parcMemory_Deallocate(&chunker->window);
+    }
+    if (chunker->fd >= 0) {
+        close(chunker->fd);
+    }
+    if (chunker->currentElement != NULL) {
+        parcBuffer_Release(&chunker->currentElement);
+    }
+    return true;
+}
+
+parcObject_Override(CCNxFileRepoContentChunker, PARCObject,
+                    .destructor = (PARCObjectDestructor *) _ccnxFileRepoContentChunker_Destructor);
+
+parcObject_ImplementAcquire(ccnxFileRepoContentChunker, CCNxFileRepoContentChunker);
+parcObject_ImplementRelease(ccnxFileRepoContentChunker, CCNxFileRepoContentChunker);
+
+PARCChunkerInterface *CCNxFileRepoContentChunkerAsChunker = &(PARCChunkerInterface) {
+    .ForwardIterator = (void *(*)(const void *))ccnxFileRepoContentChunker_ForwardIterator,
+    .ReverseIterator = (void *(*)(const void *))ccnxFileRepoContentChunker_ReverseIterator,
+    .GetChunkSize = (size_t (*)(const void *))ccnxFileRepoContentChunker_GetChunkSize
+};
+
+/**
+ * Fill the gear table with the splitmix64 sequence, which is fixed by the seed.
+ */
+static void
+_ccnxFileRepoContentChunker_FillGear(uint64_t gear[256])
+{
+    uint64_t state = _ccnxFileRepoContentChunker_GearSeed;
+    for (int i = 0; i < 256; i++) {
+        state += 0x9e3779b97f4a7c15ULL;
+        uint64_t z = state;
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+        gear[i] = z ^ (z >> 31);
+    }
+}
+
+/**
+ * Return a mask of the `bits` most significant bits. With a gear hash each byte is shifted
+ * towards the top, so the top bits depend on the most bytes.
+ */
+static uint64_t
+_ccnxFileRepoContentChunker_TopBits(unsigned bits)
+{
+    return (bits == 0) ? 0 : (~0ULL << (64 - bits));
+}
+
+CCNxFileRepoContentChunker *
+ccnxFileRepoContentChunker_CreateWithBounds(PARCFile *file, size_t minimumSize, size_t averageSize, size_t maximumSize)
+{
+    assertTrue(minimumSize > 0 && minimumSize <= averageSize && averageSize <= maximumSize,
+               "Expected 0 < minimum <= average <= maximum, got %zu, %zu, %zu", minimumSize, averageSize, maximumSize);
+
+    char *path = parcFile_ToString(file);
+    int fd = open(path, O_RDONLY);
+    parcMemory_Deallocate(&path);
+    if (fd < 0) {
+        return NULL;
+    }
+
+    struct stat statbuf;
+    if (fstat(fd, &statbuf) != 0) {
+        close(fd);
+        return NULL;
+    }
+
+    CCNxFileRepoContentChunker *chunker = parcObject_CreateAndClearInstance(CCNxFileRepoContentChunker);
+    chunker->fd = fd;
+    chunker->length = statbuf.st_size;
+    chunker->minimumSize = minimumSize;
+    chunker->averageSize = averageSize;
+    chunker->maximumSize = maximumSize;
+
+    if (chunker->length > 0) {
+        chunker->windowCapacity = (maximumSize > _ccnxFileRepoContentChunker_WindowSize)
+                                  ? maximumSize : _ccnxFileRepoContentChunker_WindowSize;
+        if (chunker->windowCapacity > chunker->length) {
+            chunker->windowCapacity = chunker->length;
+        }
+        chunker->window = parcMemory_Allocate(chunker->windowCapacity);
+        posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+    }
+
+    unsigned bits = 0;
+    while (((size_t) 2 << bits) <= averageSize) {
+        bits++;
+    }
+    chunker->strictMask = _ccnxFileRepoContentChunker_TopBits(bits + 1);
+    chunker->looseMask = _ccnxFileRepoContentChunker_TopBits(bits > 0 ? bits - 1 : 0);
+    _ccnxFileRepoContentChunker_FillGear(chunker->gear);
+
+    return chunker;
+}
+
+CCNxFileRepoContentChunker *
+ccnxFileRepoContentChunker_Create(PARCFile *file, size_t averageSize)
+{
+    assertTrue(averageSize >= 64, "The average chunk size must be at least 64 bytes, got %zu", averageSize);
+
+    // Each chunk must still fit in a packet, so the longest chunks are cut short of 8 times the average
+    size_t maximumSize = averageSize * 8;
+    if (maximumSize > ccnxFileRepoCommon_ServerMaximumChunkSize) {
+        maximumSize = (averageSize > ccnxFileRepoCommon_ServerMaximumChunkSize)
+                      ? averageSize : ccnxFileRepoCommon_ServerMaximumChunkSize;
+    }
+    return ccnxFileRepoContentChunker_CreateWithBounds(file, averageSize / 4, averageSize, maximumSize);
+}
+
+/**
+ * Return the bytes of the file from `start` to `end`, reading them into the window if they
+ * are not there yet. The window is placed to start at `start`, or to end at `end` when the
+ * file is walked backwards. Bytes that are gone because the file was truncated while it was
+ * read are zero; the file changed, so the publication is built again anyway.
+ */
+static const uint8_t *
+_ccnxFileRepoContentChunker_GetBytes(CCNxFileRepoContentChunker *chunker, size_t start, size_t end)
+{
+    if (start >= chunker->windowStart && end <= chunker->windowStart + chunker->windowLength) {
+        return chunker->window + (start - chunker->windowStart);
+    }
+
+    size_t windowStart = start;
+    if (start < chunker->windowStart && end > chunker->windowCapacity) {
+        windowStart = end - chunker->windowCapacity;
+    } else if (start < chunker->windowStart) {
+        windowStart = 0;
+    }
+    size_t windowLength = chunker->length - windowStart;
+    if (windowLength > chunker->windowCapacity) {
+        windowLength = chunker->windowCapacity;
+    }
+
+    size_t done = 0;
+    while (done < windowLength) {
+        ssize_t count = pread(chunker->fd, chunker->window + done, windowLength - done, windowStart + done);
+        if (count < 0 && errno == EINTR) {
+            continue;
+        }
+        if (count <= 0) {
+            memset(chunker->window + done, 0, windowLength - done);
+            break;
+        }
+        done += count;
+    }
+
+    chunker->windowStart = windowStart;
+    chunker->windowLength = windowLength;
+    return chunker->window + (start - windowStart);
+}
+
+/**
+ * Return the length of the chunk that starts at `offset`.
+ *
+ * The first `minimumSize` bytes are skipped rather than hashed, since no boundary may fall
+ * there, and the gear hash needs only a shift, an add and a table lookup per byte after that.
+ */
+static size_t
+_ccnxFileRepoContentChunker_FindBoundary(CCNxFileRepoContentChunker *chunker, size_t offset)
+{
+    size_t available = chunker->length - offset;
+    if (available <= chunker->minimumSize) {
+        return available;
+    }
+
+    size_t normal = (available < chunker->averageSize) ? available : chunker->averageSize;
+    size_t limit = (available < chunker->maximumSize) ? available : chunker->maximumSize;
+    const uint8_t *bytes = _ccnxFileRepoContentChunker_GetBytes(chunker, offset, offset + limit);
+    const uint64_t *gear = chunker->gear;
+    uint64_t hash = 0;
+
+    size_t i = chunker->minimumSize;
+    for (; i < normal; i++) {
+        hash = (hash << 1) + gear[bytes[i]];
+        if ((hash & chunker->strictMask) == 0) {
+            return i + 1;
+        }
+    }
+    for (; i < limit; i++) {
+        hash = (hash << 1) + gear[bytes[i]];
+        if ((hash & chunker->looseMask) == 0) {
+            return i + 1;
+        }
+    }
+    return limit;
+}
+
+static void
+_ccnxFileRepoContentChunker_SetCurrentElement(CCNxFileRepoContentChunker *chunker, size_t start, size_t end)
+{
+    if (chunker->currentElement != NULL) {
+        parcBuffer_Release(&chunker->currentElement);
+    }
+
+    // As with PARCFileChunker, the caller owns the element it is handed and the chunker keeps
+    // its own reference until the next one.
+    PARCBuffer *chunk = parcBuffer_CreateFromArray(_ccnxFileRepoContentChunker_GetBytes(chunker, start, end), end - start);
+    chunker->currentElement = parcBuffer_Acquire(chunk);
+}
+
+static void *
+_ccnxFileRepoContentChunker_InitForward(CCNxFileRepoContentChunker *chunker)
+{
+    _ContentChunkerState *state = parcMemory_AllocateAndClear(sizeof(_ContentChunkerState));
+    return state;
+}
+
+static void *
+_ccnxFileRepoContentChunker_InitReverse(CCNxFileRepoContentChunker *chunker)
+{
+    _ContentChunkerState *state = parcMemory_AllocateAndClear(sizeof(_ContentChunkerState));
+
+    size_t capacity = 1024;
+    state->ends = parcMemory_Allocate(capacity * sizeof(size_t));
+    size_t position = 0;
+    while (position < chunker->length) {
+        if (state->remaining == capacity) {
+            capacity *= 2;
+            state->ends = parcMemory_Reallocate(state->ends, capacity * sizeof(size_t));
+        }
+        position += _ccnxFileRepoContentChunker_FindBoundary(chunker, position);
+        state->ends[state->remaining++] = position;
+    }
+    return state;
+}
+
+static bool
+_ccnxFileRepoContentChunker_HasNextForward(CCNxFileRepoContentChunker *chunker, _ContentChunkerState *state)
+{
+    return state->position < chunker->length;
+}
+
+static bool
+_ccnxFileRepoContentChunker_HasNextReverse(CCNxFileRepoContentChunker *chunker, _ContentChunkerState *state)
+{
+    return state->remaining > 0;
+}
+
+static void *
+_ccnxFileRepoContentChunker_NextForward(CCNxFileRepoContentChunker *chunker, _ContentChunkerState *state)
+{
+    size_t end = state->position + _ccnxFileRepoContentChunker_FindBoundary(chunker, state->position);
+    _ccnxFileRepoContentChunker_SetCurrentElement(chunker, state->position, end);
+    state->position = end;
+    return state;
+}
+
+static void *
+_ccnxFileRepoContentChunker_NextReverse(CCNxFileRepoContentChunker *chunker, _ContentChunkerState *state)
+{
+    state->remaining--;
+    size_t start = (state->remaining == 0) ? 0 : state->ends[state->remaining - 1];
+    _ccnxFileRepoContentChunker_SetCurrentElement(chunker, start, state->ends[state->remaining]);
+    return state;
+}
+
+static void *
+_ccnxFileRepoContentChunker_GetElement(CCNxFileRepoContentChunker *chunker, _ContentChunkerState *state)
+{
+    return chunker->currentElement;
+}
+
+static void
+_ccnxFileRepoContentChunker_Finish(CCNxFileRepoContentChunker *chunker, _ContentChunkerState *state)
+{
+    if (state->ends != NULL) {
+        parcMemory_Deallocate(&state->ends);
+    }
+    parcMemory_Deallocate(&state);
+}
+
+static void
+_ccnxFileRepoContentChunker_AssertValid(const void *state)
+{
+    // Nothing to validate
+}
+
+PARCIterator *
+ccnxFileRepoContentChunker_ForwardIterator(const CCNxFileRepoContentChunker *chunker)
+{
+    return parcIterator_Create((void *) chunker,
+                               (void *(*)(PARCObject *))_ccnxFileRepoContentChunker_InitForward,
+                               (bool (*)(PARCObject *, void *))_ccnxFileRepoContentChunker_HasNextForward,
+                               (void *(*)(PARCObject *, void *))_ccnxFileRepoContentChunker_NextForward,
+                               NULL,
+                               (void *(*)(PARCObject *, void *))_ccnxFileRepoContentChunker_GetElement,
+                               (void (*)(PARCObject *, void *))_ccnxFileRepoContentChunker_Finish,
+                               (void (*)(const void *))_ccnxFileRepoContentChunker_AssertValid);
+}
+
+PARCIterator *
+ccnxFileRepoContentChunker_ReverseIterator(const CCNxFileRepoContentChunker *chunker)
+{
+    return parcIterator_Create((void *) chunker,
+                               (void *(*)(PARCObject *))_ccnxFileRepoContentChunker_InitReverse,
+                               (bool (*)(PARCObject *, void *))_ccnxFileRepoContentChunker_HasNextReverse,
+                               (void *(*)(PARCObject *, void *))_ccnxFileRepoContentChunker_NextReverse,
+                               NULL,
+                               (void *(*)(PARCObject *, void *))_ccnxFileRepoContentChunker_GetElement,
+                               (void (*)(PARCObject *, void *))_ccnxFileRepoContentChunker_Finish,
+                               (void (*)(const void *))_ccnxFileRepoContentChunker_AssertValid);
+}
+
+size_t
+ccnxFileRepoContentChunker_GetChunkSize(const CCNxFileRepoContentChunker *chunker)
+{
+    return chunker->maximumSize;
+}
@@ -0,0 +1,158 @@
+/*
+ * Copyright (c) 2016, Xerox Corporation (Xerox) and Palo Alto Research Center, Inc (PARC)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL XEROX OR PARC BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * ################################################################################
+ * #
+ * # PATENT NOTICE
+ * #
+ * # This software is distributed under the BSD 2-clause License (see LICENSE
+ * # file).  This BSD License does not make any patent claims and as such, does
+ * # not act as a patent grant.  The purpose of this section is for each contributor
+ * # to define their intentions with respect to intellectual property.
+ * #
+ * # Each contributor to this source code is encouraged to state their patent
+ * # claims and licensing mechanisms for any contributions made. At the end of
+ * # this section contributors may each make their own statements.  Contributor's
+ * # claims and grants only apply to the pieces (source code, programs, text,
+ * # media, etc) that they have contributed directly to this software.
+ * #
+ * # There is no guarantee that this section is complete, up to date or accurate. It
+ * # is up to the contributors to maintain their portion of this section and up to
+ * # the user of the software to verify any claims herein.
+ * #
+ * # Do not remove this header notification.  The contents of this section must be
+ * # present in all distributions of the software.  You may only modify your own
+ * # intellectual property statements.  Please provide contact information.
+ *
+ * - Palo Alto Research Center, Inc
+ * This software distribution does not grant any rights to patents owned by Palo
+ * Alto Research Center, Inc (PARC). Rights to these patents are available via
+ * various mechanisms. As of January 2016 PARC has committed to FRAND licensing any
+ * intellectual property used by its contributions to this software. You may
+ * contact PARC at cipo@parc.com for more information or visit http://www.ccnx.org
+ */
+/**
+ * @author Christopher A. Wood, Palo Alto Research Center (Xerox PARC)
+ * @copyright (c) 2016, Xerox Corporation (Xerox) and Palo Alto Research Center, Inc (PARC).  All rights reserved.
+ */
+
+#ifndef ccnxFileRepoContentChunker_h
+#define ccnxFileRepoContentChunker_h
+
+#include <stddef.h>
+
+#include <parc/algol/parc_Chunker.h>
+#include <parc/algol/parc_File.h>
+#include <parc/algol/parc_Iterator.h>
+
+struct ccnx_file_repo_content_chunker;
+typedef struct ccnx_file_repo_content_chunker CCNxFileRepoContentChunker;
+
+/**
+ * The mapping from a `CCNxFileRepoContentChunker` to the `PARCChunker` interface.
+ */
+extern PARCChunkerInterface *CCNxFileRepoContentChunkerAsChunker;
+
+/**
+ * Create a `CCNxFileRepoContentChunker` that cuts a file into content-defined chunks.
+ *
+ * Chunk boundaries are placed where a rolling gear hash of the preceding bytes matches a
+ * mask, as in FastCDC, so they depend on the content around them rather than on offsets:
+ * inserting or removing bytes only changes the chunks next to the edit, and a new version
+ * of a file shares the rest of its chunks with the old one. Chunks are between a quarter
+ * and eight times `averageSize` long, but no longer than `ccnxFileRepoCommon_ServerMaximumChunkSize`
+ * so that each fits in a packet, and close to `averageSize` on average.
+ *
+ * @param [in] file The `PARCFile` to chunk.
+ * @param [in] averageSize The target chunk size, in bytes, at least 64.
+ *
+ * @return A new `CCNxFileRepoContentChunker` instance, or NULL if the file could not be read.
+ *
+ * Example:
+ * @code
+ * {
+ *     PARCFile *file = parcFile_Create("/path/to/file");
+ *     CCNxFileRepoContentChunker *contentChunker = ccnxFileRepoContentChunker_Create(file, 8192);
+ *     PARCChunker *chunker = parcChunker_Create(contentChunker, CCNxFileRepoContentChunkerAsChunker);
+ *     ccnxFileRepoContentChunker_Release(&contentChunker);
+ * }
+ * @endcode
+ */
+CCNxFileRepoContentChunker *ccnxFileRepoContentChunker_Create(PARCFile *file, size_t averageSize);
+
+/**
+ * Create a `CCNxFileRepoContentChunker` with explicit bounds on the chunk size.
+ *
+ * @param [in] file The `PARCFile` to chunk.
+ * @param [in] minimumSize No chunk but the last is shorter than this.
+ * @param [in] averageSize The target chunk size, between the two bounds.
+ * @param [in] maximumSize No chunk is longer than this.
+ *
+ * @return A new `CCNxFileRepoContentChunker` instance, or NULL if the file could not be read.
+ */
+CCNxFileRepoContentChunker *ccnxFileRepoContentChunker_CreateWithBounds(PARCFile *file, size_t minimumSize,
+                                                                       size_t averageSize, size_t maximumSize);
+
+/**
+ * Increase the number of references to a `CCNxFileRepoContentChunker` instance.
+ *
+ * @param [in] instance A pointer to a valid CCNxFileRepoContentChunker instance.
+ *
+ * @return The same value as @p instance.
+ */
+CCNxFileRepoContentChunker *ccnxFileRepoContentChunker_Acquire(const CCNxFileRepoContentChunker *instance);
+
+/**
+ * Release a previously acquired reference to the given `CCNxFileRepoContentChunker` instance,
+ * decrementing the reference count for the instance.
+ *
+ * The pointer to the instance is set to NULL as a side-effect of this function.
+ *
+ * @param [in,out] instancePtr A pointer to a pointer to the instance to release.
+ */
+void ccnxFileRepoContentChunker_Release(CCNxFileRepoContentChunker **instancePtr);
+
+/**
+ * Return an iterator over the chunks of the file, from the first to the last. Each element
+ * is a new `PARCBuffer` that the caller must release.
+ *
+ * @param [in] chunker The `CCNxFileRepoContentChunker` instance.
+ */
+PARCIterator *ccnxFileRepoContentChunker_ForwardIterator(const CCNxFileRepoContentChunker *chunker);
+
+/**
+ * Return an iterator over the same chunks as `ccnxFileRepoContentChunker_ForwardIterator`,
+ * from the last to the first. The boundaries of all the chunks are found when it is created.
+ *
+ * @param [in] chunker The `CCNxFileRepoContentChunker` instance.
+ */
+PARCIterator *ccnxFileRepoContentChunker_ReverseIterator(const CCNxFileRepoContentChunker *chunker);
+
+/**
+ * Return the largest chunk size, which bounds every chunk produced.
+ *
+ * @param [in] chunker The `CCNxFileRepoContentChunker` instance.
+ */
+size_t ccnxFileRepoContentChunker_GetChunkSize(const CCNxFileRepoContentChunker *chunker);
+#endif // ccnxFileRepoContentChunker_h
@@ -0,0 +1,534 @@
+/*
+ * Copyright (c) 2016, Xerox Corporation (Xerox) and Palo Alto Research Center, Inc (PARC)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL XEROX OR PARC BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * ################################################################################
+ * #
+ * # PATENT NOTICE
+ * #
+ * # This software is distributed under the BSD 2-clause License (see LICENSE
+ * # file).  This BSD License does not make any patent claims and as such, does
+ * # not act as a patent grant.  The purpose of this section is for each contributor
+ * # to define their intentions with respect to intellectual property.
+ * #
+ * # Each contributor to this source code is encouraged to state their patent
+ * # claims and licensing mechanisms for any contributions made. At the end of
+ * # this section contributors may each make their own statements.  Contributor's
+ * # claims and grants only apply to the pieces (source code, programs, text,
+ * # media, etc) that they have contributed directly to this software.
+ * #
+ * # There is no guarantee that this section is complete, up to date or accurate. It
+ * # is up to the contributors to maintain their portion of this section and up to
+ * # the user of the software to verify any claims herein.
+ * #
+ * # Do not remove this header notification.  The contents of this section must be
+ * # present in all distributions of the software.  You may only modify your own
+ * # intellectual property statements.  Please provide contact information.
+ *
+ * - Palo Alto Research Center, Inc
+ * This software distribution does not grant any rights to patents owned by Palo
+ * Alto Research Center, Inc (PARC). Rights to these patents are available via
+ * various mechanisms. As of January 2016 PARC has committed to FRAND licensing any
+ * intellectual property used by its contributions to this software. You may
+ * contact PARC at cipo@parc.com for more information or visit http://www.ccnx.org
+ */
+/**
+ * @author Christopher A. Wood, Palo Alto Research Center (Xerox PARC)
+ * @copyright (c) 2016, Xerox Corporation (Xerox) and Palo Alto Research Center, Inc (PARC).  All rights reserved.
+ */
+#include <LongBow/runtime.h>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include <parc/algol/parc_Object.h>
+#include <parc/algol/parc_Memory.h>
+
+#include "ccnxFileRepo_DigestIndex.h"
+
+static const char _ccnxFileRepoDigestIndex_Magic[8] = { 'C', 'C', 'N', 'X', 'I', 'D', 'X', '1' };
+static const uint32_t _ccnxFileRepoDigestIndex_Version = 2;
+
+/**
+ * The file header. It occupies one cache line, so the slots that follow it are cache line aligned.
+ */
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t slotSize;
+    uint64_t slotCount;     // always a power of two
+    uint64_t count;
+    uint64_t coveredLength; // the prefix of the packfile described by the index
+    uint32_t clean;         // 1 if the index was closed after its last modification
+    uint32_t counted;       // 1 if the reference counts of the slots are complete
+    uint8_t reserved[16];
+} _DigestIndexHeader;
+
+/**
+ * A slot is exactly one cache line, so a probe that finds its digest in the home slot
+ * touches a single line.
+ */
+typedef struct {
+    uint8_t digest[CCNxFileRepoDigestIndex_DigestLength];
+    uint64_t offset;
+    uint32_t length; // 0 marks an empty slot
+    uint32_t references;
+    uint8_t reserved[16];
+} _DigestIndexSlot;
+
+typedef char _DigestIndexHeaderIsOneCacheLine[(sizeof(_DigestIndexHeader) == 64) ? 1 : -1];
+typedef char _DigestIndexSlotIsOneCacheLine[(sizeof(_DigestIndexSlot) == 64) ? 1 : -1];
+
+struct ccnx_file_repo_digest_index {
+    char *path; // NULL for an anonymous, in-memory index
+    int fd;
+    bool wasClean;
+
+    uint8_t *base;
+    size_t mappedLength;
+    _DigestIndexHeader *header;
+    _DigestIndexSlot *slots;
+};
+
+static uint64_t
+_ccnxFileRepoDigestIndex_Hash(const uint8_t *digest)
+{
+    // SHA-256 output is uniformly distributed, so its leading bytes make a good hash.
+    uint64_t hash;
+    memcpy(&hash, digest, sizeof(hash));
+    return hash;
+}
+
+static size_t
+_ccnxFileRepoDigestIndex_MappedLength(uint64_t slotCount)
+{
+    return sizeof(_DigestIndexHeader) + slotCount * sizeof(_DigestIndexSlot);
+}
+
+static _DigestIndexSlot *
+_ccnxFileRepoDigestIndex_Probe(_DigestIndexSlot *slots, uint64_t slotCount, const uint8_t *digest)
+{
+    size_t mask = slotCount - 1;
+    size_t i = _ccnxFileRepoDigestIndex_Hash(digest) & mask;
+
+    // Linear probing; the load factor is kept below 3/4, so an empty slot is always found.
+    while (slots[i].length != 0) {
+        if (memcmp(slots[i].digest, digest, CCNxFileRepoDigestIndex_DigestLength) == 0) {
+            break;
+        }
+        i = (i + 1) & mask;
+    }
+    return &slots[i];
+}
+
+/**
+ * Map a table of `slotCount` slots, backed by `fd` or by anonymous memory if `fd` is -1.
+ * The file must already have the right size.
+ */
+static uint8_t *
+_ccnxFileRepoDigestIndex_MapTable(int fd, uint64_t slotCount)
+{
+    size_t length = _ccnxFileRepoDigestIndex_MappedLength(slotCount);
+    void *base;
+    if (fd >= 0) {
+        base = mmap(NULL, length, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    } else {
+        base = mmap(NULL, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    }
+    return (base == MAP_FAILED) ? NULL : base;
+}
+
+static void
+_ccnxFileRepoDigestIndex_SetTable(CCNxFileRepoDigestIndex *index, int fd, uint8_t *base, uint64_t slotCount)
+{
+    index->fd = fd;
+    index->base = base;
+    index->mappedLength = _ccnxFileRepoDigestIndex_MappedLength(slotCount);
+    index->header = (_DigestIndexHeader *) base;
+    index->slots = (_DigestIndexSlot *) (base + sizeof(_DigestIndexHeader));
+}
+
+/**
+ * Create a new, empty table with `slotCount` slots. For a file-backed index the table is
+ * written to a temporary file that the caller renames into place.
+ */
+static bool
+_ccnxFileRepoDigestIndex_CreateTable(const char *path, uint64_t slotCount, int *fdOut, uint8_t **baseOut)
+{
+    int fd = -1;
+    if (path != NULL) {
+        fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+        if (fd < 0 || ftruncate(fd, _ccnxFileRepoDigestIndex_MappedLength(slotCount)) != 0) {
+            if (fd >= 0) {
+                close(fd);
+            }
+            return false;
+        }
+    }
+
+    uint8_t *base = _ccnxFileRepoDigestIndex_MapTable(fd, slotCount);
+    if (base == NULL) {
+        if (fd >= 0) {
+            close(fd);
+        }
+        return false;
+    }
+
+    _DigestIndexHeader *header = (_DigestIndexHeader *) base;
+    memcpy(header->magic, _ccnxFileRepoDigestIndex_Magic, sizeof(header->magic));
+    header->version = _ccnxFileRepoDigestIndex_Version;
+    header->slotSize = sizeof(_DigestIndexSlot);
+    header->slotCount = slotCount;
+    header->count = 0;
+    header->coveredLength = 0;
+    header->clean = 0;
+    header->counted = 0;
+
+    *fdOut = fd;
+    *baseOut = base;
+    return true;
+}
+
+static void
+_ccnxFileRepoDigestIndex_UnmapTable(CCNxFileRepoDigestIndex *index)
+{
+    if (index->base != NULL) {
+        munmap(index->base, index->mappedLength);
+        index->base = NULL;
+    }
+    if (index->fd >= 0) {
+        close(index->fd);
+        index->fd = -1;
+    }
+}
+
+/**
+ * Map an existing index file. Nothing is read or rebuilt: the table is probed in place.
+ */
+static bool
+_ccnxFileRepoDigestIndex_Load(CCNxFileRepoDigestIndex *index)
+{
+    int fd = open(index->path, O_RDWR);
+    if (fd < 0) {
+        return false;
+    }
+
+    struct stat statbuf;
+    _DigestIndexHeader header;
+    bool valid = fstat(fd, &statbuf) == 0
+                 && statbuf.st_size >= (off_t) sizeof(header)
+                 && pread(fd, &header, sizeof(header), 0) == sizeof(header)
+                 && memcmp(header.magic, _ccnxFileRepoDigestIndex_Magic, sizeof(header.magic)) == 0
+                 && header.version == _ccnxFileRepoDigestIndex_Version
+                 && header.slotSize == sizeof(_DigestIndexSlot)
+                 && header.slotCount > 0 && (header.slotCount & (header.slotCount - 1)) == 0
+                 && statbuf.st_size == (off_t) _ccnxFileRepoDigestIndex_MappedLength(header.slotCount);
+
+    uint8_t *base = valid ? _ccnxFileRepoDigestIndex_MapTable(fd, header.slotCount) : NULL;
+    if (base == NULL) {
+        close(fd);
+        return false;
+    }
+
+    _ccnxFileRepoDigestIndex_SetTable(index, fd, base, header.slotCount);
+    index->wasClean = (header.clean == 1);
+    return true;
+}
+
+/**
+ * Record on disk that the index is being modified, before the first modification.
+ * A crash from here on leaves `clean` at 0, which makes the next open rebuild the index.
+ */
+static void
+_ccnxFileRepoDigestIndex_MarkDirty(CCNxFileRepoDigestIndex *index)
+{
+    if (index->header->clean != 0) {
+        index->header->clean = 0;
+        if (index->fd >= 0) {
+            msync(index->base, sizeof(_DigestIndexHeader), MS_SYNC);
+        }
+    }
+}
+
+static void
+_ccnxFileRepoDigestIndex_Grow(CCNxFileRepoDigestIndex *index)
+{
+    uint64_t slotCount = index->header->slotCount * 2;
+
+    char *growPath = NULL;
+    if (index->path != NULL) {
+        growPath = parcMemory_Format("%s.grow", index->path);
+    }
+
+    int fd;
+    uint8_t *base;
+    bool created = _ccnxFileRepoDigestIndex_CreateTable(growPath, slotCount, &fd, &base);
+    assertTrue(created, "Could not grow the digest index to %llu slots: %s", (unsigned long long) slotCount, strerror(errno));
+
+    _DigestIndexHeader *header = (_DigestIndexHeader *) base;
+    _DigestIndexSlot *slots = (_DigestIndexSlot *) (base + sizeof(_DigestIndexHeader));
+    for (uint64_t i = 0; i < index->header->slotCount; i++) {
+        if (index->slots[i].length != 0) {
+            *_ccnxFileRepoDigestIndex_Probe(slots, slotCount, index->slots[i].digest) = index->slots[i];
+        }
+    }
+    header->count = index->header->count;
+    header->coveredLength = index->header->coveredLength;
+    header->counted = index->header->counted;
+
+    if (growPath != NULL) {
+        msync(base, _ccnxFileRepoDigestIndex_MappedLength(slotCount), MS_SYNC);
+        rename(growPath, index->path);
+        parcMemory_Deallocate(&growPath);
+    }
+
+    _ccnxFileRepoDigestIndex_UnmapTable(index);
+    _ccnxFileRepoDigestIndex_SetTable(index, fd, base, slotCount);
+}
+
+static bool
+_ccnxFileRepoDigestIndex_Destructor(CCNxFileRepoDigestIndex **indexPtr)
+{
+    CCNxFileRepoDigestIndex *index = *indexPtr;
+
+    if (index->base != NULL && index->fd >= 0) {
+        ccnxFileRepoDigestIndex_Sync(index);
+        index->header->clean = 1;
+        msync(index->base, sizeof(_DigestIndexHeader), MS_SYNC);
+    }
+    _ccnxFileRepoDigestIndex_UnmapTable(index);
+
+    if (index->path != NULL) {
+        parcMemory_Deallocate(&index->path);
+    }
+    return true;
+}
+
+parcObject_Override(CCNxFileRepoDigestIndex, PARCObject,
+                    .destructor = (PARCObjectDestructor *) _ccnxFileRepoDigestIndex_Destructor);
+
+parcObject_ImplementAcquire(ccnxFileRepoDigestIndex, CCNxFileRepoDigestIndex);
+parcObject_ImplementRelease(ccnxFileRepoDigestIndex, CCNxFileRepoDigestIndex);
+
+static uint64_t
+_ccnxFileRepoDigestIndex_SlotCountForCapacity(size_t capacity)
+{
+    // Slots are 64 bytes, so start with one 4 KB page worth of slots.
+    uint64_t slotCount = 64;
+    while (slotCount * 3 / 4 < capacity) {
+        slotCount *= 2;
+    }
+    return slotCount;
+}
+
+CCNxFileRepoDigestIndex *
+ccnxFileRepoDigestIndex_Open(const char *path, size_t initialCapacity)
+{
+    CCNxFileRepoDigestIndex *index = parcObject_CreateAndClearInstance(CCNxFileRepoDigestIndex);
+    if (index == NULL) {
+        return NULL;
+    }
+
+    index->fd = -1;
+    index->base = NULL;
+    index->wasClean = false;
+    index->path = (path == NULL) ? NULL : parcMemory_StringDuplicate(path, strlen(path));
+
+    if (path == NULL || !_ccnxFileRepoDigestIndex_Load(index)) {
+        int fd;
+        uint8_t *base;
+        uint64_t slotCount = _ccnxFileRepoDigestIndex_SlotCountForCapacity(initialCapacity);
+        if (!_ccnxFileRepoDigestIndex_CreateTable(path, slotCount, &fd, &base)) {
+            ccnxFileRepoDigestIndex_Release(&index);
+            return NULL;
+        }
+        _ccnxFileRepoDigestIndex_SetTable(index, fd, base, slotCount);
+    }
+
+    return index;
+}
+
+CCNxFileRepoDigestIndex *
+ccnxFileRepoDigestIndex_Create(size_t initialCapacity)
+{
+    return ccnxFileRepoDigestIndex_Open(NULL, initialCapacity);
+}
+
+bool
+ccnxFileRepoDigestIndex_WasClean(const CCNxFileRepoDigestIndex *index)
+{
+    return index->wasClean;
+}
+
+bool
+ccnxFileRepoDigestIndex_Lookup(const CCNxFileRepoDigestIndex *index, const uint8_t *digest,
+                               uint64_t *offset, uint32_t *length)
+{
+    _DigestIndexSlot *slot = _ccnxFileRepoDigestIndex_Probe(index->slots, index->header->slotCount, digest);
+    if (slot->length == 0) {
+        return false;
+    }
+
+    *offset = slot->offset;
+    *length = slot->length;
+    return true;
+}
+
+void
+ccnxFileRepoDigestIndex_Insert(CCNxFileRepoDigestIndex *index, const uint8_t *digest,
+                               uint64_t offset, uint32_t length)
+{
+    assertTrue(length > 0, "A record must not be empty");
+
+    _ccnxFileRepoDigestIndex_MarkDirty(index);
+    if ((index->header->count + 1) * 4 > index->header->slotCount * 3) {
+        _ccnxFileRepoDigestIndex_Grow(index);
+    }
+
+    _DigestIndexSlot *slot = _ccnxFileRepoDigestIndex_Probe(index->slots, index->header->slotCount, digest);
+    if (slot->length == 0) {
+        memcpy(slot->digest, digest, CCNxFileRepoDigestIndex_DigestLength);
+        slot->references = 0;
+        index->header->count++;
+    }
+    slot->offset = offset;
+    slot->length = length;
+}
+
+void
+ccnxFileRepoDigestIndex_Clear(CCNxFileRepoDigestIndex *index)
+{
+    _ccnxFileRepoDigestIndex_MarkDirty(index);
+    memset(index->slots, 0, index->header->slotCount * sizeof(_DigestIndexSlot));
+    index->header->count = 0;
+    index->header->coveredLength = 0;
+    index->header->counted = 0;
+}
+
+bool
+ccnxFileRepoDigestIndex_AddReferences(CCNxFileRepoDigestIndex *index, const uint8_t *digest, int32_t delta,
+                                      uint32_t *references)
+{
+    _DigestIndexSlot *slot = _ccnxFileRepoDigestIndex_Probe(index->slots, index->header->slotCount, digest);
+    if (slot->length == 0) {
+        return false;
+    }
+
+    _ccnxFileRepoDigestIndex_MarkDirty(index);
+    if (delta < 0 && (uint32_t) -delta > slot->references) {
+        slot->references = 0;
+    } else {
+        slot->references += delta;
+    }
+    if (references != NULL) {
+        *references = slot->references;
+    }
+    return true;
+}
+
+uint32_t
+ccnxFileRepoDigestIndex_GetReferences(const CCNxFileRepoDigestIndex *index, const uint8_t *digest)
+{
+    _DigestIndexSlot *slot = _ccnxFileRepoDigestIndex_Probe(index->slots, index->header->slotCount, digest);
+    return slot->references;
+}
+
+void
+ccnxFileRepoDigestIndex_ClearReferences(CCNxFileRepoDigestIndex *index)
+{
+    _ccnxFileRepoDigestIndex_MarkDirty(index);
+    for (uint64_t i = 0; i < index->header->slotCount; i++) {
+        index->slots[i].references = 0;
+    }
+    index->header->counted = 0;
+}
+
+bool
+ccnxFileRepoDigestIndex_HasReferenceCounts(const CCNxFileRepoDigestIndex *index)
+{
+    return index->header->counted == 1;
+}
+
+void
+ccnxFileRepoDigestIndex_SetHasReferenceCounts(CCNxFileRepoDigestIndex *index, bool counted)
+{
+    _ccnxFileRepoDigestIndex_MarkDirty(index);
+    index->header->counted = counted ? 1 : 0;
+}
+
+void
+ccnxFileRepoDigestIndex_ForEach(const CCNxFileRepoDigestIndex *index, CCNxFileRepoDigestIndexVisitor *visitor, void *context)
+{
+    for (uint64_t i = 0; i < index->header->slotCount; i++) {
+        const _DigestIndexSlot *slot = &index->slots[i];
+        if (slot->length != 0) {
+            visitor(context, slot->digest, slot->offset, slot->length, slot->references);
+        }
+    }
+}
+
+bool
+ccnxFileRepoDigestIndex_Rename(CCNxFileRepoDigestIndex *index, const char *path)
+{
+    assertNotNull(index->path, "An in-memory index has no file to rename");
+
+    if (rename(index->path, path) != 0) {
+        return false;
+    }
+    parcMemory_Deallocate(&index->path);
+    index->path = parcMemory_StringDuplicate(path, strlen(path));
+    return true;
+}
+
+size_t
+ccnxFileRepoDigestIndex_GetCount(const CCNxFileRepoDigestIndex *index)
+{
+    return index->header->count;
+}
+
+uint64_t
+ccnxFileRepoDigestIndex_GetCoveredLength(const CCNxFileRepoDigestIndex *index)
+{
+    return index->header->coveredLength;
+}
+
+void
+ccnxFileRepoDigestIndex_SetCoveredLength(CCNxFileRepoDigestIndex *index, uint64_t length)
+{
+    _ccnxFileRepoDigestIndex_MarkDirty(index);
+    index->header->coveredLength = length;
+}
+
+bool
+ccnxFileRepoDigestIndex_Sync(CCNxFileRepoDigestIndex *index)
+{
+    if (index->fd < 0) {
+        return true;
+    }
+    return msync(index->base, index->mappedLength, MS_SYNC) == 0;
+}
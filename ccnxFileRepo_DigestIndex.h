@@ -0,0 +1,306 @@
+/*
+ * Copyright (c) 2016, Xerox Corporation (Xerox) and Palo Alto Research Center, Inc (PARC)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL XEROX OR PARC BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * ################################################################################
+ * #
+ * # PATENT NOTICE
+ * #
+ * # This software is distributed under the BSD 2-clause License (see LICENSE
+ * # file).  This BSD License does not make any patent claims and as such, does
+ * # not act as a patent grant.  The purpose of this section is for each contributor
+ * # to define their intentions with respect to intellectual property.
+ * #
+ * # Each contributor to this source code is encouraged to state their patent
+ * # claims and licensing mechanisms for any contributions made. At the end of
+ * # this section contributors may each make their own statements.  Contributor's
+ * # claims and grants only apply to the pieces (source code, programs, text,
+ * # media, etc) that they have contributed directly to this software.
+ * #
+ * # There is no guarantee that this section is complete, up to date or accurate. It
+ * # is up to the contributors to maintain their portion of this section and up to
+ * # the user of the software to verify any claims herein.
+ * #
+ * # Do not remove this header notification.  The contents of this section must be
+ * # present in all distributions of the software.  You may only modify your own
+ * # intellectual property statements.  Please provide contact information.
+ *
+ * - Palo Alto Research Center, Inc
+ * This software distribution does not grant any rights to patents owned by Palo
+ * Alto Research Center, Inc (PARC). Rights to these patents are available via
+ * various mechanisms. As of January 2016 PARC has committed to FRAND licensing any
+ * intellectual property used by its contributions to this software. You may
+ * contact PARC at cipo@parc.com for more information or visit http://www.ccnx.org
+ */
+/**
+ * @author Christopher A. Wood, Palo Alto Research Center (Xerox PARC)
+ * @copyright (c) 2016, Xerox Corporation (Xerox) and Palo Alto Research Center, Inc (PARC).  All rights reserved.
+ */
+
+#ifndef ccnxFileRepoDigestIndex_h
+#define ccnxFileRepoDigestIndex_h
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+
+struct ccnx_file_repo_digest_index;
+typedef struct ccnx_file_repo_digest_index CCNxFileRepoDigestIndex;
+
+/**
+ * The length of the digests used as keys, i.e., a SHA-256 ContentObjectHash.
+ */
+#define CCNxFileRepoDigestIndex_DigestLength 32
+
+/**
+ * A function called by `ccnxFileRepoDigestIndex_ForEach` with each entry of the index.
+ */
+typedef void (CCNxFileRepoDigestIndexVisitor)(void *context, const uint8_t *digest, uint64_t offset, uint32_t length,
+                                              uint32_t references);
+
+/**
+ * Open the `CCNxFileRepoDigestIndex` stored in the file at `path`, creating an empty one if the
+ * file does not exist or is not a valid index.
+ *
+ * The index maps ContentObjectHash digests to the offset and length of a record in a packfile.
+ * It is an open-addressing hash table whose slots are each one cache line, and the file is
+ * mapped into memory and probed in place, so opening an index takes constant time regardless
+ * of the number of entries. The table grows by rehashing into a new file that replaces the old one.
+ *
+ * If `path` is NULL the index is kept in anonymous memory only.
+ *
+ * @param [in] path The path of the index file, or NULL.
+ * @param [in] initialCapacity The number of entries a new index should hold before it grows.
+ *
+ * @return A new `CCNxFileRepoDigestIndex` instance, or NULL if the file could not be created or mapped.
+ *
+ * Example:
+ * @code
+ * {
+ *     CCNxFileRepoDigestIndex *index = ccnxFileRepoDigestIndex_Open("/tmp/repo/chunks.idx", 1024);
+ *     if (!ccnxFileRepoDigestIndex_WasClean(index)) {
+ *         ccnxFileRepoDigestIndex_Clear(index);
+ *         // re-insert every record
+ *     }
+ * }
+ * @endcode
+ */
+CCNxFileRepoDigestIndex *ccnxFileRepoDigestIndex_Open(const char *path, size_t initialCapacity);
+
+/**
+ * Create an empty, in-memory `CCNxFileRepoDigestIndex`.
+ *
+ * This is equivalent to `ccnxFileRepoDigestIndex_Open(NULL, initialCapacity)`.
+ *
+ * @param [in] initialCapacity The number of entries the index should hold before it grows.
+ *
+ * @return A new `CCNxFileRepoDigestIndex` instance.
+ */
+CCNxFileRepoDigestIndex *ccnxFileRepoDigestIndex_Create(size_t initialCapacity);
+
+/**
+ * Increase the number of references to a `CCNxFileRepoDigestIndex` instance.
+ *
+ * @param [in] instance A pointer to a valid CCNxFileRepoDigestIndex instance.
+ *
+ * @return The same value as @p instance.
+ */
+CCNxFileRepoDigestIndex *ccnxFileRepoDigestIndex_Acquire(const CCNxFileRepoDigestIndex *instance);
+
+/**
+ * Release a previously acquired reference to the given `CCNxFileRepoDigestIndex` instance,
+ * decrementing the reference count for the instance.
+ *
+ * The pointer to the instance is set to NULL as a side-effect of this function.
+ *
+ * @param [in,out] instancePtr A pointer to a pointer to the instance to release.
+ */
+void ccnxFileRepoDigestIndex_Release(CCNxFileRepoDigestIndex **instancePtr);
+
+/**
+ * Find the location of the record with the given digest.
+ *
+ * @param [in] index The `CCNxFileRepoDigestIndex` instance.
+ * @param [in] digest A `CCNxFileRepoDigestIndex_DigestLength` byte digest.
+ * @param [out] offset Set to the offset of the record, if found.
+ * @param [out] length Set to the length of the record, if found.
+ *
+ * @return true The digest is in the index.
+ * @return false The digest is not in the index.
+ *
+ * Example:
+ * @code
+ * {
+ *     uint64_t offset;
+ *     uint32_t length;
+ *     if (ccnxFileRepoDigestIndex_Lookup(index, digest, &offset, &length)) {
+ *         // read the record
+ *     }
+ * }
+ * @endcode
+ */
+bool ccnxFileRepoDigestIndex_Lookup(const CCNxFileRepoDigestIndex *index, const uint8_t *digest,
+                                    uint64_t *offset, uint32_t *length);
+
+/**
+ * Record the location of the record with the given digest. An existing entry for the
+ * same digest is replaced.
+ *
+ * @param [in] index The `CCNxFileRepoDigestIndex` instance.
+ * @param [in] digest A `CCNxFileRepoDigestIndex_DigestLength` byte digest.
+ * @param [in] offset The offset of the record.
+ * @param [in] length The length of the record, which must not be 0.
+ */
+void ccnxFileRepoDigestIndex_Insert(CCNxFileRepoDigestIndex *index, const uint8_t *digest,
+                                    uint64_t offset, uint32_t length);
+
+/**
+ * Return the number of digests in the index.
+ *
+ * @param [in] index The `CCNxFileRepoDigestIndex` instance.
+ */
+size_t ccnxFileRepoDigestIndex_GetCount(const CCNxFileRepoDigestIndex *index);
+
+/**
+ * Determine if the index was loaded from a file that was closed cleanly after its last
+ * modification. If not, the entries may not match the packfile and should be rebuilt.
+ *
+ * @param [in] index The `CCNxFileRepoDigestIndex` instance.
+ *
+ * @return true The index was loaded from a cleanly closed file.
+ * @return false The index is new, or its file was not closed cleanly.
+ */
+bool ccnxFileRepoDigestIndex_WasClean(const CCNxFileRepoDigestIndex *index);
+
+/**
+ * Remove every entry from the index.
+ *
+ * @param [in] index The `CCNxFileRepoDigestIndex` instance.
+ */
+void ccnxFileRepoDigestIndex_Clear(CCNxFileRepoDigestIndex *index);
+
+/**
+ * Add `delta` to the reference count of the record with the given digest. The count never
+ * goes below 0. Reference counts are kept in the slots of the index, so they are as durable
+ * as the index itself, and are lost when the index is cleared.
+ *
+ * @param [in] index The `CCNxFileRepoDigestIndex` instance.
+ * @param [in] digest A `CCNxFileRepoDigestIndex_DigestLength` byte digest.
+ * @param [in] delta The change of the reference count.
+ * @param [out] references Set to the new reference count if not NULL.
+ *
+ * @return true The digest is in the index.
+ * @return false The digest is not in the index, and nothing was changed.
+ *
+ * Example:
+ * @code
+ * {
+ *     uint32_t references;
+ *     if (ccnxFileRepoDigestIndex_AddReferences(index, digest, -1, &references) && references == 0) {
+ *         // the record may be reclaimed
+ *     }
+ * }
+ * @endcode
+ */
+bool ccnxFileRepoDigestIndex_AddReferences(CCNxFileRepoDigestIndex *index, const uint8_t *digest, int32_t delta,
+                                           uint32_t *references);
+
+/**
+ * Return the reference count of the record with the given digest, or 0 if it is not in the index.
+ *
+ * @param [in] index The `CCNxFileRepoDigestIndex` instance.
+ * @param [in] digest A `CCNxFileRepoDigestIndex_DigestLength` byte digest.
+ */
+uint32_t ccnxFileRepoDigestIndex_GetReferences(const CCNxFileRepoDigestIndex *index, const uint8_t *digest);
+
+/**
+ * Set every reference count to 0, and mark the counts as incomplete.
+ *
+ * @param [in] index The `CCNxFileRepoDigestIndex` instance.
+ */
+void ccnxFileRepoDigestIndex_ClearReferences(CCNxFileRepoDigestIndex *index);
+
+/**
+ * Determine if the reference counts of the index are complete, i.e., every reference has
+ * been counted since the counts were last cleared. A new or rebuilt index has no counts.
+ *
+ * @param [in] index The `CCNxFileRepoDigestIndex` instance.
+ */
+bool ccnxFileRepoDigestIndex_HasReferenceCounts(const CCNxFileRepoDigestIndex *index);
+
+/**
+ * Record whether the reference counts of the index are complete.
+ *
+ * @param [in] index The `CCNxFileRepoDigestIndex` instance.
+ * @param [in] counted True once every reference has been counted.
+ */
+void ccnxFileRepoDigestIndex_SetHasReferenceCounts(CCNxFileRepoDigestIndex *index, bool counted);
+
+/**
+ * Call `visitor` with every entry of the index, in no particular order. The index must not
+ * be modified until this returns.
+ *
+ * @param [in] index The `CCNxFileRepoDigestIndex` instance.
+ * @param [in] visitor The function to call with each entry.
+ * @param [in] context Passed to `visitor`.
+ */
+void ccnxFileRepoDigestIndex_ForEach(const CCNxFileRepoDigestIndex *index, CCNxFileRepoDigestIndexVisitor *visitor,
+                                     void *context);
+
+/**
+ * Move the file of a file-backed index to `path`, replacing any file there. The index
+ * stays open and grows in its new place.
+ *
+ * @param [in] index The `CCNxFileRepoDigestIndex` instance, which must be file-backed.
+ * @param [in] path The new path of the index file.
+ *
+ * @return true The file was moved.
+ * @return false The file could not be moved, and the index is unchanged.
+ */
+bool ccnxFileRepoDigestIndex_Rename(CCNxFileRepoDigestIndex *index, const char *path);
+
+/**
+ * Return the length of the packfile prefix whose records are all in the index.
+ *
+ * @param [in] index The `CCNxFileRepoDigestIndex` instance.
+ */
+uint64_t ccnxFileRepoDigestIndex_GetCoveredLength(const CCNxFileRepoDigestIndex *index);
+
+/**
+ * Set the length of the packfile prefix whose records are all in the index.
+ *
+ * @param [in] index The `CCNxFileRepoDigestIndex` instance.
+ * @param [in] length The length of the prefix, in bytes.
+ */
+void ccnxFileRepoDigestIndex_SetCoveredLength(CCNxFileRepoDigestIndex *index, uint64_t length);
+
+/**
+ * Write any modified entries of a file-backed index to disk.
+ *
+ * @param [in] index The `CCNxFileRepoDigestIndex` instance.
+ *
+ * @return true The index was written, or is not file-backed.
+ * @return false The index could not be written.
+ */
+bool ccnxFileRepoDigestIndex_Sync(CCNxFileRepoDigestIndex *index);
+#endif // ccnxFileRepoDigestIndex_h
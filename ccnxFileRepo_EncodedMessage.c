@@ -0,0 +1,253 @@
+/*
+ * Copyright (c) 2016, Xerox Corporation (Xerox) and Palo Alto Research Center, Inc (PARC)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL XEROX OR PARC BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * ################################################################################
+ * #
+ * # PATENT NOTICE
+ * #
+ * # This software is distributed under the BSD 2-clause License (see LICENSE
+ * # file).  This BSD License does not make any patent claims and as such, does
+ * # not act as a patent grant.  The purpose of this section is for each contributor
+ * # to define their intentions with respect to intellectual property.
+ * #
+ * # Each contributor to this source code is encouraged to state their patent
+ * # claims and licensing mechanisms for any contributions made. At the end of
+ * # this section contributors may each make their own statements.  Contributor's
+ * # claims and grants only apply to the pieces (source code, programs, text,
+ * # media, etc) that they have contributed directly to this software.
+ * #
+ * # There is no guarantee that this section is complete, up to date or accurate. It
+ * # is up to the contributors to maintain their portion of this section and up to
+ * # the user of the software to verify any claims herein.
+ * #
+ * # Do not remove this header notification.  The contents of this section must be
+ * # present in all distributions of the software.  You may only modify your own
+ * # intellectual property statements.  Please provide contact information.
+ *
+ * - Palo Alto Research Center, Inc
+ * This software distribution does not grant any rights to patents owned by Palo
+ * Alto Research Center, Inc (PARC). Rights to these patents are available via
+ * various mechanisms. As of January 2016 PARC has committed to FRAND licensing any
+ * intellectual property used by its contributions to this software. You may
+ * contact PARC at cipo@parc.com for more information or visit http://www.ccnx.org
+ */
+/**
+ * @author Christopher A. Wood, Palo Alto Research Center (Xerox PARC)
+ * @copyright (c) 2016, Xerox Corporation (Xerox) and Palo Alto Research Center, Inc (PARC).  All rights reserved.
+ */
+#include <LongBow/runtime.h>
+
+#include <string.h>
+
+#include <parc/algol/parc_Object.h>
+#include <parc/algol/parc_Memory.h>
+
+#include <ccnx/common/ccnx_ContentObject.h>
+
+#include "ccnxFileRepo_Common.h"
+#include "ccnxFileRepo_EncodedMessage.h"
+#include "ccnxFileRepo_Sha256.h"
+
+/**
+ * The fixed header of a CCNx packet: the packet length is a big-endian 16-bit number at
+ * offset 2, and the length of the fixed and hop-by-hop headers is the byte at offset 7.
+ */
+#define _ccnxFileRepoEncodedMessage_FixedHeaderLength 8
+
+/**
+ * The largest packet the 16-bit packet length can describe, and the type and length that
+ * precede the value of a TLV, such as the payload.
+ */
+#define _ccnxFileRepoEncodedMessage_MaximumPacketLength 65535
+#define _ccnxFileRepoEncodedMessage_TLVHeaderLength 4
+
+struct ccnx_file_repo_encoded_message {
+    PARCBuffer *wireFormat;
+    PARCBuffer *digest;
+};
+
+static bool
+_ccnxFileRepoEncodedMessage_Destructor(CCNxFileRepoEncodedMessage **encodedPtr)
+{
+    CCNxFileRepoEncodedMessage *encoded = *encodedPtr;
+    if (encoded->wireFormat != NULL) {
+        parcBuffer_Release(&encoded->wireFormat);
+    }
+    if (encoded->digest != NULL) {
+        parcBuffer_Release(&encoded->digest);
+    }
+    return true;
+}
+
+parcObject_Override(CCNxFileRepoEncodedMessage, PARCObject,
+                    .destructor = (PARCObjectDestructor *) _ccnxFileRepoEncodedMessage_Destructor);
+
+parcObject_ImplementAcquire(ccnxFileRepoEncodedMessage, CCNxFileRepoEncodedMessage);
+parcObject_ImplementRelease(ccnxFileRepoEncodedMessage, CCNxFileRepoEncodedMessage);
+
+/**
+ * Find the region of `wireFormat` the content object hash covers: everything after the fixed
+ * and hop-by-hop headers, up to the end of the packet.
+ */
+static bool
+_ccnxFileRepoEncodedMessage_GetProtectedRegion(const PARCBuffer *wireFormat, const uint8_t **region, size_t *length)
+{
+    size_t remaining = parcBuffer_Remaining(wireFormat);
+    if (remaining < _ccnxFileRepoEncodedMessage_FixedHeaderLength) {
+        return false;
+    }
+
+    const uint8_t *packet = ccnxFileRepoCommon_GetBufferBytes(wireFormat);
+    size_t packetLength = ((size_t) packet[2] << 8) | packet[3];
+    size_t headerLength = packet[7];
+    if (headerLength < _ccnxFileRepoEncodedMessage_FixedHeaderLength || headerLength > packetLength || packetLength > remaining) {
+        return false;
+    }
+
+    *region = packet + headerLength;
+    *length = packetLength - headerLength;
+    return true;
+}
+
+static CCNxFileRepoEncodedMessage *
+_ccnxFileRepoEncodedMessage_Encode(const CCNxMetaMessage *message)
+{
+    CCNxFileRepoEncodedMessage *encoded = parcObject_CreateAndClearInstance(CCNxFileRepoEncodedMessage);
+    if (encoded != NULL) {
+        encoded->wireFormat = ccnxMetaMessage_CreateWireFormatBuffer((CCNxMetaMessage *) message, NULL);
+        encoded->digest = NULL;
+    }
+    return encoded;
+}
+
+CCNxFileRepoEncodedMessage *
+ccnxFileRepoEncodedMessage_Create(const CCNxMetaMessage *message)
+{
+    CCNxFileRepoEncodedMessage *encoded = _ccnxFileRepoEncodedMessage_Encode(message);
+    if (encoded == NULL) {
+        return NULL;
+    }
+
+    const uint8_t *region;
+    size_t length;
+    bool found = _ccnxFileRepoEncodedMessage_GetProtectedRegion(encoded->wireFormat, &region, &length);
+    assertTrue(found, "Could not find the protected region of an encoded message");
+
+    encoded->digest = parcBuffer_Allocate(CCNxFileRepoSha256_DigestLength);
+    ccnxFileRepoSha256_Digest(region, length, parcBuffer_Overlay(encoded->digest, 0));
+    return encoded;
+}
+
+void
+ccnxFileRepoEncodedMessage_CreateMany(size_t count, const CCNxMetaMessage *const messages[], CCNxFileRepoEncodedMessage *encoded[])
+{
+    // Every chunk of a run may have been reused, leaving nothing to encode
+    if (count == 0) {
+        return;
+    }
+
+    const uint8_t *regions[count];
+    size_t lengths[count];
+    uint8_t (*digests)[CCNxFileRepoSha256_DigestLength] = parcMemory_Allocate(count * CCNxFileRepoSha256_DigestLength);
+
+    for (size_t i = 0; i < count; i++) {
+        encoded[i] = _ccnxFileRepoEncodedMessage_Encode(messages[i]);
+        bool found = _ccnxFileRepoEncodedMessage_GetProtectedRegion(encoded[i]->wireFormat, &regions[i], &lengths[i]);
+        assertTrue(found, "Could not find the protected region of an encoded message");
+    }
+
+    ccnxFileRepoSha256_DigestMany(count, regions, lengths, digests);
+
+    for (size_t i = 0; i < count; i++) {
+        encoded[i]->digest = parcBuffer_Allocate(CCNxFileRepoSha256_DigestLength);
+        parcBuffer_PutArray(encoded[i]->digest, CCNxFileRepoSha256_DigestLength, digests[i]);
+        parcBuffer_Flip(encoded[i]->digest);
+    }
+    parcMemory_Deallocate(&digests);
+}
+
+bool
+ccnxFileRepoEncodedMessage_ComputeDigest(const PARCBuffer *wireFormat, uint8_t digest[CCNxFileRepoSha256_DigestLength])
+{
+    const uint8_t *region;
+    size_t length;
+    if (!_ccnxFileRepoEncodedMessage_GetProtectedRegion(wireFormat, &region, &length)) {
+        return false;
+    }
+
+    ccnxFileRepoSha256_Digest(region, length, digest);
+    return true;
+}
+
+bool
+ccnxFileRepoEncodedMessage_VerifyDigest(const PARCBuffer *wireFormat, const PARCBuffer *digest)
+{
+    uint8_t computed[CCNxFileRepoSha256_DigestLength];
+    return parcBuffer_Remaining(digest) == CCNxFileRepoSha256_DigestLength
+           && ccnxFileRepoEncodedMessage_ComputeDigest(wireFormat, computed)
+           && memcmp(computed, ccnxFileRepoCommon_GetBufferBytes(digest), sizeof(computed)) == 0;
+}
+
+CCNxFileRepoEncodedMessage *
+ccnxFileRepoEncodedMessage_CreateFromDigest(const PARCBuffer *digest)
+{
+    CCNxFileRepoEncodedMessage *encoded = parcObject_CreateAndClearInstance(CCNxFileRepoEncodedMessage);
+    if (encoded != NULL) {
+        encoded->wireFormat = NULL;
+        encoded->digest = parcBuffer_Acquire(digest);
+    }
+    return encoded;
+}
+
+PARCBuffer *
+ccnxFileRepoEncodedMessage_GetWireFormat(const CCNxFileRepoEncodedMessage *encoded)
+{
+    return encoded->wireFormat;
+}
+
+PARCBuffer *
+ccnxFileRepoEncodedMessage_GetDigest(const CCNxFileRepoEncodedMessage *encoded)
+{
+    return encoded->digest;
+}
+
+size_t
+ccnxFileRepoEncodedMessage_GetMaximumPayloadSize(const CCNxName *name)
+{
+    // Encode a content object with an empty payload to learn what the name and headers take.
+    // An empty payload may be left out, so its TLV header is counted on top.
+    PARCBuffer *empty = parcBuffer_Allocate(0);
+    CCNxContentObject *contentObject = ccnxContentObject_CreateWithNameAndPayload(name, empty);
+    CCNxMetaMessage *message = ccnxMetaMessage_CreateFromContentObject(contentObject);
+    PARCBuffer *wireFormat = ccnxMetaMessage_CreateWireFormatBuffer(message, NULL);
+    size_t overhead = parcBuffer_Remaining(wireFormat) + _ccnxFileRepoEncodedMessage_TLVHeaderLength;
+
+    parcBuffer_Release(&wireFormat);
+    ccnxMetaMessage_Release(&message);
+    ccnxContentObject_Release(&contentObject);
+    parcBuffer_Release(&empty);
+
+    return (overhead < _ccnxFileRepoEncodedMessage_MaximumPacketLength)
+           ? _ccnxFileRepoEncodedMessage_MaximumPacketLength - overhead : 0;
+}
@@ -0,0 +1,212 @@
+/*
+ * Copyright (c) 2016, Xerox Corporation (Xerox) and Palo Alto Research Center, Inc (PARC)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL XEROX OR PARC BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * ################################################################################
+ * #
+ * # PATENT NOTICE
+ * #
+ * # This software is distributed under the BSD 2-clause License (see LICENSE
+ * # file).  This BSD License does not make any patent claims and as such, does
+ * # not act as a patent grant.  The purpose of this section is for each contributor
+ * # to define their intentions with respect to intellectual property.
+ * #
+ * # Each contributor to this source code is encouraged to state their patent
+ * # claims and licensing mechanisms for any contributions made. At the end of
+ * # this section contributors may each make their own statements.  Contributor's
+ * # claims and grants only apply to the pieces (source code, programs, text,
+ * # media, etc) that they have contributed directly to this software.
+ * #
+ * # There is no guarantee that this section is complete, up to date or accurate. It
+ * # is up to the contributors to maintain their portion of this section and up to
+ * # the user of the software to verify any claims herein.
+ * #
+ * # Do not remove this header notification.  The contents of this section must be
+ * # present in all distributions of the software.  You may only modify your own
+ * # intellectual property statements.  Please provide contact information.
+ *
+ * - Palo Alto Research Center, Inc
+ * This software distribution does not grant any rights to patents owned by Palo
+ * Alto Research Center, Inc (PARC). Rights to these patents are available via
+ * various mechanisms. As of January 2016 PARC has committed to FRAND licensing any
+ * intellectual property used by its contributions to this software. You may
+ * contact PARC at cipo@parc.com for more information or visit http://www.ccnx.org
+ */
+/**
+ * @author Christopher A. Wood, Palo Alto Research Center (Xerox PARC)
+ * @copyright (c) 2016, Xerox Corporation (Xerox) and Palo Alto Research Center, Inc (PARC).  All rights reserved.
+ */
+
+#ifndef ccnxFileRepoEncodedMessage_h
+#define ccnxFileRepoEncodedMessage_h
+
+#include <parc/algol/parc_Buffer.h>
+
+#include <ccnx/common/ccnx_Name.h>
+#include <ccnx/transport/common/transport_MetaMessage.h>
+
+#include "ccnxFileRepo_Sha256.h"
+
+struct ccnx_file_repo_encoded_message;
+typedef struct ccnx_file_repo_encoded_message CCNxFileRepoEncodedMessage;
+
+/**
+ * Encode a message and compute its content object hash over that same encoding: the SHA-256
+ * digest of the packet after its fixed and hop-by-hop headers.
+ *
+ * This is the only place a message is encoded on the way into the repo: the manifest
+ * builder points at the digest and the store writes the wire format as it is.
+ *
+ * @param [in] message The `CCNxMetaMessage` to encode, e.g., a content object or a manifest.
+ *
+ * @return A new `CCNxFileRepoEncodedMessage` instance, which does not keep @p message.
+ *
+ * Example:
+ * @code
+ * {
+ *     CCNxMetaMessage *message = ccnxMetaMessage_CreateFromContentObject(contentObject);
+ *     CCNxFileRepoEncodedMessage *encoded = ccnxFileRepoEncodedMessage_Create(message);
+ *     ccnxMetaMessage_Release(&message);
+ *
+ *     ccnxFileRepoPackStore_Put(pack, ccnxFileRepoEncodedMessage_GetDigest(encoded),
+ *                               ccnxFileRepoEncodedMessage_GetWireFormat(encoded));
+ *     ccnxFileRepoEncodedMessage_Release(&encoded);
+ * }
+ * @endcode
+ */
+CCNxFileRepoEncodedMessage *ccnxFileRepoEncodedMessage_Create(const CCNxMetaMessage *message);
+
+/**
+ * Encode `count` messages and compute their content object hashes.
+ *
+ * The result is the same as calling `ccnxFileRepoEncodedMessage_Create` on each message, but
+ * the messages are hashed together, several at once with a multi-buffer SHA-256 engine where
+ * the processor has one.
+ *
+ * @param [in] count The number of messages, which may be 0.
+ * @param [in] messages The messages to encode.
+ * @param [out] encoded Set to a new `CCNxFileRepoEncodedMessage` for each message, in the same order.
+ *
+ * Example:
+ * @code
+ * {
+ *     CCNxFileRepoEncodedMessage *encoded[16];
+ *     ccnxFileRepoEncodedMessage_CreateMany(16, messages, encoded);
+ * }
+ * @endcode
+ */
+void ccnxFileRepoEncodedMessage_CreateMany(size_t count, const CCNxMetaMessage *const messages[], CCNxFileRepoEncodedMessage *encoded[]);
+
+/**
+ * Compute the content object hash of the packet in `wireFormat`, e.g., to find which of several
+ * outstanding interests a response answers.
+ *
+ * @param [in] wireFormat The wire format of a packet, positioned at its start.
+ * @param [out] digest Set to the SHA-256 content object hash.
+ *
+ * @return true if the hash was computed, false if the packet is malformed.
+ */
+bool ccnxFileRepoEncodedMessage_ComputeDigest(const PARCBuffer *wireFormat, uint8_t digest[CCNxFileRepoSha256_DigestLength]);
+
+/**
+ * Return true if `digest` is the content object hash of the packet in `wireFormat`, e.g.,
+ * to check that a response is the chunk a manifest points at.
+ *
+ * @param [in] wireFormat The wire format of a packet, positioned at its start.
+ * @param [in] digest The expected SHA-256 content object hash.
+ *
+ * @return true if the packet hashes to @p digest, false if it does not or is malformed.
+ */
+bool ccnxFileRepoEncodedMessage_VerifyDigest(const PARCBuffer *wireFormat, const PARCBuffer *digest);
+
+/**
+ * Refer to a message that is already stored under `digest`, without its encoding.
+ *
+ * The manifest builder uses this for a chunk it finds unchanged from the previous version
+ * of a file, so the chunk is neither encoded nor hashed again.
+ *
+ * @param [in] digest The SHA-256 content object hash of the stored message.
+ *
+ * @return A new `CCNxFileRepoEncodedMessage` instance whose wire format is NULL.
+ */
+CCNxFileRepoEncodedMessage *ccnxFileRepoEncodedMessage_CreateFromDigest(const PARCBuffer *digest);
+
+/**
+ * Increase the number of references to a `CCNxFileRepoEncodedMessage` instance.
+ *
+ * @param [in] instance A pointer to a valid CCNxFileRepoEncodedMessage instance.
+ *
+ * @return The same value as @p instance.
+ */
+CCNxFileRepoEncodedMessage *ccnxFileRepoEncodedMessage_Acquire(const CCNxFileRepoEncodedMessage *instance);
+
+/**
+ * Release a previously acquired reference to the given `CCNxFileRepoEncodedMessage` instance,
+ * decrementing the reference count for the instance.
+ *
+ * The pointer to the instance is set to NULL as a side-effect of this function.
+ *
+ * @param [in,out] instancePtr A pointer to a pointer to the instance to release.
+ */
+void ccnxFileRepoEncodedMessage_Release(CCNxFileRepoEncodedMessage **instancePtr);
+
+/**
+ * Return the wire format of the message, positioned at its start.
+ *
+ * @param [in] encoded The `CCNxFileRepoEncodedMessage` instance.
+ *
+ * @return The encoded message, owned by @p encoded, or NULL if @p encoded was made by
+ *         `ccnxFileRepoEncodedMessage_CreateFromDigest`.
+ */
+PARCBuffer *ccnxFileRepoEncodedMessage_GetWireFormat(const CCNxFileRepoEncodedMessage *encoded);
+
+/**
+ * Return the SHA-256 content object hash of the message, which is the digest that
+ * manifests use to point at it and the key it is stored under.
+ *
+ * @param [in] encoded The `CCNxFileRepoEncodedMessage` instance.
+ *
+ * @return The digest, owned by @p encoded.
+ */
+PARCBuffer *ccnxFileRepoEncodedMessage_GetDigest(const CCNxFileRepoEncodedMessage *encoded);
+
+/**
+ * Return the largest payload of a content object named `name` that can be encoded. A CCNx
+ * packet records its length in 16 bits, so a packet is at most 65535 bytes, including its
+ * headers and the name.
+ *
+ * @param [in] name The name of the content object.
+ *
+ * @return The largest payload, in bytes, or 0 if not even an empty content object fits.
+ *
+ * Example:
+ * @code
+ * {
+ *     if (chunkSize > ccnxFileRepoEncodedMessage_GetMaximumPayloadSize(name)) {
+ *         // the chunks cannot be published under name
+ *     }
+ * }
+ * @endcode
+ */
+size_t ccnxFileRepoEncodedMessage_GetMaximumPayloadSize(const CCNxName *name);
+#endif // ccnxFileRepoEncodedMessage_h
@@ -68,17 +68,51 @@
 #include <ccnx/transport/common/transport_MetaMessage.h>
 
 #include "ccnxFileRepo_ManifestBuilder.h"
+#include "ccnxFileRepo_Common.h"
+#include "ccnxFileRepo_EncodedMessage.h"
+#include "ccnxFileRepo_Queue.h"
+#include "ccnxFileRepo_Sha256.h"
+#include "ccnxFileRepo_WorkerPool.h"
 
+#include <pthread.h>
 #include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+/**
+ * The most levels a balanced tree may have, which is enough for 2^64 chunks with a fanout of 2.
+ */
+#define _ccnxManifestBuilder_MaximumTreeDepth 64
 
 struct ccnx_manifest_builder {
-    int chunkSize;
+    size_t chunkSize;
+    size_t threadCount;
+
+    // The most pointers in a HashGroup, or 0 for as many as it holds
+    size_t groupSize;
+
+    // 0 for a skewed tree, otherwise the fanout of a balanced one
+    size_t fanout;
+
+    // The messages of the previous build to reuse, and the table to record this build in
+    CCNxFileRepoChunkTable *previousChunks;
+    CCNxFileRepoChunkTable *chunks;
+
+    // Where the time spent in each stage of a build is added up, or NULL
+    CCNxManifestBuilderStageTimes *stageTimes;
 };
 
 static bool
 _ccnxManifestBuilder_Destructor(CCNxManifestBuilder **instancePtr)
 {
     assertNotNull(instancePtr, "Parameter must be a non-null pointer to a CCNxManifestBuilder pointer.");
+    CCNxManifestBuilder *builder = *instancePtr;
+    if (builder->previousChunks != NULL) {
+        ccnxFileRepoChunkTable_Release(&builder->previousChunks);
+    }
+    if (builder->chunks != NULL) {
+        ccnxFileRepoChunkTable_Release(&builder->chunks);
+    }
     return true;
 }
 
@@ -100,118 +134,861 @@ ccnxManifestBuilder_AssertValid(const CCNxManifestBuilder *instance)
                "CCNxManifestBuilder is not valid.");
 }
 
+CCNxManifestBuilder *
+ccnxManifestBuilder_Create()
+{
+    CCNxManifestBuilder *result = parcObject_CreateInstance(CCNxManifestBuilder);
+
+    if (result != NULL) {
+        result->chunkSize = 4096; // default chunk size
+        result->threadCount = 1;
+        result->groupSize = 0;
+        result->fanout = 0;
+        result->previousChunks = NULL;
+        result->chunks = NULL;
+        result->stageTimes = NULL;
+    }
+
+    return result;
+}
+
+/**
+ * The number of consecutive chunks read, encoded and written as one unit. Each encoding thread
+ * hashes the chunks of a run together, so this is also the number of messages a multi-buffer
+ * SHA-256 engine gets at once.
+ */
+#define _ccnxManifestBuilder_RunLength 16
+
+/**
+ * The number of runs in flight per encoding thread. A run is taken from the free list by the
+ * reader and given back by the writer, so this bounds how far reading gets ahead of writing.
+ */
+static const size_t _ccnxManifestBuilder_RunsPerThread = 4;
+
+typedef struct {
+    PARCBuffer *chunk;
+    CCNxFileRepoChunkChecksum checksum;
+    CCNxFileRepoEncodedMessage *encoded;
+} _ChunkSlot;
+
+/**
+ * Where the messages of one build go: the sink, and the chunk tables to reuse messages from
+ * and to record them in.
+ */
+typedef struct {
+    const CCNxName *name;
+    CCNxManifestBuilderSink *sink;
+    void *context;
+    CCNxFileRepoChunkTable *previousChunks;
+    CCNxFileRepoChunkTable *chunks;
+} _MessageWriter;
+
+/**
+ * Consecutive chunks on their way through the pipeline. `encoded` is set under the pipeline
+ * lock once every slot has its message.
+ */
+typedef struct {
+    _ChunkSlot slots[_ccnxManifestBuilder_RunLength];
+    size_t count;
+    bool encoded;
+} _ChunkRun;
+
+/**
+ * Runs chunks through three stages connected by bounded queues, so reading the data, encoding
+ * and hashing the chunks, and handing the messages to the sink overlap:
+ *
+ *  - the reader thread takes a run from `free`, fills it from the chunk iterator while feeding
+ *    the application data digest, if the chunks come in file order, and puts it on both the
+ *    encoding pool and `ordered`;
+ *  - the pool threads encode and hash runs in any order and mark them encoded;
+ *  - the writer, which is the thread building the manifests, takes runs from `ordered`, waits
+ *    for each to be encoded, writes its messages and puts it back on `free`.
+ *
+ * Only `runCount` runs exist, so the reader waits on `free` when the writer falls behind.
+ */
+typedef struct {
+    const _MessageWriter *writer;
+    PARCIterator *iterator;
+    bool digestData;
+    CCNxFileRepoSha256 dataDigest;
+
+    _ChunkRun *runs;
+    size_t runCount;
+    CCNxFileRepoQueue *free;
+    CCNxFileRepoQueue *ordered;
+    CCNxFileRepoWorkerPool *pool;
+    pthread_t reader;
+
+    pthread_mutex_t lock;
+    pthread_cond_t runEncoded;
+
+    // The busy time of each stage, and the time the writer spent waiting for runs
+    uint64_t start;
+    uint64_t readNanoseconds;
+    uint64_t encodeNanoseconds;
+    uint64_t writeWaitNanoseconds;
+    CCNxManifestBuilderStageTimes *stageTimes;
+} _ChunkPipeline;
+
+static uint64_t
+_ccnxManifestBuilder_Nanoseconds(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t) now.tv_sec * 1000000000 + now.tv_nsec;
+}
+
+static void
+_ccnxManifestBuilder_InitWriter(_MessageWriter *writer, const CCNxManifestBuilder *builder, const CCNxName *name,
+                                CCNxManifestBuilderSink *sink, void *context)
+{
+    writer->name = name;
+    writer->sink = sink;
+    writer->context = context;
+    writer->previousChunks = builder->previousChunks;
+    writer->chunks = builder->chunks;
+}
+
+/**
+ * Return the message recorded by the previous build for the content with `checksum`, or NULL
+ * if there is no chunk table to look in, or the content is new.
+ */
+static CCNxFileRepoEncodedMessage *
+_ccnxManifestBuilder_FindPrevious(const _MessageWriter *writer, const CCNxFileRepoChunkChecksum *checksum)
+{
+    if (writer->previousChunks == NULL) {
+        return NULL;
+    }
+
+    PARCBuffer *digest = ccnxFileRepoChunkTable_Get(writer->previousChunks, checksum);
+    if (digest == NULL) {
+        return NULL;
+    }
+    CCNxFileRepoEncodedMessage *result = ccnxFileRepoEncodedMessage_CreateFromDigest(digest);
+    parcBuffer_Release(&digest);
+    return result;
+}
+
+/**
+ * Hand a finished message to the sink and record it in the chunk table, if there is one
+ * and `checksum` is not NULL.
+ */
+static void
+_ccnxManifestBuilder_Write(const _MessageWriter *writer, CCNxFileRepoEncodedMessage *encoded,
+                           const CCNxFileRepoChunkChecksum *checksum)
+{
+    writer->sink(writer->context, encoded);
+    if (writer->chunks != NULL && checksum != NULL) {
+        ccnxFileRepoChunkTable_Put(writer->chunks, checksum, ccnxFileRepoEncodedMessage_GetDigest(encoded));
+    }
+}
+
+/**
+ * Encode the chunks of `run` that the previous build did not have, hashing them together.
+ */
+static void
+_ccnxManifestBuilder_EncodeChunkRun(const _MessageWriter *writer, _ChunkRun *run)
+{
+    const CCNxMetaMessage *messages[run->count];
+    CCNxFileRepoEncodedMessage *encoded[run->count];
+    size_t newCount = 0;
+
+    if (writer->previousChunks != NULL || writer->chunks != NULL) {
+        PARCBuffer *chunks[run->count];
+        CCNxFileRepoChunkChecksum checksums[run->count];
+        for (size_t i = 0; i < run->count; i++) {
+            chunks[i] = run->slots[i].chunk;
+        }
+        ccnxFileRepoChunkTable_ComputeChecksums(run->count, chunks, CCNxManifestHashGroupPointerType_Data, checksums);
+        for (size_t i = 0; i < run->count; i++) {
+            run->slots[i].checksum = checksums[i];
+        }
+    }
+
+    for (size_t i = 0; i < run->count; i++) {
+        _ChunkSlot *slot = &run->slots[i];
+        slot->encoded = _ccnxManifestBuilder_FindPrevious(writer, &slot->checksum);
+        if (slot->encoded == NULL) {
+            CCNxContentObject *contentObject = ccnxContentObject_CreateWithNameAndPayload(writer->name, slot->chunk);
+            messages[newCount++] = ccnxMetaMessage_CreateFromContentObject(contentObject);
+            ccnxContentObject_Release(&contentObject);
+        }
+    }
+
+    ccnxFileRepoEncodedMessage_CreateMany(newCount, messages, encoded);
+
+    size_t next = 0;
+    for (size_t i = 0; i < run->count; i++) {
+        if (run->slots[i].encoded == NULL) {
+            run->slots[i].encoded = encoded[next];
+            ccnxMetaMessage_Release((CCNxMetaMessage **) &messages[next]);
+            next++;
+        }
+    }
+}
+
+static void
+_ccnxManifestBuilder_EncodeRun(void *context, void *item)
+{
+    _ChunkPipeline *pipeline = context;
+    _ChunkRun *run = item;
+
+    uint64_t start = _ccnxManifestBuilder_Nanoseconds();
+    _ccnxManifestBuilder_EncodeChunkRun(pipeline->writer, run);
+    __atomic_add_fetch(&pipeline->encodeNanoseconds, _ccnxManifestBuilder_Nanoseconds() - start, __ATOMIC_RELAXED);
+
+    pthread_mutex_lock(&pipeline->lock);
+    run->encoded = true;
+    pthread_cond_signal(&pipeline->runEncoded);
+    pthread_mutex_unlock(&pipeline->lock);
+}
+
+static void *
+_ccnxManifestBuilder_RunReader(void *arg)
+{
+    _ChunkPipeline *pipeline = arg;
+
+    _ChunkRun *run;
+    while (parcIterator_HasNext(pipeline->iterator) && (run = ccnxFileRepoQueue_Get(pipeline->free)) != NULL) {
+        uint64_t start = _ccnxManifestBuilder_Nanoseconds();
+        run->count = 0;
+        run->encoded = false;
+        while (run->count < _ccnxManifestBuilder_RunLength && parcIterator_HasNext(pipeline->iterator)) {
+            _ChunkSlot *slot = &run->slots[run->count++];
+            slot->chunk = (PARCBuffer *) parcIterator_Next(pipeline->iterator);
+            if (pipeline->digestData) {
+                ccnxFileRepoSha256_Update(&pipeline->dataDigest, ccnxFileRepoCommon_GetBufferBytes(slot->chunk),
+                                          parcBuffer_Remaining(slot->chunk));
+            }
+        }
+        pipeline->readNanoseconds += _ccnxManifestBuilder_Nanoseconds() - start;
+
+        // Both queues hold every run, so neither put waits
+        ccnxFileRepoWorkerPool_Submit(pipeline->pool, run);
+        ccnxFileRepoQueue_Put(pipeline->ordered, run);
+    }
+
+    ccnxFileRepoQueue_Close(pipeline->ordered);
+    return NULL;
+}
+
+/**
+ * Start the pipeline on the chunks of `iterator`. With `digestData`, which needs the chunks
+ * in file order, the reader also computes the digest of the data.
+ */
+static void
+_ccnxManifestBuilder_OpenPipeline(_ChunkPipeline *pipeline, const CCNxManifestBuilder *builder, PARCIterator *iterator,
+                                  bool digestData, const _MessageWriter *writer)
+{
+    pipeline->writer = writer;
+    pipeline->iterator = iterator;
+    pipeline->digestData = digestData;
+    ccnxFileRepoSha256_Init(&pipeline->dataDigest);
+
+    pipeline->start = _ccnxManifestBuilder_Nanoseconds();
+    pipeline->readNanoseconds = 0;
+    pipeline->encodeNanoseconds = 0;
+    pipeline->writeWaitNanoseconds = 0;
+    pipeline->stageTimes = builder->stageTimes;
+
+    pthread_mutex_init(&pipeline->lock, NULL);
+    pthread_cond_init(&pipeline->runEncoded, NULL);
+
+    pipeline->runCount = builder->threadCount * _ccnxManifestBuilder_RunsPerThread;
+    pipeline->runs = parcMemory_AllocateAndClear(pipeline->runCount * sizeof(_ChunkRun));
+    assertNotNull(pipeline->runs, "parcMemory_AllocateAndClear(%zu) returned NULL", pipeline->runCount * sizeof(_ChunkRun));
+    pipeline->free = ccnxFileRepoQueue_Create(pipeline->runCount);
+    pipeline->ordered = ccnxFileRepoQueue_Create(pipeline->runCount);
+    for (size_t i = 0; i < pipeline->runCount; i++) {
+        ccnxFileRepoQueue_Put(pipeline->free, &pipeline->runs[i]);
+    }
+
+    pipeline->pool = ccnxFileRepoWorkerPool_Create(builder->threadCount, pipeline->runCount,
+                                                   _ccnxManifestBuilder_EncodeRun, pipeline);
+    int failure = pthread_create(&pipeline->reader, NULL, _ccnxManifestBuilder_RunReader, pipeline);
+    assertTrue(failure == 0, "pthread_create failed: %d", failure);
+}
+
+/**
+ * Return the next run of chunks, in the order they were read, once it is encoded.
+ *
+ * @retval NULL All the data has been read.
+ */
+static _ChunkRun *
+_ccnxManifestBuilder_NextRun(_ChunkPipeline *pipeline)
+{
+    uint64_t start = _ccnxManifestBuilder_Nanoseconds();
+    _ChunkRun *run = ccnxFileRepoQueue_Get(pipeline->ordered);
+    if (run != NULL) {
+        pthread_mutex_lock(&pipeline->lock);
+        while (!run->encoded) {
+            pthread_cond_wait(&pipeline->runEncoded, &pipeline->lock);
+        }
+        pthread_mutex_unlock(&pipeline->lock);
+    }
+    pipeline->writeWaitNanoseconds += _ccnxManifestBuilder_Nanoseconds() - start;
+    return run;
+}
+
+/**
+ * Give a run whose messages have been written back to the reader.
+ */
+static void
+_ccnxManifestBuilder_RecycleRun(_ChunkPipeline *pipeline, _ChunkRun *run)
+{
+    ccnxFileRepoQueue_Put(pipeline->free, run);
+}
+
+/**
+ * Stop the pipeline, once `_ccnxManifestBuilder_NextRun` has returned NULL, add the time each
+ * stage was busy to the builder's stage times, and return the digest of all the data read,
+ * or NULL if the pipeline was not computing it.
+ */
 static PARCBuffer *
-_ccnxManifestBuilder_ComputeMessageHash(CCNxMetaMessage *message)
+_ccnxManifestBuilder_ClosePipeline(_ChunkPipeline *pipeline)
 {
-    PARCBuffer *wireFormatBuffer = ccnxMetaMessage_CreateWireFormatBuffer(message, NULL);
-    CCNxMetaMessage *msg = ccnxMetaMessage_CreateFromWireFormatBuffer(wireFormatBuffer);
-    CCNxWireFormatMessageInterface *interface = ccnxWireFormatMessageInterface_GetInterface(msg);
-    PARCCryptoHash *hash = interface->computeContentObjectHash(msg);
+    pthread_join(pipeline->reader, NULL);
+    ccnxFileRepoWorkerPool_Finish(pipeline->pool);
+    size_t threadCount = ccnxFileRepoWorkerPool_GetThreadCount(pipeline->pool);
+    ccnxFileRepoWorkerPool_Release(&pipeline->pool);
 
-    PARCBuffer *digest = parcBuffer_Acquire(parcCryptoHash_GetDigest(hash));
-    parcCryptoHash_Release(&hash);
-    parcBuffer_Release(&wireFormatBuffer);
+    ccnxFileRepoQueue_Release(&pipeline->ordered);
+    ccnxFileRepoQueue_Release(&pipeline->free);
+    parcMemory_Deallocate(&pipeline->runs);
+    pthread_cond_destroy(&pipeline->runEncoded);
+    pthread_mutex_destroy(&pipeline->lock);
+
+    CCNxManifestBuilderStageTimes *times = pipeline->stageTimes;
+    if (times != NULL) {
+        uint64_t elapsed = _ccnxManifestBuilder_Nanoseconds() - pipeline->start;
+        __atomic_add_fetch(&times->elapsedNanoseconds, elapsed, __ATOMIC_RELAXED);
+        __atomic_add_fetch(&times->readNanoseconds, pipeline->readNanoseconds, __ATOMIC_RELAXED);
+        __atomic_add_fetch(&times->encodeNanoseconds, pipeline->encodeNanoseconds, __ATOMIC_RELAXED);
+        __atomic_add_fetch(&times->encodeThreadNanoseconds, elapsed * threadCount, __ATOMIC_RELAXED);
+        __atomic_add_fetch(&times->writeNanoseconds, elapsed - pipeline->writeWaitNanoseconds, __ATOMIC_RELAXED);
+    }
 
+    if (!pipeline->digestData) {
+        return NULL;
+    }
+    PARCBuffer *digest = parcBuffer_Allocate(CCNxFileRepoSha256_DigestLength);
+    ccnxFileRepoSha256_Final(&pipeline->dataDigest, parcBuffer_Overlay(digest, 0));
     return digest;
 }
 
-CCNxManifestBuilder *
-ccnxManifestBuilder_Create()
+/**
+ * Return the overall data digest of the data of `chunker`: the SHA-256 digest of its bytes in
+ * file order, whatever order a builder adds the chunks in.
+ */
+static PARCBuffer *
+_ccnxManifestBuilder_DigestData(PARCChunker *chunker)
 {
-    CCNxManifestBuilder *result = parcObject_CreateInstance(CCNxManifestBuilder);
+    CCNxFileRepoSha256 sha;
+    ccnxFileRepoSha256_Init(&sha);
 
-    if (result != NULL) {
-        result->chunkSize = 4096; // default chunk size
+    PARCIterator *itr = parcChunker_ForwardIterator(chunker);
+    while (parcIterator_HasNext(itr)) {
+        PARCBuffer *chunk = (PARCBuffer *) parcIterator_Next(itr);
+        ccnxFileRepoSha256_Update(&sha, ccnxFileRepoCommon_GetBufferBytes(chunk), parcBuffer_Remaining(chunk));
+        parcBuffer_Release(&chunk);
     }
+    parcIterator_Release(&itr);
 
-    return result;
+    PARCBuffer *digest = parcBuffer_Allocate(CCNxFileRepoSha256_DigestLength);
+    ccnxFileRepoSha256_Final(&sha, parcBuffer_Overlay(digest, 0));
+    return digest;
 }
 
-PARCLinkedList *
-ccnxManifestBuilder_BuildSkewedManifest(const CCNxManifestBuilder *builder, PARCChunker *chunker, const CCNxName *name)
+static void
+_ccnxManifestBuilder_PutSize(PARCBuffer *buffer, uint64_t size)
 {
-    PARCLinkedList *chunkList = parcLinkedList_Create();
+    parcBuffer_PutArray(buffer, sizeof(size), (const uint8_t *) &size);
+}
+
+/**
+ * Describe everything that goes into the manifest of `group`, other than its name, so that a
+ * checksum of the description identifies the manifest: the type and digest of each pointer
+ * and the metadata of the group.
+ */
+static PARCBuffer *
+_ccnxManifestBuilder_DescribeGroup(const CCNxManifestHashGroup *group)
+{
+    size_t pointerCount = ccnxManifestHashGroup_GetNumberOfPointers(group);
+    PARCBuffer *overallDigest = ccnxManifestHashGroup_GetOverallDataDigest(group);
+
+    size_t length = 3 * sizeof(uint64_t) + ((overallDigest != NULL) ? parcBuffer_Remaining(overallDigest) : 0);
+    for (size_t i = 0; i < pointerCount; i++) {
+        CCNxManifestHashGroupPointer *pointer = ccnxManifestHashGroup_GetPointerAtIndex(group, i);
+        length += 1 + parcBuffer_Remaining(ccnxManifestHashGroupPointer_GetDigest(pointer));
+    }
+
+    PARCBuffer *description = parcBuffer_Allocate(length);
+    for (size_t i = 0; i < pointerCount; i++) {
+        CCNxManifestHashGroupPointer *pointer = ccnxManifestHashGroup_GetPointerAtIndex(group, i);
+        PARCBuffer *digest = (PARCBuffer *) ccnxManifestHashGroupPointer_GetDigest(pointer);
+        uint8_t type = (uint8_t) ccnxManifestHashGroupPointer_GetType(pointer);
+        parcBuffer_PutArray(description, 1, &type);
+        parcBuffer_PutArray(description, parcBuffer_Remaining(digest), parcBuffer_Overlay(digest, 0));
+    }
+    _ccnxManifestBuilder_PutSize(description, ccnxManifestHashGroup_GetBlockSize(group));
+    _ccnxManifestBuilder_PutSize(description, ccnxManifestHashGroup_GetEntrySize(group));
+    _ccnxManifestBuilder_PutSize(description, ccnxManifestHashGroup_GetDataSize(group));
+    if (overallDigest != NULL) {
+        parcBuffer_PutArray(description, parcBuffer_Remaining(overallDigest), parcBuffer_Overlay(overallDigest, 0));
+    }
+    return parcBuffer_Flip(description);
+}
+
+/**
+ * Put `group` in a manifest of its own, encode it unless the previous build already stored
+ * the same manifest, and hand it to the sink. The root is always encoded, because the
+ * caller gets its wire format back, and it is not recorded, because it is never reused.
+ *
+ * @return The encoded manifest, which the caller must release.
+ */
+static CCNxFileRepoEncodedMessage *
+_ccnxManifestBuilder_EmitManifest(const _MessageWriter *writer, CCNxManifestHashGroup *group, bool isRoot)
+{
+    CCNxFileRepoChunkChecksum checksum;
+    CCNxFileRepoEncodedMessage *encodedManifest = NULL;
+    if (!isRoot && (writer->previousChunks != NULL || writer->chunks != NULL)) {
+        PARCBuffer *description = _ccnxManifestBuilder_DescribeGroup(group);
+        ccnxFileRepoChunkTable_ComputeChecksum(description, CCNxManifestHashGroupPointerType_Manifest, &checksum);
+        parcBuffer_Release(&description);
+        encodedManifest = _ccnxManifestBuilder_FindPrevious(writer, &checksum);
+    }
+
+    if (encodedManifest == NULL) {
+        CCNxManifest *manifest = ccnxManifest_Create(writer->name);
+        ccnxManifest_AddHashGroup(manifest, group);
+
+        CCNxMetaMessage *metaManifest = ccnxMetaMessage_CreateFromManifest(manifest);
+        encodedManifest = ccnxFileRepoEncodedMessage_Create(metaManifest);
+        ccnxMetaMessage_Release(&metaManifest);
+        ccnxManifest_Release(&manifest);
+    }
+
+    _ccnxManifestBuilder_Write(writer, encodedManifest, isRoot ? NULL : &checksum);
+    return encodedManifest;
+}
+
+/**
+ * Record the parameters of the publication in the root HashGroup, so that a consumer learns
+ * them from the root: the chunk size as the block size, and the size and digest of the whole
+ * data. With variable chunks the block size is an upper bound. The entry size of the root is
+ * set like that of any other group, from the pointers it holds.
+ */
+static void
+_ccnxManifestBuilder_SetRootMetadata(const CCNxManifestBuilder *builder, CCNxManifestHashGroup *group,
+                                     size_t dataSize, PARCBuffer *dataDigest)
+{
+    ccnxManifestHashGroup_SetBlockSize(group, builder->chunkSize);
+    ccnxManifestHashGroup_SetDataSize(group, dataSize);
+    ccnxManifestHashGroup_SetOverallDataDigest(group, dataDigest);
+}
+
+/**
+ * Check that `chunker` cuts the data into chunks of the size the builder records.
+ */
+static void
+_ccnxManifestBuilder_AssertChunker(const CCNxManifestBuilder *builder, const PARCChunker *chunker)
+{
+    assertTrue(parcChunker_GetChunkSize(chunker) == builder->chunkSize,
+               "Chunker makes %zu byte chunks, the builder expects %zu", parcChunker_GetChunkSize(chunker), builder->chunkSize);
+}
+
+CCNxFileRepoEncodedMessage *
+ccnxManifestBuilder_StreamSkewedManifest(const CCNxManifestBuilder *builder, PARCChunker *chunker, const CCNxName *name,
+                                         CCNxManifestBuilderSink *sink, void *context)
+{
+    _ccnxManifestBuilder_AssertChunker(builder, chunker);
+
+    // The chunks are added from the end, so the data is digested in file order first
+    PARCBuffer *dataDigest = _ccnxManifestBuilder_DigestData(chunker);
+
     CCNxManifestHashGroup *group = ccnxManifestHashGroup_Create();
     PARCIterator *itr = parcChunker_ReverseIterator(chunker);
 
-    // Create a hasher for the application data.
-    PARCCryptoHasher *hasher = parcCryptoHasher_Create(PARCCryptoHashType_SHA256);
-    parcCryptoHasher_Init(hasher);
+    _MessageWriter writer;
+    _ccnxManifestBuilder_InitWriter(&writer, builder, name, sink, context);
+
+    _ChunkPipeline pipeline;
+    _ccnxManifestBuilder_OpenPipeline(&pipeline, builder, itr, false, &writer);
 
-    // Initialize the per-HashGroup metadata values
+    // Initialize the per-HashGroup metadata values. The entry size is the size of every entry
+    // of the group but the last, if they are all the same, or else 0.
     size_t applicationDataSize = 0;
-    size_t blockSize = parcChunker_GetChunkSize(chunker);
+    size_t blockSize = builder->chunkSize;
     size_t entrySize = 0;
+    bool unevenEntries = false;
 
-    while (parcIterator_HasNext(itr)) {
-        PARCBuffer *chunk = (PARCBuffer *) parcIterator_Next(itr);
+    _ChunkRun *run;
+    while ((run = _ccnxManifestBuilder_NextRun(&pipeline)) != NULL) {
+        // Add the runs to the HashGroups in order, so the result does not depend on the threads
+        for (size_t i = 0; i < run->count; i++) {
+            _ChunkSlot *slot = &run->slots[i];
+
+            // Update metadata based on this chunk. The chunks are added from the end, so the
+            // first one in an empty group, the last chunk of the data, is its last entry; any
+            // other group ends with the pointer to the next manifest.
+            size_t nextChunkSize = parcBuffer_Remaining(slot->chunk);
+            applicationDataSize += nextChunkSize;
+            if (ccnxManifestHashGroup_GetNumberOfPointers(group) > 0) {
+                unevenEntries = unevenEntries || (entrySize != 0 && entrySize != nextChunkSize);
+                entrySize = nextChunkSize;
+            }
+            parcBuffer_Release(&slot->chunk);
+
+            // Hand this ContentObject to the sink and add it to the running HashGroup
+            _ccnxManifestBuilder_Write(&writer, slot->encoded, &slot->checksum);
+            ccnxManifestHashGroup_PrependPointer(group, CCNxManifestHashGroupPointerType_Data,
+                                                 ccnxFileRepoEncodedMessage_GetDigest(slot->encoded));
+            ccnxFileRepoEncodedMessage_Release(&slot->encoded);
+
+            // Check to see if the HashGroup is full
+            if (ccnxManifestHashGroup_IsFull(group)
+                || ccnxManifestHashGroup_GetNumberOfPointers(group) == builder->groupSize) {
+                // Set the HashGroup Metadata: the data size covers everything from the chunks
+                // of this group to the end of the data, so a consumer can place the chunks and
+                // the rest of the chain
+                ccnxManifestHashGroup_SetBlockSize(group, blockSize);
+                ccnxManifestHashGroup_SetEntrySize(group, unevenEntries ? 0 : entrySize);
+                ccnxManifestHashGroup_SetDataSize(group, applicationDataSize);
+
+                // Reset the HashGroup metadata variables for the next round
+                entrySize = 0;
+                unevenEntries = false;
+
+                // Add the HashGroup to a parent manifest
+                CCNxFileRepoEncodedMessage *encodedManifest = _ccnxManifestBuilder_EmitManifest(&writer, group, false);
+
+                CCNxManifestHashGroup *newGroup = ccnxManifestHashGroup_Create();
+                ccnxManifestHashGroup_AppendPointer(newGroup, CCNxManifestHashGroupPointerType_Manifest,
+                                                    ccnxFileRepoEncodedMessage_GetDigest(encodedManifest));
+                ccnxManifestHashGroup_Release(&group);
+                ccnxFileRepoEncodedMessage_Release(&encodedManifest);
 
-        // Update metadata based on this chunk
-        parcCryptoHasher_UpdateBuffer(hasher, chunk);
-        size_t nextChunkSize = parcBuffer_Remaining(chunk);
-        applicationDataSize += nextChunkSize;
-        entrySize += nextChunkSize;
-
-        // Add this ContentObject to the list of HashGroups
-        CCNxContentObject *contentObject = ccnxContentObject_CreateWithNameAndPayload(name, chunk);
-        CCNxMetaMessage *metaContent = ccnxMetaMessage_CreateFromContentObject(contentObject);
-        parcLinkedList_Append(chunkList, metaContent);
-
-        // Add this ContentObject to the running HashGroup
-        PARCBuffer *digest = _ccnxManifestBuilder_ComputeMessageHash(metaContent);
-        ccnxManifestHashGroup_PrependPointer(group, CCNxManifestHashGroupPointerType_Data, digest);
-        parcBuffer_Release(&digest);
-
-        // Check to see if the HashGroup is full
-        if (ccnxManifestHashGroup_IsFull(group)) {
-            // Set the HashGroup Metadata
-            ccnxManifestHashGroup_SetBlockSize(group, blockSize);
-            ccnxManifestHashGroup_SetEntrySize(group, entrySize);
-            ccnxManifestHashGroup_SetDataSize(group, entrySize);
-
-            // Reset the HashGroup metadata variables for the next round
-            entrySize = 0;
-
-            // Add the HashGroup to a parent manifest
-            CCNxManifest *root = ccnxManifest_Create(name);
-            ccnxManifest_AddHashGroup(root, group);
-            parcLinkedList_Append(chunkList, root);
-
-            CCNxMetaMessage *metaManifest = ccnxMetaMessage_CreateFromManifest(root);
-            PARCBuffer *digest = _ccnxManifestBuilder_ComputeMessageHash(metaManifest);
-            ccnxMetaMessage_Release(&metaManifest);
-
-            CCNxManifestHashGroup *newGroup = ccnxManifestHashGroup_Create();
-            ccnxManifestHashGroup_AppendPointer(newGroup, CCNxManifestHashGroupPointerType_Manifest, digest);
-            ccnxManifestHashGroup_Release(&group);
-            parcBuffer_Release(&digest);
-
-            group = ccnxManifestHashGroup_Acquire(newGroup);
-            ccnxManifestHashGroup_Release(&newGroup);
+                group = ccnxManifestHashGroup_Acquire(newGroup);
+                ccnxManifestHashGroup_Release(&newGroup);
+            }
         }
+        _ccnxManifestBuilder_RecycleRun(&pipeline, run);
     }
 
-    // Finalize the overall application data digest
-    PARCCryptoHash *hash = parcCryptoHasher_Finalize(hasher);
-    PARCBuffer *digest = parcCryptoHash_GetDigest(hash);
+    _ccnxManifestBuilder_ClosePipeline(&pipeline);
 
     // Add the root metadata to the final HashGroup
-    ccnxManifestHashGroup_SetDataSize(group, applicationDataSize);
-    ccnxManifestHashGroup_SetOverallDataDigest(group, digest);
-    parcCryptoHash_Release(&hash);
-    parcCryptoHasher_Release(&hasher);
+    ccnxManifestHashGroup_SetEntrySize(group, unevenEntries ? 0 : entrySize);
+    _ccnxManifestBuilder_SetRootMetadata(builder, group, applicationDataSize, dataDigest);
+    parcBuffer_Release(&dataDigest);
 
     // Add the HashGroup to the root manifest and return the result.
-    CCNxManifest *manifest = ccnxManifest_Create(name);
-    ccnxManifest_AddHashGroup(manifest, group);
+    CCNxFileRepoEncodedMessage *encodedManifest = _ccnxManifestBuilder_EmitManifest(&writer, group, true);
+    ccnxManifestHashGroup_Release(&group);
+    parcIterator_Release(&itr);
+
+    return encodedManifest;
+}
+
+/**
+ * The HashGroup being filled at one level of a balanced tree: data pointers at level 0,
+ * manifest pointers above.
+ */
+typedef struct {
+    CCNxManifestHashGroup *group;
+    size_t pointerCount;
+    size_t dataSize;
+
+    // The size under the pointers before the last one, unless they differ
+    size_t entrySize;
+    size_t lastSize;
+    bool unevenEntries;
+} _TreeLevel;
+
+/**
+ * Count a pointer to `dataSize` bytes added to the group of `treeLevel`.
+ */
+static void
+_ccnxManifestBuilder_CountPointer(_TreeLevel *treeLevel, size_t dataSize)
+{
+    // The pointer that was last is now followed by this one
+    if (treeLevel->pointerCount == 1) {
+        treeLevel->entrySize = treeLevel->lastSize;
+    } else if (treeLevel->pointerCount > 1 && treeLevel->lastSize != treeLevel->entrySize) {
+        treeLevel->unevenEntries = true;
+    }
+    treeLevel->lastSize = dataSize;
+    treeLevel->pointerCount++;
+    treeLevel->dataSize += dataSize;
+}
+
+/**
+ * Record the block size, entry size and data size of the group of `treeLevel`, and start the
+ * level over. The entry size is that of every pointer but the last, if they are all the same,
+ * so a consumer can find the pointer that covers any offset without fetching the others.
+ */
+static void
+_ccnxManifestBuilder_CloseLevel(_TreeLevel *treeLevel, size_t blockSize)
+{
+    ccnxManifestHashGroup_SetBlockSize(treeLevel->group, blockSize);
+    ccnxManifestHashGroup_SetEntrySize(treeLevel->group, treeLevel->unevenEntries ? 0 : treeLevel->entrySize);
+    ccnxManifestHashGroup_SetDataSize(treeLevel->group, treeLevel->dataSize);
+
+    treeLevel->pointerCount = 0;
+    treeLevel->dataSize = 0;
+    treeLevel->entrySize = 0;
+    treeLevel->lastSize = 0;
+    treeLevel->unevenEntries = false;
+}
+
+/**
+ * Add a pointer to the group at `levels[level]`. If that fills the group, it is emitted as a
+ * manifest and a pointer to it is added one level up, so only one group per level is open.
+ */
+static void
+_ccnxManifestBuilder_AddToLevel(_TreeLevel *levels, size_t level, size_t capacity, size_t blockSize,
+                                CCNxManifestHashGroupPointerType type, const PARCBuffer *digest, size_t dataSize,
+                                const _MessageWriter *writer)
+{
+    assertTrue(level < _ccnxManifestBuilder_MaximumTreeDepth, "Balanced tree deeper than %d levels", _ccnxManifestBuilder_MaximumTreeDepth);
+
+    _TreeLevel *treeLevel = &levels[level];
+    if (treeLevel->group == NULL) {
+        treeLevel->group = ccnxManifestHashGroup_Create();
+    }
+
+    ccnxManifestHashGroup_AppendPointer(treeLevel->group, type, (PARCBuffer *) digest);
+    _ccnxManifestBuilder_CountPointer(treeLevel, dataSize);
+
+    if (treeLevel->pointerCount == capacity || ccnxManifestHashGroup_IsFull(treeLevel->group)) {
+        size_t subtreeSize = treeLevel->dataSize;
+        _ccnxManifestBuilder_CloseLevel(treeLevel, blockSize);
+
+        CCNxFileRepoEncodedMessage *encodedManifest = _ccnxManifestBuilder_EmitManifest(writer, treeLevel->group, false);
+        ccnxManifestHashGroup_Release(&treeLevel->group);
+
+        _ccnxManifestBuilder_AddToLevel(levels, level + 1, capacity, blockSize, CCNxManifestHashGroupPointerType_Manifest,
+                                        ccnxFileRepoEncodedMessage_GetDigest(encodedManifest), subtreeSize, writer);
+        ccnxFileRepoEncodedMessage_Release(&encodedManifest);
+    }
+}
+
+CCNxFileRepoEncodedMessage *
+ccnxManifestBuilder_StreamBalancedManifest(const CCNxManifestBuilder *builder, PARCChunker *chunker, const CCNxName *name,
+                                           CCNxManifestBuilderSink *sink, void *context)
+{
+    _ccnxManifestBuilder_AssertChunker(builder, chunker);
+
+    PARCIterator *itr = parcChunker_ForwardIterator(chunker);
+
+    _MessageWriter writer;
+    _ccnxManifestBuilder_InitWriter(&writer, builder, name, sink, context);
+
+    _ChunkPipeline pipeline;
+    _ccnxManifestBuilder_OpenPipeline(&pipeline, builder, itr, true, &writer);
+
+    _TreeLevel levels[_ccnxManifestBuilder_MaximumTreeDepth];
+    memset(levels, 0, sizeof(levels));
+    size_t blockSize = builder->chunkSize;
+    size_t applicationDataSize = 0;
+
+    // The fanout, unless the HashGroups are limited to fewer pointers
+    size_t capacity = builder->fanout;
+    if (builder->groupSize > 0 && builder->groupSize < capacity) {
+        capacity = builder->groupSize;
+    }
+
+    _ChunkRun *run;
+    while ((run = _ccnxManifestBuilder_NextRun(&pipeline)) != NULL) {
+        for (size_t i = 0; i < run->count; i++) {
+            _ChunkSlot *slot = &run->slots[i];
+            size_t chunkSize = parcBuffer_Remaining(slot->chunk);
+            applicationDataSize += chunkSize;
+            parcBuffer_Release(&slot->chunk);
+
+            _ccnxManifestBuilder_Write(&writer, slot->encoded, &slot->checksum);
+            _ccnxManifestBuilder_AddToLevel(levels, 0, capacity, blockSize, CCNxManifestHashGroupPointerType_Data,
+                                            ccnxFileRepoEncodedMessage_GetDigest(slot->encoded), chunkSize, &writer);
+            ccnxFileRepoEncodedMessage_Release(&slot->encoded);
+        }
+        _ccnxManifestBuilder_RecycleRun(&pipeline, run);
+    }
+
+    PARCBuffer *dataDigest = _ccnxManifestBuilder_ClosePipeline(&pipeline);
+
+    // Close the partial groups from the bottom up. The highest open group becomes the root,
+    // unless a lower group is still open, in which case it must be pointed at from above.
+    size_t top = 0;
+    for (size_t level = 0; level < _ccnxManifestBuilder_MaximumTreeDepth; level++) {
+        if (levels[level].group != NULL) {
+            top = level;
+        }
+    }
+    for (size_t level = 0; level < top; level++) {
+        _TreeLevel *treeLevel = &levels[level];
+        if (treeLevel->group != NULL) {
+            size_t subtreeSize = treeLevel->dataSize;
+            _ccnxManifestBuilder_CloseLevel(treeLevel, blockSize);
+
+            CCNxFileRepoEncodedMessage *encodedManifest = _ccnxManifestBuilder_EmitManifest(&writer, treeLevel->group, false);
+            ccnxManifestHashGroup_Release(&treeLevel->group);
+
+            _TreeLevel *parent = &levels[level + 1];
+            if (parent->group == NULL) {
+                parent->group = ccnxManifestHashGroup_Create();
+            }
+            ccnxManifestHashGroup_AppendPointer(parent->group, CCNxManifestHashGroupPointerType_Manifest,
+                                                ccnxFileRepoEncodedMessage_GetDigest(encodedManifest));
+            _ccnxManifestBuilder_CountPointer(parent, subtreeSize);
+            ccnxFileRepoEncodedMessage_Release(&encodedManifest);
+        }
+    }
+
+    // The root carries the metadata of the whole file; an empty file has an empty root.
+    if (levels[top].group == NULL) {
+        levels[top].group = ccnxManifestHashGroup_Create();
+    }
+    CCNxManifestHashGroup *group = levels[top].group;
+    _ccnxManifestBuilder_CloseLevel(&levels[top], blockSize);
+    _ccnxManifestBuilder_SetRootMetadata(builder, group, applicationDataSize, dataDigest);
+    parcBuffer_Release(&dataDigest);
+
+    CCNxFileRepoEncodedMessage *encodedManifest = _ccnxManifestBuilder_EmitManifest(&writer, group, true);
     ccnxManifestHashGroup_Release(&group);
+    parcIterator_Release(&itr);
+
+    return encodedManifest;
+}
 
-    parcLinkedList_Append(chunkList, manifest);
-    ccnxManifest_Release(&manifest);
+static void
+_ccnxManifestBuilder_AppendToList(void *context, CCNxFileRepoEncodedMessage *message)
+{
+    parcLinkedList_Append((PARCLinkedList *) context, message);
+}
+
+PARCLinkedList *
+ccnxManifestBuilder_BuildSkewedManifest(const CCNxManifestBuilder *builder, PARCChunker *chunker, const CCNxName *name)
+{
+    PARCLinkedList *chunkList = parcLinkedList_Create();
+    CCNxFileRepoEncodedMessage *root =
+        ccnxManifestBuilder_StreamSkewedManifest(builder, chunker, name, _ccnxManifestBuilder_AppendToList, chunkList);
+    ccnxFileRepoEncodedMessage_Release(&root);
+    return chunkList;
+}
 
+PARCLinkedList *
+ccnxManifestBuilder_BuildBalancedManifest(const CCNxManifestBuilder *builder, PARCChunker *chunker, const CCNxName *name)
+{
+    PARCLinkedList *chunkList = parcLinkedList_Create();
+    CCNxFileRepoEncodedMessage *root =
+        ccnxManifestBuilder_StreamBalancedManifest(builder, chunker, name, _ccnxManifestBuilder_AppendToList, chunkList);
+    ccnxFileRepoEncodedMessage_Release(&root);
     return chunkList;
 }
 
+CCNxFileRepoEncodedMessage *
+ccnxManifestBuilder_StreamManifest(const CCNxManifestBuilder *builder, PARCChunker *chunker, const CCNxName *name,
+                                   CCNxManifestBuilderSink *sink, void *context)
+{
+    if (builder->fanout > 0) {
+        return ccnxManifestBuilder_StreamBalancedManifest(builder, chunker, name, sink, context);
+    }
+    return ccnxManifestBuilder_StreamSkewedManifest(builder, chunker, name, sink, context);
+}
+
+void
+ccnxManifestBuilder_SetChunkSize(CCNxManifestBuilder *builder, size_t chunkSize)
+{
+    assertTrue(chunkSize > 0, "The chunk size must be positive");
+    builder->chunkSize = chunkSize;
+}
+
+size_t
+ccnxManifestBuilder_GetChunkSize(const CCNxManifestBuilder *builder)
+{
+    return builder->chunkSize;
+}
+
+void
+ccnxManifestBuilder_SetGroupSize(CCNxManifestBuilder *builder, size_t groupSize)
+{
+    assertTrue(groupSize == 0 || groupSize >= 2, "A HashGroup needs room for at least 2 pointers, got %zu", groupSize);
+    builder->groupSize = groupSize;
+}
+
+size_t
+ccnxManifestBuilder_GetGroupSize(const CCNxManifestBuilder *builder)
+{
+    return builder->groupSize;
+}
+
+void
+ccnxManifestBuilder_SetFanout(CCNxManifestBuilder *builder, size_t fanout)
+{
+    assertTrue(fanout == 0 || fanout >= 2, "A balanced tree needs a fanout of at least 2, got %zu", fanout);
+    builder->fanout = fanout;
+}
+
+size_t
+ccnxManifestBuilder_GetFanout(const CCNxManifestBuilder *builder)
+{
+    return builder->fanout;
+}
+
+void
+ccnxManifestBuilder_SetThreadCount(CCNxManifestBuilder *builder, size_t threadCount)
+{
+    builder->threadCount = (threadCount > 0) ? threadCount : 1;
+}
+
+size_t
+ccnxManifestBuilder_GetThreadCount(const CCNxManifestBuilder *builder)
+{
+    return builder->threadCount;
+}
+
+void
+ccnxManifestBuilder_SetPreviousChunkTable(CCNxManifestBuilder *builder, CCNxFileRepoChunkTable *table)
+{
+    if (builder->previousChunks != NULL) {
+        ccnxFileRepoChunkTable_Release(&builder->previousChunks);
+    }
+    builder->previousChunks = (table != NULL) ? ccnxFileRepoChunkTable_Acquire(table) : NULL;
+}
+
+void
+ccnxManifestBuilder_SetChunkTable(CCNxManifestBuilder *builder, CCNxFileRepoChunkTable *table)
+{
+    if (builder->chunks != NULL) {
+        ccnxFileRepoChunkTable_Release(&builder->chunks);
+    }
+    builder->chunks = (table != NULL) ? ccnxFileRepoChunkTable_Acquire(table) : NULL;
+}
+
+void
+ccnxManifestBuilder_SetStageTimes(CCNxManifestBuilder *builder, CCNxManifestBuilderStageTimes *times)
+{
+    builder->stageTimes = times;
+}
+
+static double
+_ccnxManifestBuilder_Percent(uint64_t busy, uint64_t available)
+{
+    return (available > 0) ? 100.0 * busy / available : 0.0;
+}
+
+char *
+ccnxManifestBuilder_StageTimesToString(const CCNxManifestBuilderStageTimes *times)
+{
+    uint64_t elapsed = __atomic_load_n(&times->elapsedNanoseconds, __ATOMIC_RELAXED);
+    return parcMemory_Format("ingest %.2fs, busy: read %.0f%%, encode %.0f%%, write %.0f%%",
+                             elapsed / 1e9,
+                             _ccnxManifestBuilder_Percent(__atomic_load_n(&times->readNanoseconds, __ATOMIC_RELAXED), elapsed),
+                             _ccnxManifestBuilder_Percent(__atomic_load_n(&times->encodeNanoseconds, __ATOMIC_RELAXED),
+                                                          __atomic_load_n(&times->encodeThreadNanoseconds, __ATOMIC_RELAXED)),
+                             _ccnxManifestBuilder_Percent(__atomic_load_n(&times->writeNanoseconds, __ATOMIC_RELAXED), elapsed));
+}
+
 int
 ccnxManifestBuilder_Compare(const CCNxManifestBuilder *instance, const CCNxManifestBuilder *other)
 {
@@ -235,13 +1012,22 @@ CCNxManifestBuilder *
 ccnxManifestBuilder_Copy(const CCNxManifestBuilder *original)
 {
     CCNxManifestBuilder *result = ccnxManifestBuilder_Create();
+    result->threadCount = original->threadCount;
+    result->chunkSize = original->chunkSize;
+    result->groupSize = original->groupSize;
+    result->fanout = original->fanout;
+    ccnxManifestBuilder_SetPreviousChunkTable(result, original->previousChunks);
+    ccnxManifestBuilder_SetChunkTable(result, original->chunks);
+    result->stageTimes = original->stageTimes;
     return result;
 }
 
 void
 ccnxManifestBuilder_Display(const CCNxManifestBuilder *instance, int indentation)
 {
-    parcDisplayIndented_PrintLine(indentation, "CCNxManifestBuilder@%p { chunkSize = %zu }", instance->chunkSize);
+    parcDisplayIndented_PrintLine(indentation, "CCNxManifestBuilder@%p { chunkSize = %zu, groupSize = %zu, threadCount = %zu, fanout = %zu }",
+                                  (void *) instance, instance->chunkSize, instance->groupSize, instance->threadCount,
+                                  instance->fanout);
 }
 
 bool
@@ -254,7 +1040,7 @@ ccnxManifestBuilder_Equals(const CCNxManifestBuilder *x, const CCNxManifestBuild
     } else if (x == NULL || y == NULL) {
         result = false;
     } else {
-        if (x->chunkSize == y->chunkSize) {
+        if (x->chunkSize == y->chunkSize && x->groupSize == y->groupSize && x->fanout == y->fanout) {
             result = true;
         }
     }
@@ -292,6 +1078,10 @@ ccnxManifestBuilder_ToJSON(const CCNxManifestBuilder *instance)
         PARCJSONPair *pair = parcJSONPair_Create(entryName, value);
         parcBuffer_Release(&entryName);
         parcJSON_AddPair(result, pair);
+
+        parcJSON_AddInteger(result, "threadCount", instance->threadCount);
+        parcJSON_AddInteger(result, "groupSize", instance->groupSize);
+        parcJSON_AddInteger(result, "fanout", instance->fanout);
     }
 
     return result;
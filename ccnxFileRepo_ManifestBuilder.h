@@ -65,12 +65,50 @@
 #ifndef libccnx_common_ccnx_ManifestBuilder
 #define libccnx_common_ccnx_ManifestBuilder
 
+#include <stdint.h>
+
 #include <parc/algol/parc_JSON.h>
 #include <parc/algol/parc_HashCode.h>
 
+#include "ccnxFileRepo_EncodedMessage.h"
+#include "ccnxFileRepo_ChunkTable.h"
+
 struct ccnx_manifest_builder;
 typedef struct ccnx_manifest_builder CCNxManifestBuilder;
 
+/**
+ * The function a streaming builder hands each finished message to, in the order the
+ * messages are built: every chunk and intermediate manifest before the manifest that
+ * points at it, and the root manifest last.
+ *
+ * A message the builder found in the previous chunk table, see
+ * `ccnxManifestBuilder_SetPreviousChunkTable`, is handed over with a NULL wire format: it
+ * is already stored, and the sink only needs its digest.
+ *
+ * @param [in] context The context given to `ccnxManifestBuilder_StreamSkewedManifest`.
+ * @param [in] message The encoded message. The sink must acquire it to keep it.
+ */
+typedef void (CCNxManifestBuilderSink)(void *context, CCNxFileRepoEncodedMessage *message);
+
+/**
+ * The time the stages of one or more builds were busy, in nanoseconds. Comparing each stage
+ * with the time it had shows which one limits the build.
+ */
+typedef struct {
+    // The time the builds took
+    uint64_t elapsedNanoseconds;
+
+    // Reading chunks and feeding the application data digest, on the reader thread
+    uint64_t readNanoseconds;
+
+    // Encoding and hashing chunks, summed over the encoding threads, out of the time they had
+    uint64_t encodeNanoseconds;
+    uint64_t encodeThreadNanoseconds;
+
+    // Handing messages to the sink and building manifests, on the calling thread
+    uint64_t writeNanoseconds;
+} CCNxManifestBuilderStageTimes;
+
 /**
  * Increase the number of references to a `CCNxManifestBuilder` instance.
  *
@@ -395,7 +433,12 @@ char *ccnxManifestBuilder_ToString(const CCNxManifestBuilder *instance);
  * Produce a skewed Manifest.
  *
  * Each HashGroup in a manifest will contain a list of data pointers and then
- * a single Manifest pointer.
+ * a single Manifest pointer. The chunks are added from the end of the data, so the data is
+ * read once more, in file order, for the overall data digest of the root.
+ *
+ * Every message is encoded once, as a `CCNxFileRepoEncodedMessage` that carries its wire
+ * format and content object hash, so the result can be stored without encoding it again.
+ * The root manifest is the last element of the list.
  *
  * @param [in] instance The `CCNxManifestBuilder`.
  * @param [in] chunker A `PARCChunker` that chunks up the data to be created.
@@ -408,13 +451,268 @@ char *ccnxManifestBuilder_ToString(const CCNxManifestBuilder *instance);
  *     PARCChunker *chunker = ...
  *     CCNxName *manifestName = ccnxName_CreateFromCString("ccnx:/my/manifest");
  *
- *     CCNxManifest *manifest = ccnxManifestBuilder_BuildSkewedManifest(builder, chunker, manifestName);
+ *     PARCLinkedList *messages = ccnxManifestBuilder_BuildSkewedManifest(builder, chunker, manifestName);
+ *     CCNxFileRepoEncodedMessage *root = parcLinkedList_GetLast(messages);
  *
  *     ccnxManifestBuilder_Release(&builder);
  *     parcChunker_Release(&chunker);
  *     ccnxName_Release(&manifestName);
+ *     parcLinkedList_Release(&messages);
  * }
  * @endcode
  */
 PARCLinkedList *ccnxManifestBuilder_BuildSkewedManifest(const CCNxManifestBuilder *instance, PARCChunker *chunker, const CCNxName *name);
+
+/**
+ * Produce a skewed Manifest, handing each message to `sink` as soon as it is built.
+ *
+ * This builds the same messages as `ccnxManifestBuilder_BuildSkewedManifest`, but keeps none
+ * of them: only the HashGroup being filled and the chunks being encoded are held in memory,
+ * so a file of any size is built in bounded memory.
+ *
+ * @param [in] instance The `CCNxManifestBuilder`.
+ * @param [in] chunker A `PARCChunker` that chunks up the data to be created.
+ * @param [in] name The `CCNxName` of the Manifest. This may not be null.
+ * @param [in] sink The function called with each message, on the calling thread.
+ * @param [in] context Passed to every call of `sink`.
+ *
+ * @return The root manifest, which has also been handed to `sink`. The caller must release it.
+ *
+ * Example:
+ * @code
+ * {
+ *     CCNxFileRepoEncodedMessage *root =
+ *         ccnxManifestBuilder_StreamSkewedManifest(builder, chunker, manifestName, _storeMessage, store);
+ *     ccnxFileRepoEncodedMessage_Release(&root);
+ * }
+ * @endcode
+ */
+CCNxFileRepoEncodedMessage *ccnxManifestBuilder_StreamSkewedManifest(const CCNxManifestBuilder *instance, PARCChunker *chunker,
+                                                                     const CCNxName *name, CCNxManifestBuilderSink *sink, void *context);
+
+/**
+ * Produce a balanced Manifest tree whose manifests each point at up to `fanout` children.
+ *
+ * The leaves point at the data in order and each manifest above points at the manifests
+ * below it in order, so the tree is O(log n) deep and a consumer learns about many data
+ * pointers after fetching only a few manifests. Each manifest holds a single HashGroup.
+ * The root carries the size and the overall digest of the data, which is the SHA-256 digest
+ * of its bytes in file order for either shape of tree.
+ *
+ * The fanout is set with `ccnxManifestBuilder_SetFanout`; a HashGroup that fills up before
+ * reaching it is closed early. The root manifest is the last element of the list.
+ *
+ * @param [in] instance The `CCNxManifestBuilder`, with a fanout of at least 2.
+ * @param [in] chunker A `PARCChunker` that chunks up the data to be created.
+ * @param [in] name The `CCNxName` of the Manifest. This may not be null.
+ *
+ * Example:
+ * @code
+ * {
+ *     CCNxManifestBuilder *builder = ccnxManifestBuilder_Create();
+ *     ccnxManifestBuilder_SetFanout(builder, 64);
+ *
+ *     PARCLinkedList *messages = ccnxManifestBuilder_BuildBalancedManifest(builder, chunker, manifestName);
+ *     parcLinkedList_Release(&messages);
+ * }
+ * @endcode
+ */
+PARCLinkedList *ccnxManifestBuilder_BuildBalancedManifest(const CCNxManifestBuilder *instance, PARCChunker *chunker, const CCNxName *name);
+
+/**
+ * Produce a balanced Manifest tree, handing each message to `sink` as soon as it is built.
+ *
+ * This builds the same messages as `ccnxManifestBuilder_BuildBalancedManifest`, keeping only
+ * one open HashGroup per level of the tree in memory.
+ *
+ * @param [in] instance The `CCNxManifestBuilder`, with a fanout of at least 2.
+ * @param [in] chunker A `PARCChunker` that chunks up the data to be created.
+ * @param [in] name The `CCNxName` of the Manifest. This may not be null.
+ * @param [in] sink The function called with each message, on the calling thread.
+ * @param [in] context Passed to every call of `sink`.
+ *
+ * @return The root manifest, which has also been handed to `sink`. The caller must release it.
+ */
+CCNxFileRepoEncodedMessage *ccnxManifestBuilder_StreamBalancedManifest(const CCNxManifestBuilder *instance, PARCChunker *chunker,
+                                                                       const CCNxName *name, CCNxManifestBuilderSink *sink, void *context);
+
+/**
+ * Produce the Manifest tree selected by the fanout of the builder: balanced if it is set,
+ * skewed otherwise, handing each message to `sink` as soon as it is built.
+ *
+ * @param [in] instance The `CCNxManifestBuilder`.
+ * @param [in] chunker A `PARCChunker` that chunks up the data to be created.
+ * @param [in] name The `CCNxName` of the Manifest. This may not be null.
+ * @param [in] sink The function called with each message, on the calling thread.
+ * @param [in] context Passed to every call of `sink`.
+ *
+ * @return The root manifest, which has also been handed to `sink`. The caller must release it.
+ */
+CCNxFileRepoEncodedMessage *ccnxManifestBuilder_StreamManifest(const CCNxManifestBuilder *instance, PARCChunker *chunker,
+                                                               const CCNxName *name, CCNxManifestBuilderSink *sink, void *context);
+
+/**
+ * Set the size of the chunks the data is cut into. The chunker given to the builder must
+ * report this size; it is recorded as the block size of the root HashGroup so that a
+ * consumer can size its buffers. A chunker with variable chunks, such as
+ * `CCNxFileRepoContentChunker`, reports its largest chunk, and the data sizes of the
+ * HashGroups are the sums of the actual chunks. The default is 4096 bytes.
+ *
+ * @param [in] instance The `CCNxManifestBuilder`.
+ * @param [in] chunkSize The chunk size, in bytes.
+ *
+ * Example:
+ * @code
+ * {
+ *     CCNxManifestBuilder *builder = ccnxManifestBuilder_Create();
+ *     ccnxManifestBuilder_SetChunkSize(builder, 8192);
+ *
+ *     PARCFileChunker *fileChunker = parcFileChunker_Create(file, ccnxManifestBuilder_GetChunkSize(builder));
+ * }
+ * @endcode
+ */
+void ccnxManifestBuilder_SetChunkSize(CCNxManifestBuilder *instance, size_t chunkSize);
+
+/**
+ * Return the size of the chunks the data is cut into, in bytes.
+ *
+ * @param [in] instance The `CCNxManifestBuilder`.
+ */
+size_t ccnxManifestBuilder_GetChunkSize(const CCNxManifestBuilder *instance);
+
+/**
+ * Limit the number of pointers in each HashGroup. A group that reaches the limit is closed
+ * and a new one started, as a full group is. The limit is not recorded in the manifests;
+ * a repo keeps it with the publication. A size of 0, the default, fills each group to the
+ * capacity of a HashGroup.
+ *
+ * @param [in] instance The `CCNxManifestBuilder`.
+ * @param [in] groupSize 0, or the most pointers in a HashGroup, at least 2.
+ */
+void ccnxManifestBuilder_SetGroupSize(CCNxManifestBuilder *instance, size_t groupSize);
+
+/**
+ * Return the most pointers in a HashGroup, or 0 if groups are filled to their capacity.
+ *
+ * @param [in] instance The `CCNxManifestBuilder`.
+ */
+size_t ccnxManifestBuilder_GetGroupSize(const CCNxManifestBuilder *instance);
+
+/**
+ * Set the fanout of the balanced trees built by `ccnxManifestBuilder_StreamManifest`.
+ * A fanout of 0, the default, selects the skewed tree.
+ *
+ * @param [in] instance The `CCNxManifestBuilder`.
+ * @param [in] fanout 0, or the largest number of children of a manifest, at least 2.
+ */
+void ccnxManifestBuilder_SetFanout(CCNxManifestBuilder *instance, size_t fanout);
+
+/**
+ * Return the fanout of the balanced trees built, or 0 if skewed trees are built.
+ *
+ * @param [in] instance The `CCNxManifestBuilder`.
+ */
+size_t ccnxManifestBuilder_GetFanout(const CCNxManifestBuilder *instance);
+
+/**
+ * Encode and hash chunks on `threadCount` threads while building manifests.
+ *
+ * A build is a pipeline: a reader thread reads the chunks, `threadCount` threads encode and
+ * hash them, and the calling thread adds them to the manifests in order and hands every
+ * message to the sink, so reading, hashing and storing overlap. The stages are connected by
+ * bounded queues, so a slow stage holds up the ones before it rather than letting chunks pile
+ * up in memory. The messages built are byte-identical whatever the thread count. A count of 0
+ * is taken as 1, the default.
+ *
+ * @param [in] instance The `CCNxManifestBuilder`.
+ * @param [in] threadCount The number of threads that encode chunks.
+ *
+ * Example:
+ * @code
+ * {
+ *     CCNxManifestBuilder *builder = ccnxManifestBuilder_Create();
+ *     ccnxManifestBuilder_SetThreadCount(builder, sysconf(_SC_NPROCESSORS_ONLN));
+ *
+ *     PARCLinkedList *messages = ccnxManifestBuilder_BuildSkewedManifest(builder, chunker, manifestName);
+ * }
+ * @endcode
+ */
+void ccnxManifestBuilder_SetThreadCount(CCNxManifestBuilder *instance, size_t threadCount);
+
+/**
+ * Return the number of threads that encode chunks, at least 1.
+ *
+ * @param [in] instance The `CCNxManifestBuilder`.
+ */
+size_t ccnxManifestBuilder_GetThreadCount(const CCNxManifestBuilder *instance);
+
+/**
+ * Reuse the messages recorded in `table` by a previous build of the same name.
+ *
+ * The content of every chunk is hashed with SHA-256 before it is encoded, and a chunk whose
+ * hash is in the table is not encoded again: the builder hands the sink a message with the
+ * digest from the table and no wire format. Manifests are checked the same way, by a hash of
+ * their pointers and metadata, so only the manifests above a changed chunk are encoded again.
+ * The messages of the table must still be in the store.
+ *
+ * @param [in] instance The `CCNxManifestBuilder`.
+ * @param [in] table The `CCNxFileRepoChunkTable` of the previous version, or NULL to encode every message.
+ *
+ * Example:
+ * @code
+ * {
+ *     CCNxFileRepoChunkTable *previous = ccnxFileRepoChunkTable_Open("/tmp/repo/file.chunks");
+ *     CCNxFileRepoChunkTable *next = ccnxFileRepoChunkTable_Create("/tmp/repo/file.chunks.tmp", 1024);
+ *     ccnxManifestBuilder_SetPreviousChunkTable(builder, previous);
+ *     ccnxManifestBuilder_SetChunkTable(builder, next);
+ *
+ *     CCNxFileRepoEncodedMessage *root = ccnxManifestBuilder_StreamManifest(builder, chunker, name, sink, context);
+ * }
+ * @endcode
+ */
+void ccnxManifestBuilder_SetPreviousChunkTable(CCNxManifestBuilder *instance, CCNxFileRepoChunkTable *table);
+
+/**
+ * Record the checksum and digest of every message built in `table`, to be given to
+ * `ccnxManifestBuilder_SetPreviousChunkTable` when the same name is built again.
+ *
+ * @param [in] instance The `CCNxManifestBuilder`.
+ * @param [in] table A `CCNxFileRepoChunkTable` made by `ccnxFileRepoChunkTable_Create`, or NULL to record nothing.
+ */
+void ccnxManifestBuilder_SetChunkTable(CCNxManifestBuilder *instance, CCNxFileRepoChunkTable *table);
+
+/**
+ * Add the time each stage of every build is busy to `times`.
+ *
+ * The times are added atomically, so builds on several threads may share one
+ * `CCNxManifestBuilderStageTimes`. The builder does not copy or free `times`.
+ *
+ * @param [in] instance The `CCNxManifestBuilder`.
+ * @param [in] times A zeroed `CCNxManifestBuilderStageTimes` that outlives the builds, or NULL to not time them.
+ *
+ * Example:
+ * @code
+ * {
+ *     CCNxManifestBuilderStageTimes times = { 0 };
+ *     ccnxManifestBuilder_SetStageTimes(builder, &times);
+ *
+ *     CCNxFileRepoEncodedMessage *root = ccnxManifestBuilder_StreamManifest(builder, chunker, name, sink, context);
+ *
+ *     char *string = ccnxManifestBuilder_StageTimesToString(&times);
+ *     printf("%s\n", string);
+ *     parcMemory_Deallocate(&string);
+ * }
+ * @endcode
+ */
+void ccnxManifestBuilder_SetStageTimes(CCNxManifestBuilder *instance, CCNxManifestBuilderStageTimes *times);
+
+/**
+ * Describe the time the builds took and how busy each stage was, as a percentage of the time
+ * it had.
+ *
+ * @param [in] times A `CCNxManifestBuilderStageTimes` given to `ccnxManifestBuilder_SetStageTimes`.
+ *
+ * @return A nul-terminated string that must be freed with `parcMemory_Deallocate()`.
+ */
+char *ccnxManifestBuilder_StageTimesToString(const CCNxManifestBuilderStageTimes *times);
 #endif // libccnx_common_ccnx_ManifestBuilder
@@ -58,8 +58,11 @@
  */
 #include <LongBow/runtime.h>
 
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <time.h>
 #include <unistd.h>
 
 #include <parc/algol/parc_FileChunker.h>
@@ -77,62 +80,161 @@
 #include <parc/algol/parc_Object.h>
 
 #include <ccnx/transport/common/transport_MetaMessage.h>
+#include <ccnx/common/internal/ccnx_WireFormatMessage.h>
 
 #include "ccnxFileRepo_Cache.h"
+#include "ccnxFileRepo_Common.h"
+#include "ccnxFileRepo_EncodedMessage.h"
 #include "ccnxFileRepo_ManifestFetcher.h"
 
-struct ccnx_manifest_fetcher_state {
-    CCNxManifest *root;
-    size_t hashGroupIndex;
-    PARCIterator *digestIterator;
-};
+/**
+ * The congestion window a fetcher starts with, in interests.
+ */
+static const double _ccnxFileRepoManifestFetcher_InitialWindow = 2.0;
 
-typedef struct ccnx_manifest_fetcher_state _FetcherState;
+/**
+ * The window is halved when a response comes back this much later than the fastest one seen,
+ * as a fraction of the fastest round trip, or at least `_ccnxFileRepoManifestFetcher_MinimumQueueingDelay`
+ * seconds, since a round trip that long means the interests are queueing somewhere on the path.
+ */
+static const double _ccnxFileRepoManifestFetcher_QueueingDelayFraction = 0.5;
+static const double _ccnxFileRepoManifestFetcher_MinimumQueueingDelay = 0.001;
 
-static bool
-_ccnxFileRepoManifestFetcherState_Destructor(_FetcherState **statePtr)
-{
-    _FetcherState *state = *statePtr;
+/**
+ * The retransmission timeout follows RFC 6298: the smoothed round-trip time plus four times its
+ * mean deviation, both tracked with these gains from the responses to interests sent once, and
+ * kept within these bounds, in seconds. The lower bound is below the RFC's 1 s, as in most TCP
+ * stacks, since a repo is usually a few hops away.
+ */
+static const double _ccnxFileRepoManifestFetcher_RttGain = 0.125;
+static const double _ccnxFileRepoManifestFetcher_RttVarianceGain = 0.25;
+static const double _ccnxFileRepoManifestFetcher_MinimumRto = 0.2;
+static const double _ccnxFileRepoManifestFetcher_MaximumRto = 60.0;
 
-    ccnxManifest_Release(&state->root);
-    if (state->digestIterator != NULL) {
-        parcIterator_Release(&state->digestIterator);
-    }
+typedef enum {
+    _FetchRequestState_Waiting,     // not sent yet
+    _FetchRequestState_Sent,        // an interest for it is outstanding
+    _FetchRequestState_Received,    // arrived, and waits until its offset in the file is known
+    _FetchRequestState_Ready,       // arrived and placed, and waits to be handed out
+    _FetchRequestState_Skipped      // lies outside the range being read, and is not fetched
+} _FetchRequestState;
 
-    return true;
-}
+/**
+ * A chunk or manifest to fetch. The requests form a list in file order, so the data of one
+ * ends where the data of the next begins; when a manifest arrives, its request is replaced
+ * by the requests for the chunks and manifests it points to.
+ *
+ * The byte range of a request is learned piecemeal: from the data size of the hash group it
+ * is in, from the block size when the group holds whole blocks, from the request before or
+ * after it, or from its own data once it arrives. Whatever is learned about one end of a
+ * request is passed on to its neighbour.
+ *
+ * Every entry of a hash group but the last covers the entry size of the group, if it records
+ * one.
+ */
+typedef struct _fetch_request {
+    struct _fetch_request *prev;
+    struct _fetch_request *next;
+    PARCBuffer *digest;
+    bool isManifest;
+    _FetchRequestState state;
 
-parcObject_Override(_FetcherState, PARCObject,
-                    .destructor = (PARCObjectDestructor *) _ccnxFileRepoManifestFetcherState_Destructor);
+    // When the interest was first and last sent, when it is sent again if no response has
+    // arrived by then, and how many times it was sent again
+    double firstSentTime;
+    double sentTime;
+    double deadline;
+    size_t retransmissions;
 
-parcObject_ImplementAcquire(_ccnxFileRepoManifestFetcherState, _FetcherState);
-parcObject_ImplementRelease(_ccnxFileRepoManifestFetcherState, _FetcherState);
+    size_t start;
+    size_t end;
+    size_t size;
+    bool hasStart;
+    bool hasEnd;
+    bool hasSize;
 
-static _FetcherState *
-_ccnxFileRepoManifestFetcherState_Create(CCNxManifest *manifest)
-{
-    _FetcherState *state = parcObject_CreateInstance(_FetcherState);
-    if (state != NULL) {
-        state->root = ccnxManifest_Acquire(manifest);
-        state->digestIterator = NULL;
-        state->hashGroupIndex = 0;
-    }
-    return state;
-}
+    // The requests that are ready to be handed out, in the order they became ready
+    struct _fetch_request *nextReady;
+
+    // Set once a chunk is received; NULL for a manifest that points to nothing
+    PARCBuffer *payload;
+} _FetchRequest;
+
+/**
+ * A walk of the tree towards the data in [`rangeStart`, `rangeEnd`). The fetcher's own walk
+ * covers the whole file; `ccnxFileRepoManifestFetcher_ReadAt` adds one for the range it reads,
+ * which skips the chunks and manifests outside it.
+ */
+typedef struct _fetch_walk {
+    struct _fetch_walk *nextWalk;
+
+    // The requests that have not been handed out yet, in file order
+    _FetchRequest *head;
+    _FetchRequest *tail;
+
+    // The received requests whose offset is known, oldest first
+    _FetchRequest *readyHead;
+    _FetchRequest *readyTail;
+
+    // The requests sent and not yet handed out
+    size_t undelivered;
+
+    size_t rangeStart;
+    size_t rangeEnd;
+} _FetchWalk;
 
 struct ccnx_manifest_fetcher {
+    // The portal, or the functions that stand in for it
     CCNxPortal *portal;
-    PARCLinkedList *stateList;
+    CCNxFileRepoManifestFetcherSend *send;
+    CCNxFileRepoManifestFetcherReceive *receive;
+    void *transport;
+
     const CCNxName *locator;
+    CCNxManifest *root;
 
     // Fetching data
     size_t blockSize;
+    size_t dataSize;
 
     // log
     PARCLog *log;
 
-    // Manifest fetch state
-    PARCBuffer *prevState;
+    // The walk of the whole file, followed by any others under way
+    _FetchWalk walk;
+    _FetchWalk *walks;
+
+    // The interests still waiting for a response
+    size_t outstanding;
+
+    // Congestion control: the number of interests kept outstanding, grown by one per response
+    // up to `slowStartThreshold` and by one per window after that, and halved on queueing delay
+    double window;
+    double slowStartThreshold;
+    size_t maxWindow;
+    double minRtt;
+    double lastDecrease;
+
+    // Retransmission: the smoothed round-trip time, its mean deviation, the timeout they give,
+    // and the earliest deadline of an outstanding interest (0 if there is none)
+    double srtt;
+    double rttVariance;
+    double rto;
+    double nextDeadline;
+    size_t maxRetransmissions;
+    bool failed;
+
+    // Counters
+    size_t interestsSent;
+    size_t responses;
+    size_t unexpected;
+    size_t windowDecreases;
+    size_t chunksDelivered;
+    size_t chunksAhead;
+    size_t reads;
+    size_t timeouts;
+    size_t recovered;
+    double longestFetch;
 };
 
 /**
@@ -155,16 +257,713 @@ _ccnxFileRepoManifestFetcher_CreateLogger(void)
     return log;
 }
 
+static double
+_ccnxFileRepoManifestFetcher_Now(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+static _FetchRequest *
+_ccnxFileRepoManifestFetcher_CreateRequest(const PARCBuffer *digest)
+{
+    _FetchRequest *request = parcMemory_AllocateAndClear(sizeof(_FetchRequest));
+    assertNotNull(request, "parcMemory_AllocateAndClear(%zu) returned NULL", sizeof(_FetchRequest));
+    request->digest = (digest != NULL) ? parcBuffer_Acquire(digest) : NULL;
+    request->state = _FetchRequestState_Waiting;
+    return request;
+}
+
+static void
+_ccnxFileRepoManifestFetcher_DestroyRequest(_FetchRequest **requestPtr)
+{
+    _FetchRequest *request = *requestPtr;
+    if (request->digest != NULL) {
+        parcBuffer_Release(&request->digest);
+    }
+    if (request->payload != NULL) {
+        parcBuffer_Release(&request->payload);
+    }
+    parcMemory_Deallocate(requestPtr);
+}
+
+/**
+ * Take `request` out of the list of requests of `walk`.
+ */
+static void
+_ccnxFileRepoManifestFetcher_Unlink(_FetchWalk *walk, _FetchRequest *request)
+{
+    if (request->prev != NULL) {
+        request->prev->next = request->next;
+    } else {
+        walk->head = request->next;
+    }
+    if (request->next != NULL) {
+        request->next->prev = request->prev;
+    } else {
+        walk->tail = request->prev;
+    }
+}
+
+static void
+_ccnxFileRepoManifestFetcher_SetStart(_FetchRequest *request, size_t start)
+{
+    request->start = start;
+    request->hasStart = true;
+}
+
+static void
+_ccnxFileRepoManifestFetcher_SetEnd(_FetchRequest *request, size_t end)
+{
+    request->end = end;
+    request->hasEnd = true;
+}
+
+static void
+_ccnxFileRepoManifestFetcher_SetSize(_FetchRequest *request, size_t size)
+{
+    request->size = size;
+    request->hasSize = true;
+}
+
+/**
+ * Work out the end of `request` from its start and size, or its start from its end, and
+ * queue it to be handed out if it has arrived and is now placed.
+ */
+static void
+_ccnxFileRepoManifestFetcher_Settle(_FetchWalk *walk, _FetchRequest *request)
+{
+    if (request->hasSize) {
+        if (request->hasStart && !request->hasEnd) {
+            _ccnxFileRepoManifestFetcher_SetEnd(request, request->start + request->size);
+        } else if (request->hasEnd && !request->hasStart) {
+            _ccnxFileRepoManifestFetcher_SetStart(request, request->end - request->size);
+        }
+    }
+
+    if (request->state == _FetchRequestState_Received && request->hasStart) {
+        request->state = _FetchRequestState_Ready;
+        request->nextReady = NULL;
+        if (walk->readyTail != NULL) {
+            walk->readyTail->nextReady = request;
+        } else {
+            walk->readyHead = request;
+        }
+        walk->readyTail = request;
+    }
+}
+
+/**
+ * Pass what is known about the range of `request` on to its neighbours, and from them on to
+ * theirs, for as long as that places another request.
+ */
+static void
+_ccnxFileRepoManifestFetcher_Resolve(_FetchWalk *walk, _FetchRequest *request)
+{
+    _ccnxFileRepoManifestFetcher_Settle(walk, request);
+
+    for (_FetchRequest *r = request; r->hasEnd && r->next != NULL && !r->next->hasStart; r = r->next) {
+        _ccnxFileRepoManifestFetcher_SetStart(r->next, r->end);
+        _ccnxFileRepoManifestFetcher_Settle(walk, r->next);
+    }
+    for (_FetchRequest *r = request; r->hasStart && r->prev != NULL && !r->prev->hasEnd; r = r->prev) {
+        _ccnxFileRepoManifestFetcher_SetEnd(r->prev, r->start);
+        _ccnxFileRepoManifestFetcher_Settle(walk, r->prev);
+    }
+}
+
+/**
+ * Create a request for every pointer of the hash groups of `manifest`, in order, linked to
+ * each other, and return the first, setting `last` to the last one. `request` is the
+ * manifest's own request, whose start, end and size are filled in from the data size of the
+ * groups.
+ *
+ * Each group covers its data size of the range of the manifest, so the first pointer of a group
+ * starts where the group starts and the last one ends where it ends. Every other pointer covers
+ * the entry size of the group, when it records one, so all the pointers of a group are placed
+ * at once.
+ *
+ * @retval NULL The manifest has no pointers.
+ */
+static _FetchRequest *
+_ccnxFileRepoManifestFetcher_CreateChildRequests(_FetchWalk *walk, _FetchRequest *request,
+                                                 const CCNxManifest *manifest, _FetchRequest **last)
+{
+    _FetchRequest *first = NULL;
+    *last = NULL;
+
+    // A manifest covers the data of all of its groups, if they record it
+    size_t manifestSize = 0;
+    bool hasManifestSize = true;
+    for (size_t i = 0; i < ccnxManifest_GetNumberOfHashGroups(manifest); i++) {
+        CCNxManifestHashGroup *group = ccnxManifest_GetHashGroupByIndex(manifest, i);
+        size_t dataSize = ccnxManifestHashGroup_GetDataSize(group);
+        if (dataSize == 0 && ccnxManifestHashGroup_GetNumberOfPointers(group) > 0) {
+            hasManifestSize = false;
+        }
+        manifestSize += dataSize;
+        ccnxManifestHashGroup_Release(&group);
+    }
+    if (hasManifestSize && !request->hasSize) {
+        _ccnxFileRepoManifestFetcher_SetSize(request, manifestSize);
+        _ccnxFileRepoManifestFetcher_Settle(walk, request);
+    }
+
+    bool hasGroupStart = request->hasStart;
+    size_t groupStart = request->start;
+
+    for (size_t i = 0; i < ccnxManifest_GetNumberOfHashGroups(manifest); i++) {
+        CCNxManifestHashGroup *group = ccnxManifest_GetHashGroupByIndex(manifest, i);
+        size_t pointerCount = ccnxManifestHashGroup_GetNumberOfPointers(group);
+        size_t blockSize = ccnxManifestHashGroup_GetBlockSize(group);
+        size_t dataSize = ccnxManifestHashGroup_GetDataSize(group);
+
+        // The size of each entry but the last, if the group records it
+        size_t entrySize = ccnxManifestHashGroup_GetEntrySize(group);
+
+        // A group of whole blocks
+        bool wholeBlocks = (blockSize > 0 && dataSize == pointerCount * blockSize);
+        for (size_t j = 0; wholeBlocks && j < pointerCount; j++) {
+            CCNxManifestHashGroupPointer *pointer = ccnxManifestHashGroup_GetPointerAtIndex(group, j);
+            wholeBlocks = (ccnxManifestHashGroupPointer_GetType(pointer) == CCNxManifestHashGroupPointerType_Data);
+        }
+
+        for (size_t j = 0; j < pointerCount; j++) {
+            CCNxManifestHashGroupPointer *pointer = ccnxManifestHashGroup_GetPointerAtIndex(group, j);
+            _FetchRequest *child = _ccnxFileRepoManifestFetcher_CreateRequest(ccnxManifestHashGroupPointer_GetDigest(pointer));
+            child->isManifest = (ccnxManifestHashGroupPointer_GetType(pointer) == CCNxManifestHashGroupPointerType_Manifest);
+
+            if (wholeBlocks) {
+                _ccnxFileRepoManifestFetcher_SetSize(child, blockSize);
+            } else if (entrySize > 0 && j < pointerCount - 1) {
+                _ccnxFileRepoManifestFetcher_SetSize(child, entrySize);
+            }
+            if (j == 0 && hasGroupStart) {
+                _ccnxFileRepoManifestFetcher_SetStart(child, groupStart);
+            }
+            if (j == pointerCount - 1 && hasGroupStart && hasManifestSize) {
+                _ccnxFileRepoManifestFetcher_SetEnd(child, groupStart + dataSize);
+            }
+
+            child->prev = *last;
+            if (first == NULL) {
+                first = child;
+            } else {
+                (*last)->next = child;
+            }
+            *last = child;
+        }
+        ccnxManifestHashGroup_Release(&group);
+
+        groupStart += dataSize;
+        hasGroupStart = hasGroupStart && hasManifestSize;
+    }
+
+    // The last pointer ends where the manifest ends, even if its start was not known
+    if (*last != NULL && !(*last)->hasEnd && request->hasEnd && hasManifestSize) {
+        _ccnxFileRepoManifestFetcher_SetEnd(*last, request->end);
+    }
+    return first;
+}
+
+/**
+ * Replace the request for a manifest that arrived by the requests for what it points to,
+ * placing them from the metadata of its hash groups.
+ */
+static void
+_ccnxFileRepoManifestFetcher_ExpandManifest(_FetchWalk *walk, _FetchRequest *request, const CCNxManifest *manifest)
+{
+    _FetchRequest *last;
+    _FetchRequest *first = _ccnxFileRepoManifestFetcher_CreateChildRequests(walk, request, manifest, &last);
+    if (first == NULL) {
+        // Nothing to fetch: the request is handed out as no data once it is placed
+        request->state = _FetchRequestState_Received;
+        if (!request->hasSize) {
+            _ccnxFileRepoManifestFetcher_SetSize(request, 0);
+        }
+        _ccnxFileRepoManifestFetcher_Resolve(walk, request);
+        return;
+    }
+
+    first->prev = request->prev;
+    last->next = request->next;
+    if (request->prev != NULL) {
+        request->prev->next = first;
+    } else {
+        walk->head = first;
+    }
+    if (request->next != NULL) {
+        request->next->prev = last;
+    } else {
+        walk->tail = last;
+    }
+    walk->undelivered--;
+    _ccnxFileRepoManifestFetcher_DestroyRequest(&request);
+
+    for (_FetchRequest *child = first; child != last->next; child = child->next) {
+        _ccnxFileRepoManifestFetcher_Resolve(walk, child);
+    }
+}
+
+/**
+ * Start `walk` towards the data in [`rangeStart`, `rangeEnd`) by expanding the root manifest.
+ * The root arrived in answer to the client's own interest; it is expanded like any other
+ * manifest, starting the file at offset 0.
+ */
+static void
+_ccnxFileRepoManifestFetcher_StartWalk(CCNxFileRepoManifestFetcher *fetcher, _FetchWalk *walk, size_t rangeStart, size_t rangeEnd)
+{
+    memset(walk, 0, sizeof(_FetchWalk));
+    walk->rangeStart = rangeStart;
+    walk->rangeEnd = rangeEnd;
+
+    _FetchRequest *request = _ccnxFileRepoManifestFetcher_CreateRequest(NULL);
+    request->state = _FetchRequestState_Sent;
+    _ccnxFileRepoManifestFetcher_SetStart(request, 0);
+    walk->head = request;
+    walk->tail = request;
+    walk->undelivered = 1;
+    _ccnxFileRepoManifestFetcher_ExpandManifest(walk, request, fetcher->root);
+
+    walk->nextWalk = fetcher->walks;
+    fetcher->walks = walk;
+}
+
+/**
+ * Destroy the requests of `walk` and take it off the list of walks.
+ */
+static void
+_ccnxFileRepoManifestFetcher_ClearWalk(CCNxFileRepoManifestFetcher *fetcher, _FetchWalk *walk)
+{
+    while (walk->head != NULL) {
+        _FetchRequest *request = walk->head;
+        walk->head = request->next;
+        _ccnxFileRepoManifestFetcher_DestroyRequest(&request);
+    }
+    walk->tail = NULL;
+    walk->readyHead = NULL;
+    walk->readyTail = NULL;
+
+    for (_FetchWalk **walkPtr = &fetcher->walks; *walkPtr != NULL; walkPtr = &(*walkPtr)->nextWalk) {
+        if (*walkPtr == walk) {
+            *walkPtr = walk->nextWalk;
+            break;
+        }
+    }
+}
+
+/**
+ * Take the request that became ready first off `walk`, or return NULL if none is ready.
+ * `ahead` is set if an earlier request has not been handed out yet.
+ */
+static _FetchRequest *
+_ccnxFileRepoManifestFetcher_TakeReady(_FetchWalk *walk, bool *ahead)
+{
+    _FetchRequest *request = walk->readyHead;
+    if (request != NULL) {
+        walk->readyHead = request->nextReady;
+        if (walk->readyHead == NULL) {
+            walk->readyTail = NULL;
+        }
+
+        // Its neighbours already know where it starts and ends
+        *ahead = (request != walk->head);
+        _ccnxFileRepoManifestFetcher_Unlink(walk, request);
+        walk->undelivered--;
+    }
+    return request;
+}
+
+/**
+ * Skip the requests of `walk` that are known to lie outside its range and are not sent, and
+ * merge runs of skipped requests into one, which keeps what is known about where they start
+ * and end. A request is outside the range if it ends before it starts or starts after it ends,
+ * and so is every request before or after it, as is every request before one that starts before
+ * the range or after one that ends after it.
+ *
+ * @return true if requests that are not skipped remain.
+ */
+static bool
+_ccnxFileRepoManifestFetcher_Prune(_FetchWalk *walk)
+{
+    // The last request before the range and the first one after it, if they are known
+    _FetchRequest *lastBefore = NULL;
+    for (_FetchRequest *request = walk->head; request != NULL; request = request->next) {
+        if (request->hasEnd && request->end <= walk->rangeStart) {
+            lastBefore = request;
+        } else if (request->hasStart && request->start <= walk->rangeStart) {
+            lastBefore = request->prev;
+        }
+    }
+    _FetchRequest *firstAfter = NULL;
+    for (_FetchRequest *request = walk->tail; request != NULL; request = request->prev) {
+        if (request->hasStart && request->start >= walk->rangeEnd) {
+            firstAfter = request;
+        } else if (request->hasEnd && request->end >= walk->rangeEnd) {
+            firstAfter = request->next;
+        }
+    }
+
+    bool before = (lastBefore != NULL);
+    bool after = false;
+    bool remaining = false;
+    _FetchRequest *request = walk->head;
+    while (request != NULL) {
+        _FetchRequest *next = request->next;
+        after = after || (request == firstAfter);
+        bool outside = before || after;
+        before = before && (request != lastBefore);
+
+        if (outside && (request->state == _FetchRequestState_Waiting || request->state == _FetchRequestState_Received)) {
+            if (request->state == _FetchRequestState_Received) {
+                walk->undelivered--;
+            }
+            if (request->payload != NULL) {
+                parcBuffer_Release(&request->payload);
+            }
+            request->state = _FetchRequestState_Skipped;
+        }
+
+        _FetchRequest *prev = request->prev;
+        if (request->state == _FetchRequestState_Skipped && prev != NULL && prev->state == _FetchRequestState_Skipped) {
+            prev->end = request->end;
+            prev->hasEnd = request->hasEnd;
+            prev->size += request->size;
+            prev->hasSize = prev->hasSize && request->hasSize;
+            _ccnxFileRepoManifestFetcher_Unlink(walk, request);
+            _ccnxFileRepoManifestFetcher_DestroyRequest(&request);
+        } else if (request->state != _FetchRequestState_Skipped) {
+            remaining = true;
+        }
+        request = next;
+    }
+    return remaining;
+}
+
+/**
+ * Send the interest for `request`, and wait for its response until the retransmission timeout,
+ * doubled for every time it was sent before, has passed.
+ */
+static bool
+_ccnxFileRepoManifestFetcher_Express(CCNxFileRepoManifestFetcher *fetcher, _FetchRequest *request)
+{
+    CCNxInterest *interest = ccnxInterest_Create(fetcher->locator, 0, NULL, request->digest);
+    CCNxMetaMessage *message = ccnxMetaMessage_CreateFromInterest(interest);
+    bool sent = fetcher->send(fetcher->transport, message);
+    ccnxMetaMessage_Release(&message);
+    ccnxInterest_Release(&interest);
+
+    if (!sent) {
+        parcLog_Error(fetcher->log, "Could not send an interest, giving up");
+        fetcher->failed = true;
+        return false;
+    }
+
+    double timeout = fetcher->rto;
+    for (size_t i = 0; i < request->retransmissions && timeout < _ccnxFileRepoManifestFetcher_MaximumRto; i++) {
+        timeout *= 2.0;
+    }
+    if (timeout > _ccnxFileRepoManifestFetcher_MaximumRto) {
+        timeout = _ccnxFileRepoManifestFetcher_MaximumRto;
+    }
+
+    request->sentTime = _ccnxFileRepoManifestFetcher_Now();
+    request->deadline = request->sentTime + timeout;
+    if (fetcher->nextDeadline == 0.0 || request->deadline < fetcher->nextDeadline) {
+        fetcher->nextDeadline = request->deadline;
+    }
+    fetcher->interestsSent++;
+    return true;
+}
+
+static bool
+_ccnxFileRepoManifestFetcher_SendInterest(CCNxFileRepoManifestFetcher *fetcher, _FetchWalk *walk, _FetchRequest *request)
+{
+    bool sent = _ccnxFileRepoManifestFetcher_Express(fetcher, request);
+    if (sent) {
+        request->state = _FetchRequestState_Sent;
+        request->firstSentTime = request->sentTime;
+        fetcher->outstanding++;
+        walk->undelivered++;
+    }
+    return sent;
+}
+
+/**
+ * Return true if `request` is sure to be needed to read the range of `walk`: a manifest, which
+ * places what it points to, or a chunk known to overlap the range.
+ */
+static bool
+_ccnxFileRepoManifestFetcher_IsNeeded(const _FetchWalk *walk, const _FetchRequest *request)
+{
+    if (request->isManifest) {
+        return true;
+    }
+    if (request->hasStart && request->start >= walk->rangeStart && request->start < walk->rangeEnd) {
+        return true;
+    }
+    if (request->hasEnd && request->end > walk->rangeStart && request->end <= walk->rangeEnd) {
+        return true;
+    }
+    return request->hasStart && request->hasEnd && request->start <= walk->rangeStart && request->end >= walk->rangeEnd;
+}
+
+/**
+ * Send interests for the first requests of `walk` that have not been sent, in file order, until
+ * the window is full. At most twice the largest window may be sent and not yet handed out, which
+ * bounds the chunks held back until their offset is known; the first request not skipped is
+ * always sent, since its offset is always known.
+ *
+ * A read of a range first sends the requests it is sure to need, and those that may turn out to
+ * lie outside it only with what is left of the window.
+ */
+static bool
+_ccnxFileRepoManifestFetcher_FillWindow(CCNxFileRepoManifestFetcher *fetcher, _FetchWalk *walk)
+{
+    bool isRead = (walk != &fetcher->walk);
+    for (int pass = isRead ? 0 : 1; pass < 2; pass++) {
+        bool isFirst = true;
+        for (_FetchRequest *request = walk->head; request != NULL; request = request->next) {
+            if (request->state == _FetchRequestState_Skipped) {
+                continue;
+            }
+            if (!isFirst && (fetcher->outstanding >= (size_t) fetcher->window || walk->undelivered >= 2 * fetcher->maxWindow)) {
+                break;
+            }
+            bool send = (pass == 1 || isFirst || _ccnxFileRepoManifestFetcher_IsNeeded(walk, request));
+            isFirst = false;
+            if (send && request->state == _FetchRequestState_Waiting
+                && !_ccnxFileRepoManifestFetcher_SendInterest(fetcher, walk, request)) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+/**
+ * Halve the window, unless it was halved less than `rtt` seconds ago: the responses to
+ * interests sent before the decrease are just as late, so decrease at most once per round trip.
+ */
+static void
+_ccnxFileRepoManifestFetcher_DecreaseWindow(CCNxFileRepoManifestFetcher *fetcher, double rtt, double now)
+{
+    if (now - fetcher->lastDecrease > rtt) {
+        fetcher->window /= 2.0;
+        if (fetcher->window < 1.0) {
+            fetcher->window = 1.0;
+        }
+        fetcher->slowStartThreshold = fetcher->window;
+        fetcher->lastDecrease = now;
+        fetcher->windowDecreases++;
+    }
+}
+
+/**
+ * Grow or shrink the window after a response that took `rtt` seconds.
+ */
+static void
+_ccnxFileRepoManifestFetcher_AdjustWindow(CCNxFileRepoManifestFetcher *fetcher, double rtt, double now)
+{
+    if (fetcher->minRtt == 0.0 || rtt < fetcher->minRtt) {
+        fetcher->minRtt = rtt;
+    }
+
+    double threshold = fetcher->minRtt * _ccnxFileRepoManifestFetcher_QueueingDelayFraction;
+    if (threshold < _ccnxFileRepoManifestFetcher_MinimumQueueingDelay) {
+        threshold = _ccnxFileRepoManifestFetcher_MinimumQueueingDelay;
+    }
+
+    if (rtt - fetcher->minRtt > threshold) {
+        _ccnxFileRepoManifestFetcher_DecreaseWindow(fetcher, rtt, now);
+    } else if (fetcher->window < fetcher->slowStartThreshold) {
+        fetcher->window += 1.0;
+    } else {
+        fetcher->window += 1.0 / fetcher->window;
+    }
+
+    if (fetcher->window > fetcher->maxWindow) {
+        fetcher->window = fetcher->maxWindow;
+    }
+}
+
+/**
+ * Update the retransmission timeout with a round trip of `rtt` seconds, as RFC 6298 does.
+ */
+static void
+_ccnxFileRepoManifestFetcher_UpdateRto(CCNxFileRepoManifestFetcher *fetcher, double rtt)
+{
+    if (fetcher->srtt == 0.0) {
+        fetcher->srtt = rtt;
+        fetcher->rttVariance = rtt / 2.0;
+    } else {
+        double deviation = (rtt > fetcher->srtt) ? rtt - fetcher->srtt : fetcher->srtt - rtt;
+        fetcher->rttVariance += _ccnxFileRepoManifestFetcher_RttVarianceGain * (deviation - fetcher->rttVariance);
+        fetcher->srtt += _ccnxFileRepoManifestFetcher_RttGain * (rtt - fetcher->srtt);
+    }
+
+    fetcher->rto = fetcher->srtt + 4.0 * fetcher->rttVariance;
+    if (fetcher->rto < _ccnxFileRepoManifestFetcher_MinimumRto) {
+        fetcher->rto = _ccnxFileRepoManifestFetcher_MinimumRto;
+    } else if (fetcher->rto > _ccnxFileRepoManifestFetcher_MaximumRto) {
+        fetcher->rto = _ccnxFileRepoManifestFetcher_MaximumRto;
+    }
+}
+
+/**
+ * Send the interests whose response is overdue again, since they or their responses were most
+ * likely lost, and halve the window, as for any other sign of congestion, unless all of them
+ * were sent before it was last halved. Then work out the next deadline.
+ *
+ * @return false if an interest was sent again the most times allowed, or could not be sent.
+ */
+static bool
+_ccnxFileRepoManifestFetcher_Retransmit(CCNxFileRepoManifestFetcher *fetcher, double now)
+{
+    bool congested = false;
+    fetcher->nextDeadline = 0.0;
+    for (_FetchWalk *walk = fetcher->walks; walk != NULL; walk = walk->nextWalk) {
+        for (_FetchRequest *request = walk->head; request != NULL; request = request->next) {
+            if (request->state != _FetchRequestState_Sent) {
+                continue;
+            }
+            if (request->deadline <= now) {
+                if (request->retransmissions >= fetcher->maxRetransmissions) {
+                    parcLog_Error(fetcher->log, "No response to an interest sent %zu times, giving up", request->retransmissions + 1);
+                    fetcher->failed = true;
+                    return false;
+                }
+                if (request->sentTime > fetcher->lastDecrease) {
+                    congested = true;
+                }
+                request->retransmissions++;
+                fetcher->timeouts++;
+                if (!_ccnxFileRepoManifestFetcher_Express(fetcher, request)) {
+                    return false;
+                }
+            } else if (fetcher->nextDeadline == 0.0 || request->deadline < fetcher->nextDeadline) {
+                fetcher->nextDeadline = request->deadline;
+            }
+        }
+    }
+
+    if (congested) {
+        _ccnxFileRepoManifestFetcher_DecreaseWindow(fetcher, 0.0, now);
+    }
+    return true;
+}
+
+/**
+ * Record the arrival of `response` for the outstanding `request`.
+ */
+static void
+_ccnxFileRepoManifestFetcher_Complete(CCNxFileRepoManifestFetcher *fetcher, _FetchWalk *walk, _FetchRequest *request,
+                                      CCNxMetaMessage *response)
+{
+    fetcher->outstanding--;
+    if (ccnxMetaMessage_IsManifest(response)) {
+        _ccnxFileRepoManifestFetcher_ExpandManifest(walk, request, ccnxMetaMessage_GetManifest(response));
+    } else {
+        CCNxContentObject *contentObject = ccnxMetaMessage_GetContentObject(response);
+        PARCBuffer *payload = ccnxContentObject_GetPayload(contentObject);
+        // One response may satisfy several identical chunks, so each keeps its own position
+        request->payload = (payload != NULL) ? parcBuffer_Slice(payload) : NULL;
+        request->state = _FetchRequestState_Received;
+        if (!request->hasSize) {
+            _ccnxFileRepoManifestFetcher_SetSize(request, (payload != NULL) ? parcBuffer_Remaining(payload) : 0);
+        }
+        _ccnxFileRepoManifestFetcher_Resolve(walk, request);
+    }
+}
+
+/**
+ * Wait for a response until the next interest is overdue, and hand it to every outstanding
+ * request for the object it is, in any walk, found by its content object hash: the same chunk
+ * may appear at several places in the file, and the network answers identical interests once.
+ * Then send the overdue interests again.
+ *
+ * @return false if the fetcher gave up on an interest.
+ */
+static bool
+_ccnxFileRepoManifestFetcher_ReceiveResponse(CCNxFileRepoManifestFetcher *fetcher)
+{
+    double now = _ccnxFileRepoManifestFetcher_Now();
+    double deadline = (fetcher->nextDeadline > 0.0) ? fetcher->nextDeadline : now + _ccnxFileRepoManifestFetcher_MaximumRto;
+    uint64_t timeout = (deadline > now) ? (uint64_t) ((deadline - now) * 1e6) : 0;
+
+    CCNxMetaMessage *response = fetcher->receive(fetcher->transport, timeout);
+    now = _ccnxFileRepoManifestFetcher_Now();
+    if (response == NULL) {
+        return _ccnxFileRepoManifestFetcher_Retransmit(fetcher, now);
+    }
+
+    // A message that was not received off the wire has no hash to match by, so it is taken
+    // to answer the first outstanding request
+    uint8_t digest[CCNxFileRepoSha256_DigestLength];
+    PARCBuffer *wireFormat = ccnxWireFormatMessage_GetWireFormatBuffer((CCNxWireFormatMessage *) response);
+    bool hasDigest = false;
+    if (wireFormat != NULL) {
+        PARCBuffer *packet = parcBuffer_Rewind(parcBuffer_Duplicate(wireFormat));
+        hasDigest = ccnxFileRepoEncodedMessage_ComputeDigest(packet, digest);
+        parcBuffer_Release(&packet);
+    }
+
+    size_t matched = 0;
+    if (ccnxMetaMessage_IsManifest(response) || ccnxMetaMessage_IsContentObject(response)) {
+        for (_FetchWalk *walk = fetcher->walks; walk != NULL; walk = walk->nextWalk) {
+            _FetchRequest *request = walk->head;
+            while (request != NULL && (hasDigest || matched == 0)) {
+                // Expanding a manifest puts its children after it, so look past them
+                _FetchRequest *next = request->next;
+                if (request->state == _FetchRequestState_Sent
+                    && (!hasDigest || memcmp(ccnxFileRepoCommon_GetBufferBytes(request->digest), digest, sizeof(digest)) == 0)) {
+                    // The round trip of an interest sent again is ambiguous, so it is not measured
+                    if (matched++ == 0 && request->retransmissions == 0) {
+                        _ccnxFileRepoManifestFetcher_AdjustWindow(fetcher, now - request->sentTime, now);
+                        _ccnxFileRepoManifestFetcher_UpdateRto(fetcher, now - request->sentTime);
+                    }
+                    if (request->retransmissions > 0) {
+                        fetcher->recovered++;
+                    }
+                    if (now - request->firstSentTime > fetcher->longestFetch) {
+                        fetcher->longestFetch = now - request->firstSentTime;
+                    }
+                    _ccnxFileRepoManifestFetcher_Complete(fetcher, walk, request, response);
+                }
+                request = next;
+            }
+        }
+    }
+
+    // Once interests are sent again, the response to both may arrive
+    if (matched > 0) {
+        fetcher->responses++;
+    } else {
+        fetcher->unexpected++;
+        parcLog_Debug(fetcher->log, "Dropped a response that matches no outstanding interest");
+    }
+    ccnxMetaMessage_Release(&response);
+
+    if (fetcher->nextDeadline > 0.0 && fetcher->nextDeadline <= now) {
+        return _ccnxFileRepoManifestFetcher_Retransmit(fetcher, now);
+    }
+    return true;
+}
+
 static bool
 _ccnxFileRepoManifestFetcher_Destructor(CCNxFileRepoManifestFetcher **fetcherPtr)
 {
     CCNxFileRepoManifestFetcher *fetcher = *fetcherPtr;
 
-    ccnxPortal_Release(&fetcher->portal);
-    ccnxName_Release((CCNxName **) &fetcher->locator);
-    if (fetcher->prevState != NULL) {
-        parcBuffer_Release(&fetcher->prevState);
+    _ccnxFileRepoManifestFetcher_ClearWalk(fetcher, &fetcher->walk);
+
+    if (fetcher->portal != NULL) {
+        ccnxPortal_Release(&fetcher->portal);
     }
+    ccnxManifest_Release(&fetcher->root);
+    ccnxName_Release((CCNxName **) &fetcher->locator);
+    parcLog_Release(&fetcher->log);
 
     return true;
 }
@@ -172,8 +971,13 @@ _ccnxFileRepoManifestFetcher_Destructor(CCNxFileRepoManifestFetcher **fetcherPtr
 char *
 ccnxFileRepoManifestFetcher_ToString(const CCNxFileRepoManifestFetcher *fetcher)
 {
-    char *result = NULL;
-    return result;
+    return parcMemory_Format("window %.1f of %zu (%zu decreases), min RTT %.3f ms, RTO %.3f ms, %zu interests, %zu responses, "
+                             "%zu unexpected, %zu timeouts, %zu objects recovered by retransmission, longest fetch %.3f ms, "
+                             "%zu of %zu chunks handed out ahead of an earlier one, %zu reads at an offset",
+                             fetcher->window, fetcher->maxWindow, fetcher->windowDecreases, fetcher->minRtt * 1e3, fetcher->rto * 1e3,
+                             fetcher->interestsSent, fetcher->responses, fetcher->unexpected,
+                             fetcher->timeouts, fetcher->recovered, fetcher->longestFetch * 1e3,
+                             fetcher->chunksAhead, fetcher->chunksDelivered, fetcher->reads);
 }
 
 parcObject_Override(CCNxFileRepoManifestFetcher, PARCObject,
@@ -183,113 +987,181 @@ parcObject_Override(CCNxFileRepoManifestFetcher, PARCObject,
 parcObject_ImplementAcquire(ccnxFileRepoManifestFetcher, CCNxFileRepoManifestFetcher);
 parcObject_ImplementRelease(ccnxFileRepoManifestFetcher, CCNxFileRepoManifestFetcher);
 
+static bool
+_ccnxFileRepoManifestFetcher_PortalSend(void *portal, CCNxMetaMessage *message)
+{
+    return ccnxPortal_Send((CCNxPortal *) portal, message, CCNxStackTimeout_Never);
+}
+
+static CCNxMetaMessage *
+_ccnxFileRepoManifestFetcher_PortalReceive(void *portal, uint64_t microseconds)
+{
+    return ccnxPortal_Receive((CCNxPortal *) portal, CCNxStackTimeout_MicroSeconds(microseconds));
+}
+
 CCNxFileRepoManifestFetcher *
 ccnxFileRepoManifestFetcher_Create(CCNxPortal *portal, CCNxManifest *root)
 {
-    CCNxFileRepoManifestFetcher *fetcher = parcObject_CreateInstance(CCNxFileRepoManifestFetcher);
+    CCNxFileRepoManifestFetcher *fetcher =
+        ccnxFileRepoManifestFetcher_CreateWithTransport(_ccnxFileRepoManifestFetcher_PortalSend,
+                                                        _ccnxFileRepoManifestFetcher_PortalReceive, portal, root);
     if (fetcher != NULL) {
         fetcher->portal = ccnxPortal_Acquire(portal);
+    }
+    return fetcher;
+}
 
-        fetcher->stateList = parcLinkedList_Create();
-        _FetcherState *state = _ccnxFileRepoManifestFetcherState_Create(root);
-        parcLinkedList_Append(fetcher->stateList, state);
-        _ccnxFileRepoManifestFetcherState_Release(&state);
+CCNxFileRepoManifestFetcher *
+ccnxFileRepoManifestFetcher_CreateWithTransport(CCNxFileRepoManifestFetcherSend *send, CCNxFileRepoManifestFetcherReceive *receive,
+                                                void *transport, CCNxManifest *root)
+{
+    CCNxFileRepoManifestFetcher *fetcher = parcObject_CreateAndClearInstance(CCNxFileRepoManifestFetcher);
+    if (fetcher != NULL) {
+        fetcher->send = send;
+        fetcher->receive = receive;
+        fetcher->transport = transport;
 
-        fetcher->blockSize = ccnxManifestHashGroup_GetBlockSize(ccnxManifest_GetHashGroupByIndex(root, 0));
+        // The builder records the publication parameters in the root's HashGroup
+        CCNxManifestHashGroup *group = ccnxManifest_GetHashGroupByIndex(root, 0);
+        fetcher->blockSize = ccnxManifestHashGroup_GetBlockSize(group);
+        fetcher->dataSize = ccnxManifestHashGroup_GetDataSize(group);
+        ccnxManifestHashGroup_Release(&group);
 
-        fetcher->locator = ccnxManifest_GetName(root);
+        fetcher->locator = ccnxName_Acquire(ccnxManifest_GetName(root));
+        fetcher->root = ccnxManifest_Acquire(root);
         fetcher->log = _ccnxFileRepoManifestFetcher_CreateLogger();
-        fetcher->prevState = NULL;
+
+        _ccnxFileRepoManifestFetcher_StartWalk(fetcher, &fetcher->walk, 0, SIZE_MAX);
+
+        fetcher->maxWindow = ccnxFileRepoCommon_ClientMaxWindow;
+        fetcher->window = _ccnxFileRepoManifestFetcher_InitialWindow;
+        fetcher->slowStartThreshold = fetcher->maxWindow;
+
+        fetcher->rto = ccnxFileRepoCommon_ClientInitialTimeout / 1e6;
+        fetcher->maxRetransmissions = ccnxFileRepoCommon_ClientMaxRetransmissions;
     }
     return fetcher;
 }
 
-static PARCBuffer *
-_ccnxFileRepoManifestFetcher_GetNextPointer(CCNxFileRepoManifestFetcher *fetcher)
+size_t
+ccnxFileRepoManifestFetcher_GetChunkSize(const CCNxFileRepoManifestFetcher *fetcher)
 {
-    if (parcLinkedList_Size(fetcher->stateList) == 0) {
-        return false;
-    }
+    return fetcher->blockSize;
+}
 
-    _FetcherState *state = parcLinkedList_GetLast(fetcher->stateList);
-    CCNxManifest *root = state->root;
+size_t
+ccnxFileRepoManifestFetcher_GetDataSize(const CCNxFileRepoManifestFetcher *fetcher)
+{
+    return fetcher->dataSize;
+}
 
-    if (state->digestIterator == NULL) {
-        CCNxManifestHashGroup *group = ccnxManifest_GetHashGroupByIndex(root, state->hashGroupIndex);
-        state->digestIterator = ccnxManifestHashGroup_Iterator(group);
-    }
+void
+ccnxFileRepoManifestFetcher_SetMaxRetransmissions(CCNxFileRepoManifestFetcher *fetcher, size_t maxRetransmissions)
+{
+    fetcher->maxRetransmissions = maxRetransmissions;
+}
 
-    if (parcIterator_HasNext(state->digestIterator)) {
-        return (PARCBuffer *) ccnxManifestHashGroupPointer_GetDigest(parcIterator_Next(state->digestIterator));
-    } else {
-        parcIterator_Release(&state->digestIterator);
-        parcLinkedList_RemoveLast(fetcher->stateList);
-        return _ccnxFileRepoManifestFetcher_GetNextPointer(fetcher);
+bool
+ccnxFileRepoManifestFetcher_IsComplete(const CCNxFileRepoManifestFetcher *fetcher)
+{
+    return !fetcher->failed && fetcher->walk.head == NULL;
+}
+
+void
+ccnxFileRepoManifestFetcher_SetMaxWindow(CCNxFileRepoManifestFetcher *fetcher, size_t maxWindow)
+{
+    fetcher->maxWindow = (maxWindow > 0) ? maxWindow : 1;
+    if (fetcher->window > fetcher->maxWindow) {
+        fetcher->window = fetcher->maxWindow;
     }
+    fetcher->slowStartThreshold = fetcher->maxWindow;
 }
 
-static CCNxMetaMessage *
-_ccnxFileRepoManifestFetcher_FetchData(CCNxFileRepoManifestFetcher *fetcher, PARCBuffer *hashDigest)
+PARCBuffer *
+ccnxFileRepoManifestFetcher_NextChunk(CCNxFileRepoManifestFetcher *fetcher, size_t *offset)
 {
-    CCNxInterest *interest = ccnxInterest_Create(fetcher->locator, 0, NULL, hashDigest);
-    CCNxMetaMessage *message = ccnxMetaMessage_CreateFromInterest(interest);
+    _FetchWalk *walk = &fetcher->walk;
+    while (true) {
+        bool ahead;
+        _FetchRequest *request = _ccnxFileRepoManifestFetcher_TakeReady(walk, &ahead);
+        if (request != NULL) {
+            PARCBuffer *payload = request->payload;
+            request->payload = NULL;
+            *offset = request->start;
+            _ccnxFileRepoManifestFetcher_DestroyRequest(&request);
 
-    char *digestString = parcBuffer_ToHexString(hashDigest);
-    // parcLog_Info(fetcher->log, "Digest request: %s", digestString);
-    parcMemory_Deallocate(&digestString);
+            if (payload != NULL && parcBuffer_Remaining(payload) > 0) {
+                fetcher->chunksDelivered++;
+                if (ahead) {
+                    fetcher->chunksAhead++;
+                }
+                return payload;
+            }
+            if (payload != NULL) {
+                parcBuffer_Release(&payload);
+            }
+            continue;
+        }
 
-    if (ccnxPortal_Send(fetcher->portal, message, CCNxStackTimeout_Never)) {
-        CCNxMetaMessage *response = ccnxPortal_Receive(fetcher->portal, CCNxStackTimeout_Never);
-        return response;
-    }
+        if (walk->head == NULL || fetcher->failed) {
+            return NULL;
+        }
 
-    return NULL;
+        if (!_ccnxFileRepoManifestFetcher_FillWindow(fetcher, walk) || !_ccnxFileRepoManifestFetcher_ReceiveResponse(fetcher)) {
+            return NULL;
+        }
+    }
 }
 
-bool
-ccnxFileRepoManifestFetcher_FillBuffer(CCNxFileRepoManifestFetcher *fetcher, PARCBuffer *buffer)
-{
-    if (fetcher->prevState != NULL) {
-        parcBuffer_PutBuffer(buffer, fetcher->prevState);
-        parcBuffer_Release(&fetcher->prevState);
-    }
-
-    while (parcBuffer_Remaining(buffer)) {
-        PARCBuffer *hashDigest = _ccnxFileRepoManifestFetcher_GetNextPointer(fetcher);
-        if (hashDigest != NULL) {
-            CCNxMetaMessage *response = _ccnxFileRepoManifestFetcher_FetchData(fetcher, hashDigest);
-            if (response != NULL) {
-                if (ccnxMetaMessage_IsManifest(response)) {
-                    CCNxManifest *child = (CCNxManifest *) response;
-
-                    // Reset the root manifest for the fetcher
-                    _FetcherState *newState = _ccnxFileRepoManifestFetcherState_Create(child);
-                    newState->hashGroupIndex = 0;
-                    newState->digestIterator = NULL;
-                    parcLinkedList_Append(fetcher->stateList, newState);
-
-                    return ccnxFileRepoManifestFetcher_FillBuffer(fetcher, buffer);
-                } else if (ccnxMetaMessage_IsContentObject(response)) {
-                    CCNxContentObject *contentObject = (CCNxContentObject *) response;
-                    PARCBuffer *childContent = ccnxContentObject_GetPayload(contentObject);
-
-                    // Ensure we can fit the payload into the buffer
-                    // If not, store this payload as state for the next fetch and break out
-                    // of this request loop
-                    if (parcBuffer_Remaining(buffer) >= parcBuffer_Remaining(childContent)) {
-                        parcBuffer_PutBuffer(buffer, childContent);
-                    } else {
-                        fetcher->prevState = parcBuffer_Acquire(childContent);
-                        return false;
-                    }
-                }
+size_t
+ccnxFileRepoManifestFetcher_ReadAt(CCNxFileRepoManifestFetcher *fetcher, size_t offset, size_t length, PARCBuffer *buffer)
+{
+    if (length > parcBuffer_Remaining(buffer)) {
+        length = parcBuffer_Remaining(buffer);
+    }
+    if (offset >= fetcher->dataSize) {
+        return 0;
+    }
+    if (length > fetcher->dataSize - offset) {
+        length = fetcher->dataSize - offset;
+    }
+    if (length == 0 || fetcher->failed) {
+        return 0;
+    }
+    fetcher->reads++;
+
+    // A walk of its own only expands the manifests whose data overlaps the range
+    _FetchWalk walk;
+    _ccnxFileRepoManifestFetcher_StartWalk(fetcher, &walk, offset, offset + length);
 
-                ccnxMetaMessage_Release(&response);
+    uint8_t *bytes = parcBuffer_Overlay(buffer, 0);
+    bool result = true;
+    while (result) {
+        bool ahead;
+        _FetchRequest *request;
+        while ((request = _ccnxFileRepoManifestFetcher_TakeReady(&walk, &ahead)) != NULL) {
+            if (request->payload != NULL) {
+                size_t end = request->start + parcBuffer_Remaining(request->payload);
+                size_t from = (request->start > walk.rangeStart) ? request->start : walk.rangeStart;
+                size_t to = (end < walk.rangeEnd) ? end : walk.rangeEnd;
+                if (from < to) {
+                    memcpy(bytes + (from - offset),
+                           ccnxFileRepoCommon_GetBufferBytes(request->payload) + (from - request->start), to - from);
+                }
             }
-        } else {
-            return true;
+            _ccnxFileRepoManifestFetcher_DestroyRequest(&request);
         }
+
+        if (!_ccnxFileRepoManifestFetcher_Prune(&walk)) {
+            break;
+        }
+        result = _ccnxFileRepoManifestFetcher_FillWindow(fetcher, &walk) && _ccnxFileRepoManifestFetcher_ReceiveResponse(fetcher);
     }
+    _ccnxFileRepoManifestFetcher_ClearWalk(fetcher, &walk);
 
-    return false;
+    if (!result) {
+        return 0;
+    }
+    parcBuffer_SetPosition(buffer, parcBuffer_Position(buffer) + length);
+    return length;
 }
@@ -60,6 +60,8 @@
 #ifndef ccnxFileRepoManifestFetcher_h
 #define ccnxFileRepoManifestFetcher_h
 
+#include <stdint.h>
+
 #include <ccnx/common/ccnx_Name.h>
 
 #include <ccnx/api/ccnx_Portal/ccnx_Portal.h>
@@ -67,6 +69,20 @@
 struct ccnx_manifest_fetcher;
 typedef struct ccnx_manifest_fetcher CCNxFileRepoManifestFetcher;
 
+/**
+ * Send `message` on the transport given by `context`, as `ccnxPortal_Send` does.
+ *
+ * @return true if the message was sent.
+ */
+typedef bool (CCNxFileRepoManifestFetcherSend)(void *context, CCNxMetaMessage *message);
+
+/**
+ * Wait up to `microseconds` for a message on the transport given by `context`, as `ccnxPortal_Receive` does.
+ *
+ * @return A `CCNxMetaMessage` which the caller must release, or NULL if none arrived in time.
+ */
+typedef CCNxMetaMessage *(CCNxFileRepoManifestFetcherReceive)(void *context, uint64_t microseconds);
+
 /**
  * Create a new `CCNxManifestFetcher` that uses the given portal to recover
  * application data from the given Manifest.
@@ -87,6 +103,31 @@ typedef struct ccnx_manifest_fetcher CCNxFileRepoManifestFetcher;
  */
 CCNxFileRepoManifestFetcher *ccnxFileRepoManifestFetcher_Create(CCNxPortal *portal, CCNxManifest *root);
 
+/**
+ * Create a new `CCNxManifestFetcher` that sends interests and receives responses through the
+ * given functions rather than a portal, such as a stand-in for the network in a benchmark.
+ *
+ * @param [in] send The function that sends an interest.
+ * @param [in] receive The function that waits for a response.
+ * @param [in] context Passed to `send` and `receive`, and must outlive the fetcher.
+ * @param [in] root The root of a `CCNxManifest` to resolve.
+ *
+ * @return A new `CCNxFileRepoManifestFetcher` instance.
+ *
+ * Example:
+ * @code
+ * {
+ *     MyNetwork *network = ...
+ *     CCNxManifest *manifest = ...
+ *     CCNxFileRepoManifestFetcher *fetcher =
+ *         ccnxFileRepoManifestFetcher_CreateWithTransport(myNetwork_Send, myNetwork_Receive, network, manifest);
+ * }
+ * @endcode
+ */
+CCNxFileRepoManifestFetcher *ccnxFileRepoManifestFetcher_CreateWithTransport(CCNxFileRepoManifestFetcherSend *send,
+                                                                             CCNxFileRepoManifestFetcherReceive *receive,
+                                                                             void *context, CCNxManifest *root);
+
 /**
  * Increase the number of references to a `CCNxFileRepoManifestFetcher` instance.
  *
@@ -136,24 +177,157 @@ CCNxFileRepoManifestFetcher *ccnxFileRepoManifestFetcher_Create(CCNxPortal *port
 void ccnxFileRepoManifestFetcher_Release(CCNxFileRepoManifestFetcher **instancePtr);
 
 /**
- * Fill the provided `PARCBuffer` with application data. Return false if more data
- * exists in the Manifest.
+ * Return the size of the chunks of the publication, as recorded in its root manifest.
+ * No chunk handed out by `ccnxFileRepoManifestFetcher_NextChunk` is larger.
+ *
+ * @param [in] fetcher The `CCNxFileRepoManifestFetcher` instance.
+ *
+ * @return The chunk size in bytes, or 0 if the root manifest does not record it.
+ *
+ * Example:
+ * @code
+ * {
+ *     CCNxFileRepoManifestFetcher *fetcher = ccnxFileRepoManifestFetcher_Create(portal, root);
+ *     PARCBuffer *buffer = parcBuffer_Allocate(4 * ccnxFileRepoManifestFetcher_GetChunkSize(fetcher));
+ * }
+ * @endcode
+ */
+size_t ccnxFileRepoManifestFetcher_GetChunkSize(const CCNxFileRepoManifestFetcher *fetcher);
+
+/**
+ * Return the size of the application data of the publication, as recorded in its root manifest.
+ *
+ * @param [in] fetcher The `CCNxFileRepoManifestFetcher` instance.
+ *
+ * @return The data size in bytes, or 0 if the root manifest does not record it.
+ */
+size_t ccnxFileRepoManifestFetcher_GetDataSize(const CCNxFileRepoManifestFetcher *fetcher);
+
+/**
+ * Set the largest number of interests the fetcher keeps outstanding.
+ *
+ * The fetcher requests the chunks and manifests of the publication in file order, keeping a
+ * window of interests outstanding and matching each response to its interests by content
+ * object hash. The window starts small, grows by one interest per response and then by one
+ * per round trip, and is halved when round trips grow longer than the shortest one seen by
+ * more than half, which means interests are queueing on the path. A maximum of 1 fetches one
+ * object at a time.
+ *
+ * @param [in] fetcher The `CCNxFileRepoManifestFetcher` instance.
+ * @param [in] maxWindow The largest window, at least 1 (default `ccnxFileRepoCommon_ClientMaxWindow`).
+ *
+ * Example:
+ * @code
+ * {
+ *     CCNxFileRepoManifestFetcher *fetcher = ccnxFileRepoManifestFetcher_Create(portal, root);
+ *     ccnxFileRepoManifestFetcher_SetMaxWindow(fetcher, 64);
+ * }
+ * @endcode
+ */
+void ccnxFileRepoManifestFetcher_SetMaxWindow(CCNxFileRepoManifestFetcher *fetcher, size_t maxWindow);
+
+/**
+ * Set the number of times the fetcher sends an interest again before giving up on the publication.
+ *
+ * An interest whose response has not arrived within the retransmission timeout is sent again,
+ * and the window halved. The timeout is worked out from the round trips of the responses as
+ * RFC 6298 does, starting from `ccnxFileRepoCommon_ClientInitialTimeout`, and doubled for every
+ * time the same interest is sent again.
+ *
+ * @param [in] fetcher The `CCNxFileRepoManifestFetcher` instance.
+ * @param [in] maxRetransmissions The number of retransmissions (default `ccnxFileRepoCommon_ClientMaxRetransmissions`).
+ *
+ * Example:
+ * @code
+ * {
+ *     CCNxFileRepoManifestFetcher *fetcher = ccnxFileRepoManifestFetcher_Create(portal, root);
+ *     ccnxFileRepoManifestFetcher_SetMaxRetransmissions(fetcher, 10);
+ * }
+ * @endcode
+ */
+void ccnxFileRepoManifestFetcher_SetMaxRetransmissions(CCNxFileRepoManifestFetcher *fetcher, size_t maxRetransmissions);
+
+/**
+ * Determine whether all the data of the publication was handed out by
+ * `ccnxFileRepoManifestFetcher_NextChunk`, rather than the fetcher giving up on it.
+ *
+ * @param [in] fetcher The `CCNxFileRepoManifestFetcher` instance.
+ *
+ * @return true if every chunk was handed out.
+ */
+bool ccnxFileRepoManifestFetcher_IsComplete(const CCNxFileRepoManifestFetcher *fetcher);
+
+/**
+ * Produce a null-terminated string describing the congestion window and the interests sent
+ * and responses received so far.
  *
- * @param [in] fetcher A `CCNxManifestFetcher` instance.
- * @param [in, out] buffer A `PARCBuffer` to fill with application data bytes.
+ * The result must be freed by the caller via {@link parcMemory_Deallocate}.
+ *
+ * @param [in] fetcher The `CCNxFileRepoManifestFetcher` instance.
+ *
+ * @return A pointer to an allocated, null-terminated C string.
+ */
+char *ccnxFileRepoManifestFetcher_ToString(const CCNxFileRepoManifestFetcher *fetcher);
+
+/**
+ * Wait for the next chunk of application data whose offset in the file is known, and return
+ * its data, setting `offset` to where it belongs.
+ *
+ * Chunks are handed out as soon as they arrive and are placed, in whatever order that is, so
+ * a slow chunk holds up nothing after it. Offsets follow from the data size, block size and
+ * entry size each hash group records; a chunk whose offset they do not settle, such as one of
+ * the variable-length chunks of a content-chunked file, is placed when the chunk before or after
+ * it arrives.
+ *
+ * @param [in] fetcher A `CCNxFileRepoManifestFetcher` instance.
+ * @param [out] offset Set to the offset of the returned data in the file.
+ *
+ * @return A `PARCBuffer` with the data of the chunk, which must be released by the caller.
+ * @return NULL All the data was handed out, or the fetcher gave up on an interest.
  *
  * Example:
  * @code
  * {
  *     CCNxFileRepoManifestFetcher *fetcher = ...
- *     PARCBuffer *buffer = parcBuffer_Allocate(8192);
  *
- *     bool done = ccnxFileRepoManifestFetcher_FillBuffer(fetcher, buffer);
- *     while (!done) {
- *         // use the data and then fill more into the buffer
+ *     size_t offset;
+ *     PARCBuffer *chunk;
+ *     while ((chunk = ccnxFileRepoManifestFetcher_NextChunk(fetcher, &offset)) != NULL) {
+ *         // write the chunk at offset
+ *         parcBuffer_Release(&chunk);
  *     }
  * }
  * @endcode
  */
-bool ccnxFileRepoManifestFetcher_FillBuffer(CCNxFileRepoManifestFetcher *fetcher, PARCBuffer *buffer);
+PARCBuffer *ccnxFileRepoManifestFetcher_NextChunk(CCNxFileRepoManifestFetcher *fetcher, size_t *offset);
+
+/**
+ * Read the `length` bytes of application data at `offset` into `buffer`, at its position.
+ *
+ * Only the manifests whose data overlaps the range are fetched, and then only the chunks in
+ * it: the data size and entry size of each hash group place its pointers without fetching
+ * them. A skewed tree is still walked manifest by manifest up to the range. A read does not
+ * disturb the chunks handed out by `ccnxFileRepoManifestFetcher_NextChunk`.
+ *
+ * @param [in] fetcher A `CCNxFileRepoManifestFetcher` instance.
+ * @param [in] offset The offset of the first byte to read.
+ * @param [in] length The number of bytes to read.
+ * @param [in,out] buffer The `PARCBuffer` to read into, whose position is moved past the data read.
+ *
+ * @return The number of bytes read, fewer than `length` if the data or `buffer` ends first.
+ * @return 0 Nothing was read, or the fetcher gave up on an interest.
+ *
+ * Example:
+ * @code
+ * {
+ *     CCNxFileRepoManifestFetcher *fetcher = ...
+ *
+ *     size_t dataSize = ccnxFileRepoManifestFetcher_GetDataSize(fetcher);
+ *     PARCBuffer *tail = parcBuffer_Allocate(4096);
+ *     size_t read = ccnxFileRepoManifestFetcher_ReadAt(fetcher, (dataSize > 4096) ? dataSize - 4096 : 0, 4096, tail);
+ *     parcBuffer_Flip(tail);
+ * }
+ * @endcode
+ */
+size_t ccnxFileRepoManifestFetcher_ReadAt(CCNxFileRepoManifestFetcher *fetcher, size_t offset, size_t length, PARCBuffer *buffer);
 #endif // ccnxFileRepoManifestFetcher_h
@@ -0,0 +1,248 @@
+/*
+ * Copyright (c) 2016, Xerox Corporation (Xerox) and Palo Alto Research Center, Inc (PARC)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL XEROX OR PARC BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * ################################################################################
+ * #
+ * # PATENT NOTICE
+ * #
+ * # This software is distributed under the BSD 2-clause License (see LICENSE
+ * # file).  This BSD License does not make any patent claims and as such, does
+ * # not act as a patent grant.  The purpose of this section is for each contributor
+ * # to define their intentions with respect to intellectual property.
+ * #
+ * # Each contributor to this source code is encouraged to state their patent
+ * # claims and licensing mechanisms for any contributions made. At the end of
+ * # this section contributors may each make their own statements.  Contributor's
+ * # claims and grants only apply to the pieces (source code, programs, text,
+ * # media, etc) that they have contributed directly to this software.
+ * #
+ * # There is no guarantee that this section is complete, up to date or accurate. It
+ * # is up to the contributors to maintain their portion of this section and up to
+ * # the user of the software to verify any claims herein.
+ * #
+ * # Do not remove this header notification.  The contents of this section must be
+ * # present in all distributions of the software.  You may only modify your own
+ * # intellectual property statements.  Please provide contact information.
+ *
+ * - Palo Alto Research Center, Inc
+ * This software distribution does not grant any rights to patents owned by Palo
+ * Alto Research Center, Inc (PARC). Rights to these patents are available via
+ * various mechanisms. As of January 2016 PARC has committed to FRAND licensing any
+ * intellectual property used by its contributions to this software. You may
+ * contact PARC at cipo@parc.com for more information or visit http://www.ccnx.org
+ */
+/**
+ * @author Christopher A. Wood, Palo Alto Research Center (Xerox PARC)
+ * @copyright (c) 2016, Xerox Corporation (Xerox) and Palo Alto Research Center, Inc (PARC).  All rights reserved.
+ */
+#include <LongBow/runtime.h>
+
+#include <ctype.h>
+#include <dirent.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <parc/algol/parc_File.h>
+#include <parc/algol/parc_RandomAccessFile.h>
+
+#include "ccnxFileRepo_Common.h"
+#include "ccnxFileRepo_DigestIndex.h"
+#include "ccnxFileRepo_PackStore.h"
+
+/**
+ * Decode the name of a per-chunk file, which is the hex encoding of its digest.
+ *
+ * @param [in] fileName The name of a file in the repo directory.
+ *
+ * @retval NULL The name is not a hex-encoded digest.
+ * @retval PARCBuffer The digest.
+ */
+static PARCBuffer *
+_ccnxFileRepoMigrate_ParseDigest(const char *fileName)
+{
+    if (strlen(fileName) != 2 * CCNxFileRepoDigestIndex_DigestLength) {
+        return NULL;
+    }
+
+    PARCBuffer *digest = parcBuffer_Allocate(CCNxFileRepoDigestIndex_DigestLength);
+    for (size_t i = 0; i < CCNxFileRepoDigestIndex_DigestLength; i++) {
+        char byteString[3] = { fileName[2 * i], fileName[2 * i + 1], '\0' };
+        if (!isxdigit((unsigned char) byteString[0]) || !isxdigit((unsigned char) byteString[1])) {
+            parcBuffer_Release(&digest);
+            return NULL;
+        }
+        uint8_t byte = (uint8_t) strtoul(byteString, NULL, 16);
+        parcBuffer_PutArray(digest, 1, &byte);
+    }
+    return parcBuffer_Flip(digest);
+}
+
+static PARCBuffer *
+_ccnxFileRepoMigrate_ReadFile(const char *path)
+{
+    PARCBuffer *result = NULL;
+
+    PARCFile *file = parcFile_Create(path);
+    size_t fileSize = parcFile_GetFileSize(file);
+    if (fileSize > 0) {
+        PARCRandomAccessFile *fhandle = parcRandomAccessFile_Open(file);
+        result = parcBuffer_Allocate(fileSize);
+        parcRandomAccessFile_Read(fhandle, result);
+        parcBuffer_Flip(result);
+
+        parcRandomAccessFile_Close(fhandle);
+        parcRandomAccessFile_Release(&fhandle);
+    }
+    parcFile_Release(&file);
+
+    return result;
+}
+
+/**
+ * Move every per-chunk file of the repo in `directory` into its packfile.
+ *
+ * @param [in] directory The repo directory.
+ * @param [in] removeFiles If true, the per-chunk files are deleted once the packfile is written.
+ */
+static int
+_ccnxFileRepoMigrate_Run(const char *directory, bool removeFiles)
+{
+    CCNxFileRepoPackStore *store = ccnxFileRepoPackStore_Open(directory);
+    if (store == NULL) {
+        fprintf(stderr, "Could not open the packfile in %s\n", directory);
+        return EXIT_FAILURE;
+    }
+
+    DIR *dir = opendir(directory);
+    if (dir == NULL) {
+        perror(directory);
+        ccnxFileRepoPackStore_Release(&store);
+        return EXIT_FAILURE;
+    }
+
+    size_t migrated = 0;
+    size_t skipped = 0;
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != NULL) {
+        PARCBuffer *digest = _ccnxFileRepoMigrate_ParseDigest(entry->d_name);
+        if (digest == NULL) {
+            continue;
+        }
+
+        char *path = parcMemory_Format("%s/%s", directory, entry->d_name);
+        PARCBuffer *wireFormat = _ccnxFileRepoMigrate_ReadFile(path);
+        if (wireFormat != NULL && ccnxFileRepoPackStore_Put(store, digest, wireFormat)) {
+            migrated++;
+        } else {
+            skipped++;
+        }
+
+        if (wireFormat != NULL) {
+            parcBuffer_Release(&wireFormat);
+        }
+        parcMemory_Deallocate(&path);
+        parcBuffer_Release(&digest);
+    }
+
+    int status = ccnxFileRepoPackStore_Flush(store) ? EXIT_SUCCESS : EXIT_FAILURE;
+    printf("Migrated %zu chunks into %s/%s (%zu already present or unreadable)\n",
+           migrated, directory, ccnxFileRepoPackStore_PackFileName, skipped);
+
+    // Only delete the chunk files once every one of them is safely in the packfile.
+    if (status == EXIT_SUCCESS && removeFiles) {
+        rewinddir(dir);
+        while ((entry = readdir(dir)) != NULL) {
+            PARCBuffer *digest = _ccnxFileRepoMigrate_ParseDigest(entry->d_name);
+            if (digest != NULL) {
+                if (ccnxFileRepoPackStore_Contains(store, digest)) {
+                    char *path = parcMemory_Format("%s/%s", directory, entry->d_name);
+                    unlink(path);
+                    parcMemory_Deallocate(&path);
+                }
+                parcBuffer_Release(&digest);
+            }
+        }
+    }
+
+    closedir(dir);
+    ccnxFileRepoPackStore_Release(&store);
+    return status;
+}
+
+/**
+ * Display an explanation of arguments accepted by this program.
+ *
+ * @param [in] programName The name of this program.
+ */
+static void
+_ccnxFileRepoMigrate_DisplayUsage(const char *programName)
+{
+    printf("\n%s, %s\n\n", ccnxFileRepoCommon_ProgramName, programName);
+    printf("Move the chunks of a repo stored one file per chunk into a single packfile,\n");
+    printf("so that it can be served with '--store=pack'.\n");
+    printf("\n");
+    printf("Usage: %s [-h] [--remove] <repo path>\n", programName);
+    printf("\n");
+    printf("   e.g. %s /path/to/repo\n", programName);
+    printf("\n");
+    printf("  'repo path': the directory where the chunks are stored\n");
+    printf("  '--remove': delete the per-chunk files after they are written to the packfile\n");
+    printf("  '-h' will show this help\n\n");
+}
+
+int
+main(int argc, char *argv[argc])
+{
+    int status = EXIT_FAILURE;
+
+    char *commandArgs[argc];
+    int commandArgCount = 0;
+    char *commandOptions[argc];
+    int commandOptionCount = 0;
+    bool needToShowUsage = false;
+    bool shouldExit = false;
+
+    status = ccnxFileRepoCommon_ProcessCommandLineArguments(argc, argv, &commandArgCount, commandArgs,
+                                                            &commandOptionCount, commandOptions,
+                                                            &needToShowUsage, &shouldExit);
+
+    if (needToShowUsage) {
+        _ccnxFileRepoMigrate_DisplayUsage(argv[0]);
+    }
+
+    if (shouldExit) {
+        exit(status);
+    }
+
+    if (commandArgCount == 1) {
+        bool removeFiles = ccnxFileRepoCommon_GetOption(commandOptionCount, commandOptions, "remove") != NULL;
+        status = _ccnxFileRepoMigrate_Run(commandArgs[0], removeFiles);
+    } else {
+        status = EXIT_FAILURE;
+        _ccnxFileRepoMigrate_DisplayUsage(argv[0]);
+    }
+
+    exit(status);
+}
@@ -0,0 +1,231 @@
+/*
+ * Copyright (c) 2016, Xerox Corporation (Xerox) and Palo Alto Research Center, Inc (PARC)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL XEROX OR PARC BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * ################################################################################
+ * #
+ * # PATENT NOTICE
+ * #
+ * # This software is distributed under the BSD 2-clause License (see LICENSE
+ * # file).  This BSD License does not make any patent claims and as such, does
+ * # not act as a patent grant.  The purpose of this section is for each contributor
+ * # to define their intentions with respect to intellectual property.
+ * #
+ * # Each contributor to this source code is encouraged to state their patent
+ * # claims and licensing mechanisms for any contributions made. At the end of
+ * # this section contributors may each make their own statements.  Contributor's
+ * # claims and grants only apply to the pieces (source code, programs, text,
+ * # media, etc) that they have contributed directly to this software.
+ * #
+ * # There is no guarantee that this section is complete, up to date or accurate. It
+ * # is up to the contributors to maintain their portion of this section and up to
+ * # the user of the software to verify any claims herein.
+ * #
+ * # Do not remove this header notification.  The contents of this section must be
+ * # present in all distributions of the software.  You may only modify your own
+ * # intellectual property statements.  Please provide contact information.
+ *
+ * - Palo Alto Research Center, Inc
+ * This software distribution does not grant any rights to patents owned by Palo
+ * Alto Research Center, Inc (PARC). Rights to these patents are available via
+ * various mechanisms. As of January 2016 PARC has committed to FRAND licensing any
+ * intellectual property used by its contributions to this software. You may
+ * contact PARC at cipo@parc.com for more information or visit http://www.ccnx.org
+ */
+/**
+ * @author Christopher A. Wood, Palo Alto Research Center (Xerox PARC)
+ * @copyright (c) 2016, Xerox Corporation (Xerox) and Palo Alto Research Center, Inc (PARC).  All rights reserved.
+ */
+#include <LongBow/runtime.h>
+
+#include <parc/algol/parc_Object.h>
+#include <parc/algol/parc_HashMap.h>
+
+#include <ccnx/transport/common/transport_MetaMessage.h>
+
+#include "ccnxFileRepo_NameTable.h"
+#include "ccnxFileRepo_Rcu.h"
+
+/**
+ * A publication: its root manifest and, encoded once when it is added, the response to an
+ * interest for it.
+ */
+typedef struct {
+    CCNxManifest *root;
+    PARCBuffer *wireFormat;
+} _NameTableEntry;
+
+static bool
+_nameTableEntry_Destructor(_NameTableEntry **entryPtr)
+{
+    _NameTableEntry *entry = *entryPtr;
+    ccnxManifest_Release(&entry->root);
+    parcBuffer_Release(&entry->wireFormat);
+    return true;
+}
+
+parcObject_Override(_NameTableEntry, PARCObject,
+                    .destructor = (PARCObjectDestructor *) _nameTableEntry_Destructor);
+
+/**
+ * The current version of a publication. The slot of a name never changes once it is added;
+ * a new version replaces its entry with an atomic swap.
+ */
+typedef struct {
+    _NameTableEntry *entry;
+} _NameTableSlot;
+
+static bool
+_nameTableSlot_Destructor(_NameTableSlot **slotPtr)
+{
+    _NameTableSlot *slot = *slotPtr;
+    parcObject_Release((PARCObject **) &slot->entry);
+    return true;
+}
+
+parcObject_Override(_NameTableSlot, PARCObject,
+                    .destructor = (PARCObjectDestructor *) _nameTableSlot_Destructor);
+
+struct ccnx_file_repo_name_table {
+    // CCNxName -> _NameTableSlot, hashed on the name
+    PARCHashMap *entries;
+
+    // Readers look entries up in read-side sections, so a replaced entry is only released
+    // once no reader can still be using it.
+    CCNxFileRepoRcu *rcu;
+};
+
+static bool
+_ccnxFileRepoNameTable_Destructor(CCNxFileRepoNameTable **tablePtr)
+{
+    CCNxFileRepoNameTable *table = *tablePtr;
+    parcHashMap_Release(&table->entries);
+    ccnxFileRepoRcu_Release(&table->rcu);
+    return true;
+}
+
+parcObject_Override(CCNxFileRepoNameTable, PARCObject,
+                    .destructor = (PARCObjectDestructor *) _ccnxFileRepoNameTable_Destructor);
+
+parcObject_ImplementAcquire(ccnxFileRepoNameTable, CCNxFileRepoNameTable);
+parcObject_ImplementRelease(ccnxFileRepoNameTable, CCNxFileRepoNameTable);
+
+CCNxFileRepoNameTable *
+ccnxFileRepoNameTable_Create(void)
+{
+    CCNxFileRepoNameTable *table = parcObject_CreateInstance(CCNxFileRepoNameTable);
+    if (table != NULL) {
+        table->entries = parcHashMap_Create();
+        table->rcu = ccnxFileRepoRcu_Create();
+    }
+    return table;
+}
+
+static _NameTableEntry *
+_ccnxFileRepoNameTable_CreateEntry(const CCNxManifest *root)
+{
+    _NameTableEntry *entry = parcObject_CreateInstance(_NameTableEntry);
+    entry->root = ccnxManifest_Acquire(root);
+
+    CCNxMetaMessage *message = ccnxMetaMessage_CreateFromManifest(root);
+    entry->wireFormat = ccnxMetaMessage_CreateWireFormatBuffer(message, NULL);
+    ccnxMetaMessage_Release(&message);
+    return entry;
+}
+
+bool
+ccnxFileRepoNameTable_Add(CCNxFileRepoNameTable *table, const CCNxName *name, const CCNxManifest *root)
+{
+    if (parcHashMap_Contains(table->entries, name)) {
+        return false;
+    }
+
+    _NameTableSlot *slot = parcObject_CreateInstance(_NameTableSlot);
+    slot->entry = _ccnxFileRepoNameTable_CreateEntry(root);
+
+    parcHashMap_Put(table->entries, name, slot);
+    parcObject_Release((PARCObject **) &slot);
+    return true;
+}
+
+bool
+ccnxFileRepoNameTable_Replace(CCNxFileRepoNameTable *table, const CCNxName *name, const CCNxManifest *root)
+{
+    _NameTableSlot *slot = (_NameTableSlot *) parcHashMap_Get(table->entries, name);
+    if (slot == NULL) {
+        return false;
+    }
+
+    // The new entry is complete before it is published; readers that loaded the old one
+    // keep using it until they leave their section, and only then is it released.
+    _NameTableEntry *entry = _ccnxFileRepoNameTable_CreateEntry(root);
+    _NameTableEntry *old = __atomic_exchange_n(&slot->entry, entry, __ATOMIC_SEQ_CST);
+    ccnxFileRepoRcu_Synchronize(table->rcu);
+    parcObject_Release((PARCObject **) &old);
+    return true;
+}
+
+bool
+ccnxFileRepoNameTable_Contains(const CCNxFileRepoNameTable *table, const CCNxName *name)
+{
+    // The slots never change once they are added, so no read-side section is needed.
+    return parcHashMap_Contains(table->entries, name);
+}
+
+CCNxManifest *
+ccnxFileRepoNameTable_AcquireRoot(const CCNxFileRepoNameTable *table, const CCNxName *name)
+{
+    CCNxManifest *result = NULL;
+
+    size_t reader = ccnxFileRepoRcu_ReadLock(table->rcu);
+    const _NameTableSlot *slot = parcHashMap_Get(table->entries, name);
+    if (slot != NULL) {
+        const _NameTableEntry *entry = __atomic_load_n(&slot->entry, __ATOMIC_SEQ_CST);
+        result = ccnxManifest_Acquire(entry->root);
+    }
+    ccnxFileRepoRcu_ReadUnlock(table->rcu, reader);
+
+    return result;
+}
+
+PARCBuffer *
+ccnxFileRepoNameTable_CreateWireFormatView(const CCNxFileRepoNameTable *table, const CCNxName *name)
+{
+    PARCBuffer *result = NULL;
+
+    size_t reader = ccnxFileRepoRcu_ReadLock(table->rcu);
+    const _NameTableSlot *slot = parcHashMap_Get(table->entries, name);
+    if (slot != NULL) {
+        const _NameTableEntry *entry = __atomic_load_n(&slot->entry, __ATOMIC_SEQ_CST);
+        result = parcBuffer_Slice(entry->wireFormat);
+    }
+    ccnxFileRepoRcu_ReadUnlock(table->rcu, reader);
+
+    return result;
+}
+
+size_t
+ccnxFileRepoNameTable_GetCount(const CCNxFileRepoNameTable *table)
+{
+    return parcHashMap_Size(table->entries);
+}
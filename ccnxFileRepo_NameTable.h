@@ -0,0 +1,217 @@
+/*
+ * Copyright (c) 2016, Xerox Corporation (Xerox) and Palo Alto Research Center, Inc (PARC)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL XEROX OR PARC BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * ################################################################################
+ * #
+ * # PATENT NOTICE
+ * #
+ * # This software is distributed under the BSD 2-clause License (see LICENSE
+ * # file).  This BSD License does not make any patent claims and as such, does
+ * # not act as a patent grant.  The purpose of this section is for each contributor
+ * # to define their intentions with respect to intellectual property.
+ * #
+ * # Each contributor to this source code is encouraged to state their patent
+ * # claims and licensing mechanisms for any contributions made. At the end of
+ * # this section contributors may each make their own statements.  Contributor's
+ * # claims and grants only apply to the pieces (source code, programs, text,
+ * # media, etc) that they have contributed directly to this software.
+ * #
+ * # There is no guarantee that this section is complete, up to date or accurate. It
+ * # is up to the contributors to maintain their portion of this section and up to
+ * # the user of the software to verify any claims herein.
+ * #
+ * # Do not remove this header notification.  The contents of this section must be
+ * # present in all distributions of the software.  You may only modify your own
+ * # intellectual property statements.  Please provide contact information.
+ *
+ * - Palo Alto Research Center, Inc
+ * This software distribution does not grant any rights to patents owned by Palo
+ * Alto Research Center, Inc (PARC). Rights to these patents are available via
+ * various mechanisms. As of January 2016 PARC has committed to FRAND licensing any
+ * intellectual property used by its contributions to this software. You may
+ * contact PARC at cipo@parc.com for more information or visit http://www.ccnx.org
+ */
+/**
+ * @author Christopher A. Wood, Palo Alto Research Center (Xerox PARC)
+ * @copyright (c) 2016, Xerox Corporation (Xerox) and Palo Alto Research Center, Inc (PARC).  All rights reserved.
+ */
+
+#ifndef ccnxFileRepoNameTable_h
+#define ccnxFileRepoNameTable_h
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include <parc/algol/parc_Buffer.h>
+
+#include <ccnx/common/ccnx_Name.h>
+#include <ccnx/common/ccnx_Manifest.h>
+
+struct ccnx_file_repo_name_table;
+typedef struct ccnx_file_repo_name_table CCNxFileRepoNameTable;
+
+/**
+ * Create an empty `CCNxFileRepoNameTable`, which maps the name of each published file to
+ * its root manifest so that one server can answer interests for many publications.
+ *
+ * The names are added before interests are answered. After that, the root of a name may be
+ * replaced by a new version at any time: lookups never take a lock or wait for a
+ * replacement, and a lookup that found the old version can keep using it.
+ *
+ * @return A new `CCNxFileRepoNameTable` instance.
+ *
+ * Example:
+ * @code
+ * {
+ *     CCNxFileRepoNameTable *table = ccnxFileRepoNameTable_Create();
+ * }
+ * @endcode
+ */
+CCNxFileRepoNameTable *ccnxFileRepoNameTable_Create(void);
+
+/**
+ * Increase the number of references to a `CCNxFileRepoNameTable` instance.
+ *
+ * @param [in] instance A pointer to a valid CCNxFileRepoNameTable instance.
+ *
+ * @return The same value as @p instance.
+ */
+CCNxFileRepoNameTable *ccnxFileRepoNameTable_Acquire(const CCNxFileRepoNameTable *instance);
+
+/**
+ * Release a previously acquired reference to the given `CCNxFileRepoNameTable` instance,
+ * decrementing the reference count for the instance.
+ *
+ * The pointer to the instance is set to NULL as a side-effect of this function.
+ *
+ * @param [in,out] instancePtr A pointer to a pointer to the instance to release.
+ */
+void ccnxFileRepoNameTable_Release(CCNxFileRepoNameTable **instancePtr);
+
+/**
+ * Add a publication to the table. The root manifest is encoded once, here, so that
+ * interests for it are answered without encoding it again.
+ *
+ * Publications must not be added while other threads look names up.
+ *
+ * @param [in] table The `CCNxFileRepoNameTable` instance.
+ * @param [in] name The name of the publication.
+ * @param [in] root The root manifest of the publication.
+ *
+ * @return true The publication was added.
+ * @return false A publication with the same name is already in the table.
+ *
+ * Example:
+ * @code
+ * {
+ *     CCNxManifest *root = ccnxFileRepoCache_PublishFile(cache, name, "/path/to/file");
+ *     ccnxFileRepoNameTable_Add(table, name, root);
+ *     ccnxManifest_Release(&root);
+ * }
+ * @endcode
+ */
+bool ccnxFileRepoNameTable_Add(CCNxFileRepoNameTable *table, const CCNxName *name, const CCNxManifest *root);
+
+/**
+ * Replace the root manifest of a publication already in the table, e.g., with the root of a
+ * new version of its file.
+ *
+ * The new root is encoded and then swapped in atomically, so a lookup finds either the old
+ * or the new version, never a mix. The call returns once no lookup can still be using the
+ * old version, which is then released. It may be called while other threads look names up,
+ * and never makes them wait.
+ *
+ * @param [in] table The `CCNxFileRepoNameTable` instance.
+ * @param [in] name The name of the publication.
+ * @param [in] root The new root manifest of the publication.
+ *
+ * @return true The root was replaced.
+ * @return false No publication has that name.
+ *
+ * Example:
+ * @code
+ * {
+ *     CCNxManifest *root = ccnxFileRepoCache_PublishFile(cache, name, "/path/to/file");
+ *     ccnxFileRepoNameTable_Replace(table, name, root);
+ *     ccnxManifest_Release(&root);
+ * }
+ * @endcode
+ */
+bool ccnxFileRepoNameTable_Replace(CCNxFileRepoNameTable *table, const CCNxName *name, const CCNxManifest *root);
+
+/**
+ * Determine if a publication with the given name is in the table.
+ *
+ * @param [in] table The `CCNxFileRepoNameTable` instance.
+ * @param [in] name The name to look up, e.g., the name of an interest.
+ *
+ * @return true A publication has that name.
+ * @return false No publication has that name.
+ */
+bool ccnxFileRepoNameTable_Contains(const CCNxFileRepoNameTable *table, const CCNxName *name);
+
+/**
+ * Find the current root manifest of the publication with the given name.
+ *
+ * @param [in] table The `CCNxFileRepoNameTable` instance.
+ * @param [in] name The name to look up, e.g., the name of an interest.
+ *
+ * @retval NULL No publication has that name.
+ * @retval CCNxManifest The root manifest, which the caller must release.
+ */
+CCNxManifest *ccnxFileRepoNameTable_AcquireRoot(const CCNxFileRepoNameTable *table, const CCNxName *name);
+
+/**
+ * Return a view of the wire format of the current root manifest of the publication with the
+ * given name, as it was encoded when the publication was added or last replaced.
+ *
+ * The view shares the encoding, which is not copied, and keeps it alive after the
+ * publication is replaced.
+ *
+ * @param [in] table The `CCNxFileRepoNameTable` instance.
+ * @param [in] name The name to look up, e.g., the name of an interest.
+ *
+ * @retval NULL No publication has that name.
+ * @retval PARCBuffer A new view of the encoded root manifest, which the caller must release.
+ *
+ * Example:
+ * @code
+ * {
+ *     PARCBuffer *view = ccnxFileRepoNameTable_CreateWireFormatView(table, name);
+ *     if (view != NULL) {
+ *         CCNxMetaMessage *response = ccnxWireFormatMessage_Create(view);
+ *         parcBuffer_Release(&view);
+ *     }
+ * }
+ * @endcode
+ */
+PARCBuffer *ccnxFileRepoNameTable_CreateWireFormatView(const CCNxFileRepoNameTable *table, const CCNxName *name);
+
+/**
+ * Return the number of publications in the table.
+ *
+ * @param [in] table The `CCNxFileRepoNameTable` instance.
+ */
+size_t ccnxFileRepoNameTable_GetCount(const CCNxFileRepoNameTable *table);
+#endif // ccnxFileRepoNameTable_h
@@ -0,0 +1,422 @@
+/*
+ * Copyright (c) 2016, Xerox Corporation (Xerox) and Palo Alto Research Center, Inc (PARC)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL XEROX OR PARC BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * ################################################################################
+ * #
+ * # PATENT NOTICE
+ * #
+ * # This software is distributed under the BSD 2-clause License (see LICENSE
+ * # file).  This BSD License does not make any patent claims and as such, does
+ * # not act as a patent grant.  The purpose of this section is for each contributor
+ * # to define their intentions with respect to intellectual property.
+ * #
+ * # Each contributor to this source code is encouraged to state their patent
+ * # claims and licensing mechanisms for any contributions made. At the end of
+ * # this section contributors may each make their own statements.  Contributor's
+ * # claims and grants only apply to the pieces (source code, programs, text,
+ * # media, etc) that they have contributed directly to this software.
+ * #
+ * # There is no guarantee that this section is complete, up to date or accurate. It
+ * # is up to the contributors to maintain their portion of this section and up to
+ * # the user of the software to verify any claims herein.
+ * #
+ * # Do not remove this header notification.  The contents of this section must be
+ * # present in all distributions of the software.  You may only modify your own
+ * # intellectual property statements.  Please provide contact information.
+ *
+ * - Palo Alto Research Center, Inc
+ * This software distribution does not grant any rights to patents owned by Palo
+ * Alto Research Center, Inc (PARC). Rights to these patents are available via
+ * various mechanisms. As of January 2016 PARC has committed to FRAND licensing any
+ * intellectual property used by its contributions to this software. You may
+ * contact PARC at cipo@parc.com for more information or visit http://www.ccnx.org
+ */
+/**
+ * @author Christopher A. Wood, Palo Alto Research Center (Xerox PARC)
+ * @copyright (c) 2016, Xerox Corporation (Xerox) and Palo Alto Research Center, Inc (PARC).  All rights reserved.
+ */
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE // fallocate
+#endif
+
+#include <LongBow/runtime.h>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <sys/mman.h>
+
+#include <parc/algol/parc_Object.h>
+#include <parc/algol/parc_Memory.h>
+
+#include "ccnxFileRepo_Common.h"
+#include "ccnxFileRepo_OutputFile.h"
+
+/**
+ * The most batches kept open at a time. Chunks arrive roughly in file order, within the
+ * fetcher's window, so only the last few batches are still being filled.
+ */
+#define _ccnxFileRepoOutputFile_MaximumBatches 16
+
+/**
+ * A range of the file copied into a batch.
+ */
+typedef struct {
+    size_t offset;
+    size_t length;
+} _Piece;
+
+/**
+ * An aligned range of the file whose chunks are collected to be written with one call.
+ */
+typedef struct {
+    bool open;
+    size_t base;
+    size_t length;
+    size_t filled;
+    uint8_t *bytes;
+
+    // What was copied in, to write only those ranges if the batch must go out unfilled
+    _Piece *pieces;
+    size_t pieceCount;
+    size_t pieceCapacity;
+} _Batch;
+
+struct ccnx_file_repo_output_file {
+    int fd;
+    size_t size;
+    size_t batchSize;
+
+    uint8_t *map; // the mapped file, or NULL to write through the batches
+    _Batch batches[_ccnxFileRepoOutputFile_MaximumBatches];
+
+    // Counters
+    size_t bytesWritten;
+    size_t writeCount;
+    size_t partialBatches;
+    bool preallocated;
+    bool mapped;
+    double ioTime;
+};
+
+static double
+_ccnxFileRepoOutputFile_Now(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+/**
+ * Write all `length` bytes at `offset`, however many calls that takes.
+ */
+static bool
+_ccnxFileRepoOutputFile_WriteFully(CCNxFileRepoOutputFile *file, const uint8_t *bytes, size_t length, size_t offset)
+{
+    while (length > 0) {
+        ssize_t written = pwrite(file->fd, bytes, length, (off_t) offset);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        bytes += written;
+        length -= written;
+        offset += written;
+        file->writeCount++;
+    }
+    return true;
+}
+
+static int
+_ccnxFileRepoOutputFile_ComparePieces(const void *a, const void *b)
+{
+    const _Piece *x = a;
+    const _Piece *y = b;
+    return (x->offset < y->offset) ? -1 : (x->offset > y->offset);
+}
+
+/**
+ * Write `batch` and close it: with one call if it is full, or else just the ranges that were
+ * copied into it, merged where they touch, so nothing written from another batch for the same
+ * range is overwritten.
+ */
+static bool
+_ccnxFileRepoOutputFile_FlushBatch(CCNxFileRepoOutputFile *file, _Batch *batch)
+{
+    bool result = true;
+    if (batch->filled == batch->length) {
+        result = _ccnxFileRepoOutputFile_WriteFully(file, batch->bytes, batch->length, batch->base);
+    } else {
+        file->partialBatches++;
+        qsort(batch->pieces, batch->pieceCount, sizeof(_Piece), _ccnxFileRepoOutputFile_ComparePieces);
+        for (size_t i = 0; result && i < batch->pieceCount;) {
+            size_t start = batch->pieces[i].offset;
+            size_t end = start + batch->pieces[i].length;
+            for (i++; i < batch->pieceCount && batch->pieces[i].offset == end; i++) {
+                end += batch->pieces[i].length;
+            }
+            result = _ccnxFileRepoOutputFile_WriteFully(file, batch->bytes + (start - batch->base), end - start, start);
+        }
+    }
+
+    batch->open = false;
+    batch->filled = 0;
+    batch->pieceCount = 0;
+    return result;
+}
+
+/**
+ * Return the open batch for the aligned range that starts at `base`, opening it if need be.
+ * When all the batches are open, the one furthest back in the file is written unfilled to
+ * make room: it is the one waiting for a straggler.
+ */
+static _Batch *
+_ccnxFileRepoOutputFile_GetBatch(CCNxFileRepoOutputFile *file, size_t base, bool *result)
+{
+    _Batch *available = NULL;
+    _Batch *oldest = NULL;
+    for (size_t i = 0; i < _ccnxFileRepoOutputFile_MaximumBatches; i++) {
+        _Batch *batch = &file->batches[i];
+        if (!batch->open) {
+            available = (available == NULL) ? batch : available;
+        } else if (batch->base == base) {
+            return batch;
+        } else if (oldest == NULL || batch->base < oldest->base) {
+            oldest = batch;
+        }
+    }
+
+    if (available == NULL) {
+        *result = _ccnxFileRepoOutputFile_FlushBatch(file, oldest) && *result;
+        available = oldest;
+    }
+
+    if (available->bytes == NULL) {
+        available->bytes = parcMemory_Allocate(file->batchSize);
+        assertNotNull(available->bytes, "parcMemory_Allocate(%zu) returned NULL", file->batchSize);
+    }
+    available->open = true;
+    available->base = base;
+    available->length = file->batchSize;
+    if (file->size > 0 && base + available->length > file->size) {
+        // The last batch ends with the file; Write refuses anything past it
+        available->length = file->size - base;
+    }
+    return available;
+}
+
+/**
+ * Copy the `length` bytes at `offset`, all within one batch, into that batch, and write it
+ * once it is full.
+ */
+static bool
+_ccnxFileRepoOutputFile_AddToBatch(CCNxFileRepoOutputFile *file, size_t offset, const uint8_t *bytes, size_t length)
+{
+    bool result = true;
+    size_t base = offset - offset % file->batchSize;
+    _Batch *batch = _ccnxFileRepoOutputFile_GetBatch(file, base, &result);
+
+    if (batch->pieceCount == batch->pieceCapacity) {
+        batch->pieceCapacity = (batch->pieceCapacity == 0) ? 64 : batch->pieceCapacity * 2;
+        batch->pieces = parcMemory_Reallocate(batch->pieces, batch->pieceCapacity * sizeof(_Piece));
+    }
+    batch->pieces[batch->pieceCount].offset = offset;
+    batch->pieces[batch->pieceCount].length = length;
+    batch->pieceCount++;
+
+    memcpy(batch->bytes + (offset - base), bytes, length);
+    batch->filled += length;
+    if (batch->filled >= batch->length) {
+        result = _ccnxFileRepoOutputFile_FlushBatch(file, batch) && result;
+    }
+    return result;
+}
+
+bool
+ccnxFileRepoOutputFile_Close(CCNxFileRepoOutputFile *file)
+{
+    if (file->fd < 0) {
+        return true;
+    }
+
+    double start = _ccnxFileRepoOutputFile_Now();
+    bool result = true;
+    for (size_t i = 0; i < _ccnxFileRepoOutputFile_MaximumBatches; i++) {
+        if (file->batches[i].open) {
+            result = _ccnxFileRepoOutputFile_FlushBatch(file, &file->batches[i]) && result;
+        }
+    }
+    if (file->map != NULL) {
+        munmap(file->map, file->size);
+        file->map = NULL;
+    }
+    result = (close(file->fd) == 0) && result;
+    file->fd = -1;
+    file->ioTime += _ccnxFileRepoOutputFile_Now() - start;
+    return result;
+}
+
+static bool
+_ccnxFileRepoOutputFile_Destructor(CCNxFileRepoOutputFile **filePtr)
+{
+    CCNxFileRepoOutputFile *file = *filePtr;
+
+    ccnxFileRepoOutputFile_Close(file);
+    for (size_t i = 0; i < _ccnxFileRepoOutputFile_MaximumBatches; i++) {
+        if (file->batches[i].bytes != NULL) {
+            parcMemory_Deallocate(&file->batches[i].bytes);
+        }
+        if (file->batches[i].pieces != NULL) {
+            parcMemory_Deallocate(&file->batches[i].pieces);
+        }
+    }
+    return true;
+}
+
+char *
+ccnxFileRepoOutputFile_ToString(const CCNxFileRepoOutputFile *file)
+{
+    return parcMemory_Format("%zu bytes in %zu writes%s, %zu batches written unfilled, %s, %.3f s of output I/O",
+                             file->bytesWritten, file->writeCount, file->mapped ? " through a mapping" : "",
+                             file->partialBatches, file->preallocated ? "preallocated" : "not preallocated", file->ioTime);
+}
+
+parcObject_Override(CCNxFileRepoOutputFile, PARCObject,
+                    .destructor = (PARCObjectDestructor *) _ccnxFileRepoOutputFile_Destructor,
+                    .toString = (PARCObjectToString *) ccnxFileRepoOutputFile_ToString);
+
+parcObject_ImplementAcquire(ccnxFileRepoOutputFile, CCNxFileRepoOutputFile);
+parcObject_ImplementRelease(ccnxFileRepoOutputFile, CCNxFileRepoOutputFile);
+
+/**
+ * Give the file its final size up front, so its blocks are allocated together and writes
+ * past the end of the file do not have to extend it. Where the file system cannot allocate
+ * blocks ahead, only the length is set and `preallocated` is left false.
+ *
+ * @return false The length of the file could not be set, with `errno` telling why.
+ */
+static bool
+_ccnxFileRepoOutputFile_SetLength(int fd, size_t size, bool *preallocated)
+{
+    *preallocated = false;
+#ifdef __linux__
+    int status;
+    do {
+        status = fallocate(fd, 0, 0, (off_t) size);
+    } while (status != 0 && errno == EINTR);
+    if (status == 0) {
+        *preallocated = true;
+        return true;
+    }
+    // Out of space or a failing device is an error; only a missing fallocate is worked around
+    if (errno != EOPNOTSUPP && errno != ENOSYS) {
+        return false;
+    }
+#endif
+    int result;
+    do {
+        result = ftruncate(fd, (off_t) size);
+    } while (result != 0 && errno == EINTR);
+    return (result == 0);
+}
+
+CCNxFileRepoOutputFile *
+ccnxFileRepoOutputFile_Create(const char *path, size_t size, bool mapped)
+{
+    double start = _ccnxFileRepoOutputFile_Now();
+    int fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        return NULL;
+    }
+
+    bool preallocated = false;
+    if (size > 0 && !_ccnxFileRepoOutputFile_SetLength(fd, size, &preallocated)) {
+        int error = errno;
+        close(fd);
+        errno = error;
+        return NULL;
+    }
+
+    CCNxFileRepoOutputFile *file = parcObject_CreateAndClearInstance(CCNxFileRepoOutputFile);
+    if (file == NULL) {
+        close(fd);
+        return NULL;
+    }
+    file->fd = fd;
+    file->size = size;
+    file->batchSize = ccnxFileRepoCommon_ClientBufferSize;
+    file->preallocated = preallocated;
+
+    // A store into a mapping of blocks that were never allocated raises SIGBUS when the file
+    // system runs out of space, so only a preallocated file is mapped.
+    if (mapped && preallocated) {
+        void *map = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        file->map = (map != MAP_FAILED) ? map : NULL;
+        file->mapped = (file->map != NULL);
+    }
+    file->ioTime = _ccnxFileRepoOutputFile_Now() - start;
+    return file;
+}
+
+bool
+ccnxFileRepoOutputFile_Write(CCNxFileRepoOutputFile *file, size_t offset, const PARCBuffer *data)
+{
+    assertTrue(file->fd >= 0, "The output file is closed");
+
+    double start = _ccnxFileRepoOutputFile_Now();
+    const uint8_t *bytes = ccnxFileRepoCommon_GetBufferBytes(data);
+    size_t length = parcBuffer_Remaining(data);
+
+    if (file->size > 0 && (offset > file->size || length > file->size - offset)) {
+        // A chunk past the end of a file of known size means the transfer went wrong
+        errno = EINVAL;
+        return false;
+    }
+
+    bool result = true;
+    if (file->map != NULL) {
+        memcpy(file->map + offset, bytes, length);
+    } else {
+        // A chunk that straddles the end of a batch goes into both
+        while (result && length > 0) {
+            size_t inBatch = file->batchSize - offset % file->batchSize;
+            inBatch = (inBatch < length) ? inBatch : length;
+            result = _ccnxFileRepoOutputFile_AddToBatch(file, offset, bytes, inBatch);
+            offset += inBatch;
+            bytes += inBatch;
+            length -= inBatch;
+        }
+    }
+    file->bytesWritten += parcBuffer_Remaining(data);
+    file->ioTime += _ccnxFileRepoOutputFile_Now() - start;
+    return result;
+}
@@ -0,0 +1,161 @@
+/*
+ * Copyright (c) 2016, Xerox Corporation (Xerox) and Palo Alto Research Center, Inc (PARC)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL XEROX OR PARC BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * ################################################################################
+ * #
+ * # PATENT NOTICE
+ * #
+ * # This software is distributed under the BSD 2-clause License (see LICENSE
+ * # file).  This BSD License does not make any patent claims and as such, does
+ * # not act as a patent grant.  The purpose of this section is for each contributor
+ * # to define their intentions with respect to intellectual property.
+ * #
+ * # Each contributor to this source code is encouraged to state their patent
+ * # claims and licensing mechanisms for any contributions made. At the end of
+ * # this section contributors may each make their own statements.  Contributor's
+ * # claims and grants only apply to the pieces (source code, programs, text,
+ * # media, etc) that they have contributed directly to this software.
+ * #
+ * # There is no guarantee that this section is complete, up to date or accurate. It
+ * # is up to the contributors to maintain their portion of this section and up to
+ * # the user of the software to verify any claims herein.
+ * #
+ * # Do not remove this header notification.  The contents of this section must be
+ * # present in all distributions of the software.  You may only modify your own
+ * # intellectual property statements.  Please provide contact information.
+ *
+ * - Palo Alto Research Center, Inc
+ * This software distribution does not grant any rights to patents owned by Palo
+ * Alto Research Center, Inc (PARC). Rights to these patents are available via
+ * various mechanisms. As of January 2016 PARC has committed to FRAND licensing any
+ * intellectual property used by its contributions to this software. You may
+ * contact PARC at cipo@parc.com for more information or visit http://www.ccnx.org
+ */
+/**
+ * @author Christopher A. Wood, Palo Alto Research Center (Xerox PARC)
+ * @copyright (c) 2016, Xerox Corporation (Xerox) and Palo Alto Research Center, Inc (PARC).  All rights reserved.
+ */
+
+#ifndef ccnxFileRepoOutputFile_h
+#define ccnxFileRepoOutputFile_h
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include <parc/algol/parc_Buffer.h>
+
+struct ccnx_file_repo_output_file;
+typedef struct ccnx_file_repo_output_file CCNxFileRepoOutputFile;
+
+/**
+ * Create a `CCNxFileRepoOutputFile`, which writes the chunks of a download to the file at
+ * `path` at their offsets, in whatever order they arrive.
+ *
+ * The file is opened once, truncated, and preallocated to `size` bytes when the size is known.
+ * Chunks are copied into batches of `ccnxFileRepoCommon_ClientBufferSize` bytes, aligned to
+ * their size, and a batch is written with one call once all of its chunks have arrived; a few
+ * batches are kept open at a time, since chunks arrive roughly in file order. With `mapped`,
+ * a file whose blocks could be preallocated is instead mapped into memory and the chunks are
+ * copied straight into it.
+ *
+ * @param [in] path The path of the file to write.
+ * @param [in] size The size of the file, or 0 if it is not known.
+ * @param [in] mapped Whether to write through a memory mapping of the file, if it can be mapped.
+ *
+ * @return A new `CCNxFileRepoOutputFile` instance, or NULL if the file cannot be created or
+ *         given its size, with `errno` set.
+ *
+ * Example:
+ * @code
+ * {
+ *     CCNxFileRepoOutputFile *file = ccnxFileRepoOutputFile_Create("out.bin", dataSize, false);
+ *     ccnxFileRepoOutputFile_Write(file, offset, chunk);
+ *     ccnxFileRepoOutputFile_Close(file);
+ *     ccnxFileRepoOutputFile_Release(&file);
+ * }
+ * @endcode
+ */
+CCNxFileRepoOutputFile *ccnxFileRepoOutputFile_Create(const char *path, size_t size, bool mapped);
+
+/**
+ * Increase the number of references to a `CCNxFileRepoOutputFile` instance.
+ *
+ * @param [in] instance A pointer to a valid CCNxFileRepoOutputFile instance.
+ *
+ * @return The same value as @p instance.
+ */
+CCNxFileRepoOutputFile *ccnxFileRepoOutputFile_Acquire(const CCNxFileRepoOutputFile *instance);
+
+/**
+ * Release a previously acquired reference to the given `CCNxFileRepoOutputFile` instance,
+ * decrementing the reference count for the instance. The file is closed first if it is open.
+ *
+ * The pointer to the instance is set to NULL as a side-effect of this function.
+ *
+ * @param [in,out] instancePtr A pointer to a pointer to the instance to release.
+ */
+void ccnxFileRepoOutputFile_Release(CCNxFileRepoOutputFile **instancePtr);
+
+/**
+ * Write the remaining bytes of `data` at `offset` in the file. The position of `data` is
+ * not changed. When the size of the file is known, data that does not lie entirely within
+ * it is refused rather than cut short.
+ *
+ * @param [in] file The `CCNxFileRepoOutputFile` instance.
+ * @param [in] offset The offset of the data in the file.
+ * @param [in] data The data to write.
+ *
+ * @return true The data was written, or copied to be written with its batch.
+ * @return false Writing failed, or the data lies outside the file (`EINVAL`); `errno` says why.
+ */
+bool ccnxFileRepoOutputFile_Write(CCNxFileRepoOutputFile *file, size_t offset, const PARCBuffer *data);
+
+/**
+ * Write the batches that are still open and close the file.
+ *
+ * @param [in] file The `CCNxFileRepoOutputFile` instance.
+ *
+ * @return true Everything was written.
+ * @return false Writing or closing failed; `errno` says why.
+ */
+bool ccnxFileRepoOutputFile_Close(CCNxFileRepoOutputFile *file);
+
+/**
+ * Return the seconds spent opening, preallocating, writing and closing the file so far.
+ *
+ * @param [in] file The `CCNxFileRepoOutputFile` instance.
+ */
+double ccnxFileRepoOutputFile_GetIoTime(const CCNxFileRepoOutputFile *file);
+
+/**
+ * Produce a null-terminated string describing how the file was written.
+ *
+ * The result must be freed by the caller via {@link parcMemory_Deallocate}.
+ *
+ * @param [in] file The `CCNxFileRepoOutputFile` instance.
+ *
+ * @return A pointer to an allocated, null-terminated C string.
+ */
+char *ccnxFileRepoOutputFile_ToString(const CCNxFileRepoOutputFile *file);
+#endif // ccnxFileRepoOutputFile_h
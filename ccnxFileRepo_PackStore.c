@@ -0,0 +1,878 @@
+/*
+ * Copyright (c) 2016, Xerox Corporation (Xerox) and Palo Alto Research Center, Inc (PARC)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL XEROX OR PARC BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * ################################################################################
+ * #
+ * # PATENT NOTICE
+ * #
+ * # This software is distributed under the BSD 2-clause License (see LICENSE
+ * # file).  This BSD License does not make any patent claims and as such, does
+ * # not act as a patent grant.  The purpose of this section is for each contributor
+ * # to define their intentions with respect to intellectual property.
+ * #
+ * # Each contributor to this source code is encouraged to state their patent
+ * # claims and licensing mechanisms for any contributions made. At the end of
+ * # this section contributors may each make their own statements.  Contributor's
+ * # claims and grants only apply to the pieces (source code, programs, text,
+ * # media, etc) that they have contributed directly to this software.
+ * #
+ * # There is no guarantee that this section is complete, up to date or accurate. It
+ * # is up to the contributors to maintain their portion of this section and up to
+ * # the user of the software to verify any claims herein.
+ * #
+ * # Do not remove this header notification.  The contents of this section must be
+ * # present in all distributions of the software.  You may only modify your own
+ * # intellectual property statements.  Please provide contact information.
+ *
+ * - Palo Alto Research Center, Inc
+ * This software distribution does not grant any rights to patents owned by Palo
+ * Alto Research Center, Inc (PARC). Rights to these patents are available via
+ * various mechanisms. As of January 2016 PARC has committed to FRAND licensing any
+ * intellectual property used by its contributions to this software. You may
+ * contact PARC at cipo@parc.com for more information or visit http://www.ccnx.org
+ */
+/**
+ * @author Christopher A. Wood, Palo Alto Research Center (Xerox PARC)
+ * @copyright (c) 2016, Xerox Corporation (Xerox) and Palo Alto Research Center, Inc (PARC).  All rights reserved.
+ */
+#include <LongBow/runtime.h>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include <parc/algol/parc_Object.h>
+#include <parc/algol/parc_Memory.h>
+#include <parc/algol/parc_FileOutputStream.h>
+
+#include <parc/logging/parc_Log.h>
+#include <parc/logging/parc_LogReporterFile.h>
+
+#include "ccnxFileRepo_Common.h"
+#include "ccnxFileRepo_DigestIndex.h"
+#include "ccnxFileRepo_PackStore.h"
+#include "ccnxFileRepo_Rcu.h"
+
+const char *ccnxFileRepoPackStore_PackFileName = "chunks.pack";
+const char *ccnxFileRepoPackStore_IndexFileName = "chunks.idx";
+
+static const char _ccnxFileRepoPackStore_FileMagic[8] = { 'C', 'C', 'N', 'X', 'P', 'A', 'C', 'K' };
+static const uint32_t _ccnxFileRepoPackStore_Version = 1;
+static const uint32_t _ccnxFileRepoPackStore_RecordMagic = 0x4b504352; // "RCPK"
+
+/**
+ * Appends are collected in a buffer of this size before they are written out.
+ */
+static const size_t _ccnxFileRepoPackStore_WriteBufferSize = 1024 * 1024;
+
+/**
+ * Mappings are sized in multiples of this, so a growing packfile is remapped rarely.
+ * Only the address space is reserved; pages past the end of the file are never touched.
+ */
+static const size_t _ccnxFileRepoPackStore_MappingGranularity = 256 * 1024 * 1024;
+
+/**
+ * A read-only mapping of the packfile. Superseded mappings stay in the list, because views
+ * handed out earlier may still use them. They are unmapped by the compaction that replaces
+ * the packfile, once no view section that could hold one of those views is left, or by the
+ * destructor.
+ */
+typedef struct pack_mapping {
+    struct pack_mapping *previous;
+    uint8_t *base;
+    size_t length;
+} _PackMapping;
+
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t reserved;
+} _PackFileHeader;
+
+typedef struct {
+    uint32_t magic;
+    uint32_t length; // length of the wire format that follows the header
+    uint8_t digest[CCNxFileRepoDigestIndex_DigestLength];
+} _PackRecordHeader;
+
+struct ccnx_file_repo_pack_store {
+    PARCLog *log;
+    char *path;
+    char *indexPath;
+    int fd;
+
+    // Lookups and reads share the lock; appends, flushes and remapping hold it exclusively.
+    pthread_rwlock_t lock;
+
+    CCNxFileRepoDigestIndex *index;
+
+    uint8_t *writeBuffer;
+    size_t writeLength;
+    uint64_t flushedOffset; // everything before this offset is in the file
+
+    bool mapped;
+    _PackMapping *mapping; // the current (largest) mapping, or NULL
+
+    // Sections in which views of the mappings are used; see ccnxFileRepoPackStore_BeginViews
+    CCNxFileRepoRcu *viewers;
+};
+
+/**
+ * The state of a compaction: the packfile and index that replace the store's, while they
+ * are being written.
+ */
+typedef struct {
+    CCNxFileRepoPackStore *store;
+    char *path;
+    char *indexPath;
+    int fd;
+    CCNxFileRepoDigestIndex *index;
+
+    uint8_t *writeBuffer;
+    size_t writeLength;
+    uint64_t flushedOffset;
+
+    uint8_t *record; // holds one record read from the store
+    size_t recordCapacity;
+    bool failed;
+
+    _PackMapping *retired; // the mappings of the replaced packfile, unmapped once no view uses them
+} _PackCompaction;
+
+/**
+ * Create a PARCLog instance to log the request trace information.
+ */
+static PARCLog *
+_ccnxFileRepoPackStore_CreateLogger(void)
+{
+    PARCFileOutputStream *fileOutput = parcFileOutputStream_Create(dup(STDOUT_FILENO));
+    PARCOutputStream *output = parcFileOutputStream_AsOutputStream(fileOutput);
+    parcFileOutputStream_Release(&fileOutput);
+
+    PARCLogReporter *reporter = parcLogReporterFile_Create(output);
+    parcOutputStream_Release(&output);
+
+    PARCLog *log = parcLog_Create("localhost", "ccnxFileRepoPackStore", NULL, reporter);
+    parcLogReporter_Release(&reporter);
+
+    parcLog_SetLevel(log, PARCLogLevel_Info);
+    return log;
+}
+
+static bool
+_ccnxFileRepoPackStore_WriteFully(int fd, const void *data, size_t length, uint64_t offset)
+{
+    const uint8_t *bytes = data;
+    while (length > 0) {
+        ssize_t written = pwrite(fd, bytes, length, offset);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        bytes += written;
+        length -= written;
+        offset += written;
+    }
+    return true;
+}
+
+static bool
+_ccnxFileRepoPackStore_ReadFully(int fd, void *data, size_t length, uint64_t offset)
+{
+    uint8_t *bytes = data;
+    while (length > 0) {
+        ssize_t nread = pread(fd, bytes, length, offset);
+        if (nread < 0 && errno == EINTR) {
+            continue;
+        } else if (nread <= 0) {
+            return false;
+        }
+        bytes += nread;
+        length -= nread;
+        offset += nread;
+    }
+    return true;
+}
+
+/**
+ * Add the records from `offset` to the end of the file to the digest index, truncating an
+ * incomplete final record.
+ */
+static bool
+_ccnxFileRepoPackStore_Scan(CCNxFileRepoPackStore *store, uint64_t offset, uint64_t fileSize)
+{
+    while (offset + sizeof(_PackRecordHeader) <= fileSize) {
+        _PackRecordHeader header;
+        if (!_ccnxFileRepoPackStore_ReadFully(store->fd, &header, sizeof(header), offset)) {
+            return false;
+        }
+        if (header.magic != _ccnxFileRepoPackStore_RecordMagic || header.length == 0) {
+            parcLog_Error(store->log, "%s: corrupt record at offset %llu", store->path, (unsigned long long) offset);
+            return false;
+        }
+        uint64_t payloadOffset = offset + sizeof(_PackRecordHeader);
+        if (payloadOffset + header.length > fileSize) {
+            break;
+        }
+        ccnxFileRepoDigestIndex_Insert(store->index, header.digest, payloadOffset, header.length);
+        offset = payloadOffset + header.length;
+    }
+
+    if (offset < fileSize) {
+        parcLog_Warning(store->log, "%s: truncating %llu bytes of an incomplete record", store->path,
+                        (unsigned long long) (fileSize - offset));
+        if (ftruncate(store->fd, offset) != 0) {
+            return false;
+        }
+    }
+    store->flushedOffset = offset;
+    ccnxFileRepoDigestIndex_SetCoveredLength(store->index, offset);
+    return true;
+}
+
+/**
+ * Bring the persistent digest index up to date with the packfile. A cleanly closed index only
+ * needs the records appended after it was last written; anything else is rebuilt from scratch.
+ */
+static bool
+_ccnxFileRepoPackStore_LoadIndex(CCNxFileRepoPackStore *store, uint64_t fileSize)
+{
+    uint64_t covered = ccnxFileRepoDigestIndex_GetCoveredLength(store->index);
+    if (ccnxFileRepoDigestIndex_WasClean(store->index) && covered >= sizeof(_PackFileHeader) && covered <= fileSize) {
+        return _ccnxFileRepoPackStore_Scan(store, covered, fileSize);
+    }
+
+    parcLog_Info(store->log, "%s: rebuilding the digest index", store->path);
+    ccnxFileRepoDigestIndex_Clear(store->index);
+    return _ccnxFileRepoPackStore_Scan(store, sizeof(_PackFileHeader), fileSize);
+}
+
+/**
+ * Unmap and free `mapping` and the mappings it supersedes.
+ */
+static void
+_ccnxFileRepoPackStore_Unmap(_PackMapping *mapping)
+{
+    while (mapping != NULL) {
+        _PackMapping *previous = mapping->previous;
+        munmap(mapping->base, mapping->length);
+        parcMemory_Deallocate(&mapping);
+        mapping = previous;
+    }
+}
+
+static bool
+_ccnxFileRepoPackStore_Destructor(CCNxFileRepoPackStore **storePtr)
+{
+    CCNxFileRepoPackStore *store = *storePtr;
+
+    if (store->fd >= 0) {
+        // The index is marked clean when it is released, so the records it covers must be durable first.
+        ccnxFileRepoPackStore_Flush(store);
+        fsync(store->fd);
+        close(store->fd);
+    }
+    _ccnxFileRepoPackStore_Unmap(store->mapping);
+    store->mapping = NULL;
+    if (store->viewers != NULL) {
+        ccnxFileRepoRcu_Release(&store->viewers);
+    }
+    if (store->index != NULL) {
+        ccnxFileRepoDigestIndex_Release(&store->index);
+    }
+    parcMemory_Deallocate(&store->writeBuffer);
+    parcMemory_Deallocate(&store->path);
+    parcMemory_Deallocate(&store->indexPath);
+    parcLog_Release(&store->log);
+    pthread_rwlock_destroy(&store->lock);
+    return true;
+}
+
+parcObject_Override(CCNxFileRepoPackStore, PARCObject,
+                    .destructor = (PARCObjectDestructor *) _ccnxFileRepoPackStore_Destructor);
+
+parcObject_ImplementAcquire(ccnxFileRepoPackStore, CCNxFileRepoPackStore);
+parcObject_ImplementRelease(ccnxFileRepoPackStore, CCNxFileRepoPackStore);
+
+CCNxFileRepoPackStore *
+ccnxFileRepoPackStore_Open(const char *directory)
+{
+    CCNxFileRepoPackStore *store = parcObject_CreateAndClearInstance(CCNxFileRepoPackStore);
+    if (store == NULL) {
+        return NULL;
+    }
+
+    pthread_rwlock_init(&store->lock, NULL);
+    store->fd = -1;
+    store->viewers = ccnxFileRepoRcu_Create();
+    store->log = _ccnxFileRepoPackStore_CreateLogger();
+    store->path = parcMemory_Format("%s/%s", directory, ccnxFileRepoPackStore_PackFileName);
+    store->writeBuffer = parcMemory_Allocate(_ccnxFileRepoPackStore_WriteBufferSize);
+    store->writeLength = 0;
+
+    store->indexPath = parcMemory_Format("%s/%s", directory, ccnxFileRepoPackStore_IndexFileName);
+    store->index = ccnxFileRepoDigestIndex_Open(store->indexPath, 1024);
+    if (store->index == NULL) {
+        parcLog_Error(store->log, "%s/%s: %s", directory, ccnxFileRepoPackStore_IndexFileName, strerror(errno));
+        ccnxFileRepoPackStore_Release(&store);
+        return NULL;
+    }
+
+    store->fd = open(store->path, O_RDWR | O_CREAT, 0644);
+    if (store->fd < 0) {
+        parcLog_Error(store->log, "%s: %s", store->path, strerror(errno));
+        ccnxFileRepoPackStore_Release(&store);
+        return NULL;
+    }
+
+    struct stat statbuf;
+    bool valid = fstat(store->fd, &statbuf) == 0;
+    if (valid && statbuf.st_size == 0) {
+        _PackFileHeader header = { .version = _ccnxFileRepoPackStore_Version, .reserved = 0 };
+        memcpy(header.magic, _ccnxFileRepoPackStore_FileMagic, sizeof(header.magic));
+        valid = _ccnxFileRepoPackStore_WriteFully(store->fd, &header, sizeof(header), 0);
+        store->flushedOffset = sizeof(header);
+        ccnxFileRepoDigestIndex_Clear(store->index);
+        ccnxFileRepoDigestIndex_SetCoveredLength(store->index, store->flushedOffset);
+    } else if (valid) {
+        _PackFileHeader header;
+        valid = _ccnxFileRepoPackStore_ReadFully(store->fd, &header, sizeof(header), 0)
+                && memcmp(header.magic, _ccnxFileRepoPackStore_FileMagic, sizeof(header.magic)) == 0
+                && header.version == _ccnxFileRepoPackStore_Version
+                && _ccnxFileRepoPackStore_LoadIndex(store, statbuf.st_size);
+    }
+
+    if (!valid) {
+        parcLog_Error(store->log, "%s: not a valid packfile", store->path);
+        ccnxFileRepoPackStore_Release(&store);
+    }
+    return store;
+}
+
+static bool
+_ccnxFileRepoPackStore_Flush(CCNxFileRepoPackStore *store)
+{
+    if (store->writeLength == 0) {
+        return true;
+    }
+
+    bool result = _ccnxFileRepoPackStore_WriteFully(store->fd, store->writeBuffer, store->writeLength, store->flushedOffset);
+    if (result) {
+        store->flushedOffset += store->writeLength;
+        store->writeLength = 0;
+        ccnxFileRepoDigestIndex_SetCoveredLength(store->index, store->flushedOffset);
+    } else {
+        parcLog_Error(store->log, "%s: %s", store->path, strerror(errno));
+    }
+    return result;
+}
+
+bool
+ccnxFileRepoPackStore_Flush(CCNxFileRepoPackStore *store)
+{
+    pthread_rwlock_wrlock(&store->lock);
+    bool result = _ccnxFileRepoPackStore_Flush(store);
+    pthread_rwlock_unlock(&store->lock);
+    return result;
+}
+
+bool
+ccnxFileRepoPackStore_Sync(CCNxFileRepoPackStore *store)
+{
+    pthread_rwlock_wrlock(&store->lock);
+    bool result = _ccnxFileRepoPackStore_Flush(store) && fsync(store->fd) == 0;
+    result = ccnxFileRepoDigestIndex_Sync(store->index) && result;
+    pthread_rwlock_unlock(&store->lock);
+    return result;
+}
+
+static bool
+_ccnxFileRepoPackStore_Append(CCNxFileRepoPackStore *store, const void *data, size_t length)
+{
+    if (store->writeLength + length > _ccnxFileRepoPackStore_WriteBufferSize) {
+        if (!_ccnxFileRepoPackStore_Flush(store)) {
+            return false;
+        }
+    }
+
+    if (length > _ccnxFileRepoPackStore_WriteBufferSize) {
+        bool result = _ccnxFileRepoPackStore_WriteFully(store->fd, data, length, store->flushedOffset);
+        if (result) {
+            store->flushedOffset += length;
+        }
+        return result;
+    }
+
+    memcpy(store->writeBuffer + store->writeLength, data, length);
+    store->writeLength += length;
+    return true;
+}
+
+bool
+ccnxFileRepoPackStore_Contains(const CCNxFileRepoPackStore *store, const PARCBuffer *digest)
+{
+    if (parcBuffer_Remaining(digest) != CCNxFileRepoDigestIndex_DigestLength) {
+        return false;
+    }
+
+    uint64_t offset;
+    uint32_t length;
+    pthread_rwlock_rdlock((pthread_rwlock_t *) &store->lock);
+    bool result = ccnxFileRepoDigestIndex_Lookup(store->index, ccnxFileRepoCommon_GetBufferBytes(digest), &offset, &length);
+    pthread_rwlock_unlock((pthread_rwlock_t *) &store->lock);
+    return result;
+}
+
+static bool
+_ccnxFileRepoPackStore_Put(CCNxFileRepoPackStore *store, const PARCBuffer *digest, const PARCBuffer *wireFormat)
+{
+    uint64_t existingOffset;
+    uint32_t existingLength;
+    if (ccnxFileRepoDigestIndex_Lookup(store->index, ccnxFileRepoCommon_GetBufferBytes(digest), &existingOffset, &existingLength)) {
+        return false;
+    }
+
+    _PackRecordHeader header;
+    header.magic = _ccnxFileRepoPackStore_RecordMagic;
+    header.length = (uint32_t) parcBuffer_Remaining(wireFormat);
+    memcpy(header.digest, ccnxFileRepoCommon_GetBufferBytes(digest), sizeof(header.digest));
+
+    // Write the header and the message together so a record is never split by a flush.
+    uint64_t recordOffset = store->flushedOffset + store->writeLength;
+    if (store->writeLength + sizeof(header) + header.length > _ccnxFileRepoPackStore_WriteBufferSize) {
+        if (!_ccnxFileRepoPackStore_Flush(store)) {
+            return false;
+        }
+        recordOffset = store->flushedOffset;
+    }
+    if (!_ccnxFileRepoPackStore_Append(store, &header, sizeof(header))
+        || !_ccnxFileRepoPackStore_Append(store, ccnxFileRepoCommon_GetBufferBytes(wireFormat), header.length)) {
+        return false;
+    }
+
+    ccnxFileRepoDigestIndex_Insert(store->index, header.digest, recordOffset + sizeof(header), header.length);
+    return true;
+}
+
+bool
+ccnxFileRepoPackStore_Put(CCNxFileRepoPackStore *store, const PARCBuffer *digest, const PARCBuffer *wireFormat)
+{
+    if (parcBuffer_Remaining(digest) != CCNxFileRepoDigestIndex_DigestLength) {
+        return false;
+    }
+
+    pthread_rwlock_wrlock(&store->lock);
+    bool result = _ccnxFileRepoPackStore_Put(store, digest, wireFormat);
+    pthread_rwlock_unlock(&store->lock);
+    return result;
+}
+
+/**
+ * Make sure the current mapping covers the first `end` bytes of the packfile.
+ */
+static bool
+_ccnxFileRepoPackStore_EnsureMapped(CCNxFileRepoPackStore *store, uint64_t end)
+{
+    if (store->mapping != NULL && end <= store->mapping->length) {
+        return true;
+    }
+
+    size_t length = ((end / _ccnxFileRepoPackStore_MappingGranularity) + 1) * _ccnxFileRepoPackStore_MappingGranularity;
+    void *base = mmap(NULL, length, PROT_READ, MAP_SHARED, store->fd, 0);
+    if (base == MAP_FAILED) {
+        parcLog_Error(store->log, "%s: mmap of %zu bytes failed: %s", store->path, length, strerror(errno));
+        return false;
+    }
+
+    _PackMapping *mapping = parcMemory_Allocate(sizeof(_PackMapping));
+    mapping->base = base;
+    mapping->length = length;
+    mapping->previous = store->mapping;
+    store->mapping = mapping;
+    return true;
+}
+
+bool
+ccnxFileRepoPackStore_Map(CCNxFileRepoPackStore *store)
+{
+    pthread_rwlock_wrlock(&store->lock);
+    store->mapped = _ccnxFileRepoPackStore_EnsureMapped(store, store->flushedOffset);
+    bool result = store->mapped;
+    pthread_rwlock_unlock(&store->lock);
+    return result;
+}
+
+bool
+ccnxFileRepoPackStore_IsMapped(const CCNxFileRepoPackStore *store)
+{
+    return store->mapped;
+}
+
+size_t
+ccnxFileRepoPackStore_BeginViews(CCNxFileRepoPackStore *store)
+{
+    return ccnxFileRepoRcu_ReadLock(store->viewers);
+}
+
+void
+ccnxFileRepoPackStore_EndViews(CCNxFileRepoPackStore *store, size_t section)
+{
+    ccnxFileRepoRcu_ReadUnlock(store->viewers, section);
+}
+
+PARCBuffer *
+ccnxFileRepoPackStore_Get(CCNxFileRepoPackStore *store, const PARCBuffer *digest)
+{
+    if (parcBuffer_Remaining(digest) != CCNxFileRepoDigestIndex_DigestLength) {
+        return NULL;
+    }
+
+    uint64_t offset;
+    uint32_t length;
+    pthread_rwlock_rdlock(&store->lock);
+    if (!ccnxFileRepoDigestIndex_Lookup(store->index, ccnxFileRepoCommon_GetBufferBytes(digest), &offset, &length)) {
+        pthread_rwlock_unlock(&store->lock);
+        return NULL;
+    }
+
+    bool mappingTooShort = store->mapped && offset + length > store->mapping->length;
+    if (offset + length > store->flushedOffset || mappingTooShort) {
+        pthread_rwlock_unlock(&store->lock);
+        pthread_rwlock_wrlock(&store->lock);
+
+        // A compaction may have moved or dropped the record while the lock was released
+        if (!ccnxFileRepoDigestIndex_Lookup(store->index, ccnxFileRepoCommon_GetBufferBytes(digest), &offset, &length)) {
+            pthread_rwlock_unlock(&store->lock);
+            return NULL;
+        }
+        if (offset + length > store->flushedOffset) {
+            _ccnxFileRepoPackStore_Flush(store);
+        }
+        if (store->mapped) {
+            _ccnxFileRepoPackStore_EnsureMapped(store, offset + length);
+        }
+    }
+
+    PARCBuffer *result = NULL;
+    if (store->mapped && offset + length <= store->mapping->length) {
+        // The mapping is read-only; the view must never be written to.
+        result = parcBuffer_Wrap(store->mapping->base + offset, length, 0, length);
+    } else {
+        result = parcBuffer_Allocate(length);
+        if (!_ccnxFileRepoPackStore_ReadFully(store->fd, parcBuffer_Overlay(result, 0), length, offset)) {
+            parcLog_Error(store->log, "%s: short read of %u bytes at offset %llu", store->path, length, (unsigned long long) offset);
+            parcBuffer_Release(&result);
+        }
+    }
+    pthread_rwlock_unlock(&store->lock);
+    return result;
+}
+
+size_t
+ccnxFileRepoPackStore_GetCount(const CCNxFileRepoPackStore *store)
+{
+    pthread_rwlock_rdlock((pthread_rwlock_t *) &store->lock);
+    size_t result = ccnxFileRepoDigestIndex_GetCount(store->index);
+    pthread_rwlock_unlock((pthread_rwlock_t *) &store->lock);
+    return result;
+}
+
+bool
+ccnxFileRepoPackStore_AddReferences(CCNxFileRepoPackStore *store, const PARCBuffer *digest, int32_t delta)
+{
+    if (parcBuffer_Remaining(digest) != CCNxFileRepoDigestIndex_DigestLength) {
+        return false;
+    }
+
+    pthread_rwlock_wrlock(&store->lock);
+    bool result = ccnxFileRepoDigestIndex_AddReferences(store->index, ccnxFileRepoCommon_GetBufferBytes(digest), delta, NULL);
+    pthread_rwlock_unlock(&store->lock);
+    return result;
+}
+
+bool
+ccnxFileRepoPackStore_HasReferenceCounts(const CCNxFileRepoPackStore *store)
+{
+    pthread_rwlock_rdlock((pthread_rwlock_t *) &store->lock);
+    bool result = ccnxFileRepoDigestIndex_HasReferenceCounts(store->index);
+    pthread_rwlock_unlock((pthread_rwlock_t *) &store->lock);
+    return result;
+}
+
+void
+ccnxFileRepoPackStore_ClearReferences(CCNxFileRepoPackStore *store)
+{
+    pthread_rwlock_wrlock(&store->lock);
+    ccnxFileRepoDigestIndex_ClearReferences(store->index);
+    pthread_rwlock_unlock(&store->lock);
+}
+
+void
+ccnxFileRepoPackStore_SetHasReferenceCounts(CCNxFileRepoPackStore *store)
+{
+    pthread_rwlock_wrlock(&store->lock);
+    ccnxFileRepoDigestIndex_SetHasReferenceCounts(store->index, true);
+    pthread_rwlock_unlock(&store->lock);
+}
+
+static bool
+_ccnxFileRepoPackStore_CompactionFlush(_PackCompaction *compaction)
+{
+    if (!compaction->failed && compaction->writeLength > 0) {
+        compaction->failed = !_ccnxFileRepoPackStore_WriteFully(compaction->fd, compaction->writeBuffer,
+                                                                compaction->writeLength, compaction->flushedOffset);
+        compaction->flushedOffset += compaction->writeLength;
+        compaction->writeLength = 0;
+    }
+    return !compaction->failed;
+}
+
+/**
+ * Copy the record at `offset` in the store's packfile to the compacted packfile.
+ */
+static void
+_ccnxFileRepoPackStore_CompactionCopy(_PackCompaction *compaction, const uint8_t *digest, uint64_t offset, uint32_t length)
+{
+    if (compaction->failed) {
+        return;
+    }
+
+    _PackRecordHeader header;
+    header.magic = _ccnxFileRepoPackStore_RecordMagic;
+    header.length = length;
+    memcpy(header.digest, digest, sizeof(header.digest));
+
+    size_t recordLength = sizeof(header) + length;
+    if (recordLength > compaction->recordCapacity) {
+        parcMemory_Deallocate(&compaction->record);
+        compaction->record = parcMemory_Allocate(recordLength);
+        compaction->recordCapacity = recordLength;
+    }
+    memcpy(compaction->record, &header, sizeof(header));
+    if (!_ccnxFileRepoPackStore_ReadFully(compaction->store->fd, compaction->record + sizeof(header), length, offset)) {
+        compaction->failed = true;
+        return;
+    }
+
+    if (compaction->writeLength + recordLength > _ccnxFileRepoPackStore_WriteBufferSize
+        && !_ccnxFileRepoPackStore_CompactionFlush(compaction)) {
+        return;
+    }
+    uint64_t recordOffset = compaction->flushedOffset + compaction->writeLength;
+    if (recordLength > _ccnxFileRepoPackStore_WriteBufferSize) {
+        compaction->failed = !_ccnxFileRepoPackStore_WriteFully(compaction->fd, compaction->record, recordLength, recordOffset);
+        compaction->flushedOffset += recordLength;
+    } else {
+        memcpy(compaction->writeBuffer + compaction->writeLength, compaction->record, recordLength);
+        compaction->writeLength += recordLength;
+    }
+    ccnxFileRepoDigestIndex_Insert(compaction->index, digest, recordOffset + sizeof(header), length);
+}
+
+/**
+ * Copy the live records of the first `end` bytes of the packfile, in file order. This runs
+ * without the store's lock, except to read each reference count, so the store keeps serving
+ * and accepting records meanwhile.
+ */
+static void
+_ccnxFileRepoPackStore_CompactionScan(_PackCompaction *compaction, uint64_t end)
+{
+    CCNxFileRepoPackStore *store = compaction->store;
+    uint64_t offset = sizeof(_PackFileHeader);
+    while (!compaction->failed && offset + sizeof(_PackRecordHeader) <= end) {
+        _PackRecordHeader header;
+        if (!_ccnxFileRepoPackStore_ReadFully(store->fd, &header, sizeof(header), offset)) {
+            compaction->failed = true;
+            break;
+        }
+        uint64_t payloadOffset = offset + sizeof(header);
+
+        uint64_t indexedOffset;
+        uint32_t indexedLength;
+        pthread_rwlock_rdlock(&store->lock);
+        // A record the index does not point at is a stale duplicate left by an index rebuild.
+        bool live = ccnxFileRepoDigestIndex_Lookup(store->index, header.digest, &indexedOffset, &indexedLength)
+                    && indexedOffset == payloadOffset
+                    && ccnxFileRepoDigestIndex_GetReferences(store->index, header.digest) > 0;
+        pthread_rwlock_unlock(&store->lock);
+
+        if (live) {
+            _ccnxFileRepoPackStore_CompactionCopy(compaction, header.digest, payloadOffset, header.length);
+        }
+        offset = payloadOffset + header.length;
+    }
+}
+
+/**
+ * Bring the compacted packfile up to date with the store; a `CCNxFileRepoDigestIndexVisitor`
+ * called with the store's lock held. Records that were appended or referenced again during the
+ * scan are copied now, and every copied record takes the current reference count.
+ */
+static void
+_ccnxFileRepoPackStore_CompactionCatchUp(void *context, const uint8_t *digest, uint64_t offset, uint32_t length,
+                                         uint32_t references)
+{
+    _PackCompaction *compaction = context;
+
+    uint64_t copiedOffset;
+    uint32_t copiedLength;
+    bool copied = ccnxFileRepoDigestIndex_Lookup(compaction->index, digest, &copiedOffset, &copiedLength);
+    if (!copied && references > 0) {
+        _ccnxFileRepoPackStore_CompactionCopy(compaction, digest, offset, length);
+        copied = !compaction->failed;
+    }
+    if (copied && references > 0) {
+        ccnxFileRepoDigestIndex_AddReferences(compaction->index, digest, (int32_t) references, NULL);
+    }
+}
+
+/**
+ * Replace the store's packfile and index with the compacted ones. Called with the store's
+ * lock held, once every live record has been copied.
+ */
+static bool
+_ccnxFileRepoPackStore_CompactionInstall(_PackCompaction *compaction)
+{
+    CCNxFileRepoPackStore *store = compaction->store;
+    if (!_ccnxFileRepoPackStore_CompactionFlush(compaction) || fsync(compaction->fd) != 0) {
+        return false;
+    }
+
+    ccnxFileRepoDigestIndex_SetCoveredLength(compaction->index, compaction->flushedOffset);
+    ccnxFileRepoDigestIndex_SetHasReferenceCounts(compaction->index, ccnxFileRepoDigestIndex_HasReferenceCounts(store->index));
+    if (!ccnxFileRepoDigestIndex_Sync(compaction->index)) {
+        return false;
+    }
+
+    // The new index goes first: it is not marked clean, so if only it is in place after a
+    // crash, the next open rebuilds it from whichever packfile it finds.
+    if (!ccnxFileRepoDigestIndex_Rename(compaction->index, store->indexPath)) {
+        return false;
+    }
+    if (rename(compaction->path, store->path) != 0) {
+        // The store keeps its packfile, so it must not find the compacted index next to it.
+        unlink(store->indexPath);
+        return false;
+    }
+
+    close(store->fd);
+    store->fd = compaction->fd;
+    compaction->fd = -1;
+    ccnxFileRepoDigestIndex_Release(&store->index);
+    store->index = compaction->index;
+    compaction->index = NULL;
+    store->flushedOffset = compaction->flushedOffset;
+
+    // Views of the old packfile may still be in use, so its mappings are unmapped later
+    compaction->retired = store->mapping;
+    store->mapping = NULL;
+    if (store->mapped) {
+        store->mapped = _ccnxFileRepoPackStore_EnsureMapped(store, store->flushedOffset);
+    }
+    return true;
+}
+
+bool
+ccnxFileRepoPackStore_Compact(CCNxFileRepoPackStore *store)
+{
+    _PackCompaction compaction;
+    memset(&compaction, 0, sizeof(compaction));
+    compaction.store = store;
+    compaction.fd = -1;
+    compaction.path = parcMemory_Format("%s.compact", store->path);
+    compaction.indexPath = parcMemory_Format("%s.compact", store->indexPath);
+    compaction.writeBuffer = parcMemory_Allocate(_ccnxFileRepoPackStore_WriteBufferSize);
+
+    pthread_rwlock_wrlock(&store->lock);
+    bool counted = ccnxFileRepoDigestIndex_HasReferenceCounts(store->index);
+    bool flushed = _ccnxFileRepoPackStore_Flush(store);
+    uint64_t scanEnd = store->flushedOffset;
+    size_t count = ccnxFileRepoDigestIndex_GetCount(store->index);
+    pthread_rwlock_unlock(&store->lock);
+
+    bool result = false;
+    if (!counted) {
+        parcLog_Warning(store->log, "%s: not compacting without complete reference counts", store->path);
+    } else if (flushed) {
+        unlink(compaction.indexPath);
+        compaction.fd = open(compaction.path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+        compaction.index = ccnxFileRepoDigestIndex_Open(compaction.indexPath, count);
+        compaction.failed = compaction.fd < 0 || compaction.index == NULL;
+
+        _PackFileHeader header = { .version = _ccnxFileRepoPackStore_Version, .reserved = 0 };
+        memcpy(header.magic, _ccnxFileRepoPackStore_FileMagic, sizeof(header.magic));
+        compaction.failed = compaction.failed || !_ccnxFileRepoPackStore_WriteFully(compaction.fd, &header, sizeof(header), 0);
+        compaction.flushedOffset = sizeof(header);
+
+        _ccnxFileRepoPackStore_CompactionScan(&compaction, scanEnd);
+
+        // Only the catch-up and the switch to the new files hold up readers and writers.
+        pthread_rwlock_wrlock(&store->lock);
+        uint64_t previousLength = store->flushedOffset + store->writeLength;
+        if (!compaction.failed && _ccnxFileRepoPackStore_Flush(store)) {
+            ccnxFileRepoDigestIndex_ForEach(store->index, _ccnxFileRepoPackStore_CompactionCatchUp, &compaction);
+            result = !compaction.failed && _ccnxFileRepoPackStore_CompactionInstall(&compaction);
+        }
+        pthread_rwlock_unlock(&store->lock);
+
+        // The replaced packfile keeps its disk space for as long as it is mapped, so the mappings
+        // go as soon as every view section that could have read from them has ended.
+        if (compaction.retired != NULL) {
+            ccnxFileRepoRcu_Synchronize(store->viewers);
+            _ccnxFileRepoPackStore_Unmap(compaction.retired);
+        }
+
+        if (result) {
+            parcLog_Info(store->log, "%s: compacted %llu bytes to %llu", store->path,
+                         (unsigned long long) previousLength, (unsigned long long) compaction.flushedOffset);
+        } else {
+            parcLog_Error(store->log, "%s: compaction failed: %s", store->path, strerror(errno));
+        }
+    }
+
+    if (compaction.fd >= 0 && !result) {
+        close(compaction.fd);
+    }
+    if (compaction.index != NULL) {
+        ccnxFileRepoDigestIndex_Release(&compaction.index);
+    }
+    if (!result) {
+        unlink(compaction.path);
+        unlink(compaction.indexPath);
+    }
+    if (compaction.record != NULL) {
+        parcMemory_Deallocate(&compaction.record);
+    }
+    parcMemory_Deallocate(&compaction.writeBuffer);
+    parcMemory_Deallocate(&compaction.path);
+    parcMemory_Deallocate(&compaction.indexPath);
+    return result;
+}
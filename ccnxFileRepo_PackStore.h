@@ -0,0 +1,332 @@
+/*
+ * Copyright (c) 2016, Xerox Corporation (Xerox) and Palo Alto Research Center, Inc (PARC)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL XEROX OR PARC BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * ################################################################################
+ * #
+ * # PATENT NOTICE
+ * #
+ * # This software is distributed under the BSD 2-clause License (see LICENSE
+ * # file).  This BSD License does not make any patent claims and as such, does
+ * # not act as a patent grant.  The purpose of this section is for each contributor
+ * # to define their intentions with respect to intellectual property.
+ * #
+ * # Each contributor to this source code is encouraged to state their patent
+ * # claims and licensing mechanisms for any contributions made. At the end of
+ * # this section contributors may each make their own statements.  Contributor's
+ * # claims and grants only apply to the pieces (source code, programs, text,
+ * # media, etc) that they have contributed directly to this software.
+ * #
+ * # There is no guarantee that this section is complete, up to date or accurate. It
+ * # is up to the contributors to maintain their portion of this section and up to
+ * # the user of the software to verify any claims herein.
+ * #
+ * # Do not remove this header notification.  The contents of this section must be
+ * # present in all distributions of the software.  You may only modify your own
+ * # intellectual property statements.  Please provide contact information.
+ *
+ * - Palo Alto Research Center, Inc
+ * This software distribution does not grant any rights to patents owned by Palo
+ * Alto Research Center, Inc (PARC). Rights to these patents are available via
+ * various mechanisms. As of January 2016 PARC has committed to FRAND licensing any
+ * intellectual property used by its contributions to this software. You may
+ * contact PARC at cipo@parc.com for more information or visit http://www.ccnx.org
+ */
+/**
+ * @author Christopher A. Wood, Palo Alto Research Center (Xerox PARC)
+ * @copyright (c) 2016, Xerox Corporation (Xerox) and Palo Alto Research Center, Inc (PARC).  All rights reserved.
+ */
+
+#ifndef ccnxFileRepoPackStore_h
+#define ccnxFileRepoPackStore_h
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include <parc/algol/parc_Buffer.h>
+
+struct ccnx_file_repo_pack_store;
+typedef struct ccnx_file_repo_pack_store CCNxFileRepoPackStore;
+
+/**
+ * The name of the packfile inside a repo directory.
+ */
+extern const char *ccnxFileRepoPackStore_PackFileName;
+
+/**
+ * The name of the persistent digest index of the packfile inside a repo directory.
+ */
+extern const char *ccnxFileRepoPackStore_IndexFileName;
+
+/**
+ * Open (creating it if needed) the packfile in the given repo directory.
+ *
+ * A packfile holds wire-encoded messages back to back, each preceded by a small header
+ * carrying its ContentObjectHash digest and length. Records are only ever appended, and
+ * space is only reclaimed by `ccnxFileRepoPackStore_Compact`, which rewrites the packfile.
+ * A `CCNxFileRepoPackStore` may be used from several threads; reads proceed in parallel.
+ * The digest index is kept next to the packfile and mapped when the packfile is opened, so
+ * only records appended since it was last written are read. If the index is missing or was
+ * not closed cleanly it is rebuilt from the record headers. A record left incomplete by a
+ * crash during an append is truncated away.
+ *
+ * @param [in] directory The repo directory.
+ *
+ * @retval NULL The packfile could not be opened or is not a valid packfile.
+ * @retval CCNxFileRepoPackStore A new `CCNxFileRepoPackStore` instance.
+ *
+ * Example:
+ * @code
+ * {
+ *     CCNxFileRepoPackStore *store = ccnxFileRepoPackStore_Open("/path/to/repo");
+ * }
+ * @endcode
+ */
+CCNxFileRepoPackStore *ccnxFileRepoPackStore_Open(const char *directory);
+
+/**
+ * Increase the number of references to a `CCNxFileRepoPackStore` instance.
+ *
+ * @param [in] instance A pointer to a valid CCNxFileRepoPackStore instance.
+ *
+ * @return The same value as @p instance.
+ */
+CCNxFileRepoPackStore *ccnxFileRepoPackStore_Acquire(const CCNxFileRepoPackStore *instance);
+
+/**
+ * Release a previously acquired reference to the given `CCNxFileRepoPackStore` instance,
+ * decrementing the reference count for the instance. Pending appends are flushed and the
+ * packfile is closed when the last reference is released.
+ *
+ * The pointer to the instance is set to NULL as a side-effect of this function.
+ *
+ * @param [in,out] instancePtr A pointer to a pointer to the instance to release.
+ */
+void ccnxFileRepoPackStore_Release(CCNxFileRepoPackStore **instancePtr);
+
+/**
+ * Serve reads from a read-only memory mapping of the packfile instead of copying each
+ * message out of the file.
+ *
+ * Once mapped, `ccnxFileRepoPackStore_Get` returns `PARCBuffer` views that wrap the mapped
+ * bytes directly. When the packfile grows past the mapped region a larger mapping is
+ * created, but earlier mappings are only unmapped when the store is destroyed, so a view
+ * stays valid for as long as the store does. Views must therefore be released before the
+ * last reference to the store.
+ *
+ * @param [in] store The `CCNxFileRepoPackStore` instance.
+ *
+ * @return true The packfile is mapped.
+ * @return false The packfile could not be mapped; reads keep copying from the file.
+ *
+ * Example:
+ * @code
+ * {
+ *     CCNxFileRepoPackStore *store = ccnxFileRepoPackStore_Open("/path/to/repo");
+ *     ccnxFileRepoPackStore_Map(store);
+ * }
+ * @endcode
+ */
+bool ccnxFileRepoPackStore_Map(CCNxFileRepoPackStore *store);
+
+/**
+ * Determine if reads are served from a memory mapping of the packfile.
+ *
+ * @param [in] store The `CCNxFileRepoPackStore` instance.
+ *
+ * @return true `ccnxFileRepoPackStore_Get` returns views of the mapped packfile.
+ * @return false `ccnxFileRepoPackStore_Get` returns copies read from the packfile.
+ */
+bool ccnxFileRepoPackStore_IsMapped(const CCNxFileRepoPackStore *store);
+
+/**
+ * Determine if a message with the given digest is in the packfile.
+ *
+ * @param [in] store The `CCNxFileRepoPackStore` instance.
+ * @param [in] digest The ContentObjectHash digest of the message.
+ *
+ * @return true The message is stored.
+ * @return false The message is not stored.
+ */
+bool ccnxFileRepoPackStore_Contains(const CCNxFileRepoPackStore *store, const PARCBuffer *digest);
+
+/**
+ * Append a wire-encoded message to the packfile. Appends are buffered in memory and
+ * written out in large batches, either when the buffer fills, by
+ * `ccnxFileRepoPackStore_Flush`, or when a buffered record is read back.
+ *
+ * @param [in] store The `CCNxFileRepoPackStore` instance.
+ * @param [in] digest The ContentObjectHash digest of the message.
+ * @param [in] wireFormat The wire-encoded message.
+ *
+ * @return true The message was appended.
+ * @return false The message was already stored, or could not be written.
+ *
+ * Example:
+ * @code
+ * {
+ *     ccnxFileRepoPackStore_Put(store, digest, wireFormat);
+ *     ccnxFileRepoPackStore_Flush(store);
+ * }
+ * @endcode
+ */
+bool ccnxFileRepoPackStore_Put(CCNxFileRepoPackStore *store, const PARCBuffer *digest, const PARCBuffer *wireFormat);
+
+/**
+ * Enter a section in which views of the mapped packfile may be used. A compaction unmaps the
+ * packfile it replaced once every section entered before the switch has ended, so a view
+ * returned by `ccnxFileRepoPackStore_Get` must be read in a section, and released before the
+ * section ends. Sections should be short, e.g., long enough to answer one interest.
+ *
+ * @param [in] store The `CCNxFileRepoPackStore` instance.
+ *
+ * @return The section entered, to pass to `ccnxFileRepoPackStore_EndViews`.
+ *
+ * Example:
+ * @code
+ * {
+ *     size_t section = ccnxFileRepoPackStore_BeginViews(store);
+ *     PARCBuffer *wireFormat = ccnxFileRepoPackStore_Get(store, digest);
+ *     // send wireFormat
+ *     parcBuffer_Release(&wireFormat);
+ *     ccnxFileRepoPackStore_EndViews(store, section);
+ * }
+ * @endcode
+ */
+size_t ccnxFileRepoPackStore_BeginViews(CCNxFileRepoPackStore *store);
+
+/**
+ * End the section entered by `ccnxFileRepoPackStore_BeginViews`.
+ *
+ * @param [in] store The `CCNxFileRepoPackStore` instance.
+ * @param [in] section The section returned by `ccnxFileRepoPackStore_BeginViews`.
+ */
+void ccnxFileRepoPackStore_EndViews(CCNxFileRepoPackStore *store, size_t section);
+
+/**
+ * Read the wire-encoded message with the given digest, with a single positioned read.
+ * If the packfile is mapped, no read is made and the result is a view of the mapping, which
+ * is only valid inside the section of `ccnxFileRepoPackStore_BeginViews` it was read in.
+ *
+ * @param [in] store The `CCNxFileRepoPackStore` instance.
+ * @param [in] digest The ContentObjectHash digest of the message.
+ *
+ * @retval NULL The message is not stored.
+ * @retval PARCBuffer A buffer holding the message, which must be released by calling `parcBuffer_Release`.
+ */
+PARCBuffer *ccnxFileRepoPackStore_Get(CCNxFileRepoPackStore *store, const PARCBuffer *digest);
+
+/**
+ * Write out all buffered appends.
+ *
+ * @param [in] store The `CCNxFileRepoPackStore` instance.
+ *
+ * @return true All appends reached the packfile.
+ * @return false A write failed.
+ */
+bool ccnxFileRepoPackStore_Flush(CCNxFileRepoPackStore *store);
+
+/**
+ * Write out all buffered appends and wait until they, and the digest index, are on stable storage.
+ *
+ * @param [in] store The `CCNxFileRepoPackStore` instance.
+ *
+ * @return true All appends are durable.
+ * @return false A write or a sync failed.
+ */
+bool ccnxFileRepoPackStore_Sync(CCNxFileRepoPackStore *store);
+
+/**
+ * Add `delta` to the number of references to the message with the given digest.
+ *
+ * The counts are kept in the digest index, next to the location of each message, and are
+ * written out with it. A message with no references is reclaimed by
+ * `ccnxFileRepoPackStore_Compact`, so whoever stores messages must count every reference it
+ * keeps to them.
+ *
+ * @param [in] store The `CCNxFileRepoPackStore` instance.
+ * @param [in] digest The ContentObjectHash digest of the message.
+ * @param [in] delta The change of the reference count, which never goes below 0.
+ *
+ * @return true The message is stored.
+ * @return false The message is not stored, and nothing was changed.
+ */
+bool ccnxFileRepoPackStore_AddReferences(CCNxFileRepoPackStore *store, const PARCBuffer *digest, int32_t delta);
+
+/**
+ * Determine if the reference counts of the store are complete. They are not when the digest
+ * index was created or rebuilt when the store was opened, e.g., after a crash; the owner of
+ * the references must then count them again and call `ccnxFileRepoPackStore_SetHasReferenceCounts`.
+ *
+ * @param [in] store The `CCNxFileRepoPackStore` instance.
+ */
+bool ccnxFileRepoPackStore_HasReferenceCounts(const CCNxFileRepoPackStore *store);
+
+/**
+ * Set every reference count to 0 before counting the references again.
+ *
+ * @param [in] store The `CCNxFileRepoPackStore` instance.
+ */
+void ccnxFileRepoPackStore_ClearReferences(CCNxFileRepoPackStore *store);
+
+/**
+ * Record that every reference has been counted, which allows compaction.
+ *
+ * @param [in] store The `CCNxFileRepoPackStore` instance.
+ */
+void ccnxFileRepoPackStore_SetHasReferenceCounts(CCNxFileRepoPackStore *store);
+
+/**
+ * Reclaim the space of the messages that have no references, by copying the others to a new
+ * packfile and index that then replace the old ones.
+ *
+ * The copy runs while the store is in use: reads and appends go on as usual, and only the
+ * final step, which copies what changed during the copy and switches to the new files, holds
+ * them up. The old packfile is unmapped, and its space freed, once every section of
+ * `ccnxFileRepoPackStore_BeginViews` entered before the switch has ended; the compaction
+ * waits for that, so it must not be called inside such a section. Only one compaction may
+ * run at a time, and none runs while the reference counts are incomplete.
+ *
+ * @param [in] store The `CCNxFileRepoPackStore` instance.
+ *
+ * @return true The store was compacted.
+ * @return false The store was left as it was.
+ *
+ * Example:
+ * @code
+ * {
+ *     if (ccnxFileRepoPackStore_HasReferenceCounts(store)) {
+ *         ccnxFileRepoPackStore_Compact(store);
+ *     }
+ * }
+ * @endcode
+ */
+bool ccnxFileRepoPackStore_Compact(CCNxFileRepoPackStore *store);
+
+/**
+ * Return the number of messages in the packfile.
+ *
+ * @param [in] store The `CCNxFileRepoPackStore` instance.
+ */
+size_t ccnxFileRepoPackStore_GetCount(const CCNxFileRepoPackStore *store);
+#endif // ccnxFileRepoPackStore_h
@@ -0,0 +1,289 @@
+/*
+ * Copyright (c) 2016, Xerox Corporation (Xerox) and Palo Alto Research Center, Inc (PARC)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL XEROX OR PARC BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * ################################################################################
+ * #
+ * # PATENT NOTICE
+ * #
+ * # This software is distributed under the BSD 2-clause License (see LICENSE
+ * # file).  This BSD License does not make any patent claims and as such, does
+ * # not act as a patent grant.  The purpose of this section is for each contributor
+ * # to define their intentions with respect to intellectual property.
+ * #
+ * # Each contributor to this source code is encouraged to state their patent
+ * # claims and licensing mechanisms for any contributions made. At the end of
+ * # this section contributors may each make their own statements.  Contributor's
+ * # claims and grants only apply to the pieces (source code, programs, text,
+ * # media, etc) that they have contributed directly to this software.
+ * #
+ * # There is no guarantee that this section is complete, up to date or accurate. It
+ * # is up to the contributors to maintain their portion of this section and up to
+ * # the user of the software to verify any claims herein.
+ * #
+ * # Do not remove this header notification.  The contents of this section must be
+ * # present in all distributions of the software.  You may only modify your own
+ * # intellectual property statements.  Please provide contact information.
+ *
+ * - Palo Alto Research Center, Inc
+ * This software distribution does not grant any rights to patents owned by Palo
+ * Alto Research Center, Inc (PARC). Rights to these patents are available via
+ * various mechanisms. As of January 2016 PARC has committed to FRAND licensing any
+ * intellectual property used by its contributions to this software. You may
+ * contact PARC at cipo@parc.com for more information or visit http://www.ccnx.org
+ */
+/**
+ * @author Christopher A. Wood, Palo Alto Research Center (Xerox PARC)
+ * @copyright (c) 2016, Xerox Corporation (Xerox) and Palo Alto Research Center, Inc (PARC).  All rights reserved.
+ */
+#include <LongBow/runtime.h>
+
+#include <stdint.h>
+#include <pthread.h>
+
+#include <parc/algol/parc_Object.h>
+#include <parc/algol/parc_Memory.h>
+
+#include "ccnxFileRepo_Queue.h"
+
+/**
+ * Number of failed attempts before a blocking call goes to sleep.
+ */
+static const int _ccnxFileRepoQueue_SpinCount = 64;
+
+/**
+ * A cell is free for the producer at position p when its sequence is p, and holds an item
+ * for the consumer at position p when its sequence is p + 1 (D. Vyukov's bounded MPMC queue).
+ */
+typedef struct {
+    size_t sequence;
+    void *item;
+} _QueueCell;
+
+struct ccnx_file_repo_queue {
+    _QueueCell *cells;
+    size_t mask;
+
+    // Producers and consumers each update their own position, on separate cache lines.
+    size_t enqueuePosition __attribute__((aligned(64)));
+    size_t dequeuePosition __attribute__((aligned(64)));
+
+    // Only used to sleep and to wake sleepers.
+    pthread_mutex_t lock __attribute__((aligned(64)));
+    pthread_cond_t notEmpty;
+    pthread_cond_t notFull;
+    size_t emptyWaiters;
+    size_t fullWaiters;
+    bool closed;
+};
+
+static bool
+_ccnxFileRepoQueue_Destructor(CCNxFileRepoQueue **queuePtr)
+{
+    CCNxFileRepoQueue *queue = *queuePtr;
+    parcMemory_Deallocate(&queue->cells);
+    pthread_cond_destroy(&queue->notFull);
+    pthread_cond_destroy(&queue->notEmpty);
+    pthread_mutex_destroy(&queue->lock);
+    return true;
+}
+
+parcObject_Override(CCNxFileRepoQueue, PARCObject,
+                    .destructor = (PARCObjectDestructor *) _ccnxFileRepoQueue_Destructor);
+
+parcObject_ImplementAcquire(ccnxFileRepoQueue, CCNxFileRepoQueue);
+parcObject_ImplementRelease(ccnxFileRepoQueue, CCNxFileRepoQueue);
+
+CCNxFileRepoQueue *
+ccnxFileRepoQueue_Create(size_t capacity)
+{
+    CCNxFileRepoQueue *queue = parcObject_CreateAndClearInstance(CCNxFileRepoQueue);
+    if (queue != NULL) {
+        size_t cellCount = 2;
+        while (cellCount < capacity) {
+            cellCount *= 2;
+        }
+
+        queue->cells = parcMemory_Allocate(cellCount * sizeof(_QueueCell));
+        assertNotNull(queue->cells, "parcMemory_Allocate(%zu) returned NULL", cellCount * sizeof(_QueueCell));
+        for (size_t i = 0; i < cellCount; i++) {
+            queue->cells[i].sequence = i;
+            queue->cells[i].item = NULL;
+        }
+        queue->mask = cellCount - 1;
+        queue->enqueuePosition = 0;
+        queue->dequeuePosition = 0;
+
+        pthread_mutex_init(&queue->lock, NULL);
+        pthread_cond_init(&queue->notEmpty, NULL);
+        pthread_cond_init(&queue->notFull, NULL);
+        queue->emptyWaiters = 0;
+        queue->fullWaiters = 0;
+        queue->closed = false;
+    }
+    return queue;
+}
+
+bool
+ccnxFileRepoQueue_TryPut(CCNxFileRepoQueue *queue, void *item)
+{
+    assertNotNull(item, "A NULL item cannot be queued");
+
+    size_t position = __atomic_load_n(&queue->enqueuePosition, __ATOMIC_RELAXED);
+    _QueueCell *cell;
+    while (true) {
+        cell = &queue->cells[position & queue->mask];
+        size_t sequence = __atomic_load_n(&cell->sequence, __ATOMIC_ACQUIRE);
+        intptr_t difference = (intptr_t) sequence - (intptr_t) position;
+        if (difference == 0) {
+            if (__atomic_compare_exchange_n(&queue->enqueuePosition, &position, position + 1, true,
+                                            __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+                break;
+            }
+        } else if (difference < 0) {
+            return false; // the consumer one lap behind has not emptied this cell yet
+        } else {
+            position = __atomic_load_n(&queue->enqueuePosition, __ATOMIC_RELAXED);
+        }
+    }
+
+    cell->item = item;
+    __atomic_store_n(&cell->sequence, position + 1, __ATOMIC_RELEASE);
+    return true;
+}
+
+void *
+ccnxFileRepoQueue_TryGet(CCNxFileRepoQueue *queue)
+{
+    size_t position = __atomic_load_n(&queue->dequeuePosition, __ATOMIC_RELAXED);
+    _QueueCell *cell;
+    while (true) {
+        cell = &queue->cells[position & queue->mask];
+        size_t sequence = __atomic_load_n(&cell->sequence, __ATOMIC_ACQUIRE);
+        intptr_t difference = (intptr_t) sequence - (intptr_t) (position + 1);
+        if (difference == 0) {
+            if (__atomic_compare_exchange_n(&queue->dequeuePosition, &position, position + 1, true,
+                                            __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+                break;
+            }
+        } else if (difference < 0) {
+            return NULL; // empty
+        } else {
+            position = __atomic_load_n(&queue->dequeuePosition, __ATOMIC_RELAXED);
+        }
+    }
+
+    void *item = cell->item;
+    __atomic_store_n(&cell->sequence, position + queue->mask + 1, __ATOMIC_RELEASE);
+    return item;
+}
+
+/**
+ * Wake one thread sleeping on `condition`, if any. The fence orders the preceding queue update
+ * before the check of `waiters`, pairing with the fence in `_ccnxFileRepoQueue_Sleep`: either the
+ * sleeper sees the update or this thread sees the sleeper.
+ */
+static void
+_ccnxFileRepoQueue_Wake(CCNxFileRepoQueue *queue, size_t *waiters, pthread_cond_t *condition)
+{
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    if (__atomic_load_n(waiters, __ATOMIC_RELAXED) > 0) {
+        pthread_mutex_lock(&queue->lock);
+        pthread_cond_signal(condition);
+        pthread_mutex_unlock(&queue->lock);
+    }
+}
+
+/**
+ * Register as a waiter; must be called with the lock held, before the final retry.
+ */
+static void
+_ccnxFileRepoQueue_Sleep(size_t *waiters)
+{
+    __atomic_add_fetch(waiters, 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+}
+
+bool
+ccnxFileRepoQueue_Put(CCNxFileRepoQueue *queue, void *item)
+{
+    bool added = false;
+    for (int i = 0; !added && i < _ccnxFileRepoQueue_SpinCount; i++) {
+        added = ccnxFileRepoQueue_TryPut(queue, item);
+    }
+
+    if (!added) {
+        pthread_mutex_lock(&queue->lock);
+        _ccnxFileRepoQueue_Sleep(&queue->fullWaiters);
+        while (!queue->closed && !(added = ccnxFileRepoQueue_TryPut(queue, item))) {
+            pthread_cond_wait(&queue->notFull, &queue->lock);
+        }
+        __atomic_sub_fetch(&queue->fullWaiters, 1, __ATOMIC_RELAXED);
+        pthread_mutex_unlock(&queue->lock);
+    }
+
+    if (added) {
+        _ccnxFileRepoQueue_Wake(queue, &queue->emptyWaiters, &queue->notEmpty);
+    }
+    return added;
+}
+
+void *
+ccnxFileRepoQueue_Get(CCNxFileRepoQueue *queue)
+{
+    void *item = NULL;
+    for (int i = 0; item == NULL && i < _ccnxFileRepoQueue_SpinCount; i++) {
+        item = ccnxFileRepoQueue_TryGet(queue);
+    }
+
+    if (item == NULL) {
+        pthread_mutex_lock(&queue->lock);
+        _ccnxFileRepoQueue_Sleep(&queue->emptyWaiters);
+        while ((item = ccnxFileRepoQueue_TryGet(queue)) == NULL && !queue->closed) {
+            pthread_cond_wait(&queue->notEmpty, &queue->lock);
+        }
+        __atomic_sub_fetch(&queue->emptyWaiters, 1, __ATOMIC_RELAXED);
+        pthread_mutex_unlock(&queue->lock);
+    }
+
+    if (item != NULL) {
+        _ccnxFileRepoQueue_Wake(queue, &queue->fullWaiters, &queue->notFull);
+    }
+    return item;
+}
+
+void
+ccnxFileRepoQueue_Close(CCNxFileRepoQueue *queue)
+{
+    pthread_mutex_lock(&queue->lock);
+    queue->closed = true;
+    pthread_cond_broadcast(&queue->notEmpty);
+    pthread_cond_broadcast(&queue->notFull);
+    pthread_mutex_unlock(&queue->lock);
+}
+
+size_t
+ccnxFileRepoQueue_GetCapacity(const CCNxFileRepoQueue *queue)
+{
+    return queue->mask + 1;
+}
@@ -0,0 +1,181 @@
+/*
+ * Copyright (c) 2016, Xerox Corporation (Xerox) and Palo Alto Research Center, Inc (PARC)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL XEROX OR PARC BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * ################################################################################
+ * #
+ * # PATENT NOTICE
+ * #
+ * # This software is distributed under the BSD 2-clause License (see LICENSE
+ * # file).  This BSD License does not make any patent claims and as such, does
+ * # not act as a patent grant.  The purpose of this section is for each contributor
+ * # to define their intentions with respect to intellectual property.
+ * #
+ * # Each contributor to this source code is encouraged to state their patent
+ * # claims and licensing mechanisms for any contributions made. At the end of
+ * # this section contributors may each make their own statements.  Contributor's
+ * # claims and grants only apply to the pieces (source code, programs, text,
+ * # media, etc) that they have contributed directly to this software.
+ * #
+ * # There is no guarantee that this section is complete, up to date or accurate. It
+ * # is up to the contributors to maintain their portion of this section and up to
+ * # the user of the software to verify any claims herein.
+ * #
+ * # Do not remove this header notification.  The contents of this section must be
+ * # present in all distributions of the software.  You may only modify your own
+ * # intellectual property statements.  Please provide contact information.
+ *
+ * - Palo Alto Research Center, Inc
+ * This software distribution does not grant any rights to patents owned by Palo
+ * Alto Research Center, Inc (PARC). Rights to these patents are available via
+ * various mechanisms. As of January 2016 PARC has committed to FRAND licensing any
+ * intellectual property used by its contributions to this software. You may
+ * contact PARC at cipo@parc.com for more information or visit http://www.ccnx.org
+ */
+/**
+ * @author Christopher A. Wood, Palo Alto Research Center (Xerox PARC)
+ * @copyright (c) 2016, Xerox Corporation (Xerox) and Palo Alto Research Center, Inc (PARC).  All rights reserved.
+ */
+
+#ifndef ccnxFileRepoQueue_h
+#define ccnxFileRepoQueue_h
+
+#include <stdbool.h>
+#include <stddef.h>
+
+struct ccnx_file_repo_queue;
+typedef struct ccnx_file_repo_queue CCNxFileRepoQueue;
+
+/**
+ * Create a bounded, multi-producer multi-consumer `CCNxFileRepoQueue` of pointers.
+ *
+ * The queue is a ring of sequence-numbered cells: producers and consumers claim cells with a
+ * single compare-and-swap and never take a lock while the queue is neither empty nor full.
+ * Only a consumer that finds the queue empty, or a producer that finds it full, goes to sleep.
+ *
+ * @param [in] capacity The maximum number of items in the queue, rounded up to a power of two.
+ *
+ * @return A new `CCNxFileRepoQueue` instance.
+ *
+ * Example:
+ * @code
+ * {
+ *     CCNxFileRepoQueue *queue = ccnxFileRepoQueue_Create(1024);
+ * }
+ * @endcode
+ */
+CCNxFileRepoQueue *ccnxFileRepoQueue_Create(size_t capacity);
+
+/**
+ * Increase the number of references to a `CCNxFileRepoQueue` instance.
+ *
+ * @param [in] instance A pointer to a valid CCNxFileRepoQueue instance.
+ *
+ * @return The same value as @p instance.
+ */
+CCNxFileRepoQueue *ccnxFileRepoQueue_Acquire(const CCNxFileRepoQueue *instance);
+
+/**
+ * Release a previously acquired reference to the given `CCNxFileRepoQueue` instance,
+ * decrementing the reference count for the instance.
+ *
+ * Items still in the queue are not released.
+ *
+ * @param [in,out] instancePtr A pointer to a pointer to the instance to release.
+ */
+void ccnxFileRepoQueue_Release(CCNxFileRepoQueue **instancePtr);
+
+/**
+ * Add an item to the queue if there is room, without blocking.
+ *
+ * @param [in] queue The `CCNxFileRepoQueue` instance.
+ * @param [in] item A non-NULL pointer.
+ *
+ * @return true The item was added.
+ * @return false The queue is full.
+ */
+bool ccnxFileRepoQueue_TryPut(CCNxFileRepoQueue *queue, void *item);
+
+/**
+ * Remove the oldest item from the queue, without blocking.
+ *
+ * @param [in] queue The `CCNxFileRepoQueue` instance.
+ *
+ * @retval NULL The queue is empty.
+ * @retval non-NULL The item.
+ */
+void *ccnxFileRepoQueue_TryGet(CCNxFileRepoQueue *queue);
+
+/**
+ * Add an item to the queue, waiting for room if it is full.
+ *
+ * @param [in] queue The `CCNxFileRepoQueue` instance.
+ * @param [in] item A non-NULL pointer.
+ *
+ * @return true The item was added.
+ * @return false The queue has been closed.
+ *
+ * Example:
+ * @code
+ * {
+ *     ccnxFileRepoQueue_Put(queue, ccnxMetaMessage_Acquire(request));
+ * }
+ * @endcode
+ */
+bool ccnxFileRepoQueue_Put(CCNxFileRepoQueue *queue, void *item);
+
+/**
+ * Remove the oldest item from the queue, waiting for one if it is empty.
+ *
+ * @param [in] queue The `CCNxFileRepoQueue` instance.
+ *
+ * @retval NULL The queue has been closed and is empty.
+ * @retval non-NULL The item.
+ *
+ * Example:
+ * @code
+ * {
+ *     void *item;
+ *     while ((item = ccnxFileRepoQueue_Get(queue)) != NULL) {
+ *         // process the item
+ *     }
+ * }
+ * @endcode
+ */
+void *ccnxFileRepoQueue_Get(CCNxFileRepoQueue *queue);
+
+/**
+ * Close the queue. Waiting producers return false, and consumers drain the remaining
+ * items and then return NULL instead of waiting.
+ *
+ * @param [in] queue The `CCNxFileRepoQueue` instance.
+ */
+void ccnxFileRepoQueue_Close(CCNxFileRepoQueue *queue);
+
+/**
+ * Return the maximum number of items in the queue.
+ *
+ * @param [in] queue The `CCNxFileRepoQueue` instance.
+ */
+size_t ccnxFileRepoQueue_GetCapacity(const CCNxFileRepoQueue *queue);
+#endif // ccnxFileRepoQueue_h
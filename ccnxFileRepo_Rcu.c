@@ -0,0 +1,146 @@
+/*
+ * Copyright (c) 2016, Xerox Corporation (Xerox) and Palo Alto Research Center, Inc (PARC)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL XEROX OR PARC BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * ################################################################################
+ * #
+ * # PATENT NOTICE
+ * #
+ * # This software is distributed under the BSD 2-clause License (see LICENSE
+ * # file).  This BSD License does not make any patent claims and as such, does
+ * # not act as a patent grant.  The purpose of this section is for each contributor
+ * # to define their intentions with respect to intellectual property.
+ * #
+ * # Each contributor to this source code is encouraged to state their patent
+ * # claims and licensing mechanisms for any contributions made. At the end of
+ * # this section contributors may each make their own statements.  Contributor's
+ * # claims and grants only apply to the pieces (source code, programs, text,
+ * # media, etc) that they have contributed directly to this software.
+ * #
+ * # There is no guarantee that this section is complete, up to date or accurate. It
+ * # is up to the contributors to maintain their portion of this section and up to
+ * # the user of the software to verify any claims herein.
+ * #
+ * # Do not remove this header notification.  The contents of this section must be
+ * # present in all distributions of the software.  You may only modify your own
+ * # intellectual property statements.  Please provide contact information.
+ *
+ * - Palo Alto Research Center, Inc
+ * This software distribution does not grant any rights to patents owned by Palo
+ * Alto Research Center, Inc (PARC). Rights to these patents are available via
+ * various mechanisms. As of January 2016 PARC has committed to FRAND licensing any
+ * intellectual property used by its contributions to this software. You may
+ * contact PARC at cipo@parc.com for more information or visit http://www.ccnx.org
+ */
+/**
+ * @author Christopher A. Wood, Palo Alto Research Center (Xerox PARC)
+ * @copyright (c) 2016, Xerox Corporation (Xerox) and Palo Alto Research Center, Inc (PARC).  All rights reserved.
+ */
+#include <LongBow/runtime.h>
+
+#include <stdint.h>
+#include <pthread.h>
+#include <sched.h>
+
+#include <parc/algol/parc_Object.h>
+
+#include "ccnxFileRepo_Rcu.h"
+
+/**
+ * The number of reader slots. More threads than this may read at once; they only have to
+ * look further for a free slot.
+ */
+#define _ccnxFileRepoRcu_ReaderCount 64
+
+/**
+ * A reader slot holds the epoch its reader entered its section in, or 0 outside a section.
+ * Each is on its own cache line, so readers on different slots do not share lines.
+ */
+typedef struct {
+    uint64_t epoch __attribute__((aligned(64)));
+} _RcuReader;
+
+struct ccnx_file_repo_rcu {
+    uint64_t epoch __attribute__((aligned(64)));
+    _RcuReader readers[_ccnxFileRepoRcu_ReaderCount];
+};
+
+parcObject_Override(CCNxFileRepoRcu, PARCObject);
+
+parcObject_ImplementAcquire(ccnxFileRepoRcu, CCNxFileRepoRcu);
+parcObject_ImplementRelease(ccnxFileRepoRcu, CCNxFileRepoRcu);
+
+CCNxFileRepoRcu *
+ccnxFileRepoRcu_Create(void)
+{
+    CCNxFileRepoRcu *rcu = parcObject_CreateAndClearInstance(CCNxFileRepoRcu);
+    if (rcu != NULL) {
+        rcu->epoch = 1;
+    }
+    return rcu;
+}
+
+size_t
+ccnxFileRepoRcu_ReadLock(CCNxFileRepoRcu *rcu)
+{
+    // Start from a slot picked by thread, so a thread usually finds the slot it used last free.
+    uint64_t self = (uint64_t) (uintptr_t) pthread_self();
+    size_t reader = (size_t) ((self * 0x9E3779B97F4A7C15ULL) >> 58) % _ccnxFileRepoRcu_ReaderCount;
+
+    // Both the store of the epoch and the loads of the reader that follow are sequentially
+    // consistent with the writer's swap, epoch increment and scan: either the writer sees
+    // this slot taken and waits, or the reader sees the new pointer.
+    uint64_t epoch = __atomic_load_n(&rcu->epoch, __ATOMIC_SEQ_CST);
+    while (true) {
+        uint64_t expected = 0;
+        if (__atomic_compare_exchange_n(&rcu->readers[reader].epoch, &expected, epoch, false,
+                                        __ATOMIC_SEQ_CST, __ATOMIC_RELAXED)) {
+            return reader;
+        }
+        reader = (reader + 1) % _ccnxFileRepoRcu_ReaderCount;
+    }
+}
+
+void
+ccnxFileRepoRcu_ReadUnlock(CCNxFileRepoRcu *rcu, size_t reader)
+{
+    __atomic_store_n(&rcu->readers[reader].epoch, 0, __ATOMIC_RELEASE);
+}
+
+void
+ccnxFileRepoRcu_Synchronize(CCNxFileRepoRcu *rcu)
+{
+    uint64_t epoch = __atomic_add_fetch(&rcu->epoch, 1, __ATOMIC_SEQ_CST);
+
+    // A reader that entered in an earlier epoch may hold an old pointer; one that entered in
+    // this epoch or later loaded its pointers after the swap.
+    for (size_t reader = 0; reader < _ccnxFileRepoRcu_ReaderCount; reader++) {
+        while (true) {
+            uint64_t entered = __atomic_load_n(&rcu->readers[reader].epoch, __ATOMIC_SEQ_CST);
+            if (entered == 0 || entered >= epoch) {
+                break;
+            }
+            sched_yield();
+        }
+    }
+}
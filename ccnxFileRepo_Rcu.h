@@ -0,0 +1,147 @@
+/*
+ * Copyright (c) 2016, Xerox Corporation (Xerox) and Palo Alto Research Center, Inc (PARC)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL XEROX OR PARC BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * ################################################################################
+ * #
+ * # PATENT NOTICE
+ * #
+ * # This software is distributed under the BSD 2-clause License (see LICENSE
+ * # file).  This BSD License does not make any patent claims and as such, does
+ * # not act as a patent grant.  The purpose of this section is for each contributor
+ * # to define their intentions with respect to intellectual property.
+ * #
+ * # Each contributor to this source code is encouraged to state their patent
+ * # claims and licensing mechanisms for any contributions made. At the end of
+ * # this section contributors may each make their own statements.  Contributor's
+ * # claims and grants only apply to the pieces (source code, programs, text,
+ * # media, etc) that they have contributed directly to this software.
+ * #
+ * # There is no guarantee that this section is complete, up to date or accurate. It
+ * # is up to the contributors to maintain their portion of this section and up to
+ * # the user of the software to verify any claims herein.
+ * #
+ * # Do not remove this header notification.  The contents of this section must be
+ * # present in all distributions of the software.  You may only modify your own
+ * # intellectual property statements.  Please provide contact information.
+ *
+ * - Palo Alto Research Center, Inc
+ * This software distribution does not grant any rights to patents owned by Palo
+ * Alto Research Center, Inc (PARC). Rights to these patents are available via
+ * various mechanisms. As of January 2016 PARC has committed to FRAND licensing any
+ * intellectual property used by its contributions to this software. You may
+ * contact PARC at cipo@parc.com for more information or visit http://www.ccnx.org
+ */
+/**
+ * @author Christopher A. Wood, Palo Alto Research Center (Xerox PARC)
+ * @copyright (c) 2016, Xerox Corporation (Xerox) and Palo Alto Research Center, Inc (PARC).  All rights reserved.
+ */
+
+#ifndef ccnxFileRepoRcu_h
+#define ccnxFileRepoRcu_h
+
+#include <stddef.h>
+
+struct ccnx_file_repo_rcu;
+typedef struct ccnx_file_repo_rcu CCNxFileRepoRcu;
+
+/**
+ * Create a `CCNxFileRepoRcu`, which lets readers use shared data without locks while a
+ * writer replaces it, in the style of read-copy-update.
+ *
+ * A writer publishes a new version of the data by swapping a pointer, then calls
+ * `ccnxFileRepoRcu_Synchronize` before it frees the old version. Readers bracket their use of
+ * the data with `ccnxFileRepoRcu_ReadLock` and `ccnxFileRepoRcu_ReadUnlock`, which only store
+ * the current epoch into a reader slot and clear it again: a reader never waits for a writer,
+ * and a writer only waits for the readers that were already inside a read-side section.
+ *
+ * @return A new `CCNxFileRepoRcu` instance.
+ *
+ * Example:
+ * @code
+ * {
+ *     CCNxFileRepoRcu *rcu = ccnxFileRepoRcu_Create();
+ *
+ *     // reader
+ *     size_t reader = ccnxFileRepoRcu_ReadLock(rcu);
+ *     Data *data = __atomic_load_n(&shared, __ATOMIC_SEQ_CST);
+ *     // use data
+ *     ccnxFileRepoRcu_ReadUnlock(rcu, reader);
+ *
+ *     // writer
+ *     Data *old = __atomic_exchange_n(&shared, new, __ATOMIC_SEQ_CST);
+ *     ccnxFileRepoRcu_Synchronize(rcu);
+ *     free(old);
+ * }
+ * @endcode
+ */
+CCNxFileRepoRcu *ccnxFileRepoRcu_Create(void);
+
+/**
+ * Increase the number of references to a `CCNxFileRepoRcu` instance.
+ *
+ * @param [in] instance A pointer to a valid CCNxFileRepoRcu instance.
+ *
+ * @return The same value as @p instance.
+ */
+CCNxFileRepoRcu *ccnxFileRepoRcu_Acquire(const CCNxFileRepoRcu *instance);
+
+/**
+ * Release a previously acquired reference to the given `CCNxFileRepoRcu` instance,
+ * decrementing the reference count for the instance.
+ *
+ * The pointer to the instance is set to NULL as a side-effect of this function.
+ *
+ * @param [in,out] instancePtr A pointer to a pointer to the instance to release.
+ */
+void ccnxFileRepoRcu_Release(CCNxFileRepoRcu **instancePtr);
+
+/**
+ * Enter a read-side section. Data reached through pointers loaded from here on is not freed
+ * by a writer until the matching `ccnxFileRepoRcu_ReadUnlock`.
+ *
+ * Sections must be short, e.g., long enough to look something up and acquire a reference
+ * to it.
+ *
+ * @param [in] rcu The `CCNxFileRepoRcu` instance.
+ *
+ * @return The reader slot taken, to pass to `ccnxFileRepoRcu_ReadUnlock`.
+ */
+size_t ccnxFileRepoRcu_ReadLock(CCNxFileRepoRcu *rcu);
+
+/**
+ * Leave the read-side section entered by `ccnxFileRepoRcu_ReadLock`.
+ *
+ * @param [in] rcu The `CCNxFileRepoRcu` instance.
+ * @param [in] reader The reader slot returned by `ccnxFileRepoRcu_ReadLock`.
+ */
+void ccnxFileRepoRcu_ReadUnlock(CCNxFileRepoRcu *rcu, size_t reader);
+
+/**
+ * Wait until every read-side section that was entered before this call has been left, so
+ * that no reader can still hold a pointer that was replaced before the call.
+ *
+ * @param [in] rcu The `CCNxFileRepoRcu` instance.
+ */
+void ccnxFileRepoRcu_Synchronize(CCNxFileRepoRcu *rcu);
+#endif // ccnxFileRepoRcu_h
@@ -0,0 +1,132 @@
+/*
+ * Copyright (c) 2016, Xerox Corporation (Xerox) and Palo Alto Research Center, Inc (PARC)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL XEROX OR PARC BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * ################################################################################
+ * #
+ * # PATENT NOTICE
+ * #
+ * # This software is distributed under the BSD 2-clause License (see LICENSE
+ * # file).  This BSD License does not make any patent claims and as such, does
+ * # not act as a patent grant.  The purpose of this section is for each contributor
+ * # to define their intentions with respect to intellectual property.
+ * #
+ * # Each contributor to this source code is encouraged to state their patent
+ * # claims and licensing mechanisms for any contributions made. At the end of
+ * # this section contributors may each make their own statements.  Contributor's
+ * # claims and grants only apply to the pieces (source code, programs, text,
+ * # media, etc) that they have contributed directly to this software.
+ * #
+ * # There is no guarantee that this section is complete, up to date or accurate. It
+ * # is up to the contributors to maintain their portion of this section and up to
+ * # the user of the software to verify any claims herein.
+ * #
+ * # Do not remove this header notification.  The contents of this section must be
+ * # present in all distributions of the software.  You may only modify your own
+ * # intellectual property statements.  Please provide contact information.
+ *
+ * - Palo Alto Research Center, Inc
+ * This software distribution does not grant any rights to patents owned by Palo
+ * Alto Research Center, Inc (PARC). Rights to these patents are available via
+ * various mechanisms. As of January 2016 PARC has committed to FRAND licensing any
+ * intellectual property used by its contributions to this software. You may
+ * contact PARC at cipo@parc.com for more information or visit http://www.ccnx.org
+ */
+/**
+ * @author Christopher A. Wood, Palo Alto Research Center (Xerox PARC)
+ * @copyright (c) 2016, Xerox Corporation (Xerox) and Palo Alto Research Center, Inc (PARC).  All rights reserved.
+ */
+#include <LongBow/runtime.h>
+
+#include <parc/algol/parc_Object.h>
+
+#include <ccnx/common/internal/ccnx_WireFormatMessage.h>
+
+#include "ccnxFileRepo_Responder.h"
+
+struct ccnx_file_repo_responder {
+    CCNxFileRepoCache *cache;
+    CCNxFileRepoNameTable *table;
+};
+
+static bool
+_ccnxFileRepoResponder_Destructor(CCNxFileRepoResponder **responderPtr)
+{
+    CCNxFileRepoResponder *responder = *responderPtr;
+    ccnxFileRepoNameTable_Release(&responder->table);
+    ccnxFileRepoCache_Release(&responder->cache);
+    return true;
+}
+
+parcObject_Override(CCNxFileRepoResponder, PARCObject,
+                    .destructor = (PARCObjectDestructor *) _ccnxFileRepoResponder_Destructor);
+
+parcObject_ImplementAcquire(ccnxFileRepoResponder, CCNxFileRepoResponder);
+parcObject_ImplementRelease(ccnxFileRepoResponder, CCNxFileRepoResponder);
+
+CCNxFileRepoResponder *
+ccnxFileRepoResponder_Create(CCNxFileRepoCache *cache, CCNxFileRepoNameTable *table)
+{
+    CCNxFileRepoResponder *responder = parcObject_CreateInstance(CCNxFileRepoResponder);
+    if (responder != NULL) {
+        responder->cache = ccnxFileRepoCache_Acquire(cache);
+        responder->table = ccnxFileRepoNameTable_Acquire(table);
+    }
+    return responder;
+}
+
+CCNxMetaMessage *
+ccnxFileRepoResponder_CreateResponse(CCNxFileRepoResponder *responder, const CCNxInterest *interest)
+{
+    const CCNxName *name = ccnxInterest_GetName(interest);
+    PARCBuffer *digest = ccnxInterest_GetContentObjectHashRestriction(interest);
+
+    // An interest without a hash restriction asks for the current root; any other is for a
+    // chunk, which may belong to an older version of the publication that is still being fetched.
+    PARCBuffer *wireFormat = NULL;
+    if (digest == NULL) {
+        wireFormat = ccnxFileRepoNameTable_CreateWireFormatView(responder->table, name);
+    } else if (ccnxFileRepoNameTable_Contains(responder->table, name)) {
+        wireFormat = ccnxFileRepoCache_CreateWireEncodedMessageWithDigest(responder->cache, digest);
+    }
+    if (wireFormat == NULL) {
+        return NULL;
+    }
+
+    // Stored messages are complete, encoded packets, so they are sent as they are, without being decoded.
+    CCNxMetaMessage *response = ccnxWireFormatMessage_Create(wireFormat);
+    parcBuffer_Release(&wireFormat);
+    return response;
+}
+
+size_t
+ccnxFileRepoResponder_BeginViews(CCNxFileRepoResponder *responder)
+{
+    return ccnxFileRepoCache_BeginViews(responder->cache);
+}
+
+void
+ccnxFileRepoResponder_EndViews(CCNxFileRepoResponder *responder, size_t section)
+{
+    ccnxFileRepoCache_EndViews(responder->cache, section);
+}
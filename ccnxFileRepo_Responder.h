@@ -0,0 +1,155 @@
+/*
+ * Copyright (c) 2016, Xerox Corporation (Xerox) and Palo Alto Research Center, Inc (PARC)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL XEROX OR PARC BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * ################################################################################
+ * #
+ * # PATENT NOTICE
+ * #
+ * # This software is distributed under the BSD 2-clause License (see LICENSE
+ * # file).  This BSD License does not make any patent claims and as such, does
+ * # not act as a patent grant.  The purpose of this section is for each contributor
+ * # to define their intentions with respect to intellectual property.
+ * #
+ * # Each contributor to this source code is encouraged to state their patent
+ * # claims and licensing mechanisms for any contributions made. At the end of
+ * # this section contributors may each make their own statements.  Contributor's
+ * # claims and grants only apply to the pieces (source code, programs, text,
+ * # media, etc) that they have contributed directly to this software.
+ * #
+ * # There is no guarantee that this section is complete, up to date or accurate. It
+ * # is up to the contributors to maintain their portion of this section and up to
+ * # the user of the software to verify any claims herein.
+ * #
+ * # Do not remove this header notification.  The contents of this section must be
+ * # present in all distributions of the software.  You may only modify your own
+ * # intellectual property statements.  Please provide contact information.
+ *
+ * - Palo Alto Research Center, Inc
+ * This software distribution does not grant any rights to patents owned by Palo
+ * Alto Research Center, Inc (PARC). Rights to these patents are available via
+ * various mechanisms. As of January 2016 PARC has committed to FRAND licensing any
+ * intellectual property used by its contributions to this software. You may
+ * contact PARC at cipo@parc.com for more information or visit http://www.ccnx.org
+ */
+/**
+ * @author Christopher A. Wood, Palo Alto Research Center (Xerox PARC)
+ * @copyright (c) 2016, Xerox Corporation (Xerox) and Palo Alto Research Center, Inc (PARC).  All rights reserved.
+ */
+
+#ifndef ccnxFileRepoResponder_h
+#define ccnxFileRepoResponder_h
+
+#include <ccnx/common/ccnx_Interest.h>
+#include <ccnx/transport/common/transport_MetaMessage.h>
+
+#include "ccnxFileRepo_Cache.h"
+#include "ccnxFileRepo_NameTable.h"
+
+struct ccnx_file_repo_responder;
+typedef struct ccnx_file_repo_responder CCNxFileRepoResponder;
+
+/**
+ * Create a `CCNxFileRepoResponder`, which answers interests for the publications in `table`
+ * with the chunks stored in `cache`. The responder holds no mutable state of its own, so
+ * one instance may answer interests from several threads at once.
+ *
+ * @param [in] cache The repo holding the chunks of every publication.
+ * @param [in] table The root manifest of every publication, by name.
+ *
+ * @return A new `CCNxFileRepoResponder` instance.
+ *
+ * Example:
+ * @code
+ * {
+ *     CCNxFileRepoResponder *responder = ccnxFileRepoResponder_Create(cache, table);
+ * }
+ * @endcode
+ */
+CCNxFileRepoResponder *ccnxFileRepoResponder_Create(CCNxFileRepoCache *cache, CCNxFileRepoNameTable *table);
+
+/**
+ * Increase the number of references to a `CCNxFileRepoResponder` instance.
+ *
+ * @param [in] instance A pointer to a valid CCNxFileRepoResponder instance.
+ *
+ * @return The same value as @p instance.
+ */
+CCNxFileRepoResponder *ccnxFileRepoResponder_Acquire(const CCNxFileRepoResponder *instance);
+
+/**
+ * Release a previously acquired reference to the given `CCNxFileRepoResponder` instance,
+ * decrementing the reference count for the instance.
+ *
+ * @param [in,out] instancePtr A pointer to a pointer to the instance to release.
+ */
+void ccnxFileRepoResponder_Release(CCNxFileRepoResponder **instancePtr);
+
+/**
+ * Create the response to an interest: the chunk named by its ContentObjectHashRestriction,
+ * or the root manifest of the publication if it has none.
+ *
+ * The response is a wire format message around the stored, already encoded bytes (a view of
+ * them where possible), so it is neither decoded nor re-encoded before it is sent. A view is
+ * only valid inside a section of `ccnxFileRepoResponder_BeginViews`, so the response must be
+ * created, sent and released inside one.
+ *
+ * @param [in] responder The `CCNxFileRepoResponder` instance.
+ * @param [in] interest The interest to answer.
+ *
+ * @retval NULL The interest does not name a publication, or the chunk is not stored.
+ * @retval CCNxMetaMessage The response, which must be released by calling `ccnxMetaMessage_Release`.
+ *
+ * Example:
+ * @code
+ * {
+ *     size_t section = ccnxFileRepoResponder_BeginViews(responder);
+ *     CCNxMetaMessage *response = ccnxFileRepoResponder_CreateResponse(responder, interest);
+ *     if (response != NULL) {
+ *         ccnxPortal_Send(portal, response, CCNxStackTimeout_Never);
+ *         ccnxMetaMessage_Release(&response);
+ *     }
+ *     ccnxFileRepoResponder_EndViews(responder, section);
+ * }
+ * @endcode
+ */
+CCNxMetaMessage *ccnxFileRepoResponder_CreateResponse(CCNxFileRepoResponder *responder, const CCNxInterest *interest);
+
+/**
+ * Enter a section in which the responses of `ccnxFileRepoResponder_CreateResponse` may be
+ * used; see `ccnxFileRepoCache_BeginViews`.
+ *
+ * @param [in] responder The `CCNxFileRepoResponder` instance.
+ *
+ * @return The section entered, to pass to `ccnxFileRepoResponder_EndViews`.
+ */
+size_t ccnxFileRepoResponder_BeginViews(CCNxFileRepoResponder *responder);
+
+/**
+ * End the section entered by `ccnxFileRepoResponder_BeginViews`.
+ *
+ * @param [in] responder The `CCNxFileRepoResponder` instance.
+ * @param [in] section The section returned by `ccnxFileRepoResponder_BeginViews`.
+ */
+void ccnxFileRepoResponder_EndViews(CCNxFileRepoResponder *responder, size_t section);
+#endif // ccnxFileRepoResponder_h
@@ -58,16 +58,27 @@
  */
 #include <LongBow/runtime.h>
 
+#include <ctype.h>
+#include <dirent.h>
+#include <errno.h>
+#include <pthread.h>
 #include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
 
 #include <ccnx/api/ccnx_Portal/ccnx_Portal.h>
 #include <ccnx/api/ccnx_Portal/ccnx_PortalRTA.h>
 
 #include <parc/security/parc_Security.h>
 #include <parc/algol/parc_RandomAccessFile.h>
+#include <parc/algol/parc_BufferComposer.h>
 
 #include "ccnxFileRepo_Common.h"
 #include "ccnxFileRepo_Cache.h"
+#include "ccnxFileRepo_NameTable.h"
+#include "ccnxFileRepo_Responder.h"
+#include "ccnxFileRepo_WorkerPool.h"
+#include "ccnxFileRepo_Watcher.h"
 
 /**
  * Create a new CCNxPortalFactory instance using a randomly generated identity saved to
@@ -86,16 +97,256 @@ _setupConsumerPortalFactory(void)
 }
 
 /**
- * Run a producer that will serve the specified file under the specified content name.
- * The file will be transferred using a Manifest. The repo will create the manifest from
- * the specified file.
+ * Create the name of a file published under `prefix` at the given relative path, with one
+ * name segment per path component. Bytes that may not appear in a name segment URI are
+ * percent-encoded.
+ */
+static CCNxName *
+_createNameUnderPrefix(const char *prefix, const char *relativePath)
+{
+    PARCBufferComposer *composer = parcBufferComposer_Create();
+    parcBufferComposer_PutString(composer, prefix);
+
+    bool startSegment = true;
+    for (const char *p = relativePath; *p != '\0'; p++) {
+        if (*p == '/') {
+            startSegment = true;
+            continue;
+        }
+        if (startSegment) {
+            parcBufferComposer_PutString(composer, "/");
+            startSegment = false;
+        }
+        if (isalnum((unsigned char) *p) || strchr("-._~", *p) != NULL) {
+            parcBufferComposer_PutChar(composer, *p);
+        } else {
+            parcBufferComposer_Format(composer, "%%%02X", (unsigned char) *p);
+        }
+    }
+
+    char *uri = parcBufferComposer_ToString(composer);
+    parcBufferComposer_Release(&composer);
+
+    CCNxName *name = ccnxName_CreateFromCString(uri);
+    parcMemory_Deallocate(&uri);
+    return name;
+}
+
+/**
+ * Publish one file under the given name, adding it to the name table. If `watcher` is not NULL,
+ * the file is also watched for changes.
+ */
+static bool
+_publishFile(CCNxFileRepoCache *cache, CCNxFileRepoNameTable *table, CCNxFileRepoWatcher *watcher,
+             const char *path, const CCNxName *name)
+{
+    CCNxManifest *root = ccnxFileRepoCache_PublishFile(cache, (CCNxName *) name, path);
+    if (root == NULL) {
+        fprintf(stderr, "Could not publish %s\n", path);
+        return false;
+    }
+
+    bool added = ccnxFileRepoNameTable_Add(table, name, root);
+    ccnxManifest_Release(&root);
+
+    char *nameString = ccnxName_ToString(name);
+    if (added) {
+        printf("Published: %s\n", nameString);
+    } else {
+        fprintf(stderr, "%s is already published, ignoring %s\n", nameString, path);
+    }
+    if (added && watcher != NULL && !ccnxFileRepoWatcher_Add(watcher, name, path)) {
+        fprintf(stderr, "Could not watch %s: %s\n", path, strerror(errno));
+    }
+    parcMemory_Deallocate(&nameString);
+    return added;
+}
+
+/**
+ * Publish every regular file below `directory` under `prefix`. `relativePath` is the path of
+ * `directory` below the top of the tree ("" at the top). The repo directory is skipped if it
+ * lies within the tree, and symbolic links to directories are not followed.
+ */
+static size_t
+_publishDirectory(CCNxFileRepoCache *cache, CCNxFileRepoNameTable *table, CCNxFileRepoWatcher *watcher,
+                  const char *directory, const char *relativePath, const char *prefix, const struct stat *repoStat)
+{
+    DIR *dir = opendir(directory);
+    if (dir == NULL) {
+        fprintf(stderr, "%s: %s\n", directory, strerror(errno));
+        return 0;
+    }
+
+    size_t published = 0;
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != NULL) {
+        if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0) {
+            continue;
+        }
+
+        char *path = parcMemory_Format("%s/%s", directory, entry->d_name);
+        char *entryRelativePath = (relativePath[0] == '\0')
+                                  ? parcMemory_StringDuplicate(entry->d_name, strlen(entry->d_name))
+                                  : parcMemory_Format("%s/%s", relativePath, entry->d_name);
+
+        struct stat statbuf;
+        if (lstat(path, &statbuf) == 0 && S_ISDIR(statbuf.st_mode)) {
+            if (statbuf.st_dev != repoStat->st_dev || statbuf.st_ino != repoStat->st_ino) {
+                published += _publishDirectory(cache, table, watcher, path, entryRelativePath, prefix, repoStat);
+            }
+        } else if (stat(path, &statbuf) == 0 && S_ISREG(statbuf.st_mode)) {
+            CCNxName *name = _createNameUnderPrefix(prefix, entryRelativePath);
+            if (_publishFile(cache, table, watcher, path, name)) {
+                published++;
+            }
+            ccnxName_Release(&name);
+        }
+
+        parcMemory_Deallocate(&entryRelativePath);
+        parcMemory_Deallocate(&path);
+    }
+    closedir(dir);
+
+    return published;
+}
+
+/**
+ * Publish the files named in a list file under `prefix`. Each line holds the path of a file,
+ * optionally followed by whitespace and the path of its name below `prefix`; by default the
+ * last component of the file path is used. Empty lines and lines starting with '#' are ignored.
+ */
+static size_t
+_publishList(CCNxFileRepoCache *cache, CCNxFileRepoNameTable *table, CCNxFileRepoWatcher *watcher,
+             const char *listFileName, const char *prefix)
+{
+    FILE *listFile = fopen(listFileName, "r");
+    if (listFile == NULL) {
+        fprintf(stderr, "%s: %s\n", listFileName, strerror(errno));
+        return 0;
+    }
+
+    size_t published = 0;
+    char *line = NULL;
+    size_t lineCapacity = 0;
+    while (getline(&line, &lineCapacity, listFile) >= 0) {
+        char *savePtr = NULL;
+        char *path = strtok_r(line, " \t\r\n", &savePtr);
+        if (path == NULL || path[0] == '#') {
+            continue;
+        }
+
+        char *relativeName = strtok_r(NULL, " \t\r\n", &savePtr);
+        if (relativeName == NULL) {
+            relativeName = strrchr(path, '/') != NULL ? strrchr(path, '/') + 1 : path;
+        }
+
+        CCNxName *name = _createNameUnderPrefix(prefix, relativeName);
+        if (_publishFile(cache, table, watcher, path, name)) {
+            published++;
+        }
+        ccnxName_Release(&name);
+    }
+    free(line);
+    fclose(listFile);
+
+    return published;
+}
+
+/**
+ * The state shared by the worker threads of a multi-threaded server.
+ */
+typedef struct {
+    CCNxFileRepoResponder *responder;
+    CCNxPortal *portal;
+    pthread_mutex_t sendLock;
+} _ServerWorkerContext;
+
+/**
+ * Answer one interest and send the response.
+ *
+ * @param [in] responder Creates the response.
+ * @param [in] portal The portal to send the response through.
+ * @param [in] sendLock If not NULL, held while sending, since the portal is shared by several threads.
+ * @param [in] request The request, which is released.
+ */
+static void
+_respond(CCNxFileRepoResponder *responder, CCNxPortal *portal, pthread_mutex_t *sendLock, CCNxMetaMessage *request)
+{
+    CCNxInterest *interest = ccnxMetaMessage_GetInterest(request);
+
+    // The response may be a view of the mapped packfile, which must be sent before the section ends
+    size_t section = ccnxFileRepoResponder_BeginViews(responder);
+    CCNxMetaMessage *response = (interest != NULL) ? ccnxFileRepoResponder_CreateResponse(responder, interest) : NULL;
+
+    if (response != NULL) {
+        if (sendLock != NULL) {
+            pthread_mutex_lock(sendLock);
+        }
+        if (ccnxPortal_Send(portal, response, CCNxStackTimeout_Never) == false) {
+            fprintf(stderr, "ccnxPortal_Send failed: %d\n", ccnxPortal_GetError(portal));
+        }
+        if (sendLock != NULL) {
+            pthread_mutex_unlock(sendLock);
+        }
+        ccnxMetaMessage_Release(&response);
+    }
+    ccnxFileRepoResponder_EndViews(responder, section);
+    ccnxMetaMessage_Release(&request);
+}
+
+static void
+_respondInWorker(void *context, void *item)
+{
+    _ServerWorkerContext *workerContext = context;
+    _respond(workerContext->responder, workerContext->portal, &workerContext->sendLock, item);
+}
+
+/**
+ * Drop the publications of files that are gone and compact the repo; the body of the
+ * compaction thread, which runs while interests are answered.
+ */
+static void *
+_compactRepo(void *context)
+{
+    CCNxFileRepoCache *cache = context;
+    size_t removed = ccnxFileRepoCache_RemoveMissingPublications(cache);
+    if (ccnxFileRepoCache_Compact(cache)) {
+        printf("Compacted the repo after removing %zu publications\n", removed);
+    }
+    return NULL;
+}
+
+/**
+ * Run a producer that will serve the specified file, directory tree or list of files under
+ * the specified content name. Each file is transferred using a Manifest, which the repo
+ * creates from the file. All files share the repo directory and its in-memory chunk cache,
+ * and interests are routed to the right root manifest by name.
+ *
+ * With worker threads, the main thread only receives interests and hands them to the workers,
+ * which look up the chunks and send the responses.
  *
- * @param [in] fileName Path to the file to serve.
+ * @param [in] source Path to the file or directory to serve, or of the list of files to serve.
+ * @param [in] sourceIsList True if `source` is a list of files.
  * @param [in] repoBase Directory to store the repo.
- * @param [in] contentName Name under which to publish the content.
+ * @param [in] contentName Name under which to publish a single file, or the prefix of every name otherwise.
+ * @param [in] storage The layout of the chunks in the repo directory.
+ * @param [in] chunkCacheSize Memory budget of the in-memory chunk cache, in bytes.
+ * @param [in] threadCount Number of worker threads, or 0 to answer interests on the receiving thread.
+ * @param [in] queueDepth Number of interests that may wait for a worker thread.
+ * @param [in] buildThreadCount Number of threads that encode and hash chunks while loading files.
+ * @param [in] manifestFanout Fanout of the balanced manifest trees, or 0 to chain the manifests.
+ * @param [in] chunkSize Size of the chunks files are cut into, in bytes.
+ * @param [in] groupSize Most pointers in a manifest hash group, or 0 to fill each group.
+ * @param [in] chunking Whether files are cut at fixed offsets or where their content says.
+ * @param [in] compact True to reclaim the chunks no publication references once the files are loaded.
+ * @param [in] watchDelay Republish changed files this many milliseconds after they settle, or 0 not to watch them.
+ * @param [in] compressionLevel The zstd level the chunks are stored at, or 0 to store them uncompressed.
  */
 static int
-_runProducer(char *fileName, char *repoBase, char *contentName)
+_runProducer(char *source, bool sourceIsList, char *repoBase, char *contentName,
+             CCNxFileRepoCacheStorage storage, size_t chunkCacheSize, size_t threadCount, size_t queueDepth,
+             size_t buildThreadCount, size_t manifestFanout, size_t chunkSize, size_t groupSize,
+             CCNxFileRepoCacheChunking chunking, bool compact, size_t watchDelay, int compressionLevel)
 {
     parcSecurity_Init();
 
@@ -104,18 +355,61 @@ _runProducer(char *fileName, char *repoBase, char *contentName)
     CCNxPortal *portal = ccnxPortalFactory_CreatePortal(factory, ccnxPortalRTA_Message);
     assertNotNull(portal, "Expected a non-null CCNxPortal pointer.");
 
-    // Create the repo and load the first and only file
-    CCNxFileRepoCache *cache = ccnxFileRepoCache_Create(repoBase, 4096);
-    CCNxName *name = ccnxName_CreateFromCString(contentName);
+    // Create the repo and load every file into it
+    CCNxFileRepoCache *cache = ccnxFileRepoCache_CreateWithStorage(repoBase, chunkSize, storage);
+    assertNotNull(cache, "Could not open the repo in %s", repoBase);
+    ccnxFileRepoCache_SetGroupSize(cache, groupSize);
+    ccnxFileRepoCache_SetChunkCacheCapacity(cache, chunkCacheSize);
+    ccnxFileRepoCache_SetBuildThreadCount(cache, buildThreadCount);
+    ccnxFileRepoCache_SetManifestFanout(cache, manifestFanout);
+    ccnxFileRepoCache_SetChunking(cache, chunking);
+    if (!ccnxFileRepoCache_SetCompressionLevel(cache, compressionLevel)) {
+        fprintf(stderr, "Compression is not available, storing chunks uncompressed\n");
+    }
+    CCNxName *prefix = ccnxName_CreateFromCString(contentName);
+    CCNxFileRepoNameTable *table = ccnxFileRepoNameTable_Create();
+    CCNxFileRepoWatcher *watcher = NULL;
+    if (watchDelay > 0) {
+        watcher = ccnxFileRepoWatcher_Create(cache, table, watchDelay);
+        if (watcher == NULL) {
+            fprintf(stderr, "Cannot watch files for changes on this system\n");
+        }
+    }
 
-    PARCFile *file = parcFile_Create(fileName);
-    CCNxManifest *manifest = ccnxFileRepoCache_LoadFile(cache, name, file);
-    parcFile_Release(&file);
+    struct stat sourceStat;
+    struct stat repoStat;
+    if (stat(repoBase, &repoStat) != 0) {
+        memset(&repoStat, 0, sizeof(repoStat));
+    }
+    if (sourceIsList) {
+        _publishList(cache, table, watcher, source, contentName);
+    } else if (stat(source, &sourceStat) == 0 && S_ISDIR(sourceStat.st_mode)) {
+        _publishDirectory(cache, table, watcher, source, "", contentName, &repoStat);
+    } else {
+        _publishFile(cache, table, watcher, source, prefix);
+    }
+    printf("Serving %zu files under %s\n", ccnxFileRepoNameTable_GetCount(table), contentName);
 
-    printf("Published: %s\n", ccnxName_ToString(name));
+    // Changed files are republished on the watcher thread and swapped in without blocking the responders.
+    if (watcher != NULL && ccnxFileRepoWatcher_GetCount(watcher) > 0 && ccnxFileRepoWatcher_Start(watcher)) {
+        printf("Watching %zu files for changes\n", ccnxFileRepoWatcher_GetCount(watcher));
+    }
+
+    CCNxFileRepoResponder *responder = ccnxFileRepoResponder_Create(cache, table);
+
+    _ServerWorkerContext workerContext = { .responder = responder, .portal = portal };
+    pthread_mutex_init(&workerContext.sendLock, NULL);
+    CCNxFileRepoWorkerPool *pool = NULL;
+    if (threadCount > 0) {
+        pool = ccnxFileRepoWorkerPool_Create(threadCount, queueDepth, _respondInWorker, &workerContext);
+        printf("Answering interests with %zu worker threads\n", threadCount);
+    }
+
+    pthread_t compactionThread;
+    bool compacting = compact && pthread_create(&compactionThread, NULL, _compactRepo, cache) == 0;
 
     // Start listening for requests
-    if (ccnxPortal_Listen(portal, name, 365 * 86400, CCNxStackTimeout_Never)) {
+    if (ccnxFileRepoNameTable_GetCount(table) > 0 && ccnxPortal_Listen(portal, prefix, 365 * 86400, CCNxStackTimeout_Never)) {
         while (true) {
             CCNxMetaMessage *request = ccnxPortal_Receive(portal, CCNxStackTimeout_Never);
 
@@ -123,34 +417,38 @@ _runProducer(char *fileName, char *repoBase, char *contentName)
                 break;
             }
 
-            CCNxInterest *interest = ccnxMetaMessage_GetInterest(request);
-
-            if (interest != NULL) {
-                CCNxName *interestName = ccnxInterest_GetName(interest);
-                if (ccnxName_Equals(interestName, name)) {
-                    PARCBuffer *digest = ccnxInterest_GetContentObjectHashRestriction(interest);
-                    if (digest != NULL) {
-                        PARCBuffer *chunk = ccnxFileRepoCache_CreateWireEncodedMessageWithDigest(cache, digest);
-                        if (chunk != NULL) {
-                            CCNxMetaMessage *response = ccnxMetaMessage_CreateFromWireFormatBuffer(chunk);
-                            if (ccnxPortal_Send(portal, response, CCNxStackTimeout_Never) == false) {
-                                fprintf(stderr, "ccnxPortal_Send failed: %d\n", ccnxPortal_GetError(portal));
-                            }
-                        }
-                    } else {
-                        CCNxMetaMessage *response = ccnxMetaMessage_CreateFromManifest(manifest);
-                        if (ccnxPortal_Send(portal, response, CCNxStackTimeout_Never) == false) {
-                            fprintf(stderr, "ccnxPortal_Send failed: %d\n", ccnxPortal_GetError(portal));
-                        }
-                    }
-                }
+            if (pool != NULL) {
+                ccnxFileRepoWorkerPool_Submit(pool, request);
+            } else {
+                _respond(responder, portal, NULL, request);
             }
-            ccnxMetaMessage_Release(&request);
         }
     }
 
+    if (pool != NULL) {
+        ccnxFileRepoWorkerPool_Finish(pool);
+        ccnxFileRepoWorkerPool_Release(&pool);
+    }
+    pthread_mutex_destroy(&workerContext.sendLock);
+    if (compacting) {
+        pthread_join(compactionThread, NULL);
+    }
+    if (watcher != NULL) {
+        ccnxFileRepoWatcher_Stop(watcher);
+        ccnxFileRepoWatcher_Release(&watcher);
+    }
+
+    char *cacheString = ccnxFileRepoCache_ToString(cache);
+    printf("%s\n", cacheString);
+    parcMemory_Deallocate(&cacheString);
+
+    // Responses may still reference the mapped repo, so the portal goes first.
+    ccnxPortal_Release(&portal);
+    ccnxPortalFactory_Release(&factory);
+    ccnxFileRepoResponder_Release(&responder);
+    ccnxFileRepoNameTable_Release(&table);
     ccnxFileRepoCache_Release(&cache);
-    ccnxName_Release(&name);
+    ccnxName_Release(&prefix);
 
     return 0;
 }
@@ -167,13 +465,44 @@ _displayUsage(const char *programName)
     printf("This example file transfer application showcases how a Manifest can be created from a file\n");
     printf("stored in a repository, and served upon request from a consumer.\n");
     printf("\n");
-    printf("Usage: %s [-h] <file name> <repo path> <content name>\n", programName);
+    printf("Usage: %s [-h] [--store=files|pack|mmap] [--cache-size=<bytes>] [--threads=<n>] [--queue-depth=<n>] [--build-threads=<n>] [--tree=skewed|balanced] [--fanout=<n>] [--chunk-size=<bytes>] [--group-size=<n>] [--chunking=fixed|content] [--compact] [--watch] [--watch-delay=<ms>] [--compress[=<level>]] [--list] <file name> <repo path> <content name>\n", programName);
     printf("\n");
     printf("   e.g. %s /path/to/file /path/to/repo ccnx:/producer/file\n", programName);
+    printf("        %s /path/to/directory /path/to/repo ccnx:/producer\n", programName);
     printf("\n");
-    printf("  'file name': the path of the file to serve\n");
+    printf("  'file name': the path of the file to serve, or of a directory whose files are all served\n");
     printf("  'repo path': the directory where the Manifest chunks should be stored\n");
-    printf("  'content name': the CCNx name under which the file will be published\n");
+    printf("  'content name': the CCNx name under which the file will be published. Files in a directory are\n");
+    printf("                  published under this prefix, with one name segment per path component\n");
+    printf("  '--list': 'file name' is a list of files to serve, one per line, each optionally followed by its\n");
+    printf("            name under the prefix (by default the last component of its path)\n");
+    printf("  '--store': keep each chunk in its own file (files, the default) or in a single packfile (pack),\n");
+    printf("             optionally served without copies from a memory mapping (mmap)\n");
+    printf("  '--cache-size': memory budget of the in-memory chunk cache, e.g. 256M (default %zuM, 0 disables it)\n",
+           ccnxFileRepoCommon_ServerChunkCacheSize / (1024 * 1024));
+    printf("  '--threads': answer interests with this many worker threads (default 0: on the receiving thread)\n");
+    printf("  '--queue-depth': number of interests that may wait for a worker thread (default %zu)\n",
+           ccnxFileRepoCommon_ServerQueueDepth);
+    printf("  '--build-threads': encode and hash the chunks of each file with this many threads (default 1)\n");
+    printf("  '--tree': chain the manifests of each file one after another (skewed, the default) or build\n");
+    printf("            a balanced tree of them (balanced), which a consumer can descend in parallel\n");
+    printf("  '--fanout': number of children of each manifest of a balanced tree (default %zu)\n",
+           ccnxFileRepoCommon_ServerManifestFanout);
+    printf("  '--chunk-size': size of the chunks each file is cut into, e.g. 32K (default %zu, at most %zu)\n",
+           ccnxFileRepoCommon_ServerChunkSize, ccnxFileRepoCommon_ServerMaximumChunkSize);
+    printf("  '--group-size': most pointers in a manifest hash group (default 0: as many as fit)\n");
+    printf("  '--chunking': cut files into chunks of the chunk size (fixed, the default) or where their content\n");
+    printf("                says (content), with the chunk size as the average and chunks up to 8 times as long,\n");
+    printf("                but no longer than %zu\n", ccnxFileRepoCommon_ServerMaximumChunkSize);
+    printf("  '--compact': once the files are loaded, remove the publications of files that no longer exist\n");
+    printf("               and reclaim the chunks no publication uses, while serving (pack and mmap stores)\n");
+    printf("  '--watch': republish files when they change and serve the new version without a restart\n");
+    printf("  '--watch-delay': republish a changed file once it has not changed for this many milliseconds\n");
+    printf("                   (default %zu), and at most 8 times as long after it first changed\n",
+           ccnxFileRepoCommon_ServerWatchDelay);
+    printf("  '--compress': store new chunks compressed with zstd at this level (default %zu) when it saves space;\n",
+           ccnxFileRepoCommon_ServerCompressionLevel);
+    printf("                stored chunks are decompressed when read, whether or not this is given\n");
     printf("  '-h' will show this help\n\n");
 }
 
@@ -184,10 +513,13 @@ main(int argc, char *argv[argc])
 
     char *commandArgs[argc];
     int commandArgCount = 0;
+    char *commandOptions[argc];
+    int commandOptionCount = 0;
     bool needToShowUsage = false;
     bool shouldExit = false;
 
     status = ccnxFileRepoCommon_ProcessCommandLineArguments(argc, argv, &commandArgCount, commandArgs,
+                                                            &commandOptionCount, commandOptions,
                                                             &needToShowUsage, &shouldExit);
 
     if (needToShowUsage) {
@@ -199,7 +531,77 @@ main(int argc, char *argv[argc])
     }
 
     if (commandArgCount == 3) {
-        return (_runProducer(commandArgs[0], commandArgs[1], commandArgs[2]) ? EXIT_SUCCESS : EXIT_FAILURE);
+        size_t chunkCacheSize = ccnxFileRepoCommon_GetSizeOption(commandOptionCount, commandOptions, "cache-size",
+                                                                 ccnxFileRepoCommon_ServerChunkCacheSize);
+        CCNxFileRepoCacheStorage storage = CCNxFileRepoCacheStorage_Files;
+        const char *store = ccnxFileRepoCommon_GetOption(commandOptionCount, commandOptions, "store");
+        if (store != NULL && strcmp(store, "pack") == 0) {
+            storage = CCNxFileRepoCacheStorage_Pack;
+        } else if (store != NULL && strcmp(store, "mmap") == 0) {
+            storage = CCNxFileRepoCacheStorage_MappedPack;
+        } else if (store != NULL && strcmp(store, "files") != 0) {
+            _displayUsage(argv[0]);
+            return EXIT_FAILURE;
+        }
+        bool sourceIsList = ccnxFileRepoCommon_GetOption(commandOptionCount, commandOptions, "list") != NULL;
+        size_t threadCount = ccnxFileRepoCommon_GetSizeOption(commandOptionCount, commandOptions, "threads", 0);
+        size_t queueDepth = ccnxFileRepoCommon_GetSizeOption(commandOptionCount, commandOptions, "queue-depth",
+                                                             ccnxFileRepoCommon_ServerQueueDepth);
+        size_t buildThreadCount = ccnxFileRepoCommon_GetSizeOption(commandOptionCount, commandOptions, "build-threads", 1);
+        size_t manifestFanout = 0;
+        const char *tree = ccnxFileRepoCommon_GetOption(commandOptionCount, commandOptions, "tree");
+        if (tree != NULL && strcmp(tree, "balanced") == 0) {
+            manifestFanout = ccnxFileRepoCommon_GetSizeOption(commandOptionCount, commandOptions, "fanout",
+                                                              ccnxFileRepoCommon_ServerManifestFanout);
+            if (manifestFanout < 2) {
+                _displayUsage(argv[0]);
+                return EXIT_FAILURE;
+            }
+        } else if (tree != NULL && strcmp(tree, "skewed") != 0) {
+            _displayUsage(argv[0]);
+            return EXIT_FAILURE;
+        }
+        size_t chunkSize = ccnxFileRepoCommon_GetSizeOption(commandOptionCount, commandOptions, "chunk-size",
+                                                            ccnxFileRepoCommon_ServerChunkSize);
+        size_t groupSize = ccnxFileRepoCommon_GetSizeOption(commandOptionCount, commandOptions, "group-size", 0);
+        if (chunkSize == 0 || chunkSize > ccnxFileRepoCommon_ServerMaximumChunkSize || groupSize == 1) {
+            _displayUsage(argv[0]);
+            return EXIT_FAILURE;
+        }
+        bool compact = ccnxFileRepoCommon_GetOption(commandOptionCount, commandOptions, "compact") != NULL;
+        size_t watchDelay = 0;
+        if (ccnxFileRepoCommon_GetOption(commandOptionCount, commandOptions, "watch") != NULL) {
+            watchDelay = ccnxFileRepoCommon_GetSizeOption(commandOptionCount, commandOptions, "watch-delay",
+                                                          ccnxFileRepoCommon_ServerWatchDelay);
+            if (watchDelay == 0) {
+                _displayUsage(argv[0]);
+                return EXIT_FAILURE;
+            }
+        }
+        size_t compressionLevel = 0;
+        if (ccnxFileRepoCommon_GetOption(commandOptionCount, commandOptions, "compress") != NULL) {
+            compressionLevel = ccnxFileRepoCommon_GetSizeOption(commandOptionCount, commandOptions, "compress",
+                                                                ccnxFileRepoCommon_ServerCompressionLevel);
+            if (compressionLevel > 22) {
+                _displayUsage(argv[0]);
+                return EXIT_FAILURE;
+            }
+        }
+        CCNxFileRepoCacheChunking chunking = CCNxFileRepoCacheChunking_Fixed;
+        const char *chunkingOption = ccnxFileRepoCommon_GetOption(commandOptionCount, commandOptions, "chunking");
+        if (chunkingOption != NULL && strcmp(chunkingOption, "content") == 0) {
+            chunking = CCNxFileRepoCacheChunking_Content;
+            if (chunkSize < 64) {
+                _displayUsage(argv[0]);
+                return EXIT_FAILURE;
+            }
+        } else if (chunkingOption != NULL && strcmp(chunkingOption, "fixed") != 0) {
+            _displayUsage(argv[0]);
+            return EXIT_FAILURE;
+        }
+        return (_runProducer(commandArgs[0], sourceIsList, commandArgs[1], commandArgs[2], storage, chunkCacheSize,
+                             threadCount, queueDepth, buildThreadCount, manifestFanout, chunkSize, groupSize,
+                             chunking, compact, watchDelay, (int) compressionLevel) ? EXIT_SUCCESS : EXIT_FAILURE);
     } else {
         status = EXIT_FAILURE;
         _displayUsage(argv[0]);
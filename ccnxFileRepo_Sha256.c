@@ -0,0 +1,560 @@
+/*
+ * Copyright (c) 2016, Xerox Corporation (Xerox) and Palo Alto Research Center, Inc (PARC)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL XEROX OR PARC BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * ################################################################################
+ * #
+ * # PATENT NOTICE
+ * #
+ * # This software is distributed under the BSD 2-clause License (see LICENSE
+ * # file).  This BSD License does not make any patent claims and as such, does
+ * # not act as a patent grant.  The purpose of this section is for each contributor
+ * # to define their intentions with respect to intellectual property.
+ * #
+ * # Each contributor to this source code is encouraged to state their patent
+ * # claims and licensing mechanisms for any contributions made. At the end of
+ * # this section contributors may each make their own statements.  Contributor's
+ * # claims and grants only apply to the pieces (source code, programs, text,
+ * # media, etc) that they have contributed directly to this software.
+ * #
+ * # There is no guarantee that this section is complete, up to date or accurate. It
+ * # is up to the contributors to maintain their portion of this section and up to
+ * # the user of the software to verify any claims herein.
+ * #
+ * # Do not remove this header notification.  The contents of this section must be
+ * # present in all distributions of the software.  You may only modify your own
+ * # intellectual property statements.  Please provide contact information.
+ *
+ * - Palo Alto Research Center, Inc
+ * This software distribution does not grant any rights to patents owned by Palo
+ * Alto Research Center, Inc (PARC). Rights to these patents are available via
+ * various mechanisms. As of January 2016 PARC has committed to FRAND licensing any
+ * intellectual property used by its contributions to this software. You may
+ * contact PARC at cipo@parc.com for more information or visit http://www.ccnx.org
+ */
+/**
+ * @author Christopher A. Wood, Palo Alto Research Center (Xerox PARC)
+ * @copyright (c) 2016, Xerox Corporation (Xerox) and Palo Alto Research Center, Inc (PARC).  All rights reserved.
+ */
+#include <pthread.h>
+#include <string.h>
+
+#if defined(__x86_64__) && defined(__GNUC__)
+#define _ccnxFileRepoSha256_X86 1
+#include <cpuid.h>
+#include <immintrin.h>
+#endif
+
+#include "ccnxFileRepo_Sha256.h"
+
+static const uint32_t _ccnxFileRepoSha256_InitialState[8] = {
+    0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+};
+
+static const uint32_t _ccnxFileRepoSha256_K[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+/**
+ * The most messages a multi-buffer engine hashes at once.
+ */
+#define _ccnxFileRepoSha256_MaximumLanes 16
+
+#define _ccnxFileRepoSha256_RotateRight(x, n) (((x) >> (n)) | ((x) << (32 - (n))))
+
+static inline uint32_t
+_ccnxFileRepoSha256_LoadBigEndian(const uint8_t *bytes)
+{
+    return ((uint32_t) bytes[0] << 24) | ((uint32_t) bytes[1] << 16) | ((uint32_t) bytes[2] << 8) | bytes[3];
+}
+
+static inline void
+_ccnxFileRepoSha256_StoreBigEndian(uint8_t *bytes, uint32_t word)
+{
+    bytes[0] = (uint8_t) (word >> 24);
+    bytes[1] = (uint8_t) (word >> 16);
+    bytes[2] = (uint8_t) (word >> 8);
+    bytes[3] = (uint8_t) word;
+}
+
+/**
+ * Compress `blocks` consecutive 64-byte blocks of one message into `state`.
+ */
+typedef void (_CompressBlocks)(uint32_t state[8], const uint8_t *data, size_t blocks);
+
+/**
+ * Compress one block of each of the messages in the lanes into their states. Both arrays are
+ * transposed: `state[i][lane]` is word i of the state of a lane, and `words[i][lane]` word i
+ * of its block.
+ */
+typedef void (_CompressLanes)(uint32_t state[8][_ccnxFileRepoSha256_MaximumLanes],
+                              const uint32_t words[16][_ccnxFileRepoSha256_MaximumLanes]);
+
+static void
+_ccnxFileRepoSha256_CompressPortable(uint32_t state[8], const uint8_t *data, size_t blocks)
+{
+    while (blocks-- > 0) {
+        uint32_t w[64];
+        for (int t = 0; t < 16; t++) {
+            w[t] = _ccnxFileRepoSha256_LoadBigEndian(data + 4 * t);
+        }
+        for (int t = 16; t < 64; t++) {
+            uint32_t s0 = _ccnxFileRepoSha256_RotateRight(w[t - 15], 7) ^ _ccnxFileRepoSha256_RotateRight(w[t - 15], 18) ^ (w[t - 15] >> 3);
+            uint32_t s1 = _ccnxFileRepoSha256_RotateRight(w[t - 2], 17) ^ _ccnxFileRepoSha256_RotateRight(w[t - 2], 19) ^ (w[t - 2] >> 10);
+            w[t] = w[t - 16] + s0 + w[t - 7] + s1;
+        }
+
+        uint32_t a = state[0], b = state[1], c = state[2], d = state[3];
+        uint32_t e = state[4], f = state[5], g = state[6], h = state[7];
+        for (int t = 0; t < 64; t++) {
+            uint32_t t1 = h + (_ccnxFileRepoSha256_RotateRight(e, 6) ^ _ccnxFileRepoSha256_RotateRight(e, 11) ^ _ccnxFileRepoSha256_RotateRight(e, 25))
+                          + ((e & f) ^ (~e & g)) + _ccnxFileRepoSha256_K[t] + w[t];
+            uint32_t t2 = (_ccnxFileRepoSha256_RotateRight(a, 2) ^ _ccnxFileRepoSha256_RotateRight(a, 13) ^ _ccnxFileRepoSha256_RotateRight(a, 22))
+                          + ((a & b) ^ (a & c) ^ (b & c));
+            h = g;
+            g = f;
+            f = e;
+            e = d + t1;
+            d = c;
+            c = b;
+            b = a;
+            a = t1 + t2;
+        }
+        state[0] += a;
+        state[1] += b;
+        state[2] += c;
+        state[3] += d;
+        state[4] += e;
+        state[5] += f;
+        state[6] += g;
+        state[7] += h;
+
+        data += 64;
+    }
+}
+
+#ifdef _ccnxFileRepoSha256_X86
+/**
+ * The SHA extensions compute two rounds per instruction on a state split into the ABEF and
+ * CDGH halves, and extend the message schedule four words at a time.
+ */
+__attribute__((target("sha,sse4.1")))
+static void
+_ccnxFileRepoSha256_CompressShaNi(uint32_t state[8], const uint8_t *data, size_t blocks)
+{
+    const __m128i byteSwap = _mm_set_epi64x(0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL);
+
+    __m128i dcba = _mm_loadu_si128((const __m128i *) &state[0]);
+    __m128i hgfe = _mm_loadu_si128((const __m128i *) &state[4]);
+    __m128i cdab = _mm_shuffle_epi32(dcba, 0xB1);
+    __m128i efgh = _mm_shuffle_epi32(hgfe, 0x1B);
+    __m128i abef = _mm_alignr_epi8(cdab, efgh, 8);
+    __m128i cdgh = _mm_blend_epi16(efgh, cdab, 0xF0);
+
+    while (blocks-- > 0) {
+        __m128i savedAbef = abef;
+        __m128i savedCdgh = cdgh;
+
+        __m128i schedule[4];
+        for (int i = 0; i < 4; i++) {
+            schedule[i] = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *) (data + 16 * i)), byteSwap);
+        }
+
+#pragma GCC unroll 16
+        for (int i = 0; i < 16; i++) {
+            if (i >= 4) {
+                // schedule[i % 4] still holds the words of four rounds ago
+                __m128i previous = schedule[(i - 1) & 3];
+                __m128i sevenBack = _mm_alignr_epi8(previous, schedule[(i - 2) & 3], 4);
+                __m128i next = _mm_sha256msg1_epu32(schedule[i & 3], schedule[(i - 3) & 3]);
+                next = _mm_add_epi32(next, sevenBack);
+                schedule[i & 3] = _mm_sha256msg2_epu32(next, previous);
+            }
+            __m128i message = _mm_add_epi32(schedule[i & 3], _mm_loadu_si128((const __m128i *) &_ccnxFileRepoSha256_K[4 * i]));
+            cdgh = _mm_sha256rnds2_epu32(cdgh, abef, message);
+            message = _mm_shuffle_epi32(message, 0x0E);
+            abef = _mm_sha256rnds2_epu32(abef, cdgh, message);
+        }
+
+        abef = _mm_add_epi32(abef, savedAbef);
+        cdgh = _mm_add_epi32(cdgh, savedCdgh);
+        data += 64;
+    }
+
+    __m128i feba = _mm_shuffle_epi32(abef, 0x1B);
+    __m128i dchg = _mm_shuffle_epi32(cdgh, 0xB1);
+    _mm_storeu_si128((__m128i *) &state[0], _mm_blend_epi16(feba, dchg, 0xF0));
+    _mm_storeu_si128((__m128i *) &state[4], _mm_alignr_epi8(dchg, feba, 8));
+}
+
+/**
+ * Define a `_CompressLanes` function for `LANES` lanes, compiled for the instruction set
+ * `TARGET`. The compiler turns the vector arithmetic into instructions of that width.
+ */
+#define _ccnxFileRepoSha256_DefineCompressLanes(NAME, LANES, TARGET)                                                  \
+    typedef uint32_t NAME ## _Vector __attribute__((vector_size(4 * (LANES))));                                        \
+                                                                                                                       \
+    __attribute__((target(TARGET)))                                                                                    \
+    static void                                                                                                        \
+    NAME(uint32_t state[8][_ccnxFileRepoSha256_MaximumLanes], const uint32_t words[16][_ccnxFileRepoSha256_MaximumLanes]) \
+    {                                                                                                                  \
+        NAME ## _Vector w[16];                                                                                         \
+        NAME ## _Vector v[8];                                                                                          \
+        for (int i = 0; i < 16; i++) {                                                                                 \
+            memcpy(&w[i], words[i], sizeof(w[i]));                                                                     \
+        }                                                                                                              \
+        for (int i = 0; i < 8; i++) {                                                                                  \
+            memcpy(&v[i], state[i], sizeof(v[i]));                                                                     \
+        }                                                                                                              \
+        NAME ## _Vector a = v[0], b = v[1], c = v[2], d = v[3], e = v[4], f = v[5], g = v[6], h = v[7];                \
+        _Pragma("GCC unroll 64")                                                                                       \
+        for (int t = 0; t < 64; t++) {                                                                                 \
+            if (t >= 16) {                                                                                             \
+                NAME ## _Vector w15 = w[(t - 15) & 15];                                                                \
+                NAME ## _Vector w2 = w[(t - 2) & 15];                                                                  \
+                w[t & 15] += (_ccnxFileRepoSha256_RotateRight(w15, 7) ^ _ccnxFileRepoSha256_RotateRight(w15, 18) ^ (w15 >> 3)) \
+                             + w[(t - 7) & 15]                                                                         \
+                             + (_ccnxFileRepoSha256_RotateRight(w2, 17) ^ _ccnxFileRepoSha256_RotateRight(w2, 19) ^ (w2 >> 10)); \
+            }                                                                                                          \
+            NAME ## _Vector t1 = h + (_ccnxFileRepoSha256_RotateRight(e, 6) ^ _ccnxFileRepoSha256_RotateRight(e, 11)     \
+                                      ^ _ccnxFileRepoSha256_RotateRight(e, 25))                                        \
+                                 + ((e & f) ^ (~e & g)) + _ccnxFileRepoSha256_K[t] + w[t & 15];                        \
+            NAME ## _Vector t2 = (_ccnxFileRepoSha256_RotateRight(a, 2) ^ _ccnxFileRepoSha256_RotateRight(a, 13)         \
+                                  ^ _ccnxFileRepoSha256_RotateRight(a, 22))                                            \
+                                 + ((a & b) ^ (a & c) ^ (b & c));                                                      \
+            h = g;                                                                                                     \
+            g = f;                                                                                                     \
+            f = e;                                                                                                     \
+            e = d + t1;                                                                                                \
+            d = c;                                                                                                     \
+            c = b;                                                                                                     \
+            b = a;                                                                                                     \
+            a = t1 + t2;                                                                                               \
+        }                                                                                                              \
+        v[0] += a;                                                                                                     \
+        v[1] += b;                                                                                                     \
+        v[2] += c;                                                                                                     \
+        v[3] += d;                                                                                                     \
+        v[4] += e;                                                                                                     \
+        v[5] += f;                                                                                                     \
+        v[6] += g;                                                                                                     \
+        v[7] += h;                                                                                                     \
+        for (int i = 0; i < 8; i++) {                                                                                  \
+            memcpy(state[i], &v[i], sizeof(v[i]));                                                                     \
+        }                                                                                                              \
+    }
+
+_ccnxFileRepoSha256_DefineCompressLanes(_ccnxFileRepoSha256_CompressAvx2, 8, "avx2")
+_ccnxFileRepoSha256_DefineCompressLanes(_ccnxFileRepoSha256_CompressAvx512, 16, "avx512f")
+#endif
+
+typedef struct {
+    CCNxFileRepoSha256Engine engine;
+    _CompressBlocks *compressBlocks;
+    _CompressLanes *compressLanes;
+    size_t lanes;
+} _Sha256Dispatch;
+
+static pthread_once_t _ccnxFileRepoSha256_DispatchOnce = PTHREAD_ONCE_INIT;
+static _Sha256Dispatch _ccnxFileRepoSha256_Dispatch;
+
+bool
+ccnxFileRepoSha256_IsEngineAvailable(CCNxFileRepoSha256Engine engine)
+{
+    switch (engine) {
+        case CCNxFileRepoSha256Engine_Portable:
+            return true;
+#ifdef _ccnxFileRepoSha256_X86
+        case CCNxFileRepoSha256Engine_ShaNi: {
+            unsigned int eax, ebx, ecx, edx;
+            return __builtin_cpu_supports("sse4.1")
+                   && __get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx) && (ebx & (1u << 29)) != 0;
+        }
+        case CCNxFileRepoSha256Engine_Avx2:
+            return __builtin_cpu_supports("avx2");
+        case CCNxFileRepoSha256Engine_Avx512:
+            return __builtin_cpu_supports("avx512f");
+#endif
+        default:
+            return false;
+    }
+}
+
+static void
+_ccnxFileRepoSha256_Select(CCNxFileRepoSha256Engine engine)
+{
+    _Sha256Dispatch dispatch = {
+        .engine = engine, .compressBlocks = _ccnxFileRepoSha256_CompressPortable, .compressLanes = NULL, .lanes = 1
+    };
+#ifdef _ccnxFileRepoSha256_X86
+    if (engine != CCNxFileRepoSha256Engine_Portable && ccnxFileRepoSha256_IsEngineAvailable(CCNxFileRepoSha256Engine_ShaNi)) {
+        dispatch.compressBlocks = _ccnxFileRepoSha256_CompressShaNi;
+    }
+    if (engine == CCNxFileRepoSha256Engine_Avx2) {
+        dispatch.compressLanes = _ccnxFileRepoSha256_CompressAvx2;
+        dispatch.lanes = 8;
+    } else if (engine == CCNxFileRepoSha256Engine_Avx512) {
+        dispatch.compressLanes = _ccnxFileRepoSha256_CompressAvx512;
+        dispatch.lanes = 16;
+    }
+#endif
+    _ccnxFileRepoSha256_Dispatch = dispatch;
+}
+
+/**
+ * Pick the default engine. The SHA extensions beat 8 AVX2 lanes, but not 16 AVX-512 lanes
+ * when there are enough messages to fill them.
+ */
+static void
+_ccnxFileRepoSha256_SelectBest(void)
+{
+    static const CCNxFileRepoSha256Engine preference[] = {
+        CCNxFileRepoSha256Engine_Avx512, CCNxFileRepoSha256Engine_ShaNi, CCNxFileRepoSha256Engine_Avx2
+    };
+    CCNxFileRepoSha256Engine engine = CCNxFileRepoSha256Engine_Portable;
+    for (size_t i = sizeof(preference) / sizeof(preference[0]); i > 0; i--) {
+        if (ccnxFileRepoSha256_IsEngineAvailable(preference[i - 1])) {
+            engine = preference[i - 1];
+        }
+    }
+    _ccnxFileRepoSha256_Select(engine);
+}
+
+static const _Sha256Dispatch *
+_ccnxFileRepoSha256_GetDispatch(void)
+{
+    pthread_once(&_ccnxFileRepoSha256_DispatchOnce, _ccnxFileRepoSha256_SelectBest);
+    return &_ccnxFileRepoSha256_Dispatch;
+}
+
+CCNxFileRepoSha256Engine
+ccnxFileRepoSha256_GetEngine(void)
+{
+    return _ccnxFileRepoSha256_GetDispatch()->engine;
+}
+
+bool
+ccnxFileRepoSha256_SetEngine(CCNxFileRepoSha256Engine engine)
+{
+    _ccnxFileRepoSha256_GetDispatch();
+    if (!ccnxFileRepoSha256_IsEngineAvailable(engine)) {
+        return false;
+    }
+    _ccnxFileRepoSha256_Select(engine);
+    return true;
+}
+
+const char *
+ccnxFileRepoSha256_GetEngineName(CCNxFileRepoSha256Engine engine)
+{
+    switch (engine) {
+        case CCNxFileRepoSha256Engine_Portable:
+            return "portable";
+        case CCNxFileRepoSha256Engine_ShaNi:
+            return "sha-ni";
+        case CCNxFileRepoSha256Engine_Avx2:
+            return "avx2x8";
+        case CCNxFileRepoSha256Engine_Avx512:
+            return "avx512x16";
+        default:
+            return "unknown";
+    }
+}
+
+void
+ccnxFileRepoSha256_Init(CCNxFileRepoSha256 *sha)
+{
+    memcpy(sha->state, _ccnxFileRepoSha256_InitialState, sizeof(sha->state));
+    sha->length = 0;
+}
+
+void
+ccnxFileRepoSha256_Update(CCNxFileRepoSha256 *sha, const void *data, size_t length)
+{
+    _CompressBlocks *compressBlocks = _ccnxFileRepoSha256_GetDispatch()->compressBlocks;
+    const uint8_t *bytes = data;
+
+    size_t buffered = sha->length % 64;
+    sha->length += length;
+    if (buffered > 0) {
+        size_t needed = 64 - buffered;
+        if (length < needed) {
+            memcpy(sha->block + buffered, bytes, length);
+            return;
+        }
+        memcpy(sha->block + buffered, bytes, needed);
+        compressBlocks(sha->state, sha->block, 1);
+        bytes += needed;
+        length -= needed;
+    }
+
+    compressBlocks(sha->state, bytes, length / 64);
+    memcpy(sha->block, bytes + (length & ~(size_t) 63), length % 64);
+}
+
+/**
+ * Write the padding of a message of `length` bytes, whose last `length % 64` bytes are
+ * `tail`, into `blocks`. Return the number of blocks written, 1 or 2.
+ */
+static size_t
+_ccnxFileRepoSha256_Pad(const uint8_t *tail, uint64_t length, uint8_t blocks[128])
+{
+    size_t tailLength = length % 64;
+    size_t blockCount = (tailLength + 9 <= 64) ? 1 : 2;
+
+    memcpy(blocks, tail, tailLength);
+    blocks[tailLength] = 0x80;
+    memset(blocks + tailLength + 1, 0, 64 * blockCount - tailLength - 1);
+    uint64_t bits = length * 8;
+    for (int i = 0; i < 8; i++) {
+        blocks[64 * blockCount - 1 - i] = (uint8_t) (bits >> (8 * i));
+    }
+    return blockCount;
+}
+
+void
+ccnxFileRepoSha256_Final(CCNxFileRepoSha256 *sha, uint8_t digest[CCNxFileRepoSha256_DigestLength])
+{
+    uint8_t blocks[128];
+    size_t blockCount = _ccnxFileRepoSha256_Pad(sha->block, sha->length, blocks);
+    _ccnxFileRepoSha256_GetDispatch()->compressBlocks(sha->state, blocks, blockCount);
+
+    for (int i = 0; i < 8; i++) {
+        _ccnxFileRepoSha256_StoreBigEndian(digest + 4 * i, sha->state[i]);
+    }
+}
+
+void
+ccnxFileRepoSha256_Digest(const void *data, size_t length, uint8_t digest[CCNxFileRepoSha256_DigestLength])
+{
+    CCNxFileRepoSha256 sha;
+    ccnxFileRepoSha256_Init(&sha);
+
+    // Hash the whole blocks in place; only the tail is copied.
+    size_t whole = length & ~(size_t) 63;
+    _ccnxFileRepoSha256_GetDispatch()->compressBlocks(sha.state, data, whole / 64);
+    sha.length = length;
+    memcpy(sha.block, (const uint8_t *) data + whole, length - whole);
+    ccnxFileRepoSha256_Final(&sha, digest);
+}
+
+/**
+ * The message in one lane of a multi-buffer engine: its whole blocks are read in place, and
+ * its padded tail from `tail`.
+ */
+typedef struct {
+    size_t message;
+    const uint8_t *data;
+    size_t block;
+    size_t wholeBlocks;
+    size_t blocks;
+    uint8_t tail[128];
+} _Sha256Lane;
+
+static void
+_ccnxFileRepoSha256_StartLane(_Sha256Lane *lane, size_t laneIndex, uint32_t state[8][_ccnxFileRepoSha256_MaximumLanes],
+                              size_t message, const uint8_t *data, size_t length)
+{
+    lane->message = message;
+    lane->data = data;
+    lane->block = 0;
+    lane->wholeBlocks = length / 64;
+    lane->blocks = lane->wholeBlocks + _ccnxFileRepoSha256_Pad(data + 64 * lane->wholeBlocks, length, lane->tail);
+    for (int i = 0; i < 8; i++) {
+        state[i][laneIndex] = _ccnxFileRepoSha256_InitialState[i];
+    }
+}
+
+static void
+_ccnxFileRepoSha256_DigestLanes(const _Sha256Dispatch *dispatch, size_t count, const uint8_t *const data[],
+                                const size_t lengths[], uint8_t digests[][CCNxFileRepoSha256_DigestLength])
+{
+    uint32_t state[8][_ccnxFileRepoSha256_MaximumLanes] __attribute__((aligned(64)));
+    uint32_t words[16][_ccnxFileRepoSha256_MaximumLanes] __attribute__((aligned(64)));
+    _Sha256Lane lanes[_ccnxFileRepoSha256_MaximumLanes];
+    bool active[_ccnxFileRepoSha256_MaximumLanes] = { false };
+
+    size_t next = 0;
+    size_t activeCount = 0;
+    for (size_t lane = 0; lane < dispatch->lanes && next < count; lane++, next++) {
+        _ccnxFileRepoSha256_StartLane(&lanes[lane], lane, state, next, data[next], lengths[next]);
+        active[lane] = true;
+        activeCount++;
+    }
+
+    while (activeCount > 0) {
+        // Transpose the next block of every lane; an idle lane hashes zeros that are never read.
+        for (size_t lane = 0; lane < dispatch->lanes; lane++) {
+            if (!active[lane]) {
+                for (int i = 0; i < 16; i++) {
+                    words[i][lane] = 0;
+                }
+                continue;
+            }
+            const _Sha256Lane *l = &lanes[lane];
+            const uint8_t *block = (l->block < l->wholeBlocks) ? l->data + 64 * l->block : l->tail + 64 * (l->block - l->wholeBlocks);
+            for (int i = 0; i < 16; i++) {
+                words[i][lane] = _ccnxFileRepoSha256_LoadBigEndian(block + 4 * i);
+            }
+        }
+
+        dispatch->compressLanes(state, (const uint32_t (*)[_ccnxFileRepoSha256_MaximumLanes]) words);
+
+        for (size_t lane = 0; lane < dispatch->lanes; lane++) {
+            if (!active[lane] || ++lanes[lane].block < lanes[lane].blocks) {
+                continue;
+            }
+            for (int i = 0; i < 8; i++) {
+                _ccnxFileRepoSha256_StoreBigEndian(digests[lanes[lane].message] + 4 * i, state[i][lane]);
+            }
+            if (next < count) {
+                _ccnxFileRepoSha256_StartLane(&lanes[lane], lane, state, next, data[next], lengths[next]);
+                next++;
+            } else {
+                active[lane] = false;
+                activeCount--;
+            }
+        }
+    }
+}
+
+void
+ccnxFileRepoSha256_DigestMany(size_t count, const uint8_t *const data[], const size_t lengths[],
+                              uint8_t digests[][CCNxFileRepoSha256_DigestLength])
+{
+    const _Sha256Dispatch *dispatch = _ccnxFileRepoSha256_GetDispatch();
+    if (dispatch->compressLanes != NULL && 2 * count >= dispatch->lanes) {
+        _ccnxFileRepoSha256_DigestLanes(dispatch, count, data, lengths, digests);
+    } else {
+        for (size_t i = 0; i < count; i++) {
+            ccnxFileRepoSha256_Digest(data[i], lengths[i], digests[i]);
+        }
+    }
+}
@@ -0,0 +1,202 @@
+/*
+ * Copyright (c) 2016, Xerox Corporation (Xerox) and Palo Alto Research Center, Inc (PARC)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL XEROX OR PARC BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * ################################################################################
+ * #
+ * # PATENT NOTICE
+ * #
+ * # This software is distributed under the BSD 2-clause License (see LICENSE
+ * # file).  This BSD License does not make any patent claims and as such, does
+ * # not act as a patent grant.  The purpose of this section is for each contributor
+ * # to define their intentions with respect to intellectual property.
+ * #
+ * # Each contributor to this source code is encouraged to state their patent
+ * # claims and licensing mechanisms for any contributions made. At the end of
+ * # this section contributors may each make their own statements.  Contributor's
+ * # claims and grants only apply to the pieces (source code, programs, text,
+ * # media, etc) that they have contributed directly to this software.
+ * #
+ * # There is no guarantee that this section is complete, up to date or accurate. It
+ * # is up to the contributors to maintain their portion of this section and up to
+ * # the user of the software to verify any claims herein.
+ * #
+ * # Do not remove this header notification.  The contents of this section must be
+ * # present in all distributions of the software.  You may only modify your own
+ * # intellectual property statements.  Please provide contact information.
+ *
+ * - Palo Alto Research Center, Inc
+ * This software distribution does not grant any rights to patents owned by Palo
+ * Alto Research Center, Inc (PARC). Rights to these patents are available via
+ * various mechanisms. As of January 2016 PARC has committed to FRAND licensing any
+ * intellectual property used by its contributions to this software. You may
+ * contact PARC at cipo@parc.com for more information or visit http://www.ccnx.org
+ */
+/**
+ * @author Christopher A. Wood, Palo Alto Research Center (Xerox PARC)
+ * @copyright (c) 2016, Xerox Corporation (Xerox) and Palo Alto Research Center, Inc (PARC).  All rights reserved.
+ */
+
+#ifndef ccnxFileRepoSha256_h
+#define ccnxFileRepoSha256_h
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define CCNxFileRepoSha256_DigestLength 32
+
+/**
+ * The implementations of SHA-256. Which ones are available depends on the processor, and the
+ * best available one is used unless `ccnxFileRepoSha256_SetEngine` picks another.
+ */
+typedef enum {
+    CCNxFileRepoSha256Engine_Portable,  // plain C, one message at a time
+    CCNxFileRepoSha256Engine_ShaNi,     // the x86 SHA extensions, one message at a time
+    CCNxFileRepoSha256Engine_Avx2,      // AVX2, 8 messages at once
+    CCNxFileRepoSha256Engine_Avx512     // AVX-512, 16 messages at once
+} CCNxFileRepoSha256Engine;
+
+/**
+ * The state of an incremental SHA-256 computation, for data that does not arrive at once,
+ * e.g., the digest of a whole file fed one chunk at a time.
+ */
+typedef struct {
+    uint32_t state[8];
+    uint64_t length;
+    uint8_t block[64];
+} CCNxFileRepoSha256;
+
+/**
+ * Return true if the processor supports `engine`.
+ *
+ * @param [in] engine A `CCNxFileRepoSha256Engine`.
+ *
+ * @return true if @p engine can be used.
+ */
+bool ccnxFileRepoSha256_IsEngineAvailable(CCNxFileRepoSha256Engine engine);
+
+/**
+ * Return the engine that `ccnxFileRepoSha256_DigestMany` uses.
+ *
+ * @return The engine chosen by `ccnxFileRepoSha256_SetEngine`, or the best one available.
+ */
+CCNxFileRepoSha256Engine ccnxFileRepoSha256_GetEngine(void);
+
+/**
+ * Use `engine` from now on, e.g., to compare the engines in a benchmark.
+ *
+ * The multi-buffer engines only apply to `ccnxFileRepoSha256_DigestMany`; a single message
+ * is hashed with the SHA extensions if the processor has them, unless `engine` is
+ * `CCNxFileRepoSha256Engine_Portable`, which uses plain C for everything.
+ *
+ * This must not be called while other threads compute digests.
+ *
+ * @param [in] engine A `CCNxFileRepoSha256Engine`.
+ *
+ * @return true if the engine is used, false if the processor does not support it.
+ */
+bool ccnxFileRepoSha256_SetEngine(CCNxFileRepoSha256Engine engine);
+
+/**
+ * Return the name of `engine`, e.g., "avx2x8".
+ *
+ * @param [in] engine A `CCNxFileRepoSha256Engine`.
+ *
+ * @return A static, null-terminated string.
+ */
+const char *ccnxFileRepoSha256_GetEngineName(CCNxFileRepoSha256Engine engine);
+
+/**
+ * Start an incremental SHA-256 computation.
+ *
+ * @param [out] sha The state to initialize.
+ *
+ * Example:
+ * @code
+ * {
+ *     CCNxFileRepoSha256 sha;
+ *     uint8_t digest[CCNxFileRepoSha256_DigestLength];
+ *
+ *     ccnxFileRepoSha256_Init(&sha);
+ *     ccnxFileRepoSha256_Update(&sha, "abc", 3);
+ *     ccnxFileRepoSha256_Final(&sha, digest);
+ * }
+ * @endcode
+ */
+void ccnxFileRepoSha256_Init(CCNxFileRepoSha256 *sha);
+
+/**
+ * Add `length` bytes to an incremental SHA-256 computation.
+ *
+ * @param [in,out] sha The state of the computation.
+ * @param [in] data The bytes to add.
+ * @param [in] length The number of bytes to add.
+ */
+void ccnxFileRepoSha256_Update(CCNxFileRepoSha256 *sha, const void *data, size_t length);
+
+/**
+ * Finish an incremental SHA-256 computation.
+ *
+ * @param [in,out] sha The state of the computation, which must be initialized again to be reused.
+ * @param [out] digest Set to the digest of all the bytes added.
+ */
+void ccnxFileRepoSha256_Final(CCNxFileRepoSha256 *sha, uint8_t digest[CCNxFileRepoSha256_DigestLength]);
+
+/**
+ * Compute the SHA-256 digest of one message.
+ *
+ * @param [in] data The message.
+ * @param [in] length The length of the message.
+ * @param [out] digest Set to the digest of the message.
+ */
+void ccnxFileRepoSha256_Digest(const void *data, size_t length, uint8_t digest[CCNxFileRepoSha256_DigestLength]);
+
+/**
+ * Compute the SHA-256 digests of `count` independent messages.
+ *
+ * A single message is a chain of dependent compressions, so one core cannot hash it any
+ * faster than one block after another. Independent messages, such as the chunks of a file,
+ * can be hashed side by side: the AVX2 and AVX-512 engines hash 8 or 16 of them at once, one
+ * in each lane of the vector registers, and move the next message into a lane as soon as its
+ * previous one is done, so messages of different lengths can be mixed. With fewer messages
+ * than half the lanes, or without a multi-buffer engine, the messages are hashed one at a time.
+ *
+ * @param [in] count The number of messages.
+ * @param [in] data The messages.
+ * @param [in] lengths The lengths of the messages.
+ * @param [out] digests Set to the digests of the messages, in the same order.
+ *
+ * Example:
+ * @code
+ * {
+ *     const uint8_t *data[2] = { first, second };
+ *     size_t lengths[2] = { firstLength, secondLength };
+ *     uint8_t digests[2][CCNxFileRepoSha256_DigestLength];
+ *     ccnxFileRepoSha256_DigestMany(2, data, lengths, digests);
+ * }
+ * @endcode
+ */
+void ccnxFileRepoSha256_DigestMany(size_t count, const uint8_t *const data[], const size_t lengths[],
+                                   uint8_t digests[][CCNxFileRepoSha256_DigestLength]);
+#endif // ccnxFileRepoSha256_h
@@ -0,0 +1,360 @@
+/*
+ * Copyright (c) 2016, Xerox Corporation (Xerox) and Palo Alto Research Center, Inc (PARC)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL XEROX OR PARC BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * ################################################################################
+ * #
+ * # PATENT NOTICE
+ * #
+ * # This software is distributed under the BSD 2-clause License (see LICENSE
+ * # file).  This BSD License does not make any patent claims and as such, does
+ * # not act as a patent grant.  The purpose of this section is for each contributor
+ * # to define their intentions with respect to intellectual property.
+ * #
+ * # Each contributor to this source code is encouraged to state their patent
+ * # claims and licensing mechanisms for any contributions made. At the end of
+ * # this section contributors may each make their own statements.  Contributor's
+ * # claims and grants only apply to the pieces (source code, programs, text,
+ * # media, etc) that they have contributed directly to this software.
+ * #
+ * # There is no guarantee that this section is complete, up to date or accurate. It
+ * # is up to the contributors to maintain their portion of this section and up to
+ * # the user of the software to verify any claims herein.
+ * #
+ * # Do not remove this header notification.  The contents of this section must be
+ * # present in all distributions of the software.  You may only modify your own
+ * # intellectual property statements.  Please provide contact information.
+ *
+ * - Palo Alto Research Center, Inc
+ * This software distribution does not grant any rights to patents owned by Palo
+ * Alto Research Center, Inc (PARC). Rights to these patents are available via
+ * various mechanisms. As of January 2016 PARC has committed to FRAND licensing any
+ * intellectual property used by its contributions to this software. You may
+ * contact PARC at cipo@parc.com for more information or visit http://www.ccnx.org
+ */
+/**
+ * @author Christopher A. Wood, Palo Alto Research Center (Xerox PARC)
+ * @copyright (c) 2016, Xerox Corporation (Xerox) and Palo Alto Research Center, Inc (PARC).  All rights reserved.
+ */
+#include <LongBow/runtime.h>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#endif
+
+#include <parc/algol/parc_Object.h>
+#include <parc/algol/parc_Memory.h>
+
+#include "ccnxFileRepo_Watcher.h"
+
+/**
+ * However often a file changes, it is republished at most this many delays after its first change.
+ */
+static const size_t _ccnxFileRepoWatcher_MaximumDelays = 8;
+
+typedef struct {
+    CCNxName *name;
+    char *path;
+    const char *baseName; // the last component of path
+    int watch;            // the watch descriptor of the directory of the file
+
+    bool changed;
+    double firstChange;
+    double lastChange;
+} _WatchedFile;
+
+struct ccnx_file_repo_watcher {
+    CCNxFileRepoCache *cache;
+    CCNxFileRepoNameTable *table;
+    double delay; // in seconds
+
+    int inotifyFd;
+    int wakeFds[2]; // written to stop the thread
+    pthread_t thread;
+    bool running;
+
+    _WatchedFile *files;
+    size_t fileCount;
+    size_t fileCapacity;
+};
+
+static double
+_ccnxFileRepoWatcher_Now(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+static bool
+_ccnxFileRepoWatcher_Destructor(CCNxFileRepoWatcher **watcherPtr)
+{
+    CCNxFileRepoWatcher *watcher = *watcherPtr;
+
+    ccnxFileRepoWatcher_Stop(watcher);
+    for (size_t i = 0; i < watcher->fileCount; i++) {
+        ccnxName_Release(&watcher->files[i].name);
+        parcMemory_Deallocate(&watcher->files[i].path);
+    }
+    if (watcher->files != NULL) {
+        parcMemory_Deallocate(&watcher->files);
+    }
+    if (watcher->inotifyFd >= 0) {
+        close(watcher->inotifyFd);
+    }
+    if (watcher->wakeFds[0] >= 0) {
+        close(watcher->wakeFds[0]);
+        close(watcher->wakeFds[1]);
+    }
+    ccnxFileRepoNameTable_Release(&watcher->table);
+    ccnxFileRepoCache_Release(&watcher->cache);
+    return true;
+}
+
+parcObject_Override(CCNxFileRepoWatcher, PARCObject,
+                    .destructor = (PARCObjectDestructor *) _ccnxFileRepoWatcher_Destructor);
+
+parcObject_ImplementAcquire(ccnxFileRepoWatcher, CCNxFileRepoWatcher);
+parcObject_ImplementRelease(ccnxFileRepoWatcher, CCNxFileRepoWatcher);
+
+CCNxFileRepoWatcher *
+ccnxFileRepoWatcher_Create(CCNxFileRepoCache *cache, CCNxFileRepoNameTable *table, size_t delay)
+{
+#ifdef __linux__
+    int inotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+#else
+    int inotifyFd = -1;
+#endif
+    if (inotifyFd < 0) {
+        return NULL;
+    }
+
+    CCNxFileRepoWatcher *watcher = parcObject_CreateAndClearInstance(CCNxFileRepoWatcher);
+    if (watcher == NULL) {
+        close(inotifyFd);
+        return NULL;
+    }
+
+    watcher->cache = ccnxFileRepoCache_Acquire(cache);
+    watcher->table = ccnxFileRepoNameTable_Acquire(table);
+    watcher->delay = delay / 1e3;
+    watcher->inotifyFd = inotifyFd;
+    watcher->running = false;
+    watcher->files = NULL;
+    if (pipe(watcher->wakeFds) != 0) {
+        watcher->wakeFds[0] = -1;
+        ccnxFileRepoWatcher_Release(&watcher);
+    }
+    return watcher;
+}
+
+bool
+ccnxFileRepoWatcher_Add(CCNxFileRepoWatcher *watcher, const CCNxName *name, const char *path)
+{
+    assertFalse(watcher->running, "Files must be added before the watcher is started");
+
+    // Watch the directory rather than the file: an editor that saves by writing a new file
+    // and renaming it over the old one leaves a watch on the old file with nothing to report.
+    const char *slash = strrchr(path, '/');
+    char *directory = (slash == NULL) ? parcMemory_StringDuplicate(".", 1)
+                      : (slash == path) ? parcMemory_StringDuplicate("/", 1)
+                      : parcMemory_StringDuplicate(path, slash - path);
+#ifdef __linux__
+    int watch = inotify_add_watch(watcher->inotifyFd, directory, IN_CLOSE_WRITE | IN_MODIFY | IN_MOVED_TO | IN_CREATE);
+#else
+    int watch = -1;
+#endif
+    parcMemory_Deallocate(&directory);
+    if (watch < 0) {
+        return false;
+    }
+
+    if (watcher->fileCount == watcher->fileCapacity) {
+        watcher->fileCapacity = (watcher->fileCapacity == 0) ? 16 : watcher->fileCapacity * 2;
+        watcher->files = parcMemory_Reallocate(watcher->files, watcher->fileCapacity * sizeof(_WatchedFile));
+    }
+
+    _WatchedFile *file = &watcher->files[watcher->fileCount++];
+    memset(file, 0, sizeof(*file));
+    file->name = ccnxName_Acquire(name);
+    file->path = parcMemory_StringDuplicate(path, strlen(path));
+    file->baseName = (slash == NULL) ? file->path : file->path + (slash - path) + 1;
+    file->watch = watch;
+    return true;
+}
+
+size_t
+ccnxFileRepoWatcher_GetCount(const CCNxFileRepoWatcher *watcher)
+{
+    return watcher->fileCount;
+}
+
+static void
+_ccnxFileRepoWatcher_MarkChanged(_WatchedFile *file, double now)
+{
+    if (!file->changed) {
+        file->changed = true;
+        file->firstChange = now;
+    }
+    file->lastChange = now;
+}
+
+/**
+ * Read the pending inotify events and mark the files they are about as changed.
+ */
+static void
+_ccnxFileRepoWatcher_ReadEvents(CCNxFileRepoWatcher *watcher)
+{
+#ifdef __linux__
+    char buffer[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+    double now = _ccnxFileRepoWatcher_Now();
+
+    ssize_t length;
+    while ((length = read(watcher->inotifyFd, buffer, sizeof(buffer))) > 0) {
+        for (char *p = buffer; p < buffer + length; p += sizeof(struct inotify_event) + ((struct inotify_event *) p)->len) {
+            const struct inotify_event *event = (const struct inotify_event *) p;
+
+            // Events were lost, so any file may have changed.
+            bool overflow = (event->mask & IN_Q_OVERFLOW) != 0;
+            for (size_t i = 0; i < watcher->fileCount; i++) {
+                _WatchedFile *file = &watcher->files[i];
+                if (overflow || (event->wd == file->watch && event->len > 0 && strcmp(event->name, file->baseName) == 0)) {
+                    _ccnxFileRepoWatcher_MarkChanged(file, now);
+                }
+            }
+        }
+    }
+#endif
+}
+
+/**
+ * Return when the changed file should be republished: once it has been quiet for the
+ * delay, but no later than the maximum delay after its first change.
+ */
+static double
+_ccnxFileRepoWatcher_DueTime(const CCNxFileRepoWatcher *watcher, const _WatchedFile *file)
+{
+    double quiet = file->lastChange + watcher->delay;
+    double latest = file->firstChange + watcher->delay * _ccnxFileRepoWatcher_MaximumDelays;
+    return (quiet < latest) ? quiet : latest;
+}
+
+static void
+_ccnxFileRepoWatcher_Republish(CCNxFileRepoWatcher *watcher, _WatchedFile *file)
+{
+    char *nameString = ccnxName_ToString(file->name);
+
+    CCNxManifest *root = ccnxFileRepoCache_PublishFile(watcher->cache, file->name, file->path);
+    if (root == NULL) {
+        // The file may be gone or half written; the old version is served until it settles.
+        fprintf(stderr, "Could not republish %s, still serving the previous version of %s\n", file->path, nameString);
+    } else {
+        CCNxManifest *current = ccnxFileRepoNameTable_AcquireRoot(watcher->table, file->name);
+        if (current == NULL || !ccnxManifest_Equals(current, root)) {
+            ccnxFileRepoNameTable_Replace(watcher->table, file->name, root);
+            printf("Republished: %s\n", nameString);
+        }
+        if (current != NULL) {
+            ccnxManifest_Release(&current);
+        }
+        ccnxManifest_Release(&root);
+    }
+
+    parcMemory_Deallocate(&nameString);
+}
+
+static void *
+_ccnxFileRepoWatcher_Run(void *context)
+{
+    CCNxFileRepoWatcher *watcher = context;
+
+    while (true) {
+        // Sleep until the next change, or until the earliest changed file is due.
+        double now = _ccnxFileRepoWatcher_Now();
+        int timeout = -1;
+        for (size_t i = 0; i < watcher->fileCount; i++) {
+            if (watcher->files[i].changed) {
+                double wait = _ccnxFileRepoWatcher_DueTime(watcher, &watcher->files[i]) - now;
+                int milliseconds = (wait > 0) ? (int) (wait * 1e3) + 1 : 0;
+                if (timeout < 0 || milliseconds < timeout) {
+                    timeout = milliseconds;
+                }
+            }
+        }
+
+        struct pollfd fds[2] = {
+            { .fd = watcher->inotifyFd, .events = POLLIN },
+            { .fd = watcher->wakeFds[0], .events = POLLIN }
+        };
+        if (poll(fds, 2, timeout) < 0 && errno != EINTR) {
+            fprintf(stderr, "Stopped watching files: %s\n", strerror(errno));
+            break;
+        }
+        if (fds[1].revents != 0) {
+            break;
+        }
+        if (fds[0].revents & POLLIN) {
+            _ccnxFileRepoWatcher_ReadEvents(watcher);
+        }
+
+        now = _ccnxFileRepoWatcher_Now();
+        for (size_t i = 0; i < watcher->fileCount; i++) {
+            _WatchedFile *file = &watcher->files[i];
+            if (file->changed && _ccnxFileRepoWatcher_DueTime(watcher, file) <= now) {
+                file->changed = false;
+                _ccnxFileRepoWatcher_Republish(watcher, file);
+            }
+        }
+    }
+    return NULL;
+}
+
+bool
+ccnxFileRepoWatcher_Start(CCNxFileRepoWatcher *watcher)
+{
+    assertFalse(watcher->running, "The watcher is already running");
+    watcher->running = pthread_create(&watcher->thread, NULL, _ccnxFileRepoWatcher_Run, watcher) == 0;
+    return watcher->running;
+}
+
+void
+ccnxFileRepoWatcher_Stop(CCNxFileRepoWatcher *watcher)
+{
+    if (watcher->running) {
+        char stop = 0;
+        if (write(watcher->wakeFds[1], &stop, 1) != 1) {
+            fprintf(stderr, "Could not wake the watcher thread: %s\n", strerror(errno));
+        }
+        pthread_join(watcher->thread, NULL);
+        watcher->running = false;
+    }
+}
@@ -0,0 +1,167 @@
+/*
+ * Copyright (c) 2016, Xerox Corporation (Xerox) and Palo Alto Research Center, Inc (PARC)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL XEROX OR PARC BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * ################################################################################
+ * #
+ * # PATENT NOTICE
+ * #
+ * # This software is distributed under the BSD 2-clause License (see LICENSE
+ * # file).  This BSD License does not make any patent claims and as such, does
+ * # not act as a patent grant.  The purpose of this section is for each contributor
+ * # to define their intentions with respect to intellectual property.
+ * #
+ * # Each contributor to this source code is encouraged to state their patent
+ * # claims and licensing mechanisms for any contributions made. At the end of
+ * # this section contributors may each make their own statements.  Contributor's
+ * # claims and grants only apply to the pieces (source code, programs, text,
+ * # media, etc) that they have contributed directly to this software.
+ * #
+ * # There is no guarantee that this section is complete, up to date or accurate. It
+ * # is up to the contributors to maintain their portion of this section and up to
+ * # the user of the software to verify any claims herein.
+ * #
+ * # Do not remove this header notification.  The contents of this section must be
+ * # present in all distributions of the software.  You may only modify your own
+ * # intellectual property statements.  Please provide contact information.
+ *
+ * - Palo Alto Research Center, Inc
+ * This software distribution does not grant any rights to patents owned by Palo
+ * Alto Research Center, Inc (PARC). Rights to these patents are available via
+ * various mechanisms. As of January 2016 PARC has committed to FRAND licensing any
+ * intellectual property used by its contributions to this software. You may
+ * contact PARC at cipo@parc.com for more information or visit http://www.ccnx.org
+ */
+/**
+ * @author Christopher A. Wood, Palo Alto Research Center (Xerox PARC)
+ * @copyright (c) 2016, Xerox Corporation (Xerox) and Palo Alto Research Center, Inc (PARC).  All rights reserved.
+ */
+
+#ifndef ccnxFileRepoWatcher_h
+#define ccnxFileRepoWatcher_h
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include <ccnx/common/ccnx_Name.h>
+
+#include "ccnxFileRepo_Cache.h"
+#include "ccnxFileRepo_NameTable.h"
+
+struct ccnx_file_repo_watcher;
+typedef struct ccnx_file_repo_watcher CCNxFileRepoWatcher;
+
+/**
+ * Create a `CCNxFileRepoWatcher`, which republishes files when they change while the
+ * server keeps answering interests.
+ *
+ * The watcher follows the directories of the watched files with inotify, so a file that is
+ * rewritten in place or replaced by a rename is noticed either way. Once a changed file has
+ * been left alone for `delay` milliseconds, or at the latest 8 times `delay` after its first
+ * change, it is published again by `ccnxFileRepoCache_PublishFile` on the watcher's own
+ * thread, and its new root manifest is swapped into the name table with
+ * `ccnxFileRepoNameTable_Replace`. Interests are never held up by either: consumers that
+ * already have the old root keep fetching its chunks, and new consumers get the new root.
+ *
+ * File watching needs inotify, so on other systems no watcher can be created.
+ *
+ * @param [in] cache The `CCNxFileRepoCache` the files are published in.
+ * @param [in] table The `CCNxFileRepoNameTable` the publications are served from.
+ * @param [in] delay Milliseconds a file must be unchanged before it is republished.
+ *
+ * @return A new `CCNxFileRepoWatcher` instance, or NULL if files cannot be watched.
+ *
+ * Example:
+ * @code
+ * {
+ *     CCNxFileRepoWatcher *watcher = ccnxFileRepoWatcher_Create(cache, table, 250);
+ *     ccnxFileRepoWatcher_Add(watcher, name, "/path/to/file");
+ *     ccnxFileRepoWatcher_Start(watcher);
+ *
+ *     // answer interests
+ *
+ *     ccnxFileRepoWatcher_Stop(watcher);
+ *     ccnxFileRepoWatcher_Release(&watcher);
+ * }
+ * @endcode
+ */
+CCNxFileRepoWatcher *ccnxFileRepoWatcher_Create(CCNxFileRepoCache *cache, CCNxFileRepoNameTable *table, size_t delay);
+
+/**
+ * Increase the number of references to a `CCNxFileRepoWatcher` instance.
+ *
+ * @param [in] instance A pointer to a valid CCNxFileRepoWatcher instance.
+ *
+ * @return The same value as @p instance.
+ */
+CCNxFileRepoWatcher *ccnxFileRepoWatcher_Acquire(const CCNxFileRepoWatcher *instance);
+
+/**
+ * Release a previously acquired reference to the given `CCNxFileRepoWatcher` instance,
+ * decrementing the reference count for the instance. The watcher is stopped first.
+ *
+ * The pointer to the instance is set to NULL as a side-effect of this function.
+ *
+ * @param [in,out] instancePtr A pointer to a pointer to the instance to release.
+ */
+void ccnxFileRepoWatcher_Release(CCNxFileRepoWatcher **instancePtr);
+
+/**
+ * Watch the file at `path`, which is published under `name` in the name table. Files are
+ * added before the watcher is started.
+ *
+ * @param [in] watcher The `CCNxFileRepoWatcher` instance.
+ * @param [in] name The name the file is published under.
+ * @param [in] path The path of the file.
+ *
+ * @return true The file is watched.
+ * @return false The directory of the file cannot be watched, e.g., because the inotify watch limit is reached.
+ */
+bool ccnxFileRepoWatcher_Add(CCNxFileRepoWatcher *watcher, const CCNxName *name, const char *path);
+
+/**
+ * Return the number of files watched.
+ *
+ * @param [in] watcher The `CCNxFileRepoWatcher` instance.
+ */
+size_t ccnxFileRepoWatcher_GetCount(const CCNxFileRepoWatcher *watcher);
+
+/**
+ * Start the thread that waits for changes and republishes the changed files.
+ *
+ * @param [in] watcher The `CCNxFileRepoWatcher` instance.
+ *
+ * @return true The watcher is running.
+ * @return false The thread could not be started.
+ */
+bool ccnxFileRepoWatcher_Start(CCNxFileRepoWatcher *watcher);
+
+/**
+ * Stop the watcher thread, after it finishes the file it may be republishing. Changes that
+ * are still waiting for their delay to pass are dropped, to be picked up when the files are
+ * next published.
+ *
+ * @param [in] watcher The `CCNxFileRepoWatcher` instance.
+ */
+void ccnxFileRepoWatcher_Stop(CCNxFileRepoWatcher *watcher);
+#endif // ccnxFileRepoWatcher_h
@@ -0,0 +1,154 @@
+/*
+ * Copyright (c) 2016, Xerox Corporation (Xerox) and Palo Alto Research Center, Inc (PARC)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL XEROX OR PARC BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * ################################################################################
+ * #
+ * # PATENT NOTICE
+ * #
+ * # This software is distributed under the BSD 2-clause License (see LICENSE
+ * # file).  This BSD License does not make any patent claims and as such, does
+ * # not act as a patent grant.  The purpose of this section is for each contributor
+ * # to define their intentions with respect to intellectual property.
+ * #
+ * # Each contributor to this source code is encouraged to state their patent
+ * # claims and licensing mechanisms for any contributions made. At the end of
+ * # this section contributors may each make their own statements.  Contributor's
+ * # claims and grants only apply to the pieces (source code, programs, text,
+ * # media, etc) that they have contributed directly to this software.
+ * #
+ * # There is no guarantee that this section is complete, up to date or accurate. It
+ * # is up to the contributors to maintain their portion of this section and up to
+ * # the user of the software to verify any claims herein.
+ * #
+ * # Do not remove this header notification.  The contents of this section must be
+ * # present in all distributions of the software.  You may only modify your own
+ * # intellectual property statements.  Please provide contact information.
+ *
+ * - Palo Alto Research Center, Inc
+ * This software distribution does not grant any rights to patents owned by Palo
+ * Alto Research Center, Inc (PARC). Rights to these patents are available via
+ * various mechanisms. As of January 2016 PARC has committed to FRAND licensing any
+ * intellectual property used by its contributions to this software. You may
+ * contact PARC at cipo@parc.com for more information or visit http://www.ccnx.org
+ */
+/**
+ * @author Christopher A. Wood, Palo Alto Research Center (Xerox PARC)
+ * @copyright (c) 2016, Xerox Corporation (Xerox) and Palo Alto Research Center, Inc (PARC).  All rights reserved.
+ */
+#include <LongBow/runtime.h>
+
+#include <pthread.h>
+
+#include <parc/algol/parc_Object.h>
+#include <parc/algol/parc_Memory.h>
+
+#include "ccnxFileRepo_Queue.h"
+#include "ccnxFileRepo_WorkerPool.h"
+
+struct ccnx_file_repo_worker_pool {
+    CCNxFileRepoQueue *queue;
+    CCNxFileRepoWorkerPoolHandler *handler;
+    void *context;
+
+    pthread_t *threads;
+    size_t threadCount;
+    bool finished;
+};
+
+static void *
+_ccnxFileRepoWorkerPool_Run(void *arg)
+{
+    CCNxFileRepoWorkerPool *pool = arg;
+
+    void *item;
+    while ((item = ccnxFileRepoQueue_Get(pool->queue)) != NULL) {
+        pool->handler(pool->context, item);
+    }
+    return NULL;
+}
+
+void
+ccnxFileRepoWorkerPool_Finish(CCNxFileRepoWorkerPool *pool)
+{
+    if (pool->finished) {
+        return;
+    }
+    pool->finished = true;
+
+    ccnxFileRepoQueue_Close(pool->queue);
+    for (size_t i = 0; i < pool->threadCount; i++) {
+        pthread_join(pool->threads[i], NULL);
+    }
+}
+
+static bool
+_ccnxFileRepoWorkerPool_Destructor(CCNxFileRepoWorkerPool **poolPtr)
+{
+    CCNxFileRepoWorkerPool *pool = *poolPtr;
+
+    ccnxFileRepoWorkerPool_Finish(pool);
+    parcMemory_Deallocate(&pool->threads);
+    ccnxFileRepoQueue_Release(&pool->queue);
+    return true;
+}
+
+parcObject_Override(CCNxFileRepoWorkerPool, PARCObject,
+                    .destructor = (PARCObjectDestructor *) _ccnxFileRepoWorkerPool_Destructor);
+
+parcObject_ImplementAcquire(ccnxFileRepoWorkerPool, CCNxFileRepoWorkerPool);
+parcObject_ImplementRelease(ccnxFileRepoWorkerPool, CCNxFileRepoWorkerPool);
+
+CCNxFileRepoWorkerPool *
+ccnxFileRepoWorkerPool_Create(size_t threadCount, size_t queueDepth, CCNxFileRepoWorkerPoolHandler *handler, void *context)
+{
+    assertTrue(threadCount > 0, "A worker pool needs at least one thread");
+
+    CCNxFileRepoWorkerPool *pool = parcObject_CreateAndClearInstance(CCNxFileRepoWorkerPool);
+    if (pool != NULL) {
+        pool->queue = ccnxFileRepoQueue_Create(queueDepth);
+        pool->handler = handler;
+        pool->context = context;
+        pool->finished = false;
+
+        pool->threads = parcMemory_Allocate(threadCount * sizeof(pthread_t));
+        assertNotNull(pool->threads, "parcMemory_Allocate(%zu) returned NULL", threadCount * sizeof(pthread_t));
+        for (pool->threadCount = 0; pool->threadCount < threadCount; pool->threadCount++) {
+            int failure = pthread_create(&pool->threads[pool->threadCount], NULL, _ccnxFileRepoWorkerPool_Run, pool);
+            assertTrue(failure == 0, "pthread_create failed: %d", failure);
+        }
+    }
+    return pool;
+}
+
+bool
+ccnxFileRepoWorkerPool_Submit(CCNxFileRepoWorkerPool *pool, void *item)
+{
+    return ccnxFileRepoQueue_Put(pool->queue, item);
+}
+
+size_t
+ccnxFileRepoWorkerPool_GetThreadCount(const CCNxFileRepoWorkerPool *pool)
+{
+    return pool->threadCount;
+}
@@ -0,0 +1,146 @@
+/*
+ * Copyright (c) 2016, Xerox Corporation (Xerox) and Palo Alto Research Center, Inc (PARC)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL XEROX OR PARC BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * ################################################################################
+ * #
+ * # PATENT NOTICE
+ * #
+ * # This software is distributed under the BSD 2-clause License (see LICENSE
+ * # file).  This BSD License does not make any patent claims and as such, does
+ * # not act as a patent grant.  The purpose of this section is for each contributor
+ * # to define their intentions with respect to intellectual property.
+ * #
+ * # Each contributor to this source code is encouraged to state their patent
+ * # claims and licensing mechanisms for any contributions made. At the end of
+ * # this section contributors may each make their own statements.  Contributor's
+ * # claims and grants only apply to the pieces (source code, programs, text,
+ * # media, etc) that they have contributed directly to this software.
+ * #
+ * # There is no guarantee that this section is complete, up to date or accurate. It
+ * # is up to the contributors to maintain their portion of this section and up to
+ * # the user of the software to verify any claims herein.
+ * #
+ * # Do not remove this header notification.  The contents of this section must be
+ * # present in all distributions of the software.  You may only modify your own
+ * # intellectual property statements.  Please provide contact information.
+ *
+ * - Palo Alto Research Center, Inc
+ * This software distribution does not grant any rights to patents owned by Palo
+ * Alto Research Center, Inc (PARC). Rights to these patents are available via
+ * various mechanisms. As of January 2016 PARC has committed to FRAND licensing any
+ * intellectual property used by its contributions to this software. You may
+ * contact PARC at cipo@parc.com for more information or visit http://www.ccnx.org
+ */
+/**
+ * @author Christopher A. Wood, Palo Alto Research Center (Xerox PARC)
+ * @copyright (c) 2016, Xerox Corporation (Xerox) and Palo Alto Research Center, Inc (PARC).  All rights reserved.
+ */
+
+#ifndef ccnxFileRepoWorkerPool_h
+#define ccnxFileRepoWorkerPool_h
+
+#include <stdbool.h>
+#include <stddef.h>
+
+struct ccnx_file_repo_worker_pool;
+typedef struct ccnx_file_repo_worker_pool CCNxFileRepoWorkerPool;
+
+/**
+ * The function run by a worker thread for each submitted item.
+ *
+ * @param [in] context The context given to `ccnxFileRepoWorkerPool_Create`.
+ * @param [in] item The submitted item.
+ */
+typedef void (CCNxFileRepoWorkerPoolHandler)(void *context, void *item);
+
+/**
+ * Create a `CCNxFileRepoWorkerPool` of `threadCount` threads that run `handler` on each
+ * submitted item. Items are handed to the threads through a `CCNxFileRepoQueue` of
+ * `queueDepth` items, so a submitter that gets ahead of the workers waits for room.
+ *
+ * @param [in] threadCount The number of worker threads, at least 1.
+ * @param [in] queueDepth The number of submitted items that may be waiting for a worker.
+ * @param [in] handler The function run for each item.
+ * @param [in] context Passed to every call of `handler`; it must outlive the pool.
+ *
+ * @return A new `CCNxFileRepoWorkerPool` instance with running threads.
+ *
+ * Example:
+ * @code
+ * {
+ *     CCNxFileRepoWorkerPool *pool = ccnxFileRepoWorkerPool_Create(4, 1024, _handleRequest, responder);
+ *     ccnxFileRepoWorkerPool_Submit(pool, request);
+ *     ccnxFileRepoWorkerPool_Finish(pool);
+ *     ccnxFileRepoWorkerPool_Release(&pool);
+ * }
+ * @endcode
+ */
+CCNxFileRepoWorkerPool *ccnxFileRepoWorkerPool_Create(size_t threadCount, size_t queueDepth,
+                                                      CCNxFileRepoWorkerPoolHandler *handler, void *context);
+
+/**
+ * Increase the number of references to a `CCNxFileRepoWorkerPool` instance.
+ *
+ * @param [in] instance A pointer to a valid CCNxFileRepoWorkerPool instance.
+ *
+ * @return The same value as @p instance.
+ */
+CCNxFileRepoWorkerPool *ccnxFileRepoWorkerPool_Acquire(const CCNxFileRepoWorkerPool *instance);
+
+/**
+ * Release a previously acquired reference to the given `CCNxFileRepoWorkerPool` instance,
+ * decrementing the reference count for the instance.
+ *
+ * Releasing the last reference finishes the pool as by `ccnxFileRepoWorkerPool_Finish`.
+ *
+ * @param [in,out] instancePtr A pointer to a pointer to the instance to release.
+ */
+void ccnxFileRepoWorkerPool_Release(CCNxFileRepoWorkerPool **instancePtr);
+
+/**
+ * Hand an item to the worker threads, waiting if `queueDepth` items are already waiting.
+ * The handler becomes responsible for the item.
+ *
+ * @param [in] pool The `CCNxFileRepoWorkerPool` instance.
+ * @param [in] item A non-NULL pointer.
+ *
+ * @return true The item was queued.
+ * @return false The pool has been finished.
+ */
+bool ccnxFileRepoWorkerPool_Submit(CCNxFileRepoWorkerPool *pool, void *item);
+
+/**
+ * Stop accepting items, let the workers handle every queued item, and wait for them to exit.
+ *
+ * @param [in] pool The `CCNxFileRepoWorkerPool` instance.
+ */
+void ccnxFileRepoWorkerPool_Finish(CCNxFileRepoWorkerPool *pool);
+
+/**
+ * Return the number of worker threads.
+ *
+ * @param [in] pool The `CCNxFileRepoWorkerPool` instance.
+ */
+size_t ccnxFileRepoWorkerPool_GetThreadCount(const CCNxFileRepoWorkerPool *pool);
+#endif // ccnxFileRepoWorkerPool_h
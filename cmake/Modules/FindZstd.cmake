@@ -0,0 +1,47 @@
+########################################
+#
+# Find the zstd libraries and includes
+# This module sets:
+#  ZSTD_FOUND: True if zstd was found
+#  ZSTD_LIBRARY:  The zstd library
+#  ZSTD_LIBRARIES:  The zstd library and dependencies
+#  ZSTD_INCLUDE_DIR:  The zstd include dir
+#
+# This module will look for the libraries in various locations
+# See the ZSTD_SEARCH_PATH_LIST for a full list.
+#
+# The caller can hint at locations using the following variables:
+#
+# ZSTD_HOME (passed as -D to cmake)
+# CCNX_DEPENDENCIES (in environment)
+# ZSTD_HOME (in environment)
+# CCNX_HOME (in environment)
+#
+
+set(ZSTD_SEARCH_PATH_LIST
+  ${ZSTD_HOME}
+  $ENV{CCNX_DEPENDENCIES}
+  $ENV{ZSTD_HOME}
+  $ENV{CCNX_HOME}
+  /usr/local/ccnx
+  /usr/local/ccn
+  /usr/local
+  /opt
+  /usr
+  )
+
+find_path(ZSTD_INCLUDE_DIR zstd.h
+  HINTS ${ZSTD_SEARCH_PATH_LIST}
+  PATH_SUFFIXES include
+  DOC "Find the zstd includes" )
+
+find_library(ZSTD_LIBRARY NAMES zstd
+  HINTS ${ZSTD_SEARCH_PATH_LIST}
+  PATH_SUFFIXES lib
+  DOC "Find the zstd libraries" )
+
+set(ZSTD_LIBRARIES ${ZSTD_LIBRARY})
+set(ZSTD_INCLUDE_DIRS ${ZSTD_INCLUDE_DIR})
+
+include(FindPackageHandleStandardArgs)
+find_package_handle_standard_args(Zstd  DEFAULT_MSG ZSTD_LIBRARY ZSTD_INCLUDE_DIR)